@@ -0,0 +1,104 @@
+/**
+	CLASS: CompactStorage
+	DESCRIPTION: Storage formats of the data a scene keeps many copies of: the matrices of the nodes (and of the intersections), the normals of the meshes
+	and the boxes of the bounding volume hierarchies. By default they are stored in full precision. Defining RAYTRACINGFRAMEWORK_COMPACT_STORAGE (for the
+	whole build) stores them in compact formats instead, for scenes that would not fit in memory otherwise:
+	- StoredMatrix: affine transformations as 3x4 matrices (48 bytes instead of 64). The last row of the matrices of the scene is always (0, 0, 0, 1).
+	- StoredNormal: half precision normals (6 bytes instead of 12, about 3 significant digits).
+	- StoredBox: boxes quantised to 16 bits per coordinate within the box of the whole hierarchy (12 bytes instead of 24). Quantised boxes are rounded
+	  outwards, so they always contain the original box (rays may visit a few more nodes, but never miss one).
+	Code converts to and from the full precision types (toMatrix/toStoredMatrix, glm::vec3(normal), StoredBox::set/getMinimum/getMaximum), so it reads
+	the same in both modes. See MemoryReport to find out where the memory goes.
+*/
+#ifndef _COMPACTSTORAGE_RAYTRACINGFRAMEWORK
+#define _COMPACTSTORAGE_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include <external\glm\gtc\packing.hpp>
+#include <stdint.h>
+#include <cmath>
+
+namespace RayTracingFramework{
+	//Quantisation grid of the boxes of a hierarchy: 65535 steps along each axis of the box of its root (unused with full precision boxes).
+	struct BoxGrid {
+		static const int STEPS = 65535;
+		glm::vec3 origin, step;
+
+		BoxGrid() : origin(0.0f), step(1.0f) { ; }
+
+		inline void set(glm::vec3 minimum, glm::vec3 maximum) {
+			origin = minimum;
+			//Steps slightly longer than needed, so the last one reaches past maximum despite rounding.
+			for (int axis = 0; axis < 3; axis++) {
+				step[axis] = (maximum[axis] > minimum[axis]) ? (maximum[axis] - minimum[axis]) / (float)STEPS * 1.0001f : 1.0f;
+				while (decode(axis, (uint16_t)STEPS) < maximum[axis])
+					step[axis] *= 2.0f;		//Tiny boxes far from the origin.
+			}
+		}
+
+		inline float decode(int axis, uint16_t value) const { return origin[axis] + (float)value * step[axis]; }
+
+		//Largest value that decodes to a coordinate <= x (and smallest one >= x, for roundUp).
+		inline uint16_t encode(int axis, float x, bool roundUp) const {
+			float position = (x - origin[axis]) / step[axis];
+			int value = (int)glm::clamp(roundUp ? std::ceil(position) : std::floor(position), 0.0f, (float)STEPS);
+			//Fix the rounding errors of the division.
+			while (!roundUp && value > 0 && decode(axis, (uint16_t)value) > x) value--;
+			while (roundUp && value < STEPS && decode(axis, (uint16_t)value) < x) value++;
+			return (uint16_t)value;
+		}
+	};
+
+	//Full precision box.
+	struct FloatBox {
+		glm::vec3 minimum, maximum;
+
+		inline void set(glm::vec3 _minimum, glm::vec3 _maximum, const BoxGrid&) { minimum = _minimum; maximum = _maximum; }
+		inline glm::vec3 getMinimum(const BoxGrid&) const { return minimum; }
+		inline glm::vec3 getMaximum(const BoxGrid&) const { return maximum; }
+	};
+
+	//Box quantised to a BoxGrid (rounded outwards). The grid must contain the box.
+	struct QuantisedBox {
+		uint16_t minimum[3], maximum[3];
+
+		inline void set(glm::vec3 _minimum, glm::vec3 _maximum, const BoxGrid& grid) {
+			for (int axis = 0; axis < 3; axis++) {
+				minimum[axis] = grid.encode(axis, _minimum[axis], false);
+				maximum[axis] = grid.encode(axis, _maximum[axis], true);
+			}
+		}
+		inline glm::vec3 getMinimum(const BoxGrid& grid) const { return glm::vec3(grid.decode(0, minimum[0]), grid.decode(1, minimum[1]), grid.decode(2, minimum[2])); }
+		inline glm::vec3 getMaximum(const BoxGrid& grid) const { return glm::vec3(grid.decode(0, maximum[0]), grid.decode(1, maximum[1]), grid.decode(2, maximum[2])); }
+	};
+
+	//Vector stored in half precision (converted from/to glm::vec3).
+	struct HalfVector3 {
+		uint16_t x, y, z;
+
+		HalfVector3() : x(0), y(0), z(0) { ; }
+		HalfVector3(glm::vec3 v) : x(glm::packHalf1x16(v.x)), y(glm::packHalf1x16(v.y)), z(glm::packHalf1x16(v.z)) { ; }
+		inline operator glm::vec3() const { return glm::vec3(glm::unpackHalf1x16(x), glm::unpackHalf1x16(y), glm::unpackHalf1x16(z)); }
+	};
+
+#ifdef RAYTRACINGFRAMEWORK_COMPACT_STORAGE
+	typedef glm::mat4x3 StoredMatrix;
+	typedef HalfVector3 StoredNormal;
+	typedef QuantisedBox StoredBox;
+#else
+	typedef glm::mat4 StoredMatrix;
+	typedef glm::vec3 StoredNormal;
+	typedef FloatBox StoredBox;
+#endif
+
+	inline glm::mat4 toMatrix(const StoredMatrix& m) { return glm::mat4(m); }
+	inline StoredMatrix toStoredMatrix(const glm::mat4& m) { return StoredMatrix(m); }
+
+	inline bool isCompactStorage() {
+#ifdef RAYTRACINGFRAMEWORK_COMPACT_STORAGE
+		return true;
+#else
+		return false;
+#endif
+	}
+};
+#endif
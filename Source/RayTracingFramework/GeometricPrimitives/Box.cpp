@@ -1,6 +1,7 @@
 #include "Box.h"
 #include "RayTracingFramework\Ray.h"
 #include "RayTracingFramework\VirtualObject\IVirtualObject.h"
+#include <algorithm>
 
 //PointA -> frontTopLeft AKA smallest x, biggest y & smallest z
 //PointB -> backBottomRight AKA biggest x, smallest y & biggest z
@@ -19,7 +20,7 @@ RayTracingFramework::Box::Box(glm::vec4 pointA, glm::vec4 pointB)
 
 bool RayTracingFramework::Box::testLocalCollision(RayTracingFramework::Ray& ray) {
 	//Transform from world coords to local (object) coordinates.
-	glm::vec4 origin_local = owner->getFromWorldToObjectCoordinates() * ray.origin_InWorldCoords;
+	glm::vec4 origin_local = owner->getFromWorldToObjectCoordinates(ray.time) * ray.origin_InWorldCoords;
 	glm::vec4 direction_local = ray.direction_InWorldCoords;
 	//Test local intersection.
 	glm::vec4 collision_Point, collision_Normal;
@@ -32,13 +33,76 @@ bool RayTracingFramework::Box::testLocalCollision(RayTracingFramework::Ray& ray)
 		i1.collidingObjectID = owner->getID();
 		i1.collisionPoint_InObjectCoords = collision_Point;
 		i1.collisionNormalVector_InObjectCoords = collision_Normal;
-		i1.fromObjectToWorldCoords = owner->getFromObjectToWorldCoordinates();
+		i1.textureCoordinates = computeTextureCoordinates(collision_Point, collision_Normal, i1.textureCoordinatesScale);
+		i1.fromObjectToWorldCoords = toStoredMatrix(owner->getFromObjectToWorldCoordinates(ray.time));
 		ray.addIntersection(i1);
 		return true;
 	}
 	return false;
 }
 
+bool RayTracingFramework::Box::getLocalBounds(glm::vec3& minimum, glm::vec3& maximum) {
+	minimum = glm::vec3(A.x, B.y, A.z);
+	maximum = glm::vec3(B.x, A.y, B.z);
+	return true;
+}
+
+bool RayTracingFramework::Box::computeHits(glm::vec4 origin, glm::vec4 direction, HitList& hits) {
+	hits.count = 0;
+	hits.startsInside = false;
+	glm::vec3 minimum, maximum;
+	getLocalBounds(minimum, maximum);
+	//Slabs: the ray is inside the box where it is between the two planes of every axis.
+	float tNear = -FLT_MAX, tFar = FLT_MAX;
+	int nearAxis = 0, farAxis = 0;
+	for (int axis = 0; axis < 3; axis++) {
+		if (direction[axis] == 0) {
+			if (origin[axis] < minimum[axis] || origin[axis] > maximum[axis])
+				return true;
+			continue;
+		}
+		float t0 = (minimum[axis] - origin[axis]) / direction[axis];
+		float t1 = (maximum[axis] - origin[axis]) / direction[axis];
+		if (t0 > t1) std::swap(t0, t1);
+		if (t0 > tNear) { tNear = t0; nearAxis = axis; }
+		if (t1 < tFar) { tFar = t1; farAxis = axis; }
+	}
+	if (tNear >= tFar)
+		return true;
+	float t[2] = { tNear, tFar };
+	int axes[2] = { nearAxis, farAxis };
+	for (int i = 0; i < 2; i++) {
+		Hit& hit = hits.hits[hits.count++];
+		hit.t = t[i];
+		hit.point = origin + t[i] * direction;
+		hit.point.w = 1;
+		//The normal of the face crossed points against the ray when entering, along it when exiting.
+		hit.normal = glm::vec4(0, 0, 0, 0);
+		hit.normal[axes[i]] = ((direction[axes[i]] > 0) == (i == 1)) ? 1.0f : -1.0f;
+		hit.textureCoordinates = computeTextureCoordinates(hit.point, hit.normal, hit.textureCoordinatesScale);
+		hit.entering = (i == 0);
+	}
+	return true;
+}
+
+glm::vec2 RayTracingFramework::Box::computeTextureCoordinates(glm::vec4 collisionPoint, glm::vec4 collisionNormal, float& scale) {
+	//Size of the box along each axis (A has the biggest y).
+	glm::vec3 size(B.x - A.x, A.y - B.y, B.z - A.z);
+	float u = (collisionPoint.x - A.x) / size.x;
+	float v = (A.y - collisionPoint.y) / size.y;
+	float w = (collisionPoint.z - A.z) / size.z;
+	if (collisionNormal.x != 0) {//Left/right faces.
+		scale = 1.0f / glm::max(size.z, size.y);
+		return glm::vec2(w, v);
+	}
+	if (collisionNormal.y != 0) {//Top/bottom faces.
+		scale = 1.0f / glm::max(size.x, size.z);
+		return glm::vec2(u, w);
+	}
+	scale = 1.0f / glm::max(size.x, size.y);//Front/back faces.
+	return glm::vec2(u, v);
+}
+
 //Check if collision with one of the box's planes actually exists within the box's spatial constraints.
 bool RayTracingFramework::Box::checkConstraint(glm::vec3 collisionPoint, Plane& faceRef) {
 	//Don't check constraint on the same axis that the plane's normal faces.
@@ -86,8 +150,10 @@ bool RayTracingFramework::Box::testRayBoxCollision(glm::vec4 origin, glm::vec4 d
 	int shortestRayIndex = -1;
 
 	//Loop through faces, testing and validating collisions.
+	//(Only faces in front of the origin count, so that rays starting inside the box find the face they leave through.)
 	for (int i = 0; i < 6; i++) {
 		if (faceRef[i].testRayPlaneCollision(origin, direction, rayLengths[i], collisionPoints[i], collisionNormals[i])
+			&& rayLengths[i] > 0
 			&& checkConstraint(collisionPoints[i], faceRef[i])
 			&& (shortestRayIndex == -1 || rayLengths[i] < rayLengths[shortestRayIndex]))
 			shortestRayIndex = i;
@@ -11,6 +11,14 @@ namespace RayTracingFramework {
 	public:
 		Box(glm::vec4 pointA, glm::vec4 pointB);
 		virtual bool testLocalCollision(RayTracingFramework::Ray& ray);
+		virtual bool computeHits(glm::vec4 origin, glm::vec4 direction, HitList& hits);
+		virtual bool getLocalBounds(glm::vec3& minimum, glm::vec3& maximum);
+		virtual size_t getMemoryBytes() { return sizeof(Box); }
+		/**
+			Box UV mapping: each face is mapped to [0,1]x[0,1] (V goes down on the side faces).
+			@param scale (Output parameter): Change of the UV coordinates per unit of length on that face.
+		*/
+		glm::vec2 computeTextureCoordinates(glm::vec4 collisionPoint, glm::vec4 collisionNormal, float& scale);
 	private:
 		bool checkConstraint(glm::vec3 collisionPoint, Plane& faceRef);
 		bool testRayBoxCollision(glm::vec4 origin, glm::vec4 direction, float& t, glm::vec4& col_P, glm::vec4& col_N);
@@ -0,0 +1,170 @@
+#include "CSGGeometry.h"
+#include "RayTracingFramework\Ray.h"
+#include "RayTracingFramework\VirtualObject\IVirtualObject.h"
+#include <algorithm>
+
+RayTracingFramework::CSGGeometry::CSGGeometry(Operation operation, IGeometry* a, IGeometry* b, glm::mat4 aToLocal, glm::mat4 bToLocal)
+	: operation(operation)
+{
+	IGeometry* geometries[2] = { a, b };
+	glm::mat4 transforms[2] = { aToLocal, bToLocal };
+	for (int c = 0; c < 2; c++) {
+		Child& child = children[c];
+		child.geometry = geometries[c];
+		child.toLocal = transforms[c];
+		child.fromLocal = glm::inverse(transforms[c]);
+		child.normalToLocal = glm::transpose(child.fromLocal);
+		//Bounding box of the transformed child: box around its 8 transformed corners.
+		glm::vec3 childMinimum, childMaximum;
+		child.bounded = child.geometry->getLocalBounds(childMinimum, childMaximum);
+		if (child.bounded) {
+			child.minimum = glm::vec3(FLT_MAX);
+			child.maximum = glm::vec3(-FLT_MAX);
+			for (int corner = 0; corner < 8; corner++) {
+				glm::vec4 p((corner & 1) ? childMaximum.x : childMinimum.x, (corner & 2) ? childMaximum.y : childMinimum.y, (corner & 4) ? childMaximum.z : childMinimum.z, 1);
+				glm::vec3 q(child.toLocal * p);
+				child.minimum = glm::min(child.minimum, q);
+				child.maximum = glm::max(child.maximum, q);
+			}
+		}
+	}
+	//Bounds of the result.
+	Child& A = children[0];
+	Child& B = children[1];
+	switch (operation) {
+	case CSG_UNION:
+		bounded = A.bounded && B.bounded;
+		minimum = glm::min(A.minimum, B.minimum);
+		maximum = glm::max(A.maximum, B.maximum);
+		break;
+	case CSG_INTERSECTION:
+		bounded = A.bounded || B.bounded;
+		minimum = !A.bounded ? B.minimum : (!B.bounded ? A.minimum : glm::max(A.minimum, B.minimum));
+		maximum = !A.bounded ? B.maximum : (!B.bounded ? A.maximum : glm::min(A.maximum, B.maximum));
+		break;
+	case CSG_DIFFERENCE:
+		bounded = A.bounded;
+		minimum = A.minimum;
+		maximum = A.maximum;
+		break;
+	}
+}
+
+RayTracingFramework::CSGGeometry::~CSGGeometry() {
+	delete children[0].geometry;
+	delete children[1].geometry;
+}
+
+bool RayTracingFramework::CSGGeometry::getLocalBounds(glm::vec3& minimum, glm::vec3& maximum) {
+	minimum = this->minimum;
+	maximum = this->maximum;
+	return bounded;
+}
+
+bool RayTracingFramework::CSGGeometry::lineHitsBox(glm::vec4 origin, glm::vec4 direction, glm::vec3 minimum, glm::vec3 maximum) {
+	float tNear = -FLT_MAX, tFar = FLT_MAX;
+	for (int axis = 0; axis < 3; axis++) {
+		if (direction[axis] == 0) {
+			if (origin[axis] < minimum[axis] || origin[axis] > maximum[axis])
+				return false;
+			continue;
+		}
+		float t0 = (minimum[axis] - origin[axis]) / direction[axis];
+		float t1 = (maximum[axis] - origin[axis]) / direction[axis];
+		if (t0 > t1) std::swap(t0, t1);
+		tNear = std::max(tNear, t0);
+		tFar = std::min(tFar, t1);
+	}
+	return tNear <= tFar;
+}
+
+void RayTracingFramework::CSGGeometry::computeChildHits(Child& child, glm::vec4 origin, glm::vec4 direction, HitList& hits) {
+	hits.count = 0;
+	hits.startsInside = false;
+	if (child.bounded && !lineHitsBox(origin, direction, child.minimum, child.maximum))
+		return;//Culled: the line never gets inside it.
+	//Hits are computed in the coordinates of the child (t does not change: the transform is affine) and brought back to ours.
+	if (!child.geometry->computeHits(child.fromLocal * origin, child.fromLocal * direction, hits)) {
+		hits.count = 0;	//Not a solid: ignored.
+		return;
+	}
+	for (int h = 0; h < hits.count; h++) {
+		hits.hits[h].point = child.toLocal * hits.hits[h].point;
+		glm::vec3 normal(child.normalToLocal * hits.hits[h].normal);
+		hits.hits[h].normal = glm::vec4(glm::normalize(normal), 0);
+	}
+}
+
+bool RayTracingFramework::CSGGeometry::isInside(bool insideA, bool insideB) {
+	switch (operation) {
+	case CSG_UNION: return insideA || insideB;
+	case CSG_INTERSECTION: return insideA && insideB;
+	default: return insideA && !insideB;
+	}
+}
+
+void RayTracingFramework::CSGGeometry::combine(HitList& a, HitList& b, HitList& result) {
+	bool insideA = a.startsInside, insideB = b.startsInside;
+	bool inside = isInside(insideA, insideB);
+	result.startsInside = inside;
+	result.count = 0;
+	//Walk both lists in order: the result has a hit wherever its inside/outside state changes.
+	int i = 0, j = 0;
+	while (i < a.count || j < b.count) {
+		bool fromA = (j >= b.count) || (i < a.count && a.hits[i].t <= b.hits[j].t);
+		const Hit& hit = fromA ? a.hits[i++] : b.hits[j++];
+		(fromA ? insideA : insideB) = hit.entering;
+		bool nowInside = isInside(insideA, insideB);
+		if (nowInside == inside)
+			continue;
+		if (result.count == HitList::MAX_HITS)
+			return;//Keep the closest ones.
+		Hit& out = result.hits[result.count++];
+		out = hit;
+		out.entering = nowInside;
+		if (!fromA && operation == CSG_DIFFERENCE)
+			out.normal = -out.normal;	//Surface of B bounding the result: its normal points into B.
+		inside = nowInside;
+	}
+}
+
+bool RayTracingFramework::CSGGeometry::computeHits(glm::vec4 origin, glm::vec4 direction, HitList& hits) {
+	HitList a, b;
+	computeChildHits(children[0], origin, direction, a);
+	if (operation != CSG_UNION && a.count == 0 && !a.startsInside) {
+		hits.count = 0;//Empty A: so are A and B, and A - B (B does not need to be tested).
+		hits.startsInside = false;
+		return true;
+	}
+	computeChildHits(children[1], origin, direction, b);
+	combine(a, b, hits);
+	return true;
+}
+
+bool RayTracingFramework::CSGGeometry::testLocalCollision(RayTracingFramework::Ray& ray) {
+	//Transform origin and direction to local coordinates (t then measures distances along the ray in world units).
+	glm::mat4 worldToObject = owner->getFromWorldToObjectCoordinates(ray.time);
+	glm::vec4 origin_local = worldToObject * ray.origin_InWorldCoords;
+	glm::vec4 direction_local = worldToObject * glm::vec4(glm::normalize(glm::vec3(ray.direction_InWorldCoords)), 0);
+	if (bounded && !lineHitsBox(origin_local, direction_local, minimum, maximum))
+		return false;
+	HitList hits;
+	computeHits(origin_local, direction_local, hits);
+	bool collided = false;
+	for (int h = 0; h < hits.count; h++) {
+		if (hits.hits[h].t <= 0)
+			continue;
+		//Every boundary in front of the ray is reported, so transparency and media tracking see all the intervals.
+		Ray::Intersection i1;
+		i1.t_distance = hits.hits[h].t;
+		i1.collidingObjectID = owner->getID();
+		i1.collisionPoint_InObjectCoords = hits.hits[h].point;
+		i1.collisionNormalVector_InObjectCoords = hits.hits[h].normal;
+		i1.textureCoordinates = hits.hits[h].textureCoordinates;
+		i1.textureCoordinatesScale = hits.hits[h].textureCoordinatesScale;
+		i1.fromObjectToWorldCoords = toStoredMatrix(owner->getFromObjectToWorldCoordinates(ray.time));
+		ray.addIntersection(i1);
+		collided = true;
+	}
+	return collided;
+}
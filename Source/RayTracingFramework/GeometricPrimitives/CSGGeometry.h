@@ -0,0 +1,51 @@
+#ifndef _CSGGEOMETRY_RAYTRACINGFRAMEWORK
+#define _CSGGEOMETRY_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include "IGeometry.h"
+
+namespace RayTracingFramework{
+	/**
+		CLASS: CSGGeometry
+		DESCRIPTION: Constructive solid geometry node: the union, intersection or difference (A - B) of two solids (any IGeometry supporting computeHits,
+		including other CSG nodes, so trees of operations can be built).
+		Each child reports all the points where the ray enters/exits it (a list of intervals, in HitList), and the intervals are combined walking both
+		lists in order of distance. Hit lists have a fixed capacity, so evaluating a node never allocates memory.
+		Children whose bounding box the ray misses are not tested (and, for intersections and differences, a miss of A skips B as well).
+		The whole node shares the material of its IVirtualObject.
+	*/
+	class CSGGeometry : public IGeometry
+	{
+	public:
+		enum Operation { CSG_UNION, CSG_INTERSECTION, CSG_DIFFERENCE };
+
+		/**
+			Combines solids a and b (deleted with the node).
+			@param aToLocal, bToLocal: Placement of each child (from the coordinates of the child to those of the node).
+		*/
+		CSGGeometry(Operation operation, IGeometry* a, IGeometry* b, glm::mat4 aToLocal = glm::mat4(1.0f), glm::mat4 bToLocal = glm::mat4(1.0f));
+		virtual ~CSGGeometry();
+
+		virtual bool testLocalCollision(RayTracingFramework::Ray& ray);
+		virtual bool computeHits(glm::vec4 origin, glm::vec4 direction, HitList& hits);
+		virtual bool getLocalBounds(glm::vec3& minimum, glm::vec3& maximum);
+		virtual size_t getMemoryBytes() { return sizeof(CSGGeometry) + children[0].geometry->getMemoryBytes() + children[1].geometry->getMemoryBytes(); }
+
+	private:
+		struct Child {
+			IGeometry* geometry;
+			glm::mat4 toLocal, fromLocal, normalToLocal;
+			bool bounded;
+			glm::vec3 minimum, maximum;		//Bounding box in the coordinates of the node.
+		};
+		Operation operation;
+		Child children[2];
+		bool bounded;
+		glm::vec3 minimum, maximum;
+
+		void computeChildHits(Child& child, glm::vec4 origin, glm::vec4 direction, HitList& hits);
+		bool isInside(bool insideA, bool insideB);
+		void combine(HitList& a, HitList& b, HitList& result);
+		static bool lineHitsBox(glm::vec4 origin, glm::vec4 direction, glm::vec3 minimum, glm::vec3 maximum);
+	};
+};
+#endif
@@ -0,0 +1,67 @@
+#include "GeometryCache.h"
+
+RayTracingFramework::GeometryCache::GeometryCache(size_t memoryBudget)
+	: memoryBudget(memoryBudget)
+	, residentBytes(0)
+	, numTessellations(0)
+	, numEvictions(0)
+	, nextGeometryID(0)
+{
+	;
+}
+
+void RayTracingFramework::GeometryCache::setMemoryBudget(size_t memoryBudget) {
+	std::lock_guard<std::mutex> lock(mutex);
+	this->memoryBudget = memoryBudget;
+	evict();
+}
+
+void RayTracingFramework::GeometryCache::clear() {
+	std::lock_guard<std::mutex> lock(mutex);
+	entries.clear();
+	residentMeshes.clear();
+	residentBytes = 0;
+}
+
+uint32_t RayTracingFramework::GeometryCache::createGeometryID() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return nextGeometryID++;
+}
+
+RayTracingFramework::GeometryCache::MeshPointer RayTracingFramework::GeometryCache::find(uint64_t key) {
+	std::lock_guard<std::mutex> lock(mutex);
+	std::unordered_map<uint64_t, std::list<Entry>::iterator>::iterator found = residentMeshes.find(key);
+	if (found == residentMeshes.end())
+		return MeshPointer();
+	//Hit: move it to the front of the list.
+	entries.splice(entries.begin(), entries, found->second);
+	return found->second->mesh;
+}
+
+RayTracingFramework::GeometryCache::MeshPointer RayTracingFramework::GeometryCache::insert(uint64_t key, TriangleMesh* mesh) {
+	MeshPointer pointer(mesh);
+	std::lock_guard<std::mutex> lock(mutex);
+	std::unordered_map<uint64_t, std::list<Entry>::iterator>::iterator found = residentMeshes.find(key);
+	if (found != residentMeshes.end()) {
+		entries.splice(entries.begin(), entries, found->second);
+		return found->second->mesh;//Tessellated twice (by two threads): keep the first one.
+	}
+	Entry entry = { key, pointer, mesh->getMemoryBytes() };
+	entries.push_front(entry);
+	residentMeshes[key] = entries.begin();
+	residentBytes += entry.bytes;
+	numTessellations++;
+	evict();
+	return pointer;
+}
+
+void RayTracingFramework::GeometryCache::evict() {
+	//Drop the least recently used meshes until we are within budget (always keeping the most recent one).
+	while (residentBytes > memoryBudget && entries.size() > 1) {
+		Entry& last = entries.back();
+		residentBytes -= last.bytes;
+		residentMeshes.erase(last.key);
+		entries.pop_back();
+		numEvictions++;
+	}
+}
@@ -0,0 +1,75 @@
+#ifndef _GEOMETRYCACHE_RAYTRACINGFRAMEWORK
+#define _GEOMETRYCACHE_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include "TriangleMesh.h"
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <stdint.h>
+
+namespace RayTracingFramework{
+	/**
+		CLASS: GeometryCache
+		DESCRIPTION: Keeps the most recently used tessellated patches of procedural geometry (see ProceduralGeometry), within a fixed memory budget.
+		When the budget is exceeded, the least recently used meshes are evicted (and tessellated again if a ray needs them later), so scenes whose
+		fully tessellated form would not fit in memory can still be rendered. Meshes are handed out as shared pointers: a mesh evicted while another
+		thread is still intersecting it is deleted when that thread is done with it.
+	*/
+	class GeometryCache
+	{
+	public:
+		typedef std::shared_ptr<const TriangleMesh> MeshPointer;
+
+		/**
+			@param memoryBudget: Maximum memory (in bytes) used by resident meshes (the most recent mesh is always kept, even if bigger).
+		*/
+		GeometryCache(size_t memoryBudget = 256 * 1024 * 1024);
+
+		/**
+			Changes the memory budget, evicting meshes if needed.
+		*/
+		void setMemoryBudget(size_t memoryBudget);
+
+		/**
+			Returns a resident mesh (marking it as the most recently used), or null.
+		*/
+		MeshPointer find(uint64_t key);
+
+		/**
+			Adds a mesh (the cache takes ownership). If another thread inserted the same key meanwhile, its mesh is kept and returned instead.
+		*/
+		MeshPointer insert(uint64_t key, TriangleMesh* mesh);
+
+		/**
+			Drops all resident meshes.
+		*/
+		void clear();
+
+		/**
+			Unique identifier for a new procedural geometry (the high 32 bits of its keys). The low 32 bits hold the level of detail (4 bits) and the patch (28 bits).
+		*/
+		uint32_t createGeometryID();
+		static inline uint64_t makeKey(uint32_t geometryID, uint32_t patch, uint32_t level = 0) { return ((uint64_t)geometryID << 32) | ((uint64_t)level << 28) | patch; }
+
+		inline size_t getResidentBytes() { return residentBytes; }
+		inline unsigned long long getNumTessellations() { return numTessellations; }
+		inline unsigned long long getNumEvictions() { return numEvictions; }
+
+	private:
+		struct Entry {
+			uint64_t key;
+			MeshPointer mesh;
+			size_t bytes;
+		};
+		std::list<Entry> entries;		//From most to least recently used.
+		std::unordered_map<uint64_t, std::list<Entry>::iterator> residentMeshes;
+		size_t memoryBudget, residentBytes;
+		unsigned long long numTessellations, numEvictions;
+		uint32_t nextGeometryID;
+		std::mutex mutex;
+
+		void evict();
+	};
+};
+#endif
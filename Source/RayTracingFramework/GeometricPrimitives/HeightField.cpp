@@ -0,0 +1,88 @@
+#include "HeightField.h"
+#include <algorithm>
+
+RayTracingFramework::HeightField::HeightField(GeometryCache& cache, HeightFunction height, glm::vec2 size, int samplesX, int samplesZ, int patchQuads)
+	: ProceduralGeometry(cache)
+	, height(height)
+	, size(size)
+	, samplesX(std::max(samplesX, 2))
+	, samplesZ(std::max(samplesZ, 2))
+	, patchQuads(std::max(patchQuads, 1))
+{
+	patchesX = (this->samplesX - 2) / this->patchQuads + 1;
+	patchesZ = (this->samplesZ - 2) / this->patchQuads + 1;
+	//Height range of each patch (its vertices are shared with the neighbours, so every sample is evaluated once per patch touching it).
+	patchMinimumHeight.assign((size_t)patchesX * patchesZ, FLT_MAX);
+	patchMaximumHeight.assign((size_t)patchesX * patchesZ, -FLT_MAX);
+	for (int pz = 0; pz < patchesZ; pz++)
+		for (int px = 0; px < patchesX; px++) {
+			int patch = pz * patchesX + px;
+			for (int j = pz * this->patchQuads; j <= std::min((pz + 1) * this->patchQuads, this->samplesZ - 1); j++)
+				for (int i = px * this->patchQuads; i <= std::min((px + 1) * this->patchQuads, this->samplesX - 1); i++) {
+					float y = height(sampleX(i), sampleZ(j));
+					patchMinimumHeight[patch] = std::min(patchMinimumHeight[patch], y);
+					patchMaximumHeight[patch] = std::max(patchMaximumHeight[patch], y);
+				}
+		}
+}
+
+int RayTracingFramework::HeightField::getNumPatches() {
+	return patchesX * patchesZ;
+}
+
+void RayTracingFramework::HeightField::getPatchBounds(int patch, glm::vec3& minimum, glm::vec3& maximum) {
+	int px = patch % patchesX, pz = patch / patchesX;
+	minimum = glm::vec3(sampleX(px * patchQuads), patchMinimumHeight[patch], sampleZ(pz * patchQuads));
+	maximum = glm::vec3(sampleX(std::min((px + 1) * patchQuads, samplesX - 1)), patchMaximumHeight[patch], sampleZ(std::min((pz + 1) * patchQuads, samplesZ - 1)));
+}
+
+int RayTracingFramework::HeightField::getNumLevels() {
+	//Down to a single quad per patch.
+	int levels = 1;
+	while ((1 << levels) <= patchQuads)
+		levels++;
+	return levels;
+}
+
+float RayTracingFramework::HeightField::getDetailSize() {
+	return std::max(size.x / (float)(samplesX - 1), size.y / (float)(samplesZ - 1));
+}
+
+void RayTracingFramework::HeightField::tessellatePatch(int patch, int level, TriangleMesh& mesh) {
+	int px = patch % patchesX, pz = patch / patchesX;
+	int i0 = px * patchQuads, i1 = std::min(i0 + patchQuads, samplesX - 1);
+	int j0 = pz * patchQuads, j1 = std::min(j0 + patchQuads, samplesZ - 1);
+	//Samples used at this level (the borders of the patch are always included).
+	int stride = 1 << level;
+	std::vector<int> columnSamples, rowSamples;
+	for (int i = i0; i < i1; i += stride)
+		columnSamples.push_back(i);
+	columnSamples.push_back(i1);
+	for (int j = j0; j < j1; j += stride)
+		rowSamples.push_back(j);
+	rowSamples.push_back(j1);
+	int columns = (int)columnSamples.size(), rows = (int)rowSamples.size();
+	mesh.positions.resize((size_t)columns * rows);
+	mesh.normals.resize(mesh.positions.size());
+	mesh.uvs.resize(mesh.positions.size());
+	float dx = size.x / (float)(samplesX - 1), dz = size.y / (float)(samplesZ - 1);
+	for (int r = 0; r < rows; r++)
+		for (int c = 0; c < columns; c++) {
+			size_t v = (size_t)r * columns + c;
+			float x = sampleX(columnSamples[c]), z = sampleZ(rowSamples[r]);
+			mesh.positions[v] = glm::vec3(x, height(x, z), z);
+			//Normal from central differences of the height function (the same on both sides of a patch border).
+			float slopeX = (height(x + dx, z) - height(x - dx, z)) / (2.0f * dx);
+			float slopeZ = (height(x, z + dz) - height(x, z - dz)) / (2.0f * dz);
+			mesh.normals[v] = glm::normalize(glm::vec3(-slopeX, 1.0f, -slopeZ));
+			mesh.uvs[v] = glm::vec2(x / size.x, z / size.y);
+		}
+	mesh.indices.reserve((size_t)(columns - 1) * (rows - 1) * 6);
+	for (int j = 0; j < rows - 1; j++)
+		for (int i = 0; i < columns - 1; i++) {
+			uint32_t a = j * columns + i, b = a + 1, c = a + columns, d = c + 1;
+			//Counter clockwise seen from above (+Y).
+			uint32_t quad[6] = { a, c, b, b, c, d };
+			mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+		}
+}
@@ -0,0 +1,46 @@
+#ifndef _HEIGHTFIELD_RAYTRACINGFRAMEWORK
+#define _HEIGHTFIELD_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include "ProceduralGeometry.h"
+#include <functional>
+#include <vector>
+
+namespace RayTracingFramework{
+	/**
+		CLASS: HeightField
+		DESCRIPTION: Terrain y = height(x, z) over the rectangle [0, size.x] x [0, size.y] of the XZ plane, sampled on a regular grid.
+		The grid is split into square patches (patchQuads x patchQuads quads), tessellated on demand (see ProceduralGeometry). Only the height range of
+		each patch is kept in memory (for its bounds); normals come from the height function itself, so they match across patches.
+		UVs map the whole rectangle to [0,1] x [0,1]. Coarser levels of detail skip samples (every 2^level-th one, plus the last sample of the patch).
+	*/
+	class HeightField : public ProceduralGeometry
+	{
+	public:
+		typedef std::function<float(float x, float z)> HeightFunction;
+
+		/**
+			@param samplesX, samplesZ: Vertices of the grid along X and Z (at least 2).
+		*/
+		HeightField(GeometryCache& cache, HeightFunction height, glm::vec2 size, int samplesX, int samplesZ, int patchQuads = 32);
+
+		virtual int getNumPatches();
+		virtual void getPatchBounds(int patch, glm::vec3& minimum, glm::vec3& maximum);
+		virtual void tessellatePatch(int patch, int level, TriangleMesh& mesh);
+		virtual int getNumLevels();
+		virtual float getDetailSize();
+		virtual size_t getMemoryBytes() {
+			return ProceduralGeometry::getMemoryBytes() + (sizeof(HeightField) - sizeof(ProceduralGeometry)) + (patchMinimumHeight.capacity() + patchMaximumHeight.capacity()) * sizeof(float);
+		}
+
+	private:
+		HeightFunction height;
+		glm::vec2 size;
+		int samplesX, samplesZ, patchQuads;
+		int patchesX, patchesZ;
+		std::vector<float> patchMinimumHeight, patchMaximumHeight;
+
+		inline float sampleX(int i) { return size.x * (float)i / (float)(samplesX - 1); }
+		inline float sampleZ(int j) { return size.y * (float)j / (float)(samplesZ - 1); }
+	};
+};
+#endif
@@ -2,6 +2,7 @@
 #define _GEOMETRY_RAYTRACINGFRAMEWORK
 #include <RayTracingFramework\RayTracingPrerequisites.h>
 #include <RayTracingFramework\VirtualObject\IVirtualObject.h>
+#include <vector>
 
 namespace RayTracingFramework{
 	/*
@@ -13,11 +14,50 @@ namespace RayTracingFramework{
 	protected:
 		IVirtualObject* owner;
 	public:
+		//A point where a ray crosses the surface of a solid (in the local coordinates of the geometry).
+		struct Hit {
+			float t;						//Parameter along the ray (point = origin + t * direction). Can be negative.
+			glm::vec4 point, normal;		//Normal points out of the solid.
+			glm::vec2 textureCoordinates;
+			float textureCoordinatesScale;
+			bool entering;					//True if the ray goes into the solid here.
+		};
+		//All the hits of a ray with a solid, sorted by t (fixed capacity: it never allocates memory). Used by constructive solid geometry (CSGGeometry).
+		struct HitList {
+			static const int MAX_HITS = 16;
+			Hit hits[MAX_HITS];
+			int count;
+			bool startsInside;				//Whether the ray is inside the solid before the first hit (t = -infinity), e.g. unbounded solids.
+			HitList() : count(0), startsInside(false) { ; }
+		};
+
 		virtual ~IGeometry() { ; }
 		inline void setOwner(IVirtualObject* _owner) {
 			owner = _owner;
 		}
 		virtual bool testLocalCollision(Ray& ray) { return false; }
+
+		/**
+			Computes all the hits of the line origin + t * direction (local coordinates, any t) with the geometry, seen as a solid.
+			Returns false if the geometry does not enclose a volume (e.g. a triangle), so it cannot be used in CSG.
+		*/
+		virtual bool computeHits(glm::vec4 origin, glm::vec4 direction, HitList& hits) { return false; }
+
+		/**
+			Axis aligned bounding box of the geometry, in its local coordinates. Returns false if it is unbounded (e.g. a plane) or unknown.
+		*/
+		virtual bool getLocalBounds(glm::vec3& minimum, glm::vec3& maximum) { return false; }
+
+		/**
+			Appends the triangles the geometry is made of (local coordinates, 3 vertices each), for code that rasterises it (see PrimaryVisibilityBuffer).
+			Returns false if it is not made of a few triangles (it is then drawn as its bounding box).
+		*/
+		virtual bool getLocalTriangles(std::vector<glm::vec3>& vertices) { return false; }
+
+		/**
+			Memory used by the geometry (the object and the data it owns). Data shared with other geometries (e.g. patches in a GeometryCache) is not included.
+		*/
+		virtual size_t getMemoryBytes() { return sizeof(IGeometry); }
 	};
 
 };
@@ -9,7 +9,7 @@ RayTracingFramework::ISphere::ISphere(float radius):radius(radius)
 
 bool RayTracingFramework::ISphere::testLocalCollision(RayTracingFramework::Ray& ray){
 	//0. Transform origin and direction coordinates to local coordinates:
-	glm::vec4 origin_local = owner->getFromWorldToObjectCoordinates() * ray.origin_InWorldCoords;
+	glm::vec4 origin_local = owner->getFromWorldToObjectCoordinates(ray.time) * ray.origin_InWorldCoords;
 	glm::vec4 direction_local = ray.direction_InWorldCoords;
 	//1. Compute intersection with sphere (compute collision point and normal). 
 	glm::vec4 collision_Point1, collision_Normal1;
@@ -26,8 +26,10 @@ bool RayTracingFramework::ISphere::testLocalCollision(RayTracingFramework::Ray&
 		i1.collidingObjectID = owner->getID();
 		i1.collisionPoint_InObjectCoords = collision_Point1;
 		i1.collisionNormalVector_InObjectCoords = collision_Normal1;
+		i1.textureCoordinates = computeTextureCoordinates(collision_Point1);
+		i1.textureCoordinatesScale = 1.0f / (3.14159265f * radius);
 		//3. To transform from local (object) coords to world coordinates 
-		i1.fromObjectToWorldCoords = owner->getFromObjectToWorldCoordinates();
+		i1.fromObjectToWorldCoords = toStoredMatrix(owner->getFromObjectToWorldCoordinates(ray.time));
 		ray.addIntersection(i1);
 		//Add second solution if existing...
 		if (numSolutions == 2) {
@@ -36,8 +38,10 @@ bool RayTracingFramework::ISphere::testLocalCollision(RayTracingFramework::Ray&
 			i1.collidingObjectID = owner->getID();
 			i1.collisionPoint_InObjectCoords = collision_Point2;
 			i1.collisionNormalVector_InObjectCoords = collision_Normal2;
+			i1.textureCoordinates = computeTextureCoordinates(collision_Point2);
+			i1.textureCoordinatesScale = 1.0f / (3.14159265f * radius);
 			//3. To transform from local (object) coords to world coordinates 
-			i1.fromObjectToWorldCoords = owner->getFromObjectToWorldCoordinates();
+			i1.fromObjectToWorldCoords = toStoredMatrix(owner->getFromObjectToWorldCoordinates(ray.time));
 			ray.addIntersection(i1);
 		}
 		return true;
@@ -45,6 +49,41 @@ bool RayTracingFramework::ISphere::testLocalCollision(RayTracingFramework::Ray&
 	return false;
 }
 
+bool RayTracingFramework::ISphere::computeHits(glm::vec4 origin, glm::vec4 direction, HitList& hits) {
+	hits.count = 0;
+	hits.startsInside = false;
+	glm::vec3 o(origin), d(direction);
+	float a = glm::dot(d, d), b = 2.0f * glm::dot(d, o), c = glm::dot(o, o) - radius * radius;
+	float discriminant = b * b - 4.0f * a * c;
+	if (discriminant <= 0.0f || a == 0.0f)//Missed, or grazing (an empty interval).
+		return true;
+	float root = glm::sqrt(discriminant);
+	float roots[2] = { (-b - root) / (2.0f * a), (-b + root) / (2.0f * a) };
+	for (int i = 0; i < 2; i++) {
+		Hit& hit = hits.hits[hits.count++];
+		hit.t = roots[i];
+		hit.point = glm::vec4(o + roots[i] * d, 1);
+		hit.normal = glm::vec4(glm::vec3(hit.point) / radius, 0);
+		hit.textureCoordinates = computeTextureCoordinates(hit.point);
+		hit.textureCoordinatesScale = 1.0f / (3.14159265f * radius);
+		hit.entering = (i == 0);
+	}
+	return true;
+}
+
+bool RayTracingFramework::ISphere::getLocalBounds(glm::vec3& minimum, glm::vec3& maximum) {
+	minimum = glm::vec3(-radius);
+	maximum = glm::vec3(radius);
+	return true;
+}
+
+glm::vec2 RayTracingFramework::ISphere::computeTextureCoordinates(glm::vec4 collisionPoint_local) {
+	const float PI = 3.14159265f;
+	float u = 0.5f + glm::atan(collisionPoint_local.z, collisionPoint_local.x) / (2.0f * PI);
+	float cosTheta = glm::clamp(collisionPoint_local.y / radius, -1.0f, 1.0f);
+	return glm::vec2(u, glm::acos(cosTheta) / PI);
+}
+
 int RayTracingFramework::ISphere::testRaySphereCollision(glm::vec4 origin_local, glm::vec4 direction_local
 	, float &t1, glm::vec4& collision_Point1, glm::vec4& collision_Normal1
 	, float &t2, glm::vec4& collision_Point2, glm::vec4& collision_Normal2) {
@@ -11,6 +11,13 @@ namespace RayTracingFramework{
 	public:
 		ISphere(float radius);
 		virtual bool testLocalCollision(RayTracingFramework::Ray& ray);
+		virtual bool computeHits(glm::vec4 origin, glm::vec4 direction, HitList& hits);
+		virtual bool getLocalBounds(glm::vec3& minimum, glm::vec3& maximum);
+		virtual size_t getMemoryBytes() { return sizeof(ISphere); }
+		/**
+			Spherical UV mapping: u follows the longitude (around the Y axis), v goes from the top (v=0) to the bottom (v=1) pole.
+		*/
+		glm::vec2 computeTextureCoordinates(glm::vec4 collisionPoint_local);
 		int testRaySphereCollision(glm::vec4 origin_local, glm::vec4 direction_local
 			, float &t1, glm::vec4& collision_Point1, glm::vec4& collision_Normal1
 			, float &t2, glm::vec4& collision_Point2, glm::vec4& collision_Normal2);
@@ -5,21 +5,24 @@
 
 bool RayTracingFramework::ITriangle::testLocalCollision(RayTracingFramework::Ray& ray){
 	//0. Transform origin and direction coordinates to local coordinates:
-	glm::vec4 origin_local = owner->getFromWorldToObjectCoordinates()*ray.origin_InWorldCoords;
+	glm::vec4 origin_local = owner->getFromWorldToObjectCoordinates(ray.time)*ray.origin_InWorldCoords;
 	glm::vec4 direction_local = ray.direction_InWorldCoords;
 	//1. Compute intersection with plane (compute collision point and normal). 
 	glm::vec4 collision_Point, collision_Normal;
 	float t;
+	glm::vec2 textureCoordinates;
 	if (testRayTriangleCollision(origin_local, direction_local
-		, t, collision_Point, collision_Normal)) {
+		, t, collision_Point, collision_Normal, textureCoordinates)) {
 		//2. Intersection! --> Add it to the result (ray).
 		Ray::Intersection i1;
 		i1.t_distance = t;
 		i1.collidingObjectID = owner->getID();
 		i1.collisionPoint_InObjectCoords = collision_Point;
 		i1.collisionNormalVector_InObjectCoords = collision_Normal;
+		i1.textureCoordinates = textureCoordinates;
+		i1.textureCoordinatesScale = textureCoordinatesScale;
 		//3. To transform from local (object) coords to world coordinates 
-		i1.fromObjectToWorldCoords = owner->getFromObjectToWorldCoordinates();
+		i1.fromObjectToWorldCoords = toStoredMatrix(owner->getFromObjectToWorldCoordinates(ray.time));
 		ray.addIntersection(i1);
 		
 		return true;
@@ -27,9 +30,38 @@ bool RayTracingFramework::ITriangle::testLocalCollision(RayTracingFramework::Ray
 	return false;
 }
 
+bool RayTracingFramework::ITriangle::getLocalBounds(glm::vec3& minimum, glm::vec3& maximum) {
+	minimum = glm::min(glm::vec3(A), glm::min(glm::vec3(B), glm::vec3(C)));
+	maximum = glm::max(glm::vec3(A), glm::max(glm::vec3(B), glm::vec3(C)));
+	return true;
+}
+
+bool RayTracingFramework::ITriangle::getLocalTriangles(std::vector<glm::vec3>& vertices) {
+	vertices.push_back(glm::vec3(A));
+	vertices.push_back(glm::vec3(B));
+	vertices.push_back(glm::vec3(C));
+	return true;
+}
+
+void RayTracingFramework::ITriangle::setTextureCoordinates(glm::vec2 _uvA, glm::vec2 _uvB, glm::vec2 _uvC) {
+	uvA = _uvA; uvB = _uvB; uvC = _uvC;
+	//Ratio between the area of the triangle in UV space and in object space (squared scale).
+	glm::vec2 uvAB = uvB - uvA, uvAC = uvC - uvA;
+	float uvArea = glm::abs(uvAB.x * uvAC.y - uvAB.y * uvAC.x);
+	float area = glm::length(glm::cross(glm::vec3(B - A), glm::vec3(C - A)));
+	textureCoordinatesScale = (area > 0) ? glm::sqrt(uvArea / area) : 0.0f;
+}
+
 bool RayTracingFramework::ITriangle::testRayTriangleCollision(glm::vec4 origin_local, glm::vec4 direction_local
 	, float &t, glm::vec4& collision_Point, glm::vec4& collision_Normal
 	) {
+	glm::vec2 textureCoordinates;
+	return testRayTriangleCollision(origin_local, direction_local, t, collision_Point, collision_Normal, textureCoordinates);
+}
+
+bool RayTracingFramework::ITriangle::testRayTriangleCollision(glm::vec4 origin_local, glm::vec4 direction_local
+	, float &t, glm::vec4& collision_Point, glm::vec4& collision_Normal, glm::vec2& textureCoordinates
+	) {
 	//Build 3x3 matrix D ... breakpoint and check
 	//Build 3x3 matrix D_t ... breakpoint and check
 	//...build also D_beta and D_sigma 
@@ -125,5 +157,8 @@ bool RayTracingFramework::ITriangle::testRayTriangleCollision(glm::vec4 origin_l
 	n = glm::normalize(n);
 	collision_Normal = glm::vec4(n, 0.0f);
 
+	//Interpolate texture coordinates (same barycentric coordinates as the collision point).
+	textureCoordinates = uvA + beta * (uvB - uvA) + gamma * (uvC - uvA);
+
 	return true;
 }
\ No newline at end of file
@@ -11,15 +11,28 @@ namespace RayTracingFramework{
 		//To represent equation system related to D*[t, beta, sigma]=Res
 		glm::mat3 D, D_t, D_beta, D_sigma;	//These is the equation system and the determinants to solve it using Cramer's rule.
 		glm::vec3 Res;
+		glm::vec2 uvA, uvB, uvC;			//Texture coordinates at each vertex.
+		float textureCoordinatesScale;
 	public:
 		ITriangle(glm::vec4 A, glm::vec4 B, glm::vec4 C)
 			: A(A)
 			, B(B)
 			, C(C)
-		{; }
+		{
+			setTextureCoordinates(glm::vec2(0, 0), glm::vec2(1, 0), glm::vec2(0, 1));
+		}
+		/**
+			Assigns UV coordinates to the vertices A, B and C (interpolated across the triangle). Default: (0,0), (1,0), (0,1).
+		*/
+		void setTextureCoordinates(glm::vec2 uvA, glm::vec2 uvB, glm::vec2 uvC);
 		virtual bool testLocalCollision(RayTracingFramework::Ray& ray);
+		virtual bool getLocalBounds(glm::vec3& minimum, glm::vec3& maximum);
+		virtual bool getLocalTriangles(std::vector<glm::vec3>& vertices);
+		virtual size_t getMemoryBytes() { return sizeof(ITriangle); }
 		bool testRayTriangleCollision(glm::vec4 origin_local, glm::vec4 direction_local
 			, float &t, glm::vec4& collision_Point, glm::vec4& collision_Normal);
+		bool testRayTriangleCollision(glm::vec4 origin_local, glm::vec4 direction_local
+			, float &t, glm::vec4& collision_Point, glm::vec4& collision_Normal, glm::vec2& textureCoordinates);
 	};
 
 };
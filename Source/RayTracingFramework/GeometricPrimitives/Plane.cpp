@@ -2,22 +2,27 @@
 #include "RayTracingFramework\Ray.h"
 #include "RayTracingFramework\VirtualObject\IVirtualObject.h"
 
-RayTracingFramework::Plane::Plane(glm::vec4 P0, glm::vec4 N)
+RayTracingFramework::Plane::Plane(glm::vec4 P0, glm::vec4 N, float textureSize)
 	: P0(P0)
 	, N(N)
 	, A(N.x)
 	, B(N.y)
 	, C(N.z)
 	, D(A*P0.x + B*P0.y +C*P0.z)	//Check slides, we compute D, so that P0 belongs to the plane.
+	, textureSize(textureSize)
 {
-	;
+	//Any pair of directions perpendicular to N (and to each other) will do as texture axes.
+	glm::vec3 normal = glm::normalize(glm::vec3(N));
+	glm::vec3 helper = (glm::abs(normal.y) < 0.99f) ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0);
+	tangent = glm::normalize(glm::cross(helper, normal));
+	bitangent = glm::cross(normal, tangent);
 }
 
 //Implementation of Test Local Collision.
 //Called by parent node via Test Collision during ray tracing collision check.
 bool RayTracingFramework::Plane::testLocalCollision(RayTracingFramework::Ray& ray){
 	//Transform origin and direction coordinates to local coordinates (Ray is described in World coordinates):
-	glm::vec4 origin_local = owner->getFromWorldToObjectCoordinates() * ray.origin_InWorldCoords;
+	glm::vec4 origin_local = owner->getFromWorldToObjectCoordinates(ray.time) * ray.origin_InWorldCoords;
 	glm::vec4 direction_local = ray.direction_InWorldCoords;
 	//1. Compute intersection with plane (compute collision point and normal). 
 	glm::vec4 collision_Point, collision_Normal;
@@ -30,14 +35,42 @@ bool RayTracingFramework::Plane::testLocalCollision(RayTracingFramework::Ray& ra
 		i1.collidingObjectID = owner->getID();
 		i1.collisionPoint_InObjectCoords = collision_Point;
 		i1.collisionNormalVector_InObjectCoords = collision_Normal;
+		i1.textureCoordinates = computeTextureCoordinates(collision_Point);
+		i1.textureCoordinatesScale = 1.0f / textureSize;
 		//3. To transform from local (object) coords to world coordinates 
-		i1.fromObjectToWorldCoords = owner->getFromObjectToWorldCoordinates();
+		i1.fromObjectToWorldCoords = toStoredMatrix(owner->getFromObjectToWorldCoordinates(ray.time));
 		ray.addIntersection(i1);
 		return true;
 	}
 	return false;
 }
 
+bool RayTracingFramework::Plane::computeHits(glm::vec4 origin, glm::vec4 direction, HitList& hits) {
+	glm::vec3 normal(N);
+	float distance = glm::dot(glm::vec3(origin - P0), normal);	//Positive: in front of the plane (outside).
+	float speed = glm::dot(glm::vec3(direction), normal);
+	hits.count = 0;
+	if (speed == 0) {//Parallel: the whole line is either inside or outside.
+		hits.startsInside = distance < 0;
+		return true;
+	}
+	Hit& hit = hits.hits[hits.count++];
+	hit.t = -distance / speed;
+	hit.point = origin + hit.t * direction;
+	hit.point.w = 1;
+	hit.normal = glm::vec4(normal, 0);
+	hit.textureCoordinates = computeTextureCoordinates(hit.point);
+	hit.textureCoordinatesScale = 1.0f / textureSize;
+	hit.entering = speed < 0;
+	hits.startsInside = !hit.entering;
+	return true;
+}
+
+glm::vec2 RayTracingFramework::Plane::computeTextureCoordinates(glm::vec4 collisionPoint_local) {
+	glm::vec3 offset = glm::vec3(collisionPoint_local - P0);
+	return glm::vec2(glm::dot(offset, tangent), glm::dot(offset, bitangent)) / textureSize;
+}
+
 bool RayTracingFramework::Plane::testRayPlaneCollision(glm::vec4 origin, glm::vec4 direction
 	, float& t, glm::vec4& col_P, glm::vec4& col_N)
 {
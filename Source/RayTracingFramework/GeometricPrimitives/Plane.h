@@ -10,9 +10,20 @@ namespace RayTracingFramework{
 		friend class Box;
 		glm::vec4 P0, N;		//Origin point and Normal vector describing the plane.
 		float A, B, C, D;		//Variables from the implicit equations. Ax + By +Cz +D=0=
+		glm::vec3 tangent, bitangent;	//Directions of the U and V texture axes (on the plane).
+		float textureSize;				//Size (in object coordinates) covered by one repetition of a texture.
 	public:
-		Plane(glm::vec4 P0, glm::vec4 N);
+		Plane(glm::vec4 P0, glm::vec4 N, float textureSize = 1.0f);
 		virtual bool testLocalCollision(RayTracingFramework::Ray& ray);
+		/**
+			As a solid, a plane is the half space behind it (opposite to N).
+		*/
+		virtual bool computeHits(glm::vec4 origin, glm::vec4 direction, HitList& hits);
+		virtual size_t getMemoryBytes() { return sizeof(Plane); }
+		/**
+			Planar UV mapping: coordinates along the tangent/bitangent of the plane (measured from P0), divided by textureSize.
+		*/
+		glm::vec2 computeTextureCoordinates(glm::vec4 collisionPoint_local);
 	private: 
 		/**
 			Computes a collision of a ray (in coords local to the plane) with the plane
@@ -0,0 +1,164 @@
+#include "ProceduralGeometry.h"
+#include "RayTracingFramework\Ray.h"
+#include "RayTracingFramework\VirtualObject\IVirtualObject.h"
+#include <algorithm>
+#include <cmath>
+
+RayTracingFramework::ProceduralGeometry::ProceduralGeometry(GeometryCache& cache)
+	: cache(cache)
+{
+	geometryID = cache.createGeometryID();
+}
+
+RayTracingFramework::ProceduralGeometry::~ProceduralGeometry() {
+	;
+}
+
+void RayTracingFramework::ProceduralGeometry::buildHierarchy() {
+	//Built on first use (the patches are described by the subclass, which is not constructed yet in our constructor).
+	int numPatches = getNumPatches();
+	if (numPatches <= 0)
+		return;
+	std::vector<glm::vec3> minimums(numPatches), maximums(numPatches);
+	patchOrder.resize(numPatches);
+	for (int p = 0; p < numPatches; p++) {
+		getPatchBounds(p, minimums[p], maximums[p]);
+		patchOrder[p] = p;
+	}
+	Node root = { glm::vec3(0.0f), glm::vec3(0.0f), 0, numPatches };
+	nodes.push_back(root);
+	subdivide(0, minimums, maximums);
+}
+
+void RayTracingFramework::ProceduralGeometry::subdivide(int node, std::vector<glm::vec3>& minimums, std::vector<glm::vec3>& maximums) {
+	int first = nodes[node].first, count = nodes[node].count;
+	glm::vec3 minimum(FLT_MAX), maximum(-FLT_MAX);
+	for (int i = first; i < first + count; i++) {
+		minimum = glm::min(minimum, minimums[patchOrder[i]]);
+		maximum = glm::max(maximum, maximums[patchOrder[i]]);
+	}
+	nodes[node].minimum = minimum;
+	nodes[node].maximum = maximum;
+	if (count == 1)
+		return;
+	//Split at the median patch centre along the longest axis.
+	glm::vec3 extent = maximum - minimum;
+	int axis = (extent.x > extent.y && extent.x > extent.z) ? 0 : (extent.y > extent.z ? 1 : 2);
+	int half = count / 2;
+	std::nth_element(patchOrder.begin() + first, patchOrder.begin() + first + half, patchOrder.begin() + first + count,
+		[&minimums, &maximums, axis](int a, int b) { return minimums[a][axis] + maximums[a][axis] < minimums[b][axis] + maximums[b][axis]; });
+	int left = (int)nodes.size();
+	Node children[2] = { { minimum, maximum, first, half }, { minimum, maximum, first + half, count - half } };
+	nodes.push_back(children[0]);
+	nodes.push_back(children[1]);
+	nodes[node].first = left;
+	nodes[node].count = 0;
+	subdivide(left, minimums, maximums);
+	subdivide(left + 1, minimums, maximums);
+}
+
+bool RayTracingFramework::ProceduralGeometry::getLocalBounds(glm::vec3& minimum, glm::vec3& maximum) {
+	std::call_once(hierarchyBuilt, &ProceduralGeometry::buildHierarchy, this);
+	if (nodes.empty())
+		return false;
+	minimum = nodes[0].minimum;
+	maximum = nodes[0].maximum;
+	return true;
+}
+
+RayTracingFramework::GeometryCache::MeshPointer RayTracingFramework::ProceduralGeometry::getPatchMesh(int patch, int level) {
+	uint64_t key = GeometryCache::makeKey(geometryID, (uint32_t)patch, (uint32_t)level);
+	GeometryCache::MeshPointer mesh = cache.find(key);
+	if (mesh)
+		return mesh;
+	//Tessellate outside the lock of the cache, so other threads keep rendering meanwhile.
+	TriangleMesh* tessellated = new TriangleMesh();
+	tessellatePatch(patch, level, *tessellated);
+	tessellated->buildBVH();
+	return cache.insert(key, tessellated);
+}
+
+bool RayTracingFramework::ProceduralGeometry::hitsBox(const Node& node, glm::vec3 origin, glm::vec3 inverseDirection, float tMax, float& tNear) {
+	glm::vec3 t0 = (node.minimum - origin) * inverseDirection;
+	glm::vec3 t1 = (node.maximum - origin) * inverseDirection;
+	glm::vec3 tSmall = glm::min(t0, t1), tBig = glm::max(t0, t1);
+	tNear = std::max(std::max(tSmall.x, tSmall.y), std::max(tSmall.z, 0.0f));
+	float tFar = std::min(std::min(tBig.x, tBig.y), std::min(tBig.z, tMax));
+	return tNear <= tFar;
+}
+
+int RayTracingFramework::ProceduralGeometry::selectLevel(const Ray& ray, float t, float localScale) {
+	int numLevels = std::min(getNumLevels(), 16);
+	float detailSize = getDetailSize();
+	if (numLevels <= 1 || detailSize <= 0 || !ray.differentials.valid)
+		return 0;
+	//Footprint of the pixel at distance t (world units), in local units.
+	float footprint = ray.differentials.getWidth(t) * localScale;
+	//Edges of level L are about detailSize * 2^L long.
+	int level = 0;
+	while (level + 1 < numLevels && detailSize * (float)(2 << level) <= footprint)
+		level++;
+	return level;
+}
+
+bool RayTracingFramework::ProceduralGeometry::testLocalCollision(RayTracingFramework::Ray& ray) {
+	std::call_once(hierarchyBuilt, &ProceduralGeometry::buildHierarchy, this);
+	if (nodes.empty())
+		return false;
+	//Transform origin and direction to local coordinates (t then measures distances along the ray in world units).
+	glm::mat4 worldToObject = owner->getFromWorldToObjectCoordinates(ray.time);
+	glm::vec3 origin(worldToObject * ray.origin_InWorldCoords);
+	glm::vec3 direction(worldToObject * glm::vec4(glm::normalize(glm::vec3(ray.direction_InWorldCoords)), 0));
+	//Axis parallel directions: a huge (not infinite) inverse, so that 0 * inverse never gives NaN in the box tests.
+	glm::vec3 inverseDirection;
+	for (int axis = 0; axis < 3; axis++)
+		inverseDirection[axis] = 1.0f / ((std::abs(direction[axis]) > 1e-20f) ? direction[axis] : 1e-20f);
+	//Level of detail for this ray (from its footprint where it enters the object; direction has the length of a world unit in local units).
+	float tNear;
+	if (!hitsBox(nodes[0], origin, inverseDirection, FLT_MAX, tNear))
+		return false;
+	int level = selectLevel(ray, tNear, glm::length(direction));
+	//Front to back traversal of the patches: a patch is only tessellated if its box is closer than the closest hit so far.
+	int stack[64];
+	int top = 0;
+	stack[top++] = 0;
+	Hit closest = Hit(), hit;
+	closest.t = FLT_MAX;
+	while (top > 0) {
+		const Node& node = nodes[stack[--top]];
+		if (!hitsBox(node, origin, inverseDirection, closest.t, tNear))
+			continue;
+		if (node.count > 0) {
+			for (int i = node.first; i < node.first + node.count; i++) {
+				GeometryCache::MeshPointer mesh = getPatchMesh(patchOrder[i], level);
+				if (mesh->intersect(origin, direction, closest.t, hit))
+					closest = hit;
+			}
+			continue;
+		}
+		float tLeft, tRight;
+		bool hitLeft = hitsBox(nodes[node.first], origin, inverseDirection, closest.t, tLeft);
+		bool hitRight = hitsBox(nodes[node.first + 1], origin, inverseDirection, closest.t, tRight);
+		if (hitLeft && hitRight) {
+			bool leftFirst = tLeft <= tRight;
+			stack[top++] = leftFirst ? node.first + 1 : node.first;
+			stack[top++] = leftFirst ? node.first : node.first + 1;
+		}
+		else if (hitLeft)
+			stack[top++] = node.first;
+		else if (hitRight)
+			stack[top++] = node.first + 1;
+	}
+	if (closest.t == FLT_MAX)
+		return false;
+	Ray::Intersection i1;
+	i1.t_distance = closest.t;
+	i1.collidingObjectID = owner->getID();
+	i1.collisionPoint_InObjectCoords = closest.point;
+	i1.collisionNormalVector_InObjectCoords = closest.normal;
+	i1.textureCoordinates = closest.textureCoordinates;
+	i1.textureCoordinatesScale = closest.textureCoordinatesScale;
+	i1.fromObjectToWorldCoords = toStoredMatrix(owner->getFromObjectToWorldCoordinates(ray.time));
+	ray.addIntersection(i1);
+	return true;
+}
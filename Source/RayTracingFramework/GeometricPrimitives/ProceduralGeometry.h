@@ -0,0 +1,72 @@
+#ifndef _PROCEDURALGEOMETRY_RAYTRACINGFRAMEWORK
+#define _PROCEDURALGEOMETRY_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include "IGeometry.h"
+#include "GeometryCache.h"
+#include <vector>
+#include <mutex>
+
+namespace RayTracingFramework{
+	/**
+		CLASS: ProceduralGeometry
+		DESCRIPTION: Base class of geometry generated on demand (heightfields, subdivision surfaces, displaced surfaces...), split into patches with known bounds.
+		A patch is tessellated into a TriangleMesh only the first time a ray enters its bounding box, and stored in a GeometryCache (shared by all procedural
+		objects), which evicts the least recently used patches when it is full. Patches are visited front to back (with a hierarchy of their boxes),
+		so patches hidden behind closer hits are never tessellated: only the visible parts of the geometry cost time and memory.
+		Subclasses describe the patches: their number, their (conservative) bounds and how to tessellate each of them.
+		LEVEL OF DETAIL: Subclasses can also tessellate their patches more coarsely (level 0 is the full detail, each level doubles the length of the edges).
+		Rays with differentials (see RayDifferentials) use the coarsest level whose triangles are not larger than the footprint of their pixel. The level is chosen
+		once per ray and object (where the ray enters its bounds), so that each ray sees a closed surface (patches of different levels may not match at their borders).
+	*/
+	class ProceduralGeometry : public IGeometry
+	{
+	public:
+		ProceduralGeometry(GeometryCache& cache);
+		virtual ~ProceduralGeometry();
+
+		virtual bool testLocalCollision(RayTracingFramework::Ray& ray);
+		virtual bool getLocalBounds(glm::vec3& minimum, glm::vec3& maximum);
+		/**
+			Hierarchy of the patches (subclasses add their own data). Tessellated patches are charged to the GeometryCache.
+		*/
+		virtual size_t getMemoryBytes() { return sizeof(ProceduralGeometry) + nodes.capacity() * sizeof(Node) + patchOrder.capacity() * sizeof(int); }
+
+		virtual int getNumPatches() = 0;
+		/**
+			Box containing all the triangles tessellatePatch will generate for the patch.
+		*/
+		virtual void getPatchBounds(int patch, glm::vec3& minimum, glm::vec3& maximum) = 0;
+		/**
+			Fills mesh with the triangles of the patch at a level of detail (called concurrently from several threads: it must not modify the geometry).
+		*/
+		virtual void tessellatePatch(int patch, int level, TriangleMesh& mesh) = 0;
+
+		//Number of levels of detail (1: the patches are always tessellated at full detail).
+		virtual int getNumLevels() { return 1; }
+		//Typical length of the edges of the triangles at level 0 (local coordinates).
+		virtual float getDetailSize() { return 0.0f; }
+
+		/**
+			Tessellated patch, from the cache (tessellated and inserted if it is not resident). Each level of a patch is cached separately.
+		*/
+		GeometryCache::MeshPointer getPatchMesh(int patch, int level = 0);
+
+	private:
+		struct Node {
+			glm::vec3 minimum, maximum;
+			int first;		//Leaf: first patch (in patchOrder). Inner node: first child.
+			int count;		//Patches of a leaf (0 for inner nodes).
+		};
+		GeometryCache& cache;
+		uint32_t geometryID;
+		std::vector<Node> nodes;
+		std::vector<int> patchOrder;
+		std::once_flag hierarchyBuilt;
+
+		void buildHierarchy();
+		void subdivide(int node, std::vector<glm::vec3>& minimums, std::vector<glm::vec3>& maximums);
+		static bool hitsBox(const Node& node, glm::vec3 origin, glm::vec3 inverseDirection, float tMax, float& tNear);
+		int selectLevel(const Ray& ray, float t, float localScale);
+	};
+};
+#endif
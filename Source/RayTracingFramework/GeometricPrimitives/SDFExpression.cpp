@@ -0,0 +1,278 @@
+#include "SDFExpression.h"
+#include <cmath>
+#include <algorithm>
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define SDFEXPRESSION_USE_SSE
+#include <emmintrin.h>
+#endif
+
+namespace {
+	const float MANDELBULB_RADIUS = 1.25f;
+
+	float smoothMinimum(float a, float b, float k) {
+		//Polynomial smooth minimum: never more than k/4 below min(a, b).
+		float h = glm::clamp(0.5f + 0.5f * (b - a) / k, 0.0f, 1.0f);
+		return b + (a - b) * h - k * h * (1.0f - h);
+	}
+
+	float mandelbulb(glm::vec3 p, float power, int iterations) {
+		glm::vec3 z = p;
+		float dr = 1.0f, r = 0.0f;
+		for (int i = 0; i < iterations; i++) {
+			r = glm::length(z);
+			if (r > 2.0f)
+				break;
+			if (r < 1e-6f)
+				return -1e-3f;//Centre of the set.
+			float theta = std::acos(glm::clamp(z.z / r, -1.0f, 1.0f)) * power;
+			float phi = std::atan2(z.y, z.x) * power;
+			float zr = std::pow(r, power);
+			dr = std::pow(r, power - 1.0f) * power * dr + 1.0f;
+			z = zr * glm::vec3(std::sin(theta) * std::cos(phi), std::sin(phi) * std::sin(theta), std::cos(theta)) + p;
+		}
+		r = glm::length(z);
+		return 0.5f * std::log(r) * r / dr;
+	}
+
+#ifdef SDFEXPRESSION_USE_SSE
+	inline __m128 absolute(__m128 v) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), v); }
+	inline __m128 length3(__m128 x, __m128 y, __m128 z) { return _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z))); }
+
+	//Box of half size (bx, by, bz) centred at the origin.
+	inline __m128 box4(__m128 x, __m128 y, __m128 z, const float* b) {
+		__m128 zero = _mm_setzero_ps();
+		__m128 qx = _mm_sub_ps(absolute(x), _mm_set1_ps(b[0]));
+		__m128 qy = _mm_sub_ps(absolute(y), _mm_set1_ps(b[1]));
+		__m128 qz = _mm_sub_ps(absolute(z), _mm_set1_ps(b[2]));
+		__m128 outside = length3(_mm_max_ps(qx, zero), _mm_max_ps(qy, zero), _mm_max_ps(qz, zero));
+		__m128 inside = _mm_min_ps(_mm_max_ps(qx, _mm_max_ps(qy, qz)), zero);
+		return _mm_add_ps(outside, inside);
+	}
+#endif
+};
+
+RayTracingFramework::SDFExpression::SDFExpression() { ; }
+
+void RayTracingFramework::SDFExpression::addPrimitive(Opcode opcode, const float* parameters, glm::mat4 placement, glm::vec3 localHalfSize) {
+	Instruction instruction;
+	instruction.opcode = opcode;
+	for (int i = 0; i < 4; i++)
+		instruction.parameters[i] = parameters[i];
+	glm::mat4 toPrimitive = glm::inverse(placement);
+	for (int row = 0; row < 3; row++)
+		for (int column = 0; column < 4; column++)
+			instruction.toPrimitive[4 * row + column] = toPrimitive[column][row];
+	instruction.scale = glm::length(glm::vec3(placement[0]));
+	//Bounds: box around the 8 placed corners of the local box.
+	instruction.boundsMinimum = glm::vec3(FLT_MAX);
+	instruction.boundsMaximum = glm::vec3(-FLT_MAX);
+	for (int corner = 0; corner < 8; corner++) {
+		glm::vec4 p((corner & 1) ? localHalfSize.x : -localHalfSize.x, (corner & 2) ? localHalfSize.y : -localHalfSize.y, (corner & 4) ? localHalfSize.z : -localHalfSize.z, 1);
+		glm::vec3 q(placement * p);
+		instruction.boundsMinimum = glm::min(instruction.boundsMinimum, q);
+		instruction.boundsMaximum = glm::max(instruction.boundsMaximum, q);
+	}
+	instructions.push_back(instruction);
+}
+
+void RayTracingFramework::SDFExpression::addSphere(float radius, glm::mat4 placement) {
+	float parameters[4] = { radius, 0, 0, 0 };
+	addPrimitive(SDF_SPHERE, parameters, placement, glm::vec3(radius));
+}
+
+void RayTracingFramework::SDFExpression::addBox(glm::vec3 halfSize, glm::mat4 placement) {
+	float parameters[4] = { halfSize.x, halfSize.y, halfSize.z, 0 };
+	addPrimitive(SDF_BOX, parameters, placement, halfSize);
+}
+
+void RayTracingFramework::SDFExpression::addRoundedBox(glm::vec3 halfSize, float cornerRadius, glm::mat4 placement) {
+	//Stored as the inner box (shrunk by the radius) plus the radius.
+	float parameters[4] = { halfSize.x - cornerRadius, halfSize.y - cornerRadius, halfSize.z - cornerRadius, cornerRadius };
+	addPrimitive(SDF_ROUNDED_BOX, parameters, placement, halfSize);
+}
+
+void RayTracingFramework::SDFExpression::addTorus(float majorRadius, float minorRadius, glm::mat4 placement) {
+	float parameters[4] = { majorRadius, minorRadius, 0, 0 };
+	addPrimitive(SDF_TORUS, parameters, placement, glm::vec3(majorRadius + minorRadius, minorRadius, majorRadius + minorRadius));
+}
+
+void RayTracingFramework::SDFExpression::addMandelbulb(float power, int iterations, glm::mat4 placement) {
+	float parameters[4] = { power, (float)iterations, 0, 0 };
+	addPrimitive(SDF_MANDELBULB, parameters, placement, glm::vec3(MANDELBULB_RADIUS));
+}
+
+void RayTracingFramework::SDFExpression::addOperation(Opcode operation, float smoothness) {
+	Instruction instruction;
+	instruction.opcode = operation;
+	instruction.parameters[0] = (smoothness > 0) ? smoothness : 1e-6f;
+	instruction.parameters[1] = instruction.parameters[2] = instruction.parameters[3] = 0;
+	instructions.push_back(instruction);
+}
+
+bool RayTracingFramework::SDFExpression::isValid() {
+	int depth = 0;
+	for (size_t i = 0; i < instructions.size(); i++) {
+		if (instructions[i].opcode < SDF_UNION) {
+			if (++depth > MAX_STACK_DEPTH)
+				return false;
+		}
+		else if (--depth < 1)
+			return false;
+	}
+	return depth == 1;
+}
+
+bool RayTracingFramework::SDFExpression::getBounds(glm::vec3& minimum, glm::vec3& maximum) {
+	if (!isValid())
+		return false;
+	glm::vec3 minimums[MAX_STACK_DEPTH], maximums[MAX_STACK_DEPTH];
+	int top = -1;
+	for (size_t i = 0; i < instructions.size(); i++) {
+		const Instruction& instruction = instructions[i];
+		if (instruction.opcode < SDF_UNION) {
+			top++;
+			minimums[top] = instruction.boundsMinimum;
+			maximums[top] = instruction.boundsMaximum;
+			continue;
+		}
+		glm::vec3 &aMinimum = minimums[top - 1], &aMaximum = maximums[top - 1];
+		glm::vec3 &bMinimum = minimums[top], &bMaximum = maximums[top];
+		switch (instruction.opcode) {
+		case SDF_INTERSECTION:
+			aMinimum = glm::max(aMinimum, bMinimum);
+			aMaximum = glm::min(aMaximum, bMaximum);
+			break;
+		case SDF_SUBTRACTION:
+			break;//Within A.
+		default:
+			//Union; the smooth union can grow up to k/4 beyond both.
+			float margin = (instruction.opcode == SDF_SMOOTH_UNION) ? 0.25f * instruction.parameters[0] : 0.0f;
+			aMinimum = glm::min(aMinimum, bMinimum) - glm::vec3(margin);
+			aMaximum = glm::max(aMaximum, bMaximum) + glm::vec3(margin);
+			break;
+		}
+		top--;
+	}
+	minimum = minimums[0];
+	maximum = maximums[0];
+	return glm::all(glm::lessThanEqual(minimum, maximum));
+}
+
+float RayTracingFramework::SDFExpression::evaluatePrimitive(const Instruction& instruction, glm::vec3 p) {
+	const float* m = instruction.toPrimitive;
+	glm::vec3 q(m[0] * p.x + m[1] * p.y + m[2] * p.z + m[3], m[4] * p.x + m[5] * p.y + m[6] * p.z + m[7], m[8] * p.x + m[9] * p.y + m[10] * p.z + m[11]);
+	const float* parameters = instruction.parameters;
+	float distance;
+	switch (instruction.opcode) {
+	case SDF_SPHERE:
+		distance = glm::length(q) - parameters[0];
+		break;
+	case SDF_BOX:
+	case SDF_ROUNDED_BOX: {
+		glm::vec3 d = glm::abs(q) - glm::vec3(parameters[0], parameters[1], parameters[2]);
+		distance = glm::length(glm::max(d, glm::vec3(0.0f))) + glm::min(glm::max(d.x, glm::max(d.y, d.z)), 0.0f);
+		if (instruction.opcode == SDF_ROUNDED_BOX)
+			distance -= parameters[3];
+		break;
+	}
+	case SDF_TORUS: {
+		glm::vec2 d(glm::length(glm::vec2(q.x, q.z)) - parameters[0], q.y);
+		distance = glm::length(d) - parameters[1];
+		break;
+	}
+	default:
+		distance = mandelbulb(q, parameters[0], (int)parameters[1]);
+		break;
+	}
+	return instruction.scale * distance;
+}
+
+float RayTracingFramework::SDFExpression::evaluate(glm::vec3 p) {
+	float stack[MAX_STACK_DEPTH];
+	int top = -1;
+	for (size_t i = 0; i < instructions.size(); i++) {
+		const Instruction& instruction = instructions[i];
+		if (instruction.opcode < SDF_UNION) {
+			stack[++top] = evaluatePrimitive(instruction, p);
+			continue;
+		}
+		float a = stack[top - 1], b = stack[top];
+		switch (instruction.opcode) {
+		case SDF_UNION: a = std::min(a, b); break;
+		case SDF_INTERSECTION: a = std::max(a, b); break;
+		case SDF_SUBTRACTION: a = std::max(a, -b); break;
+		default: a = smoothMinimum(a, b, instruction.parameters[0]); break;
+		}
+		stack[--top] = a;
+	}
+	return (top == 0) ? stack[0] : FLT_MAX;
+}
+
+void RayTracingFramework::SDFExpression::evaluate4(const float* x, const float* y, const float* z, float* distances) {
+#ifdef SDFEXPRESSION_USE_SSE
+	__m128 stack[MAX_STACK_DEPTH];
+	int top = -1;
+	__m128 px = _mm_loadu_ps(x), py = _mm_loadu_ps(y), pz = _mm_loadu_ps(z);
+	__m128 zero = _mm_setzero_ps();
+	for (size_t i = 0; i < instructions.size(); i++) {
+		const Instruction& instruction = instructions[i];
+		const float* parameters = instruction.parameters;
+		if (instruction.opcode >= SDF_UNION) {
+			__m128 a = stack[top - 1], b = stack[top];
+			switch (instruction.opcode) {
+			case SDF_UNION: a = _mm_min_ps(a, b); break;
+			case SDF_INTERSECTION: a = _mm_max_ps(a, b); break;
+			case SDF_SUBTRACTION: a = _mm_max_ps(a, _mm_xor_ps(b, _mm_set1_ps(-0.0f))); break;
+			default: {
+				__m128 k = _mm_set1_ps(parameters[0]);
+				__m128 h = _mm_add_ps(_mm_set1_ps(0.5f), _mm_div_ps(_mm_mul_ps(_mm_set1_ps(0.5f), _mm_sub_ps(b, a)), k));
+				h = _mm_min_ps(_mm_max_ps(h, zero), _mm_set1_ps(1.0f));
+				__m128 blend = _mm_add_ps(b, _mm_mul_ps(_mm_sub_ps(a, b), h));
+				a = _mm_sub_ps(blend, _mm_mul_ps(_mm_mul_ps(k, h), _mm_sub_ps(_mm_set1_ps(1.0f), h)));
+				break;
+			}
+			}
+			stack[--top] = a;
+			continue;
+		}
+		//Points in the coordinates of the primitive.
+		const float* m = instruction.toPrimitive;
+		__m128 qx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[0]), px), _mm_mul_ps(_mm_set1_ps(m[1]), py)), _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[2]), pz), _mm_set1_ps(m[3])));
+		__m128 qy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[4]), px), _mm_mul_ps(_mm_set1_ps(m[5]), py)), _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[6]), pz), _mm_set1_ps(m[7])));
+		__m128 qz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[8]), px), _mm_mul_ps(_mm_set1_ps(m[9]), py)), _mm_add_ps(_mm_mul_ps(_mm_set1_ps(m[10]), pz), _mm_set1_ps(m[11])));
+		__m128 distance;
+		switch (instruction.opcode) {
+		case SDF_SPHERE:
+			distance = _mm_sub_ps(length3(qx, qy, qz), _mm_set1_ps(parameters[0]));
+			break;
+		case SDF_BOX:
+			distance = box4(qx, qy, qz, parameters);
+			break;
+		case SDF_ROUNDED_BOX:
+			distance = _mm_sub_ps(box4(qx, qy, qz, parameters), _mm_set1_ps(parameters[3]));
+			break;
+		case SDF_TORUS: {
+			__m128 radial = _mm_sub_ps(_mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(qx, qx), _mm_mul_ps(qz, qz))), _mm_set1_ps(parameters[0]));
+			distance = _mm_sub_ps(_mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(radial, radial), _mm_mul_ps(qy, qy))), _mm_set1_ps(parameters[1]));
+			break;
+		}
+		default: {
+			//The fractal iteration has data dependent exits: evaluated one lane at a time.
+			float lx[4], ly[4], lz[4], ld[4];
+			_mm_storeu_ps(lx, qx);
+			_mm_storeu_ps(ly, qy);
+			_mm_storeu_ps(lz, qz);
+			for (int lane = 0; lane < 4; lane++)
+				ld[lane] = mandelbulb(glm::vec3(lx[lane], ly[lane], lz[lane]), parameters[0], (int)parameters[1]);
+			distance = _mm_loadu_ps(ld);
+			break;
+		}
+		}
+		stack[++top] = _mm_mul_ps(distance, _mm_set1_ps(instruction.scale));
+	}
+	_mm_storeu_ps(distances, (top == 0) ? stack[0] : _mm_set1_ps(FLT_MAX));
+#else
+	for (int lane = 0; lane < 4; lane++)
+		distances[lane] = evaluate(glm::vec3(x[lane], y[lane], z[lane]));
+#endif
+}
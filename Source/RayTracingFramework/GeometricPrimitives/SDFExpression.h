@@ -0,0 +1,69 @@
+#ifndef _SDFEXPRESSION_RAYTRACINGFRAMEWORK
+#define _SDFEXPRESSION_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include <vector>
+
+namespace RayTracingFramework{
+	/**
+		CLASS: SDFExpression
+		DESCRIPTION: Signed distance function (negative inside) built by composing primitives (spheres, boxes, rounded boxes, tori, Mandelbulb fractals)
+		with CSG style operations (union, intersection, subtraction and smooth union, e.g. for metaballs).
+		The expression tree is flattened into a list of instructions in postfix order (each primitive pushes a distance, each operation pops two
+		and pushes one), evaluated with a small fixed size stack: no recursion, no virtual calls, no allocations.
+		evaluate4 evaluates 4 points at once, with SSE instructions when available (used for normals, which need exactly 4 evaluations, and to build grids).
+		Distances must not overestimate the true distance (sphere tracing relies on it), so primitive placements must be rigid transforms,
+		optionally with a uniform scale.
+	*/
+	class SDFExpression
+	{
+	public:
+		enum Opcode { SDF_SPHERE, SDF_BOX, SDF_ROUNDED_BOX, SDF_TORUS, SDF_MANDELBULB, SDF_UNION, SDF_INTERSECTION, SDF_SUBTRACTION, SDF_SMOOTH_UNION };
+		static const int MAX_STACK_DEPTH = 16;
+
+		SDFExpression();
+
+		//Primitives (centred at the origin of their placement):
+		void addSphere(float radius, glm::mat4 placement = glm::mat4(1.0f));
+		void addBox(glm::vec3 halfSize, glm::mat4 placement = glm::mat4(1.0f));
+		void addRoundedBox(glm::vec3 halfSize, float cornerRadius, glm::mat4 placement = glm::mat4(1.0f));
+		void addTorus(float majorRadius, float minorRadius, glm::mat4 placement = glm::mat4(1.0f));		//Around the Y axis.
+		/**
+			Mandelbulb fractal (distance estimate), about 1.2 units in radius.
+		*/
+		void addMandelbulb(float power = 8.0f, int iterations = 8, glm::mat4 placement = glm::mat4(1.0f));
+
+		/**
+			Combines the last two values: union, intersection, subtraction (second from first) or smooth union (blending distance smoothness).
+		*/
+		void addOperation(Opcode operation, float smoothness = 0.0f);
+
+		/**
+			True if the instructions leave exactly one value (a complete expression) within the stack limit.
+		*/
+		bool isValid();
+
+		float evaluate(glm::vec3 p);
+		void evaluate4(const float* x, const float* y, const float* z, float* distances);
+
+		/**
+			Box containing the surface (false if it is unbounded or the expression is not valid).
+		*/
+		bool getBounds(glm::vec3& minimum, glm::vec3& maximum);
+
+		inline size_t getMemoryBytes() { return sizeof(SDFExpression) + instructions.capacity() * sizeof(Instruction); }
+
+	private:
+		struct Instruction {
+			Opcode opcode;
+			float parameters[4];
+			float toPrimitive[12];		//Rows of the 3x4 affine transform from expression to primitive coordinates.
+			float scale;				//Uniform scale of the placement (primitive distances are multiplied by it).
+			glm::vec3 boundsMinimum, boundsMaximum;
+		};
+		std::vector<Instruction> instructions;
+
+		void addPrimitive(Opcode opcode, const float* parameters, glm::mat4 placement, glm::vec3 localHalfSize);
+		static float evaluatePrimitive(const Instruction& instruction, glm::vec3 p);
+	};
+};
+#endif
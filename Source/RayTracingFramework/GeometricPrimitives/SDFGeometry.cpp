@@ -0,0 +1,243 @@
+#include "SDFGeometry.h"
+#include "RayTracingFramework\Ray.h"
+#include "RayTracingFramework\VirtualObject\IVirtualObject.h"
+#include <algorithm>
+#include <cmath>
+
+RayTracingFramework::SDFGeometry::SDFGeometry(SDFExpression* expression, int gridResolution, int maxSteps)
+	: expression(expression)
+	, maxSteps(maxSteps)
+	, numBlocks(0)
+{
+	valid = expression->getBounds(minimum, maximum);
+	if (!valid)
+		return;
+	//Expand the bounds a little, so the surface never lies on the border of the grid.
+	float diagonal = glm::length(maximum - minimum);
+	epsilon = std::max(1e-4f * diagonal, 1e-6f);
+	glm::vec3 margin(0.01f * diagonal + 4.0f * epsilon);
+	minimum -= margin;
+	maximum += margin;
+	buildGrid(gridResolution);
+}
+
+RayTracingFramework::SDFGeometry::~SDFGeometry() {
+	delete expression;
+}
+
+void RayTracingFramework::SDFGeometry::buildGrid(int gridResolution) {
+	const int CELLS_PER_BLOCK = BLOCK_SIZE * BLOCK_SIZE * BLOCK_SIZE;
+	numBlocks = std::max(1, (gridResolution + BLOCK_SIZE - 1) / BLOCK_SIZE);
+	int resolution = numBlocks * BLOCK_SIZE;
+	cellSize = (maximum - minimum) / (float)resolution;
+	float halfDiagonal = 0.5f * glm::length(cellSize);
+	blocks.assign((size_t)numBlocks * numBlocks * numBlocks, -1);
+	cellBounds.clear();
+	std::vector<float> bounds(CELLS_PER_BLOCK);
+	for (int bz = 0; bz < numBlocks; bz++)
+		for (int by = 0; by < numBlocks; by++)
+			for (int bx = 0; bx < numBlocks; bx++) {
+				//Bounds of the cells of the block, 4 cell centres at a time.
+				bool hasSurface = false;
+				for (int c = 0; c < CELLS_PER_BLOCK; c += 4) {
+					float x[4], y[4], z[4], distances[4];
+					for (int lane = 0; lane < 4; lane++) {
+						int cell = c + lane;
+						glm::vec3 centre = minimum + cellSize * (glm::vec3(bx * BLOCK_SIZE + cell % BLOCK_SIZE, by * BLOCK_SIZE + (cell / BLOCK_SIZE) % BLOCK_SIZE, bz * BLOCK_SIZE + cell / (BLOCK_SIZE * BLOCK_SIZE)) + glm::vec3(0.5f));
+						x[lane] = centre.x;
+						y[lane] = centre.y;
+						z[lane] = centre.z;
+					}
+					expression->evaluate4(x, y, z, distances);
+					for (int lane = 0; lane < 4; lane++) {
+						bounds[c + lane] = std::abs(distances[lane]) - halfDiagonal;
+						hasSurface |= (bounds[c + lane] <= 0);
+					}
+				}
+				if (!hasSurface)
+					continue;//Sparse: empty blocks keep no cells.
+				blocks[((size_t)bz * numBlocks + by) * numBlocks + bx] = (int)cellBounds.size();
+				cellBounds.insert(cellBounds.end(), bounds.begin(), bounds.end());
+			}
+}
+
+bool RayTracingFramework::SDFGeometry::getLocalBounds(glm::vec3& minimum, glm::vec3& maximum) {
+	minimum = this->minimum;
+	maximum = this->maximum;
+	return valid;
+}
+
+bool RayTracingFramework::SDFGeometry::clip(glm::vec3 origin, glm::vec3 direction, float& tNear, float& tFar) {
+	tNear = -FLT_MAX;
+	tFar = FLT_MAX;
+	for (int axis = 0; axis < 3; axis++) {
+		if (direction[axis] == 0) {
+			if (origin[axis] < minimum[axis] || origin[axis] > maximum[axis])
+				return false;
+			continue;
+		}
+		float t0 = (minimum[axis] - origin[axis]) / direction[axis];
+		float t1 = (maximum[axis] - origin[axis]) / direction[axis];
+		if (t0 > t1) std::swap(t0, t1);
+		tNear = std::max(tNear, t0);
+		tFar = std::min(tFar, t1);
+	}
+	return tNear <= tFar;
+}
+
+float RayTracingFramework::SDFGeometry::getEmptySpaceExit(glm::vec3 p, glm::vec3 direction) {
+	//Cell containing p (clamped: p can be on the border of the grid).
+	glm::vec3 g = (p - minimum) / cellSize;
+	int resolution = numBlocks * BLOCK_SIZE;
+	int cell[3];
+	for (int axis = 0; axis < 3; axis++)
+		cell[axis] = glm::clamp((int)std::floor(g[axis]), 0, resolution - 1);
+	int firstCell = blocks[((size_t)(cell[2] / BLOCK_SIZE) * numBlocks + cell[1] / BLOCK_SIZE) * numBlocks + cell[0] / BLOCK_SIZE];
+	glm::vec3 boxMinimum, boxSize;
+	if (firstCell < 0) {
+		//Empty block: skip all of it.
+		boxMinimum = minimum + cellSize * glm::vec3(cell[0] / BLOCK_SIZE * BLOCK_SIZE, cell[1] / BLOCK_SIZE * BLOCK_SIZE, cell[2] / BLOCK_SIZE * BLOCK_SIZE);
+		boxSize = cellSize * (float)BLOCK_SIZE;
+	}
+	else {
+		int local = ((cell[2] % BLOCK_SIZE) * BLOCK_SIZE + cell[1] % BLOCK_SIZE) * BLOCK_SIZE + cell[0] % BLOCK_SIZE;
+		if (cellBounds[firstCell + local] <= 0)
+			return 0;//The surface may be here: sphere trace.
+		boxMinimum = minimum + cellSize * glm::vec3(cell[0], cell[1], cell[2]);
+		boxSize = cellSize;
+	}
+	//Distance to the exit of the box along the ray.
+	float exit = FLT_MAX;
+	for (int axis = 0; axis < 3; axis++) {
+		if (direction[axis] > 0)
+			exit = std::min(exit, (boxMinimum[axis] + boxSize[axis] - p[axis]) / direction[axis]);
+		else if (direction[axis] < 0)
+			exit = std::min(exit, (boxMinimum[axis] - p[axis]) / direction[axis]);
+	}
+	return std::max(exit, 0.0f) + epsilon;
+}
+
+void RayTracingFramework::SDFGeometry::trace(glm::vec3 origin, glm::vec3 direction, float tStart, float tEnd, HitList& hits) {
+	hits.count = 0;
+	bool inside = expression->evaluate(origin + tStart * direction) < 0;
+	hits.startsInside = inside;
+	float t = tStart;
+	for (int step = 0; step < maxSteps && t < tEnd && hits.count < HitList::MAX_HITS; step++) {
+		glm::vec3 p = origin + t * direction;
+		float skip = getEmptySpaceExit(p, direction);
+		if (skip > 0) {
+			t += skip;
+			continue;
+		}
+		float distance = expression->evaluate(p);
+		float distanceOnThisSide = inside ? -distance : distance;
+		if (distanceOnThisSide >= epsilon) {
+			t += distanceOnThisSide;
+			continue;
+		}
+		//On the surface: leave it with growing steps, until we are clearly on the other side (a crossing) or back on this one (a tangent ray).
+		float tOut = t, leap = epsilon;
+		bool crossed = false;
+		for (int attempt = 0; attempt < 12; attempt++, leap *= 2.0f) {
+			tOut += leap;
+			float d = expression->evaluate(origin + tOut * direction);
+			if ((inside ? d : -d) >= epsilon) {
+				crossed = true;
+				break;
+			}
+			if ((inside ? -d : d) >= epsilon)
+				break;
+		}
+		if (crossed) {
+			Hit& hit = hits.hits[hits.count++];
+			hit.t = t;
+			hit.point = glm::vec4(p, 1);
+			hit.normal = glm::vec4(computeNormal(p), 0);
+			hit.textureCoordinates = computeTextureCoordinates(p);
+			hit.textureCoordinatesScale = 2.0f / (3.14159265f * glm::length(maximum - minimum));
+			hit.entering = !inside;
+			inside = !inside;
+		}
+		t = tOut;
+	}
+}
+
+glm::vec3 RayTracingFramework::SDFGeometry::computeNormal(glm::vec3 p) {
+	//Gradient from the vertices of a tetrahedron around p: n = sum(k_i * f(p + h * k_i)), all 4 evaluated at once.
+	const float k[4][3] = { { 1, -1, -1 }, { -1, -1, 1 }, { -1, 1, -1 }, { 1, 1, 1 } };
+	float h = 2.0f * epsilon;
+	float x[4], y[4], z[4], distances[4];
+	for (int i = 0; i < 4; i++) {
+		x[i] = p.x + h * k[i][0];
+		y[i] = p.y + h * k[i][1];
+		z[i] = p.z + h * k[i][2];
+	}
+	expression->evaluate4(x, y, z, distances);
+	glm::vec3 gradient(0.0f);
+	for (int i = 0; i < 4; i++)
+		gradient += distances[i] * glm::vec3(k[i][0], k[i][1], k[i][2]);
+	float length = glm::length(gradient);
+	return (length > 0) ? gradient / length : glm::vec3(0, 1, 0);
+}
+
+glm::vec2 RayTracingFramework::SDFGeometry::computeTextureCoordinates(glm::vec3 p) {
+	//Spherical mapping around the centre of the bounds (as ISphere).
+	const float PI = 3.14159265f;
+	glm::vec3 q = p - 0.5f * (minimum + maximum);
+	float length = glm::length(q);
+	float cosTheta = (length > 0) ? glm::clamp(q.y / length, -1.0f, 1.0f) : 1.0f;
+	return glm::vec2(0.5f + glm::atan(q.z, q.x) / (2.0f * PI), glm::acos(cosTheta) / PI);
+}
+
+bool RayTracingFramework::SDFGeometry::computeHits(glm::vec4 origin, glm::vec4 direction, HitList& hits) {
+	hits.count = 0;
+	hits.startsInside = false;
+	if (!valid)
+		return false;
+	//Sphere tracing needs a unit direction: trace along it and convert back to the parameter of the line.
+	float length = glm::length(glm::vec3(direction));
+	if (length == 0)
+		return true;
+	glm::vec3 unitDirection = glm::vec3(direction) / length;
+	float tNear, tFar;
+	if (!clip(glm::vec3(origin), unitDirection, tNear, tFar))
+		return true;
+	trace(glm::vec3(origin), unitDirection, tNear, tFar, hits);
+	hits.startsInside = false;//The line starts outside the bounds.
+	for (int h = 0; h < hits.count; h++)
+		hits.hits[h].t /= length;
+	return true;
+}
+
+bool RayTracingFramework::SDFGeometry::testLocalCollision(RayTracingFramework::Ray& ray) {
+	if (!valid)
+		return false;
+	//Transform origin and direction to local coordinates (t then measures distances along the ray in world units).
+	glm::mat4 worldToObject = owner->getFromWorldToObjectCoordinates(ray.time);
+	glm::vec4 origin_local = worldToObject * ray.origin_InWorldCoords;
+	glm::vec4 direction_local = worldToObject * glm::vec4(glm::normalize(glm::vec3(ray.direction_InWorldCoords)), 0);
+	float length = glm::length(glm::vec3(direction_local));
+	glm::vec3 unitDirection = glm::vec3(direction_local) / length;
+	float tNear, tFar;
+	if (!clip(glm::vec3(origin_local), unitDirection, tNear, tFar) || tFar <= 0)
+		return false;
+	//Only the part of the ray in front of its origin is traced.
+	HitList hits;
+	trace(glm::vec3(origin_local), unitDirection, std::max(tNear, 0.0f), tFar, hits);
+	bool collided = false;
+	for (int h = 0; h < hits.count; h++) {
+		if (hits.hits[h].t <= 0)
+			continue;
+		Ray::Intersection i1;
+		i1.t_distance = hits.hits[h].t / length;
+		i1.collidingObjectID = owner->getID();
+		i1.collisionPoint_InObjectCoords = hits.hits[h].point;
+		i1.collisionNormalVector_InObjectCoords = hits.hits[h].normal;
+		i1.textureCoordinates = hits.hits[h].textureCoordinates;
+		i1.textureCoordinatesScale = hits.hits[h].textureCoordinatesScale;
+		i1.fromObjectToWorldCoords = toStoredMatrix(owner->getFromObjectToWorldCoordinates(ray.time));
+		ray.addIntersection(i1);
+		collided = true;
+	}
+	return collided;
+}
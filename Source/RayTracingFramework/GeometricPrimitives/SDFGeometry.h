@@ -0,0 +1,60 @@
+#ifndef _SDFGEOMETRY_RAYTRACINGFRAMEWORK
+#define _SDFGEOMETRY_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include "IGeometry.h"
+#include "SDFExpression.h"
+#include <vector>
+
+namespace RayTracingFramework{
+	/**
+		CLASS: SDFGeometry
+		DESCRIPTION: Implicit surface (the zero set of a signed distance function, SDFExpression), rendered by sphere tracing: the ray advances by the distance
+		to the surface, which can never jump over it. It reports all the boundaries it crosses, so it mixes with any other geometry (and works inside CSG).
+		To take large steps through empty space, a grid over the bounds of the surface is precomputed: a cell whose centre is further from the surface than
+		half its diagonal cannot contain any surface, and rays jump straight to its exit without evaluating the function. The grid is sparse: it is split into
+		blocks of BLOCK_SIZE^3 cells, and only blocks touching the surface keep their cells (an empty block is skipped as a whole).
+		Normals are the gradient of the function, from 4 samples (tetrahedron technique) evaluated together with SDFExpression::evaluate4.
+		Placements of the object must be rigid (rotations and translations) or uniform scales, so distances stay valid.
+	*/
+	class SDFGeometry : public IGeometry
+	{
+	public:
+		static const int BLOCK_SIZE = 4;
+
+		/**
+			@param expression: Distance function (deleted with the geometry). Must be valid and bounded.
+			@param gridResolution: Cells of the empty space grid along each axis (rounded up to a multiple of BLOCK_SIZE).
+			@param maxSteps: Maximum steps of a ray (grid skips included), after which the rest of the ray is considered empty.
+		*/
+		SDFGeometry(SDFExpression* expression, int gridResolution = 32, int maxSteps = 256);
+		virtual ~SDFGeometry();
+
+		virtual bool testLocalCollision(RayTracingFramework::Ray& ray);
+		virtual bool computeHits(glm::vec4 origin, glm::vec4 direction, HitList& hits);
+		virtual bool getLocalBounds(glm::vec3& minimum, glm::vec3& maximum);
+		virtual size_t getMemoryBytes() { return sizeof(SDFGeometry) + expression->getMemoryBytes() + blocks.capacity() * sizeof(int) + cellBounds.capacity() * sizeof(float); }
+
+		inline bool isValid() { return valid; }
+		inline int getNumSurfaceBlocks() { return (int)(cellBounds.size() / (BLOCK_SIZE * BLOCK_SIZE * BLOCK_SIZE)); }
+		inline int getNumBlocks() { return (int)blocks.size(); }
+
+	private:
+		SDFExpression* expression;
+		bool valid;
+		int maxSteps;
+		float epsilon;						//Distance at which a point counts as on the surface (relative to the size of the object).
+		glm::vec3 minimum, maximum;			//Bounds of the grid (the surface, slightly expanded).
+		int numBlocks;						//Per axis.
+		glm::vec3 cellSize;
+		std::vector<int> blocks;			//First cell of each block in cellBounds, or -1 if the block contains no surface.
+		std::vector<float> cellBounds;		//|distance at the centre| - half diagonal: positive if the cell contains no surface.
+
+		void buildGrid(int gridResolution);
+		bool clip(glm::vec3 origin, glm::vec3 direction, float& tNear, float& tFar);
+		float getEmptySpaceExit(glm::vec3 p, glm::vec3 direction);
+		void trace(glm::vec3 origin, glm::vec3 direction, float tStart, float tEnd, HitList& hits);
+		glm::vec3 computeNormal(glm::vec3 p);
+		glm::vec2 computeTextureCoordinates(glm::vec3 p);
+	};
+};
+#endif
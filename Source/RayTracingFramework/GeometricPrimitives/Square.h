@@ -10,6 +10,7 @@ namespace RayTracingFramework {
 	public:
 		Rectangle(glm::vec4 p0, glm::vec4 n, glm::vec2 A, glm::vec2 B);
 		virtual bool testLocalCollision(RayTracingFramework::Ray& ray);
+		virtual size_t getMemoryBytes() { return sizeof(Rectangle); }
 		virtual bool testRayPlaneCollision(glm::vec4 origin, glm::vec4 direction, float& t, glm::vec4& col_P, glm::vec4& col_N);
 	};
 }
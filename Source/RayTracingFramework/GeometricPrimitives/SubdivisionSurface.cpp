@@ -0,0 +1,123 @@
+#include "SubdivisionSurface.h"
+#include <algorithm>
+
+RayTracingFramework::SubdivisionSurface::SubdivisionSurface(GeometryCache& cache, const TriangleMesh& controlMesh, int level
+	, DisplacementFunction displacement, float maxDisplacement)
+	: ProceduralGeometry(cache)
+	, level(glm::clamp(level, 0, 10))
+	, detailSize(0.0f)
+	, displacement(displacement)
+	, maxDisplacement(std::abs(maxDisplacement))
+{
+	control.positions = controlMesh.positions;
+	control.normals = controlMesh.normals;
+	control.uvs = controlMesh.uvs;
+	control.indices = controlMesh.indices;
+	if (control.normals.size() != control.positions.size())
+		control.computeVertexNormals();
+	size_t numEdges = control.indices.size();
+	for (size_t e = 0; e < numEdges; e++) {
+		size_t next = (e % 3 == 2) ? e - 2 : e + 1;
+		detailSize += glm::length(control.positions[control.indices[next]] - control.positions[control.indices[e]]);
+	}
+	if (numEdges > 0)
+		detailSize /= (float)numEdges * (float)(1 << this->level);
+}
+
+int RayTracingFramework::SubdivisionSurface::getNumLevels() {
+	return level + 1;
+}
+
+float RayTracingFramework::SubdivisionSurface::getDetailSize() {
+	return detailSize;
+}
+
+int RayTracingFramework::SubdivisionSurface::getNumPatches() {
+	return (int)control.getNumTriangles();
+}
+
+void RayTracingFramework::SubdivisionSurface::buildPNTriangle(int patch, PNTriangle& pn) {
+	const uint32_t* index = &control.indices[3 * patch];
+	glm::vec3 P1 = control.positions[index[0]], P2 = control.positions[index[1]], P3 = control.positions[index[2]];
+	glm::vec3 N1 = glm::normalize(glm::vec3(control.normals[index[0]])), N2 = glm::normalize(glm::vec3(control.normals[index[1]])), N3 = glm::normalize(glm::vec3(control.normals[index[2]]));
+	//Edge control points: the points at 1/3 of each edge, projected onto the tangent plane of the closest vertex.
+	pn.b300 = P1; pn.b030 = P2; pn.b003 = P3;
+	pn.b210 = (2.0f * P1 + P2 - glm::dot(P2 - P1, N1) * N1) / 3.0f;
+	pn.b120 = (2.0f * P2 + P1 - glm::dot(P1 - P2, N2) * N2) / 3.0f;
+	pn.b021 = (2.0f * P2 + P3 - glm::dot(P3 - P2, N2) * N2) / 3.0f;
+	pn.b012 = (2.0f * P3 + P2 - glm::dot(P2 - P3, N3) * N3) / 3.0f;
+	pn.b102 = (2.0f * P3 + P1 - glm::dot(P1 - P3, N3) * N3) / 3.0f;
+	pn.b201 = (2.0f * P1 + P3 - glm::dot(P3 - P1, N1) * N1) / 3.0f;
+	glm::vec3 E = (pn.b210 + pn.b120 + pn.b021 + pn.b012 + pn.b102 + pn.b201) / 6.0f;
+	glm::vec3 V = (P1 + P2 + P3) / 3.0f;
+	pn.b111 = E + (E - V) * 0.5f;
+	//Normals: quadratic, with the mid edge normals reflected across the plane perpendicular to the edge.
+	pn.n200 = N1; pn.n020 = N2; pn.n002 = N3;
+	glm::vec3 edges[3][2] = { { P1, P2 }, { P2, P3 }, { P3, P1 } };
+	glm::vec3 edgeNormals[3][2] = { { N1, N2 }, { N2, N3 }, { N3, N1 } };
+	glm::vec3* midNormals[3] = { &pn.n110, &pn.n011, &pn.n101 };
+	for (int e = 0; e < 3; e++) {
+		glm::vec3 edge = edges[e][1] - edges[e][0];
+		float lengthSquared = glm::dot(edge, edge);
+		float v = (lengthSquared > 0) ? 2.0f * glm::dot(edge, edgeNormals[e][0] + edgeNormals[e][1]) / lengthSquared : 0.0f;
+		glm::vec3 n = edgeNormals[e][0] + edgeNormals[e][1] - v * edge;
+		float length = glm::length(n);
+		*midNormals[e] = (length > 0) ? n / length : edgeNormals[e][0];
+	}
+}
+
+void RayTracingFramework::SubdivisionSurface::getPatchBounds(int patch, glm::vec3& minimum, glm::vec3& maximum) {
+	//The Bezier triangle lies within the convex hull of its control points; displacement moves it at most maxDisplacement.
+	PNTriangle pn;
+	buildPNTriangle(patch, pn);
+	glm::vec3 points[10] = { pn.b300, pn.b030, pn.b003, pn.b210, pn.b120, pn.b021, pn.b012, pn.b102, pn.b201, pn.b111 };
+	minimum = maximum = points[0];
+	for (int i = 1; i < 10; i++) {
+		minimum = glm::min(minimum, points[i]);
+		maximum = glm::max(maximum, points[i]);
+	}
+	minimum -= glm::vec3(maxDisplacement);
+	maximum += glm::vec3(maxDisplacement);
+}
+
+void RayTracingFramework::SubdivisionSurface::tessellatePatch(int patch, int lodLevel, TriangleMesh& mesh) {
+	PNTriangle pn;
+	buildPNTriangle(patch, pn);
+	const uint32_t* index = &control.indices[3 * patch];
+	bool hasUVs = control.uvs.size() == control.positions.size();
+	int segments = 1 << std::max(level - lodLevel, 0);
+	//Vertices (i, j): barycentric coordinates u = i / segments (weight of the second vertex), v = j / segments (third), w = 1 - u - v (first).
+	for (int j = 0; j <= segments; j++)
+		for (int i = 0; i <= segments - j; i++) {
+			float u = (float)i / segments, v = (float)j / segments, w = 1.0f - u - v;
+			glm::vec3 position = pn.b300 * (w * w * w) + pn.b030 * (u * u * u) + pn.b003 * (v * v * v)
+				+ pn.b210 * (3.0f * w * w * u) + pn.b120 * (3.0f * w * u * u) + pn.b201 * (3.0f * w * w * v)
+				+ pn.b021 * (3.0f * u * u * v) + pn.b102 * (3.0f * w * v * v) + pn.b012 * (3.0f * u * v * v)
+				+ pn.b111 * (6.0f * w * u * v);
+			glm::vec3 normal = glm::normalize(pn.n200 * (w * w) + pn.n020 * (u * u) + pn.n002 * (v * v) + pn.n110 * (w * u) + pn.n011 * (u * v) + pn.n101 * (w * v));
+			if (displacement)
+				position += normal * glm::clamp(displacement(position, normal), -maxDisplacement, maxDisplacement);
+			mesh.positions.push_back(position);
+			mesh.normals.push_back(normal);
+			if (hasUVs)
+				mesh.uvs.push_back(w * control.uvs[index[0]] + u * control.uvs[index[1]] + v * control.uvs[index[2]]);
+		}
+	//First vertex of each row j.
+	std::vector<uint32_t> rowStart(segments + 2);
+	rowStart[0] = 0;
+	for (int j = 0; j <= segments; j++)
+		rowStart[j + 1] = rowStart[j] + (segments - j + 1);
+	for (int j = 0; j < segments; j++)
+		for (int i = 0; i < segments - j; i++) {
+			uint32_t a = rowStart[j] + i, b = a + 1, c = rowStart[j + 1] + i;
+			uint32_t triangle[3] = { a, b, c };
+			mesh.indices.insert(mesh.indices.end(), triangle, triangle + 3);
+			if (i + j < segments - 1) {
+				uint32_t other[3] = { b, c + 1, c };
+				mesh.indices.insert(mesh.indices.end(), other, other + 3);
+			}
+		}
+	//Displaced surfaces get the normals of their own triangles.
+	if (displacement)
+		mesh.computeVertexNormals();
+}
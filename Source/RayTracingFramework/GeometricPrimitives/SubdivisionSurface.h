@@ -0,0 +1,51 @@
+#ifndef _SUBDIVISIONSURFACE_RAYTRACINGFRAMEWORK
+#define _SUBDIVISIONSURFACE_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include "ProceduralGeometry.h"
+#include <functional>
+
+namespace RayTracingFramework{
+	/**
+		CLASS: SubdivisionSurface
+		DESCRIPTION: Smooth surface through the vertices of a coarse control mesh, optionally displaced along its normal by a procedural function.
+		Each control triangle is a patch (see ProceduralGeometry), refined on demand into 4^level triangles. The refinement uses curved point-normal triangles
+		(a cubic Bezier triangle per control triangle, built from its vertices and normals only), so every patch can be tessellated on its own and
+		neighbouring patches still share their edges exactly. Coarser levels of detail refine the control triangles fewer times (down to the control mesh itself).
+	*/
+	class SubdivisionSurface : public ProceduralGeometry
+	{
+	public:
+		typedef std::function<float(glm::vec3 position, glm::vec3 normal)> DisplacementFunction;
+
+		/**
+			@param controlMesh: Positions, indices and optionally normals (computed from the triangles if empty) and UVs.
+			@param maxDisplacement: Bound of |displacement| (needed for the bounds of the patches).
+		*/
+		SubdivisionSurface(GeometryCache& cache, const TriangleMesh& controlMesh, int level
+			, DisplacementFunction displacement = DisplacementFunction(), float maxDisplacement = 0.0f);
+
+		virtual int getNumPatches();
+		virtual void getPatchBounds(int patch, glm::vec3& minimum, glm::vec3& maximum);
+		virtual void tessellatePatch(int patch, int lodLevel, TriangleMesh& mesh);
+		virtual int getNumLevels();
+		virtual float getDetailSize();
+		virtual size_t getMemoryBytes() {
+			return ProceduralGeometry::getMemoryBytes() + (sizeof(SubdivisionSurface) - sizeof(ProceduralGeometry) - sizeof(TriangleMesh)) + control.getMemoryBytes();
+		}
+
+	private:
+		//Control points of the cubic position and quadratic normal patches of a control triangle.
+		struct PNTriangle {
+			glm::vec3 b300, b030, b003, b210, b120, b021, b012, b102, b201, b111;
+			glm::vec3 n200, n020, n002, n110, n011, n101;
+		};
+		TriangleMesh control;
+		int level;
+		float detailSize;	//Average length of the edges of the control triangles, divided by 2^level.
+		DisplacementFunction displacement;
+		float maxDisplacement;
+
+		void buildPNTriangle(int patch, PNTriangle& pn);
+	};
+};
+#endif
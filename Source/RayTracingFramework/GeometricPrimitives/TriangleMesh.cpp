@@ -0,0 +1,195 @@
+#include "TriangleMesh.h"
+#include <algorithm>
+#include <cmath>
+
+void RayTracingFramework::TriangleMesh::buildBVH() {
+	nodes.clear();
+	uint32_t numTriangles = (uint32_t)getNumTriangles();
+	if (numTriangles == 0)
+		return;
+	std::vector<glm::vec3> centroids(numTriangles);
+	std::vector<uint32_t> order(numTriangles);
+	for (uint32_t t = 0; t < numTriangles; t++) {
+		centroids[t] = (positions[indices[3 * t]] + positions[indices[3 * t + 1]] + positions[indices[3 * t + 2]]) / 3.0f;
+		order[t] = t;
+	}
+	nodes.reserve(2 * numTriangles / MAX_LEAF_TRIANGLES + 1);
+	Node root = { StoredBox(), 0, numTriangles };
+	nodes.push_back(root);
+	subdivide(0, centroids, order);
+	//Store the triangles in the order of the leaves.
+	std::vector<uint32_t> sorted(indices.size());
+	for (uint32_t t = 0; t < numTriangles; t++)
+		for (int k = 0; k < 3; k++)
+			sorted[3 * t + k] = indices[3 * order[t] + k];
+	indices.swap(sorted);
+}
+
+void RayTracingFramework::TriangleMesh::subdivide(uint32_t node, std::vector<glm::vec3>& centroids, std::vector<uint32_t>& order) {
+	uint32_t first = nodes[node].first, count = nodes[node].count;
+	glm::vec3 minimum(FLT_MAX), maximum(-FLT_MAX), centroidMinimum(FLT_MAX), centroidMaximum(-FLT_MAX);
+	for (uint32_t i = first; i < first + count; i++) {
+		for (int k = 0; k < 3; k++) {
+			minimum = glm::min(minimum, positions[indices[3 * order[i] + k]]);
+			maximum = glm::max(maximum, positions[indices[3 * order[i] + k]]);
+		}
+		centroidMinimum = glm::min(centroidMinimum, centroids[order[i]]);
+		centroidMaximum = glm::max(centroidMaximum, centroids[order[i]]);
+	}
+	if (node == 0)
+		grid.set(minimum, maximum);
+	nodes[node].box.set(minimum, maximum, grid);
+	if (count <= (uint32_t)MAX_LEAF_TRIANGLES)
+		return;
+	//Split at the median centroid along the longest axis.
+	glm::vec3 extent = centroidMaximum - centroidMinimum;
+	int axis = (extent.x > extent.y && extent.x > extent.z) ? 0 : (extent.y > extent.z ? 1 : 2);
+	uint32_t half = count / 2;
+	std::nth_element(order.begin() + first, order.begin() + first + half, order.begin() + first + count,
+		[&centroids, axis](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+	uint32_t left = (uint32_t)nodes.size();
+	Node children[2] = { { StoredBox(), first, half }, { StoredBox(), first + half, count - half } };
+	nodes.push_back(children[0]);
+	nodes.push_back(children[1]);
+	nodes[node].first = left;
+	nodes[node].count = 0;
+	subdivide(left, centroids, order);
+	subdivide(left + 1, centroids, order);
+}
+
+bool RayTracingFramework::TriangleMesh::hitsBox(const Node& node, const BoxGrid& grid, glm::vec3 origin, glm::vec3 inverseDirection, float tMax, float& tNear) {
+	glm::vec3 t0 = (node.box.getMinimum(grid) - origin) * inverseDirection;
+	glm::vec3 t1 = (node.box.getMaximum(grid) - origin) * inverseDirection;
+	glm::vec3 tSmall = glm::min(t0, t1), tBig = glm::max(t0, t1);
+	tNear = std::max(std::max(tSmall.x, tSmall.y), std::max(tSmall.z, 0.0f));
+	float tFar = std::min(std::min(tBig.x, tBig.y), std::min(tBig.z, tMax));
+	return tNear <= tFar;
+}
+
+bool RayTracingFramework::TriangleMesh::intersectTriangle(uint32_t triangle, glm::vec3 origin, glm::vec3 direction, float& t, float& u, float& v) const {
+	//Moller-Trumbore.
+	const glm::vec3& A = positions[indices[3 * triangle]];
+	glm::vec3 AB = positions[indices[3 * triangle + 1]] - A, AC = positions[indices[3 * triangle + 2]] - A;
+	glm::vec3 p = glm::cross(direction, AC);
+	float determinant = glm::dot(AB, p);
+	if (determinant == 0.0f)
+		return false;
+	float inverse = 1.0f / determinant;
+	glm::vec3 s = origin - A;
+	u = glm::dot(s, p) * inverse;
+	if (u < 0.0f || u > 1.0f)
+		return false;
+	glm::vec3 q = glm::cross(s, AB);
+	v = glm::dot(direction, q) * inverse;
+	if (v < 0.0f || u + v > 1.0f)
+		return false;
+	t = glm::dot(AC, q) * inverse;
+	return true;
+}
+
+bool RayTracingFramework::TriangleMesh::intersect(glm::vec3 origin, glm::vec3 direction, float tMax, IGeometry::Hit& hit) const {
+	if (nodes.empty())
+		return false;
+	//Axis parallel directions: a huge (not infinite) inverse, so that 0 * inverse never gives NaN in the box tests.
+	glm::vec3 inverseDirection;
+	for (int axis = 0; axis < 3; axis++)
+		inverseDirection[axis] = 1.0f / ((std::abs(direction[axis]) > 1e-20f) ? direction[axis] : 1e-20f);
+	uint32_t stack[64];
+	int top = 0;
+	stack[top++] = 0;
+	uint32_t closestTriangle = 0;
+	float closestT = tMax, closestU = 0, closestV = 0;
+	bool found = false;
+	float tNear;
+	while (top > 0) {
+		const Node& node = nodes[stack[--top]];
+		if (!hitsBox(node, grid, origin, inverseDirection, closestT, tNear))
+			continue;
+		if (node.count > 0) {
+			for (uint32_t triangle = node.first; triangle < node.first + node.count; triangle++) {
+				float t, u, v;
+				if (intersectTriangle(triangle, origin, direction, t, u, v) && t > 0 && t < closestT) {
+					closestT = t;
+					closestU = u;
+					closestV = v;
+					closestTriangle = triangle;
+					found = true;
+				}
+			}
+			continue;
+		}
+		//Visit the nearest child first (pushed last).
+		float tLeft, tRight;
+		bool hitLeft = hitsBox(nodes[node.first], grid, origin, inverseDirection, closestT, tLeft);
+		bool hitRight = hitsBox(nodes[node.first + 1], grid, origin, inverseDirection, closestT, tRight);
+		if (hitLeft && hitRight) {
+			bool leftFirst = tLeft <= tRight;
+			stack[top++] = leftFirst ? node.first + 1 : node.first;
+			stack[top++] = leftFirst ? node.first : node.first + 1;
+		}
+		else if (hitLeft)
+			stack[top++] = node.first;
+		else if (hitRight)
+			stack[top++] = node.first + 1;
+	}
+	if (!found)
+		return false;
+	uint32_t a = indices[3 * closestTriangle], b = indices[3 * closestTriangle + 1], c = indices[3 * closestTriangle + 2];
+	float w = 1.0f - closestU - closestV;
+	glm::vec3 geometricNormal = glm::cross(positions[b] - positions[a], positions[c] - positions[a]);
+	glm::vec3 normal = normals.empty() ? geometricNormal : w * glm::vec3(normals[a]) + closestU * glm::vec3(normals[b]) + closestV * glm::vec3(normals[c]);
+	hit.t = closestT;
+	hit.point = glm::vec4(origin + closestT * direction, 1);
+	hit.normal = glm::vec4(glm::normalize(normal), 0);
+	hit.entering = glm::dot(geometricNormal, direction) < 0;
+	if (uvs.empty()) {
+		hit.textureCoordinates = glm::vec2(closestU, closestV);
+		hit.textureCoordinatesScale = 0.0f;
+	}
+	else {
+		hit.textureCoordinates = w * uvs[a] + closestU * uvs[b] + closestV * uvs[c];
+		//Ratio between the area in UV space and in object space (as ITriangle).
+		glm::vec2 uvAB = uvs[b] - uvs[a], uvAC = uvs[c] - uvs[a];
+		float uvArea = std::abs(uvAB.x * uvAC.y - uvAB.y * uvAC.x);
+		float area = glm::length(geometricNormal);
+		hit.textureCoordinatesScale = (area > 0) ? std::sqrt(uvArea / area) : 0.0f;
+	}
+	return true;
+}
+
+bool RayTracingFramework::TriangleMesh::getBounds(glm::vec3& minimum, glm::vec3& maximum) const {
+	if (!nodes.empty()) {
+		minimum = nodes[0].box.getMinimum(grid);
+		maximum = nodes[0].box.getMaximum(grid);
+		return true;
+	}
+	minimum = glm::vec3(FLT_MAX);
+	maximum = glm::vec3(-FLT_MAX);
+	for (size_t i = 0; i < positions.size(); i++) {
+		minimum = glm::min(minimum, positions[i]);
+		maximum = glm::max(maximum, positions[i]);
+	}
+	return !positions.empty();
+}
+
+size_t RayTracingFramework::TriangleMesh::getMemoryBytes() const {
+	return sizeof(TriangleMesh) + positions.capacity() * sizeof(glm::vec3) + normals.capacity() * sizeof(StoredNormal) + uvs.capacity() * sizeof(glm::vec2)
+		+ indices.capacity() * sizeof(uint32_t) + nodes.capacity() * sizeof(Node);
+}
+
+void RayTracingFramework::TriangleMesh::computeVertexNormals() {
+	//Sums in full precision (normals may be stored in half precision).
+	std::vector<glm::vec3> sums(positions.size(), glm::vec3(0.0f));
+	for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+		uint32_t a = indices[t], b = indices[t + 1], c = indices[t + 2];
+		glm::vec3 n = glm::cross(positions[b] - positions[a], positions[c] - positions[a]);//Length: twice the area.
+		sums[a] += n;
+		sums[b] += n;
+		sums[c] += n;
+	}
+	normals.resize(sums.size());
+	for (size_t i = 0; i < sums.size(); i++) {
+		float length = glm::length(sums[i]);
+		normals[i] = (length > 0) ? sums[i] / length : glm::vec3(0, 1, 0);
+	}
+}
@@ -0,0 +1,63 @@
+#ifndef _TRIANGLEMESH_RAYTRACINGFRAMEWORK
+#define _TRIANGLEMESH_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include "IGeometry.h"
+#include <RayTracingFramework\CompactStorage.h>
+#include <vector>
+#include <stdint.h>
+
+namespace RayTracingFramework{
+	/**
+		CLASS: TriangleMesh
+		DESCRIPTION: Indexed triangle mesh (positions, optional per vertex normals and UVs) with its own bounding volume hierarchy, so the closest hit of a ray
+		is found in logarithmic time. Used for the triangles generated by procedural geometry (see ProceduralGeometry), which are kept in a GeometryCache.
+		The hierarchy is built by splitting the triangles at the median of their centroids, along the longest axis.
+	*/
+	class TriangleMesh
+	{
+	public:
+		std::vector<glm::vec3> positions;
+		std::vector<StoredNormal> normals;	//Empty: flat shading (geometric normals). Half precision in compact storage (see CompactStorage).
+		std::vector<glm::vec2> uvs;			//Empty: barycentric coordinates are used.
+		std::vector<uint32_t> indices;		//3 per triangle.
+
+		inline size_t getNumTriangles() const { return indices.size() / 3; }
+
+		/**
+			Builds the hierarchy (the order of the triangles changes). Must be called after the mesh is filled, before intersect.
+		*/
+		void buildBVH();
+
+		/**
+			Closest hit of origin + t * direction with t in (0, tMax). Returns false if there is none.
+		*/
+		bool intersect(glm::vec3 origin, glm::vec3 direction, float tMax, IGeometry::Hit& hit) const;
+
+		bool getBounds(glm::vec3& minimum, glm::vec3& maximum) const;
+
+		/**
+			Memory used by the mesh and its hierarchy (what a GeometryCache charges for it).
+		*/
+		size_t getMemoryBytes() const;
+
+		/**
+			Fills normals with the (area weighted) average of the normals of the triangles around each vertex.
+		*/
+		void computeVertexNormals();
+
+	private:
+		struct Node {
+			StoredBox box;
+			uint32_t first;		//Leaf: first triangle. Inner node: first child (the second one follows it).
+			uint32_t count;		//Triangles of a leaf (0 for inner nodes).
+		};
+		static const int MAX_LEAF_TRIANGLES = 4;
+		std::vector<Node> nodes;
+		BoxGrid grid;			//Quantisation of the boxes (the box of the root).
+
+		void subdivide(uint32_t node, std::vector<glm::vec3>& centroids, std::vector<uint32_t>& order);
+		bool intersectTriangle(uint32_t triangle, glm::vec3 origin, glm::vec3 direction, float& t, float& u, float& v) const;
+		static bool hitsBox(const Node& node, const BoxGrid& grid, glm::vec3 origin, glm::vec3 inverseDirection, float tMax, float& tNear);
+	};
+};
+#endif
@@ -2,15 +2,21 @@
 #define _DIRECTIONALLIGHT_RAYTRACINGFRAMEWORK
 #include <RayTracingFramework\RayTracingPrerequisites.h>
 #include <RayTracingFramework\Light\ILight.h>
+#include <RayTracingFramework\Sampling\Sampler.h>
 namespace RayTracingFramework {
 	class DirectionalLight :public ILight {
 		glm::vec4 directionInWorld;
 		RayTracingFramework::Colour colour;		//Perceived light colour (if radiometric is used, this is the colour perceived for luminance = 1Lux)*/
+		float cosAngularRadius;					//Cosine of the angular radius of the light disk (1 -> point at infinity, hard shadows).
 	public:
-		DirectionalLight(IScene& scene, glm::vec4 directionInWorld, Colour baseColour = Colour(1, 1, 1))
+		/**
+			@param angularRadius: Angular radius (radians) of the disk of the light (e.g. 0.0047 for the sun), for soft shadows. 0 -> hard shadows.
+		*/
+		DirectionalLight(IScene& scene, glm::vec4 directionInWorld, Colour baseColour = Colour(1, 1, 1), float angularRadius = 0.0f)
 			: ILight(scene)
 			, directionInWorld(glm::normalize(directionInWorld))
 			, colour(baseColour)
+			, cosAngularRadius(glm::cos(angularRadius))
 		{
 			;
 		}
@@ -18,6 +24,21 @@ namespace RayTracingFramework {
 			return directionInWorld;
 		}
 
+		virtual glm::vec4 sampleLightDirectionAtPoint(glm::vec4 pointInWorld, Sampler& sampler) {
+			if (cosAngularRadius >= 1.0f)
+				return directionInWorld;
+			//Uniform direction in the cone of the disk.
+			glm::vec2 u = sampler.next2D();
+			float cosTheta = 1.0f - u.x * (1.0f - cosAngularRadius);
+			float sinTheta = glm::sqrt(glm::max(0.0f, 1.0f - cosTheta * cosTheta));
+			float phi = 6.28318531f * u.y;
+			glm::vec3 axis(directionInWorld);
+			glm::vec3 helper = (glm::abs(axis.x) > 0.9f) ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0);
+			glm::vec3 tangent = glm::normalize(glm::cross(helper, axis));
+			glm::vec3 bitangent = glm::cross(axis, tangent);
+			return glm::vec4(glm::normalize(sinTheta * glm::cos(phi) * tangent + sinTheta * glm::sin(phi) * bitangent + cosTheta * axis), 0.0f);
+		}
+
 		virtual float lightDistanceFromPoint(glm::vec4 pointInWorld) {
 			return FLT_MAX;
 		}
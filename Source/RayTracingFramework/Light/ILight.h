@@ -7,9 +7,15 @@ namespace RayTracingFramework{
 	public:
 		ILight(IScene& scene);
 		virtual glm::vec4 lightDirectionAtPoint(glm::vec4 pointInWorld)=0;
+		/**
+			Direction of a ray of light arriving at the point, drawn with sampler (for lights with an extent, e.g. soft shadows).
+			Lights without extent return lightDirectionAtPoint (and draw nothing).
+		*/
+		virtual glm::vec4 sampleLightDirectionAtPoint(glm::vec4 pointInWorld, Sampler& sampler) { return lightDirectionAtPoint(pointInWorld); }
 		virtual float lightDistanceFromPoint(glm::vec4 pointInWorld) = 0;
 		virtual float illuminanceAtPoint(glm::vec4 pointInWorld)=0;
 		virtual Colour baseColour()=0;
+		virtual ~ILight() { ; }
 
 	};
 };
@@ -16,15 +16,20 @@ namespace RayTracingFramework{
 		float K_a, K_d, K_s, shininess;									//Shading coefficients for ambient, diffuse and specular components (shininess describes the power for K_s components);
 		float K_t, K_r;													//Reflectiveness and transparency of the object.			
 		float refractiveIndex;											//Refraction Index
+		RayTracingFramework::Colour emissiveColour;						//Light emitted by the surface (only used by shading models that support emitters, e.g. path tracing).
 		cimg_library::CImg<unsigned char> *diffuseMap, *specularMap;	//UV map for diffuse colour and specular reflections (extra marks)
+		Texture *diffuseTexture, *specularTexture;						//Streamed alternatives to the maps above (e.g. Texture(tiledFileName)), for textures too big to keep in memory. They take precedence over the maps.
 		
 		//Default constructor: Matte red material.
 		Material():
 			diffuseColour(1,0,0), specularColour (1,1,1)
 			, K_a(0), K_d(1), K_s(0), shininess(3) 
 			, K_t (0), K_r(0), refractiveIndex(1)
+			, emissiveColour(0, 0, 0)
 			, diffuseMap(0)
 			, specularMap(0)
+			, diffuseTexture(0)
+			, specularTexture(0)
 			{ ; }
 		inline void setOwner(IVirtualObject* _owner) {
 			owner = _owner;
@@ -0,0 +1,127 @@
+#include "MemoryReport.h"
+#include "Profiler.h"
+#include "RayTracingFramework\VirtualObject\ISceneManager.h"
+#include "RayTracingFramework\VirtualObject\IVirtualObject.h"
+#include "RayTracingFramework\GeometricPrimitives\IGeometry.h"
+#include "RayTracingFramework\GeometricPrimitives\GeometryCache.h"
+#include "RayTracingFramework\ShadingModels\IShadingModel.h"
+#include "RayTracingFramework\ShadingModels\MaterialTable.h"
+#include "RayTracingFramework\Rendering\FrameBuffer.h"
+#include "RayTracingFramework\Textures\TextureCache.h"
+#include "RayTracingFramework\Material.h"
+#include "RayTracingFramework\CompactStorage.h"
+#include <typeinfo>
+
+namespace {
+	//"12.34 MB"
+	std::string formatBytes(size_t bytes) {
+		const char* units[] = { "B", "KB", "MB", "GB", "TB" };
+		double value = (double)bytes;
+		int unit = 0;
+		while (value >= 1024.0 && unit < 4) {
+			value /= 1024.0;
+			unit++;
+		}
+		char text[32];
+		sprintf(text, unit == 0 ? "%.0f %s" : "%.2f %s", value, units[unit]);
+		return text;
+	}
+}
+
+const char* RayTracingFramework::MemoryReport::getCategoryName(Category category) {
+	static const char* names[NUM_MEMORY_CATEGORIES] = { "Nodes", "Geometry", "Materials", "Acceleration", "Framebuffers", "Textures" };
+	return names[category];
+}
+
+void RayTracingFramework::MemoryReport::add(Category category, const std::string& name, size_t bytes, size_t count) {
+	for (size_t i = 0; i < items.size(); i++)
+		if (items[i].category == category && items[i].name == name) {
+			items[i].bytes += bytes;
+			items[i].count += count;
+			return;
+		}
+	Item item = { category, name, count, bytes };
+	items.push_back(item);
+}
+
+void RayTracingFramework::MemoryReport::addScene(ISceneManager& scene) {
+	std::vector<IVirtualObject*> objects;
+	scene.getObjects(objects);
+	for (size_t o = 0; o < objects.size(); o++) {
+		IVirtualObject* object = objects[o];
+		if (addOnce(object))
+			add(MEMORY_NODES, "IVirtualObject", object->getMemoryBytes());
+		//Geometries, by type.
+		if (object->hasGeometry() && addOnce(&object->getGeometry()))
+			add(MEMORY_GEOMETRY, Profiler::getTypeName(typeid(object->getGeometry())), object->getGeometry().getMemoryBytes());
+		if (!object->hasMaterial())
+			continue;
+		Material& material = object->getMaterial();
+		if (addOnce(&material))
+			add(MEMORY_MATERIALS, "Material", sizeof(Material));
+		//Textures of the material: images kept in memory, and the streamed textures (whose tiles are in the texture cache).
+		cimg_library::CImg<unsigned char>* images[2] = { material.diffuseMap, material.specularMap };
+		for (int i = 0; i < 2; i++)
+			if (images[i] && addOnce(images[i]))
+				add(MEMORY_TEXTURES, "Image", sizeof(*images[i]) + images[i]->size() * sizeof(unsigned char));
+		Texture* textures[2] = { material.diffuseTexture, material.specularTexture };
+		for (int t = 0; t < 2; t++)
+			if (textures[t] && addOnce(textures[t]))
+				add(MEMORY_TEXTURES, "Texture", textures[t]->getMemoryBytes());
+	}
+	if (addOnce(&scene)) {
+		add(MEMORY_NODES, "ObjectTable", scene.getRegistryMemoryBytes());
+		add(MEMORY_ACCELERATION, "SceneBVH", scene.getBVH().getMemoryBytes());
+	}
+	TextureCache& textureCache = scene.getShadingModel().getTextureCache();
+	if (addOnce(&textureCache))
+		add(MEMORY_TEXTURES, "TextureCache", textureCache.getMemoryBytes());
+}
+
+void RayTracingFramework::MemoryReport::addFrameBuffer(FrameBuffer& frameBuffer, const char* name) {
+	if (addOnce(&frameBuffer))
+		add(MEMORY_FRAMEBUFFERS, name, frameBuffer.getMemoryBytes());
+}
+
+void RayTracingFramework::MemoryReport::addGeometryCache(GeometryCache& cache) {
+	//Tessellated patches of procedural geometry.
+	if (addOnce(&cache))
+		add(MEMORY_GEOMETRY, "GeometryCache", sizeof(GeometryCache) + cache.getResidentBytes());
+}
+
+void RayTracingFramework::MemoryReport::addMaterialTable(MaterialTable& table) {
+	if (addOnce(&table))
+		add(MEMORY_MATERIALS, "MaterialTable", table.getMemoryBytes());
+}
+
+size_t RayTracingFramework::MemoryReport::getBytes(Category category) {
+	size_t bytes = 0;
+	for (size_t i = 0; i < items.size(); i++)
+		if (items[i].category == category)
+			bytes += items[i].bytes;
+	return bytes;
+}
+
+size_t RayTracingFramework::MemoryReport::getTotalBytes() {
+	size_t bytes = 0;
+	for (size_t i = 0; i < items.size(); i++)
+		bytes += items[i].bytes;
+	return bytes;
+}
+
+void RayTracingFramework::MemoryReport::write(FILE* file) {
+	fprintf(file, "Memory report (%s storage):\n", isCompactStorage() ? "compact" : "full precision");
+	fprintf(file, "  %-14s %-24s %10s %14s\n", "Category", "Item", "Count", "Memory");
+	for (int c = 0; c < NUM_MEMORY_CATEGORIES; c++) {
+		Category category = (Category)c;
+		bool found = false;
+		for (size_t i = 0; i < items.size(); i++)
+			if (items[i].category == category) {
+				fprintf(file, "  %-14s %-24s %10llu %14s\n", getCategoryName(category), items[i].name.c_str(), (unsigned long long)items[i].count, formatBytes(items[i].bytes).c_str());
+				found = true;
+			}
+		if (found)
+			fprintf(file, "  %-14s %-24s %10s %14s\n", getCategoryName(category), "(total)", "", formatBytes(getBytes(category)).c_str());
+	}
+	fprintf(file, "  %-14s %-24s %10s %14s\n", "Total", "", "", formatBytes(getTotalBytes()).c_str());
+}
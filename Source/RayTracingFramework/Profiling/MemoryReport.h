@@ -0,0 +1,67 @@
+/**
+	CLASS: MemoryReport
+	DESCRIPTION: Where the memory of a render goes, broken down by subsystem: scene graph nodes, geometry, materials, acceleration structures, frame buffers
+	and textures. Each subsystem reports the memory it owns (the getMemoryBytes methods) and the report adds it up, counting shared components (e.g. a
+	material used by several objects) once, and writes it as a table. Sizes are those of the objects and of the capacity of their containers, without the
+	overhead of the allocator.
+	Builds with RAYTRACINGFRAMEWORK_COMPACT_STORAGE (see CompactStorage) need less memory for nodes, meshes and hierarchies.
+*/
+#ifndef _MEMORYREPORT_RAYTRACINGFRAMEWORK
+#define _MEMORYREPORT_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include <vector>
+#include <set>
+#include <string>
+#include <cstdio>
+
+namespace RayTracingFramework{
+	class ISceneManager;
+	class FrameBuffer;
+	class GeometryCache;
+	class MaterialTable;
+
+	class MemoryReport
+	{
+	public:
+		enum Category { MEMORY_NODES, MEMORY_GEOMETRY, MEMORY_MATERIALS, MEMORY_ACCELERATION, MEMORY_FRAMEBUFFERS, MEMORY_TEXTURES, NUM_MEMORY_CATEGORIES };
+
+		MemoryReport() { ; }
+
+		/**
+			Adds everything the scene holds: its objects (and their registry), their geometries and materials, the images and textures of the materials,
+			its hierarchy (see ISceneManager::buildBVH) and the texture cache of its shading model.
+		*/
+		void addScene(ISceneManager& scene);
+
+		void addFrameBuffer(FrameBuffer& frameBuffer, const char* name = "FrameBuffer");
+		void addGeometryCache(GeometryCache& cache);
+		void addMaterialTable(MaterialTable& table);
+
+		/**
+			Adds memory of anything else (e.g. a PrimaryVisibilityBuffer). Items with the same category and name are added up.
+		*/
+		void add(Category category, const std::string& name, size_t bytes, size_t count = 1);
+
+		size_t getBytes(Category category);
+		size_t getTotalBytes();
+
+		/**
+			Writes the table (one line per item, and the total of each category).
+		*/
+		void write(FILE* file = stdout);
+
+		static const char* getCategoryName(Category category);
+
+	private:
+		struct Item {
+			Category category;
+			std::string name;
+			size_t count, bytes;
+		};
+		std::vector<Item> items;
+		std::set<const void*> counted;		//Components already added.
+
+		inline bool addOnce(const void* component) { return counted.insert(component).second; }
+	};
+};
+#endif
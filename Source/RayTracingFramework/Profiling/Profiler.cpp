@@ -0,0 +1,270 @@
+#include "Profiler.h"
+#include "RayTracingFramework\VirtualObject\ISceneManager.h"
+#include "RayTracingFramework\VirtualObject\IVirtualObject.h"
+#include "RayTracingFramework\GeometricPrimitives\IGeometry.h"
+#include <mutex>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <typeinfo>
+#include <algorithm>
+#ifdef __GNUC__
+#include <cxxabi.h>
+#endif
+
+namespace {
+	//Call tree of the timers: each node aggregates all the calls of a timer (name and label) under the same chain of enclosing timers.
+	struct Node {
+		typedef std::pair<const char*, uint32_t> Key;
+		const char* name;
+		uint32_t label;
+		Node* parent;
+		std::map<Key, Node*> children;
+		long long ticks;
+		unsigned long long calls;
+
+		Node(const char* name = "", uint32_t label = RayTracingFramework::Profiler::NO_LABEL, Node* parent = NULL)
+			: name(name), label(label), parent(parent), ticks(0), calls(0) { ; }
+		~Node() { clear(); }
+
+		void clear() {
+			for (std::map<Key, Node*>::iterator it = children.begin(); it != children.end(); it++)
+				delete it->second;
+			children.clear();
+			ticks = 0;
+			calls = 0;
+		}
+
+		Node* getChild(const char* childName, uint32_t childLabel) {
+			Node*& child = children[Key(childName, childLabel)];
+			if (!child)
+				child = new Node(childName, childLabel, this);
+			return child;
+		}
+
+		void merge(const Node& other) {
+			ticks += other.ticks;
+			calls += other.calls;
+			for (std::map<Key, Node*>::const_iterator it = other.children.begin(); it != other.children.end(); it++)
+				getChild(it->first.first, it->first.second)->merge(*it->second);
+		}
+	};
+
+	std::mutex profilerMutex;
+	Node finishedThreads;		//Timings of the threads that ended.
+	struct ThreadProfile;
+	std::vector<ThreadProfile*> liveThreads;
+	std::map<std::vector<int>, double> tileTimes;		//(x0, y0, x1, y1) -> seconds.
+	//Reference points to measure the length of a tick (time stamp counter rates are not reported by the CPU).
+	long long calibrationTicks = 0;
+	std::chrono::steady_clock::time_point calibrationTime;
+
+	//Timings of a thread (registered while it lives, merged into finishedThreads when it ends).
+	struct ThreadProfile {
+		Node root;
+		Node* current;
+		//Hash table (open addressing) of all the nodes by (parent, name, label), so entering a timer does not search the children of the current node.
+		std::vector<Node*> table;
+		size_t numNodes;
+
+		ThreadProfile() : current(&root), table(1024, (Node*)NULL), numNodes(0) {
+			std::lock_guard<std::mutex> lock(profilerMutex);
+			liveThreads.push_back(this);
+		}
+		~ThreadProfile() {
+			std::lock_guard<std::mutex> lock(profilerMutex);
+			finishedThreads.merge(root);
+			liveThreads.erase(std::find(liveThreads.begin(), liveThreads.end(), this));
+		}
+
+		static inline size_t hash(const Node* parent, const char* name, uint32_t label) {
+			uint64_t h = (uint64_t)(uintptr_t)parent * 0x9E3779B97F4A7C15ull ^ (uint64_t)(uintptr_t)name * 0xC2B2AE3D27D4EB4Full ^ (uint64_t)label * 0x165667B19E3779F9ull;
+			return (size_t)(h ^ (h >> 29));
+		}
+
+		Node* getChild(const char* name, uint32_t label) {
+			size_t mask = table.size() - 1;
+			for (size_t slot = hash(current, name, label) & mask; ; slot = (slot + 1) & mask) {
+				Node* node = table[slot];
+				if (!node)
+					break;
+				if (node->parent == current && node->name == name && node->label == label)
+					return node;
+			}
+			Node* node = current->getChild(name, label);
+			insert(node);
+			return node;
+		}
+
+		void insert(Node* node) {
+			//Kept at most half full.
+			if (2 * (numNodes + 1) > table.size()) {
+				std::vector<Node*> old(table.size() * 2, (Node*)NULL);
+				old.swap(table);
+				numNodes = 0;
+				for (size_t i = 0; i < old.size(); i++)
+					if (old[i])
+						insert(old[i]);
+			}
+			size_t mask = table.size() - 1;
+			size_t slot = hash(node->parent, node->name, node->label) & mask;
+			while (table[slot])
+				slot = (slot + 1) & mask;
+			table[slot] = node;
+			numNodes++;
+		}
+
+		void clear() {
+			root.clear();
+			current = &root;
+			std::fill(table.begin(), table.end(), (Node*)NULL);
+			numNodes = 0;
+		}
+	};
+
+	ThreadProfile& threadProfile() {
+		static thread_local ThreadProfile profile;
+		return profile;
+	}
+
+	std::string getFrameName(const Node& node, RayTracingFramework::IScene* scene) {
+		std::string frame = node.name;
+		if (node.label == RayTracingFramework::Profiler::NO_LABEL)
+			return frame;
+		frame += " [object " + std::to_string(node.label);
+		RayTracingFramework::IVirtualObject* object = scene ? scene->findNodeByID(node.label) : NULL;
+		if (object && object->hasGeometry())
+			frame += " " + RayTracingFramework::Profiler::getTypeName(typeid(object->getGeometry()));
+		return frame + "]";
+	}
+
+	//One line per node with self time: "parent frames;frame microseconds".
+	void writeStacks(FILE* file, const Node& node, const std::string& stack, double microsecondsPerTick, RayTracingFramework::IScene* scene, bool& ok) {
+		long long self = node.ticks;
+		for (std::map<Node::Key, Node*>::const_iterator it = node.children.begin(); it != node.children.end(); it++) {
+			self -= it->second->ticks;
+			writeStacks(file, *it->second, stack + (stack.empty() ? "" : ";") + getFrameName(*it->second, scene), microsecondsPerTick, scene, ok);
+		}
+		long long microseconds = (long long)(self * microsecondsPerTick);
+		if (!stack.empty() && microseconds > 0)
+			ok = ok && fprintf(file, "%s %lld\n", stack.c_str(), microseconds) > 0;
+	}
+}
+
+std::atomic<bool> RayTracingFramework::Profiler::enabled(false);
+
+void RayTracingFramework::Profiler::setEnabled(bool enable) {
+	std::lock_guard<std::mutex> lock(profilerMutex);
+	if (enable && calibrationTicks == 0) {
+		calibrationTicks = ticks();
+		calibrationTime = std::chrono::steady_clock::now();
+	}
+	enabled.store(enable);
+}
+
+std::string RayTracingFramework::Profiler::getTypeName(const std::type_info& type) {
+	std::string name = type.name();
+#ifdef __GNUC__
+	int status = 0;
+	char* demangled = abi::__cxa_demangle(type.name(), NULL, NULL, &status);
+	if (demangled) {
+		name = demangled;
+		free(demangled);
+	}
+#endif
+	//"class RayTracingFramework::ISphere" -> "ISphere".
+	size_t separator = name.rfind("::");
+	if (separator != std::string::npos)
+		name = name.substr(separator + 2);
+	else if (name.compare(0, 6, "class ") == 0)
+		name = name.substr(6);
+	return name;
+}
+
+double RayTracingFramework::Profiler::getSecondsPerTick() {
+#ifdef PROFILER_USE_TSC
+	//Measured since profiling was first enabled (the longer, the more accurate).
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - calibrationTime).count();
+	long long elapsedTicks = ticks() - calibrationTicks;
+	return (calibrationTicks != 0 && elapsedTicks > 0) ? seconds / (double)elapsedTicks : 0.0;
+#else
+	return 1e-9;
+#endif
+}
+
+void RayTracingFramework::Profiler::reset() {
+	std::lock_guard<std::mutex> lock(profilerMutex);
+	finishedThreads.clear();
+	for (size_t t = 0; t < liveThreads.size(); t++)
+		liveThreads[t]->clear();
+	tileTimes.clear();
+}
+
+void RayTracingFramework::Profiler::enter(const char* name, uint32_t label) {
+	ThreadProfile& profile = threadProfile();
+	profile.current = profile.getChild(name, label);
+}
+
+void RayTracingFramework::Profiler::leave(long long elapsedTicks) {
+	ThreadProfile& profile = threadProfile();
+	profile.current->ticks += elapsedTicks;
+	profile.current->calls++;
+	if (profile.current->parent)
+		profile.current = profile.current->parent;
+}
+
+void RayTracingFramework::Profiler::addTileTime(int x0, int y0, int x1, int y1, double seconds) {
+	int bounds[4] = { x0, y0, x1, y1 };
+	std::lock_guard<std::mutex> lock(profilerMutex);
+	tileTimes[std::vector<int>(bounds, bounds + 4)] += seconds;
+}
+
+bool RayTracingFramework::Profiler::writeCollapsedStacks(const char* fileName, IScene* scene) {
+	Node merged;
+	double microsecondsPerTick;
+	{
+		std::lock_guard<std::mutex> lock(profilerMutex);
+		merged.merge(finishedThreads);
+		for (size_t t = 0; t < liveThreads.size(); t++)
+			merged.merge(liveThreads[t]->root);
+		microsecondsPerTick = 1e6 * getSecondsPerTick();
+	}
+	FILE* file = fopen(fileName, "w");
+	if (!file)
+		return false;
+	bool ok = true;
+	writeStacks(file, merged, "", microsecondsPerTick, scene, ok);
+	return (fclose(file) == 0) && ok;
+}
+
+bool RayTracingFramework::Profiler::writeTileTimes(const char* fileName, int width, int height) {
+	std::map<std::vector<int>, double> tiles;
+	{
+		std::lock_guard<std::mutex> lock(profilerMutex);
+		tiles = tileTimes;
+	}
+	//Time per pixel of each tile, relative to the slowest one.
+	double slowest = 0;
+	for (std::map<std::vector<int>, double>::iterator it = tiles.begin(); it != tiles.end(); it++) {
+		int area = std::max((it->first[2] - it->first[0]) * (it->first[3] - it->first[1]), 1);
+		it->second /= area;
+		slowest = std::max(slowest, it->second);
+	}
+	cimg_library::CImg<unsigned char> image(width, height, 1, 3, 0);
+	for (std::map<std::vector<int>, double>::iterator it = tiles.begin(); it != tiles.end(); it++) {
+		float t = (slowest > 0) ? (float)(it->second / slowest) : 0.0f;
+		unsigned char heat[3] = { (unsigned char)(255 * glm::clamp(3 * t, 0.0f, 1.0f)), (unsigned char)(255 * glm::clamp(3 * t - 1, 0.0f, 1.0f)), (unsigned char)(255 * glm::clamp(3 * t - 2, 0.0f, 1.0f)) };
+		for (int y = std::max(it->first[1], 0); y < std::min(it->first[3], height); y++)
+			for (int x = std::max(it->first[0], 0); x < std::min(it->first[2], width); x++)
+				for (int c = 0; c < 3; c++)
+					image(x, y, 0, c) = heat[c];
+	}
+	try {
+		image.save(fileName);
+	}
+	catch (cimg_library::CImgException&) {
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,133 @@
+/**
+	CLASS: Profiler
+	DESCRIPTION: Built-in profiler of the renderer, to find the objects, materials and stages that make a scene slow without an external profiler.
+	Scoped timers (PROFILE_SCOPE) measure the time spent in the main stages (intersection tests of each object, shading stages...). Each thread aggregates its
+	timings in its own call tree (no locks), which is merged into a global one when the thread ends (or when the results are written). Results are written as
+	collapsed stacks ("frame;frame;frame microseconds" lines, where times are self times), which flame graph tools (flamegraph.pl, speedscope...) read directly.
+	Renderers also report how long each tile (or row) took (addTileTime), written as a heat map of the image.
+	Timers cost a single test while profiling is disabled (the default). Defining RAYTRACINGFRAMEWORK_NO_PROFILER removes them completely.
+	Results should be read/written while nothing is being rendered.
+*/
+#ifndef _PROFILER_RAYTRACINGFRAMEWORK
+#define _PROFILER_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include <stdint.h>
+#include <chrono>
+#include <atomic>
+#include <string>
+#include <typeinfo>
+//Timers read the time stamp counter of the CPU when possible (much cheaper than the system clocks).
+#if defined(_M_X64) || defined(_M_IX86)
+#define PROFILER_USE_TSC
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#define PROFILER_USE_TSC
+#include <x86intrin.h>
+#endif
+
+namespace RayTracingFramework{
+	class Profiler
+	{
+	public:
+		static const uint32_t NO_LABEL = 0xFFFFFFFFu;
+
+		/**
+			Measures the time until the end of the scope, as a call of name (a string literal) inside the scope of the enclosing timers of the thread.
+			label is an optional object ID (its frame is then named after the object and its geometry, e.g. to tell the time of each object apart).
+		*/
+		class ScopedTimer
+		{
+		public:
+			inline ScopedTimer(const char* name, uint32_t label = NO_LABEL) : active(isEnabled()), start(0) {
+				if (active) {
+					enter(name, label);
+					start = ticks();
+				}
+			}
+			inline ~ScopedTimer() {
+				if (active)
+					leave(ticks() - start);
+			}
+		private:
+			bool active;
+			long long start;
+		};
+
+		/**
+			Measures the time until the end of the scope as the time of a tile (see addTileTime).
+		*/
+		class TileTimer
+		{
+		public:
+			inline TileTimer(int x0, int y0, int x1, int y1) : active(isEnabled()), x0(x0), y0(y0), x1(x1), y1(y1) {
+				if (active)
+					start = std::chrono::steady_clock::now();
+			}
+			inline ~TileTimer() {
+				if (active)
+					addTileTime(x0, y0, x1, y1, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+			}
+		private:
+			bool active;
+			int x0, y0, x1, y1;
+			std::chrono::steady_clock::time_point start;
+		};
+
+		/**
+			Starts/stops profiling (timers started before a change keep their state).
+		*/
+		static void setEnabled(bool enable);
+		static inline bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+		/**
+			Discards all the timings (of the tiles too).
+		*/
+		static void reset();
+
+		/**
+			Adds the time spent rendering pixels [x0, x1) x [y0, y1) (times of the same tile add up, e.g. over progressive passes).
+		*/
+		static void addTileTime(int x0, int y0, int x1, int y1, double seconds);
+
+		/**
+			Writes the collapsed stacks of all the threads. Frames with a label are named after the object (and the type of its geometry) if scene is given.
+		*/
+		static bool writeCollapsedStacks(const char* fileName, IScene* scene = NULL);
+
+		/**
+			Writes an image (e.g. BMP) of the time per pixel of each tile, as a heat map from black (no time) through red and yellow to white (the slowest tile).
+			Pixels of tiles without times stay black.
+		*/
+		static bool writeTileTimes(const char* fileName, int width, int height);
+
+		/**
+			Name of a class without its namespace (e.g. "ISphere"), to label results (see also MemoryReport).
+		*/
+		static std::string getTypeName(const std::type_info& type);
+
+	private:
+		static std::atomic<bool> enabled;
+
+		//Time stamp counter (or nanoseconds of the steady clock). Ticks are converted to seconds when results are written.
+		static inline long long ticks() {
+#ifdef PROFILER_USE_TSC
+			return (long long)__rdtsc();
+#else
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+		}
+		static double getSecondsPerTick();
+		static void enter(const char* name, uint32_t label);
+		static void leave(long long elapsedTicks);
+	};
+};
+
+#ifndef RAYTRACINGFRAMEWORK_NO_PROFILER
+#define PROFILE_CONCATENATE_(a, b) a##b
+#define PROFILE_CONCATENATE(a, b) PROFILE_CONCATENATE_(a, b)
+//Times the rest of the scope: PROFILE_SCOPE("name") or PROFILE_SCOPE("name", objectID).
+#define PROFILE_SCOPE(...) RayTracingFramework::Profiler::ScopedTimer PROFILE_CONCATENATE(profileTimer, __LINE__)(__VA_ARGS__)
+#else
+#define PROFILE_SCOPE(...)
+#endif
+#endif
@@ -8,6 +8,8 @@
 #ifndef _RAY_RAYTRACINGFRAMEWORK
 #define _RAY_RAYTRACINGFRAMEWORK
 #include <RayTracingFramework\RayTracingPrerequisites.h>
+#include <RayTracingFramework\RayDifferentials.h>
+#include <RayTracingFramework\CompactStorage.h>
 namespace RayTracingFramework{
 	class Ray{
 	public:
@@ -20,42 +22,142 @@ namespace RayTracingFramework{
 			float t_distance;
 			unsigned int collidingObjectID;
 			glm::vec4 collisionPoint_InObjectCoords;					
-			glm::mat4 fromObjectToWorldCoords; //The ray would be relative to the camera, the world, etc... this matrix accumulates the transformation to get origin and direction in local coordinates.
+			StoredMatrix fromObjectToWorldCoords; //The ray would be relative to the camera, the world, etc... this matrix accumulates the transformation to get origin and direction in local coordinates.
 			glm::vec4 collisionNormalVector_InObjectCoords;// You might need to add others (collisionNormalVector?)
+			glm::vec2 textureCoordinates;		//UV coordinates of the collision point (textures repeat outside [0,1]).
+			float textureCoordinatesScale;		//Approximate change of the UV coordinates per unit of length (object coordinates) around the collision point. Used to choose a mip level.
+		};
+
+		/**
+			Small fixed size stack with the (transparent) objects the ray is currently inside of, and their refractive indices.
+			This tells us whether a hit enters or exits an object, and which medium we go back to when we exit it (nested media).
+		*/
+		struct MediumStack {
+			static const int MAX_DEPTH = 4;
+			unsigned int objectID[MAX_DEPTH];
+			float refractiveIndex[MAX_DEPTH];
+			int depth;
+
+			MediumStack() : depth(0) { ; }
+
+			inline bool contains(unsigned int ID) {
+				for (int i = 0; i < depth; i++)
+					if (objectID[i] == ID) return true;
+				return false;
+			}
+			inline void push(unsigned int ID, float index) {
+				if (depth == MAX_DEPTH) {//Too many nested media: forget the outermost one.
+					for (int i = 1; i < depth; i++) { objectID[i - 1] = objectID[i]; refractiveIndex[i - 1] = refractiveIndex[i]; }
+					depth--;
+				}
+				objectID[depth] = ID;
+				refractiveIndex[depth] = index;
+				depth++;
+			}
+			inline void remove(unsigned int ID) {
+				for (int i = 0; i < depth; i++)
+					if (objectID[i] == ID) {
+						for (int k = i + 1; k < depth; k++) { objectID[k - 1] = objectID[k]; refractiveIndex[k - 1] = refractiveIndex[k]; }
+						depth--;
+						return;
+					}
+			}
+			//Refractive index of the innermost medium (outsideIndex if we are not inside any object).
+			inline float currentIndex(float outsideIndex) {
+				return (depth > 0) ? refractiveIndex[depth - 1] : outsideIndex;
+			}
 		};
 
 		//PUBLIC ATTRIBUTES: Description of the ray itself
 		glm::vec4 origin_InWorldCoords, direction_InWorldCoords;
 		float refractiveIndex;	//Refractive index of the material that the ray is travelling through (it it goping through air, crystal, etc...)
-		std::map<float, struct Intersection> intersections;	//Container of all the intersections with objects. The internal order is from smaller to higher distance t (distance to origin of ray).
+		MediumStack media;		//Objects the ray is travelling inside of (refractiveIndex is the index of the innermost one, or of the surrounding medium if the stack is empty).
+		float time;				//Time of the shutter interval ([0, 1]) the ray is traced at (motion blur). Set by the camera, inherited by secondary rays.
+		float importance;		//Contribution of this ray to the final pixel colour (product of the weights of the rays that spawned it). Used to avoid tracing rays that cannot change the result.
+		RayDifferentials differentials;	//Footprint of the pixel the ray belongs to (set by the camera, carried by reflections/refractions; invalid for other rays).
+		static const int MAX_INTERSECTIONS = 16;						//Only the closest intersections are kept (enough for shading, shadows and transparency).
+		struct Intersection intersections[MAX_INTERSECTIONS];			//Container of the intersections with objects, ordered from smaller to higher distance t (distance to origin of ray). Stored inline, so tracing a ray never allocates memory.
+		int firstIntersection, numIntersections;						//Valid intersections are [firstIntersection, numIntersections). Discarded ones are skipped, not moved.
 
 		/**
 			Creates a ray with the specified direction and origin, travelling through a medium with a specific refractive index (default air~vacuum).
 		*/
-		Ray(glm::vec4 origin_InWorldCoords, glm::vec4 direction_InWorldCoords, float refractiveIndex=1)
+		Ray(glm::vec4 origin_InWorldCoords, glm::vec4 direction_InWorldCoords, float refractiveIndex=1, float time=0)
 			: origin_InWorldCoords(origin_InWorldCoords)
 			, direction_InWorldCoords(direction_InWorldCoords)
 			, refractiveIndex(refractiveIndex)
+			, time(time)
+			, importance(1)
+			, firstIntersection(0)
+			, numIntersections(0)
 		{
 			;
 		}
+
 		/**
-			Add an intersection with an object.
+			Re-initialises the ray with a new origin and direction, discarding all its intersections. This allows the same Ray to be reused (e.g. along a path), without creating new objects.
+			The time of the ray is kept (all the rays of a path are traced at the same time).
+		*/
+		inline void reset(glm::vec4 origin, glm::vec4 direction, float refractiveIndex = 1) {
+			origin_InWorldCoords = origin;
+			direction_InWorldCoords = direction;
+			this->refractiveIndex = refractiveIndex;
+			media.depth = 0;
+			importance = 1;
+			differentials.valid = false;
+			firstIntersection = numIntersections = 0;
+		}
+
+		/**
+			Add an intersection with an object. If the container is full, the furthest intersection is dropped.
 		*/
 		inline void addIntersection(Intersection i){
-			if(i.t_distance>0)
-				intersections[i.t_distance]=i;
+			if (i.t_distance <= 0)
+				return;
+			//Find insertion point (keeping the order by distance).
+			int pos = numIntersections;
+			while (pos > firstIntersection && intersections[pos - 1].t_distance > i.t_distance)
+				pos--;
+			if (pos > firstIntersection && intersections[pos - 1].t_distance == i.t_distance) {
+				intersections[pos - 1] = i;	//Same distance: replace it (as the old std::map did).
+				return;
+			}
+			if (numIntersections == MAX_INTERSECTIONS) {
+				if (firstIntersection > 0) {//Reclaim the discarded slots at the front.
+					for (int k = firstIntersection; k < numIntersections; k++)
+						intersections[k - firstIntersection] = intersections[k];
+					pos -= firstIntersection;
+					numIntersections -= firstIntersection;
+					firstIntersection = 0;
+				}
+				else if (pos == MAX_INTERSECTIONS)
+					return;					//Further than everything we keep.
+				else
+					numIntersections--;		//Drop the furthest one.
+			}
+			for (int k = numIntersections; k > pos; k--)
+				intersections[k] = intersections[k - 1];
+			intersections[pos] = i;
+			numIntersections++;
+		}
+
+		/**
+			Returns the number of (non discarded) intersections.
+		*/
+		inline int getNumIntersections() {
+			return numIntersections - firstIntersection;
 		}
 
 		/**
 			Returns the closest intersection to the ray origin.
 		*/
-		Intersection getClosestIntersection(){//Maps order elements internally, using the < operator. This is a cheap way of ordering the intersections we detect...
-			if(intersections.size()>0)
-				return intersections.begin()->second;
+		Intersection getClosestIntersection(){//Intersections are kept ordered as we add them, so the closest is always the first one.
+			if(numIntersections>firstIntersection)
+				return intersections[firstIntersection];
 			else{//Signify there were no collisions, by returning an intersection at inifinity.
 				Intersection noCollision;
 				noCollision.t_distance=FLT_MAX;
+				noCollision.collidingObjectID=0;	//IVirtualObject::INVALID_OBJECT_ID
 				return noCollision;
 			}
 		}
@@ -64,8 +166,8 @@ namespace RayTracingFramework{
 			Discards the first intersection (closest to origin). This is usefull when the intersection is behind the camera (negative t), or the first collision is with the starting object (to avoid self-shadowing).
 		*/
 		void discardClosestIntersection() {
-			if(intersections.size()>0)
-				intersections.erase(intersections.begin());
+			if(numIntersections>firstIntersection)
+				firstIntersection++;
 		}
 	};
 
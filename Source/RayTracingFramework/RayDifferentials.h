@@ -0,0 +1,77 @@
+/**
+	CLASS: RayDifferentials
+	DESCRIPTION: Ray differentials (H. Igehy, "Tracing ray differentials"): how the origin and the direction of a ray change from one pixel to the next, along the
+	x and y axes of the image. The camera creates them with its primary rays and the shading model carries them through reflections and refractions, so that
+	at every hit we know the size of the area seen by the pixel (used to choose texture mip levels and the level of detail of procedural geometry).
+	Surfaces are treated as locally flat (normals are assumed not to change across the footprint), so footprints seen on curved mirrors are underestimated.
+*/
+#ifndef _RAYDIFFERENTIALS_RAYTRACINGFRAMEWORK
+#define _RAYDIFFERENTIALS_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+
+namespace RayTracingFramework{
+	struct RayDifferentials {
+		glm::vec3 dOriginX, dOriginY;			//Change of the origin per pixel.
+		glm::vec3 dDirectionX, dDirectionY;		//Change of the (unit) direction per pixel.
+		bool valid;								//False for rays that do not belong to a pixel footprint (e.g. random bounces of path tracing).
+
+		RayDifferentials() : valid(false) { ; }
+
+		/**
+			Width of the area seen by the pixel, at distance t along the ray (perpendicular to it). 0 if there are no differentials.
+		*/
+		inline float getWidth(float t) const {
+			if (!valid)
+				return 0.0f;
+			return glm::max(glm::length(dOriginX + t * dDirectionX), glm::length(dOriginY + t * dDirectionY));
+		}
+
+		/**
+			Moves the origin to the hit at distance t on a surface with the given normal (direction: unit direction of the ray). The origin differentials then
+			lie on the surface (the footprint stretches at grazing angles), and getWidth(0) is the size of the footprint on the surface.
+		*/
+		inline void transfer(float t, glm::vec3 direction, glm::vec3 normal) {
+			dOriginX += t * dDirectionX;
+			dOriginY += t * dDirectionY;
+			float cosine = glm::dot(direction, normal);
+			if (glm::abs(cosine) < 1e-3f)
+				return;		//Grazing: the projection would blow up.
+			dOriginX -= (glm::dot(dOriginX, normal) / cosine) * direction;
+			dOriginY -= (glm::dot(dOriginY, normal) / cosine) * direction;
+		}
+
+		/**
+			Mirror reflection of the direction about normal (after transfer).
+		*/
+		inline void reflect(glm::vec3 normal) {
+			dDirectionX -= 2.0f * glm::dot(dDirectionX, normal) * normal;
+			dDirectionY -= 2.0f * glm::dot(dDirectionY, normal) * normal;
+		}
+
+		/**
+			Refraction of the direction (after transfer): the new direction is eta * direction + (eta * cosIncident - cosTransmitted) * normal, with normal facing
+			the incoming ray and cosIncident = -dot(direction, normal).
+		*/
+		inline void refract(glm::vec3 normal, float eta, float cosIncident, float cosTransmitted) {
+			glm::vec3* dDirection[2] = { &dDirectionX, &dDirectionY };
+			for (int axis = 0; axis < 2; axis++) {
+				float dCosIncident = -glm::dot(*dDirection[axis], normal);
+				float dCosTransmitted = (cosTransmitted > 0) ? eta * eta * cosIncident * dCosIncident / cosTransmitted : 0.0f;
+				*dDirection[axis] = eta * *dDirection[axis] + (eta * dCosIncident - dCosTransmitted) * normal;
+			}
+		}
+
+		/**
+			The direction becomes normalize(v), where v changes as the current direction does (e.g. v = direction + constant vector).
+		*/
+		inline void normalizeDirection(glm::vec3 v) {
+			float length = glm::length(v);
+			if (length <= 0)
+				return;
+			glm::vec3 unit = v / length;
+			dDirectionX = (dDirectionX - unit * glm::dot(unit, dDirectionX)) / length;
+			dDirectionY = (dDirectionY - unit * glm::dot(unit, dDirectionY)) / length;
+		}
+	};
+};
+#endif
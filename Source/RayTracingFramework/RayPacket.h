@@ -0,0 +1,42 @@
+/**
+	CLASS: RayPacket
+	DESCRIPTION: A block of rays (e.g. all the primary rays of a tile), stored as a structure of arrays (one array per coordinate).
+	This layout lets packet/SIMD code load the same coordinate of consecutive rays with a single instruction. Individual rays can still be extracted with getRay.
+*/
+#ifndef _RAYPACKET_RAYTRACINGFRAMEWORK
+#define _RAYPACKET_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include <RayTracingFramework\Ray.h>
+#include <vector>
+
+namespace RayTracingFramework{
+	class RayPacket {
+	public:
+		std::vector<float> originX, originY, originZ;
+		std::vector<float> directionX, directionY, directionZ;
+		std::vector<RayDifferentials> differentials;	//Footprint of each ray (not needed by the intersection code, so kept apart).
+		int x0, y0, width, height;			//Pixels covered by the packet: ray i belongs to pixel (x0 + i % width, y0 + i / width).
+
+		RayPacket() : x0(0), y0(0), width(0), height(0) { ; }
+
+		/**
+			Resizes the packet to hold the rays of pixels [x0, x0 + width) x [y0, y0 + height). Memory is only reallocated if the packet grows.
+		*/
+		inline void resize(int _x0, int _y0, int _width, int _height) {
+			x0 = _x0; y0 = _y0; width = _width; height = _height;
+			size_t n = (size_t)(width * height);
+			originX.resize(n); originY.resize(n); originZ.resize(n);
+			directionX.resize(n); directionY.resize(n); directionZ.resize(n);
+			differentials.resize(n);
+		}
+
+		inline int size() { return width * height; }
+
+		inline Ray getRay(int i) {
+			Ray ray(glm::vec4(originX[i], originY[i], originZ[i], 1.0f), glm::vec4(directionX[i], directionY[i], directionZ[i], 0.0f));
+			ray.differentials = differentials[i];
+			return ray;
+		}
+	};
+};
+#endif
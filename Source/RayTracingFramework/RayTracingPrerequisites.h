@@ -16,5 +16,8 @@ namespace RayTracingFramework{
 	class IShadingModel;
 	class IVirtualObject;
 	class IScene;
+	class Texture;
+	class TextureCache;
+	class Sampler;
 };
 #endif
\ No newline at end of file
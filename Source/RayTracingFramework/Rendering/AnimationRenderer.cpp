@@ -0,0 +1,112 @@
+#include "AnimationRenderer.h"
+#include "FrameBuffer.h"
+#include "RayTracingFramework\VirtualObject\ISceneManager.h"
+#include "RayTracingFramework\VirtualObject\Animation.h"
+#include "RayTracingFramework\VirtualObject\Camera\Camera.h"
+#include "RayTracingFramework\ShadingModels\IShadingModel.h"
+#include "RayTracingFramework\Profiling\Profiler.h"
+#include <deque>
+#include <vector>
+#include <algorithm>
+
+RayTracingFramework::AnimationRenderer::AnimationRenderer(ISceneManager& scene, Camera& camera, Animation& animation, ITileRenderer& tileRenderer, int numThreads, int tileSize, bool enableAOVs)
+	: scene(scene)
+	, camera(camera)
+	, animation(animation)
+	, tileRenderer(tileRenderer)
+	, threadPool(numThreads)
+	, tileSize(tileSize)
+	, enableAOVs(enableAOVs)
+	, shutter(0)
+	, numShutterKeys(2)
+{
+	for (int b = 0; b < 2; b++)
+		frameBuffers[b] = new FrameBuffer(camera.getPixelWidth(), camera.getPixelHeight(), enableAOVs);
+}
+
+RayTracingFramework::AnimationRenderer::~AnimationRenderer() {
+	for (int b = 0; b < 2; b++)
+		delete frameBuffers[b];
+}
+
+void RayTracingFramework::AnimationRenderer::renderFrames(int firstFrame, int lastFrame, IFrameListener& listener) {
+	//Frames waiting for the writer (in order), and whether each buffer holds one of them (or is being written).
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::deque<int> pendingFrames;
+	bool bufferBusy[2] = { false, false };
+	bool done = false;
+	std::thread writer([&] {
+		while (true) {
+			int frame;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				changed.wait(lock, [&] { return done || !pendingFrames.empty(); });
+				if (pendingFrames.empty())
+					return;
+				frame = pendingFrames.front();
+			}
+			int b = (frame - firstFrame) % 2;
+			listener.frameFinished(frame, *frameBuffers[b]);
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				pendingFrames.pop_front();
+				bufferBusy[b] = false;
+			}
+			changed.notify_all();
+		}
+	});
+	for (int frame = firstFrame; frame <= lastFrame; frame++) {
+		int b = (frame - firstFrame) % 2;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [&] { return !bufferBusy[b]; });
+		}
+		//The writer only reads the other buffer: the scene can be moved while it works.
+		animation.applyFrame(scene, (float)frame, shutter, numShutterKeys);
+		camera.prepareFrame();
+		scene.refitBVH();
+		//Records of the irradiance cache are only valid while the objects stay where they were (they do not depend on the camera).
+		IrradianceCache* irradianceCache = scene.getShadingModel().getIrradianceCache();
+		if (irradianceCache && (frame == firstFrame || !animation.movesOnly(camera, (float)(frame - 1), (float)frame)))
+			irradianceCache->clear();
+		listener.prepareFrame(frame);
+		tileRenderer.prepareFrame(frame);
+		renderFrame(frame, *frameBuffers[b]);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			bufferBusy[b] = true;
+			pendingFrames.push_back(frame);
+		}
+		changed.notify_all();
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		done = true;
+	}
+	changed.notify_all();
+	writer.join();
+}
+
+void RayTracingFramework::AnimationRenderer::renderFrame(int frame, FrameBuffer& frameBuffer) {
+	PROFILE_SCOPE("AnimationRenderer::renderFrame");
+	frameBuffer.clear();
+	int width = frameBuffer.getWidth(), height = frameBuffer.getHeight();
+	int tilesX = (width + tileSize - 1) / tileSize, tilesY = (height + tileSize - 1) / tileSize;
+	//Each tile is rendered into its own buffer (as ITileRenderer expects) and merged: tiles cover different pixels, so merging needs no lock.
+	threadPool.parallelFor(tilesX * tilesY, [&](int t) {
+		RenderJob job;
+		job.ID = (uint32_t)t;
+		job.frame = frame;
+		job.x0 = (t % tilesX) * tileSize;
+		job.y0 = (t / tilesX) * tileSize;
+		job.x1 = std::min(job.x0 + tileSize, width);
+		job.y1 = std::min(job.y0 + tileSize, height);
+		job.enableAOVs = enableAOVs ? 1 : 0;
+		FrameBuffer tile(job.x1 - job.x0, job.y1 - job.y0, enableAOVs, job.x0, job.y0);
+		tileRenderer.renderTile(job, tile);
+		std::vector<unsigned char> data;
+		tile.serialize(data);
+		frameBuffer.accumulate(&data[0], data.size());
+	});
+}
@@ -0,0 +1,70 @@
+/**
+	CLASS: AnimationRenderer
+	DESCRIPTION: Renders a range of frames of an Animation with the same scene, camera and tile renderer, so that whatever they keep between frames is
+	reused: the bounding volume hierarchy is refit (not built again), texture and geometry caches stay warm and the worker threads (ThreadPool) are started
+	once. Frames are rendered into two buffers in turn: while frame N is handed to the listener (e.g. encoded and written to disk) on a writer thread,
+	frame N + 1 is already being rendered. The listener gets frames in order.
+	The irradiance cache of the shading model (if any) is kept while only the camera moves, and cleared when other objects move.
+*/
+#ifndef _ANIMATIONRENDERER_RAYTRACINGFRAMEWORK
+#define _ANIMATIONRENDERER_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include "RenderJob.h"
+#include "ThreadPool.h"
+
+namespace RayTracingFramework{
+	class ISceneManager;
+	class Camera;
+	class Animation;
+
+	class AnimationRenderer
+	{
+	public:
+		class IFrameListener {
+		public:
+			/**
+				The scene and camera have been moved to frame, and its tiles are about to be rendered (called on the rendering thread, e.g. to rebuild
+				structures that depend on the positions of the objects).
+			*/
+			virtual void prepareFrame(int frame) { ; }
+			/**
+				All the tiles of frame are in frameBuffer (called on the writer thread; the buffer is reused for another frame after this call).
+			*/
+			virtual void frameFinished(int frame, FrameBuffer& frameBuffer) = 0;
+			virtual ~IFrameListener() { ; }
+		};
+
+		/**
+			@param numThreads: Threads rendering the tiles of a frame (0 -> one per hardware thread). tileRenderer must support being called from all of them.
+		*/
+		AnimationRenderer(ISceneManager& scene, Camera& camera, Animation& animation, ITileRenderer& tileRenderer, int numThreads = 0, int tileSize = 32, bool enableAOVs = false);
+		~AnimationRenderer();
+
+		/**
+			Objects move from frame to frame + shutter while the shutter is open (motion blur). 0 (default): they are still during each frame.
+		*/
+		inline void setShutter(float shutter, int numShutterKeys = 2) { this->shutter = shutter; this->numShutterKeys = numShutterKeys; }
+
+		/**
+			Renders frames [firstFrame, lastFrame]. Returns once the listener has got all of them.
+		*/
+		void renderFrames(int firstFrame, int lastFrame, IFrameListener& listener);
+
+		inline ThreadPool& getThreadPool() { return threadPool; }
+
+	private:
+		ISceneManager& scene;
+		Camera& camera;
+		Animation& animation;
+		ITileRenderer& tileRenderer;
+		ThreadPool threadPool;
+		int tileSize;
+		bool enableAOVs;
+		float shutter;
+		int numShutterKeys;
+		FrameBuffer* frameBuffers[2];
+
+		void renderFrame(int frame, FrameBuffer& frameBuffer);
+	};
+};
+#endif
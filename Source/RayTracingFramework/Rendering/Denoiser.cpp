@@ -0,0 +1,361 @@
+#include "Denoiser.h"
+#include "FrameBuffer.h"
+#include <thread>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define DENOISER_USE_SSE
+#include <emmintrin.h>
+#endif
+
+namespace {
+	//B3 spline kernel (1D), applied as a separable 5x5 kernel.
+	const float KERNEL[5] = { 1.0f / 16.0f, 1.0f / 4.0f, 3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f };
+	//Albedo channels below this are not divided out (the colour is then filtered as it is).
+	const float MIN_ALBEDO = 0.01f;
+	//Pixels with fewer samples get their variance from their neighbourhood instead.
+	const float MIN_SAMPLES_FOR_VARIANCE = 4.0f;
+	//Depth tolerance that remains when the depth gradient is 0 (relative to the depth of the pixel).
+	const float RELATIVE_DEPTH_EPSILON = 1e-3f;
+
+	inline float luminance(float r, float g, float b) { return 0.2126f * r + 0.7152f * g + 0.0722f * b; }
+
+	//exp(-x) for x >= 0, as 2^(-x log2(e)) with a polynomial for the fractional part (relative error about 1e-7). The SSE version performs
+	//exactly the same operations, so both give the same weights.
+	inline float expNegative(float x) {
+		float t = -x * 1.44269504f;
+		if (!(t >= -126.0f))
+			t = -126.0f;
+		float n = (float)(int)t;
+		if (n > t)
+			n -= 1.0f;
+		float f = t - n;
+		float p = 1.0f + f * (0.693147182f + f * (0.240226507f + f * (0.0555041086f + f * (0.00961812911f + f * 0.00133335581f))));
+		int bits = ((int)n + 127) << 23;
+		float scale;
+		std::memcpy(&scale, &bits, sizeof(float));
+		return p * scale;
+	}
+
+#ifdef DENOISER_USE_SSE
+	inline __m128 expNegative(__m128 x) {
+		const __m128 one = _mm_set1_ps(1.0f);
+		__m128 t = _mm_max_ps(_mm_mul_ps(x, _mm_set1_ps(-1.44269504f)), _mm_set1_ps(-126.0f));
+		__m128 n = _mm_cvtepi32_ps(_mm_cvttps_epi32(t));
+		n = _mm_sub_ps(n, _mm_and_ps(_mm_cmpgt_ps(n, t), one));
+		__m128 f = _mm_sub_ps(t, n);
+		__m128 p = _mm_add_ps(_mm_set1_ps(0.0555041086f), _mm_mul_ps(f, _mm_add_ps(_mm_set1_ps(0.00961812911f), _mm_mul_ps(f, _mm_set1_ps(0.00133335581f)))));
+		p = _mm_add_ps(one, _mm_mul_ps(f, _mm_add_ps(_mm_set1_ps(0.693147182f), _mm_mul_ps(f, _mm_add_ps(_mm_set1_ps(0.240226507f), _mm_mul_ps(f, p))))));
+		__m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(n), _mm_set1_epi32(127)), 23));
+		return _mm_mul_ps(p, scale);
+	}
+
+	inline __m128 absolute(__m128 x) { return _mm_and_ps(x, _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF))); }
+#endif
+}
+
+RayTracingFramework::Denoiser::Denoiser(Settings settings, int numThreads)
+	: settings(settings)
+	, numThreads(numThreads > 0 ? numThreads : (int)std::thread::hardware_concurrency())
+	, frameBuffer(NULL)
+	, width(0)
+	, height(0)
+	, planeSize(0)
+	, current(0)
+	, step(1)
+{
+	if (this->numThreads < 1)
+		this->numThreads = 1;
+}
+
+bool RayTracingFramework::Denoiser::denoise(FrameBuffer& buffer) {
+	if (!buffer.hasAOVs())
+		return false;
+	frameBuffer = &buffer;
+	width = buffer.getWidth();
+	height = buffer.getHeight();
+	planeSize = (size_t)width * height;
+	for (int b = 0; b < 2; b++) {
+		colourPlanes[b].assign(3 * planeSize, 0.0f);
+		variance[b].assign(planeSize, 0.0f);
+	}
+	luminanceScale.assign(planeSize, 0.0f);
+	normalPlanes.assign(3 * planeSize, 0.0f);
+	albedoPlanes.assign(3 * planeSize, 0.0f);
+	demodulation.assign(3 * planeSize, 1.0f);
+	depth.assign(planeSize, 0.0f);
+	depthScale.assign(planeSize, 0.0f);
+	valid.assign(planeSize, 0.0f);
+	current = 0;
+	runPass(PASS_GATHER);
+	runPass(PASS_ESTIMATE_VARIANCE);
+	for (int iteration = 0; iteration < settings.iterations; iteration++) {
+		step = 1 << iteration;
+		runPass(PASS_PREPARE_ITERATION);
+		runPass(PASS_FILTER);
+		current = 1 - current;
+	}
+	runPass(PASS_WRITE);
+	frameBuffer = NULL;
+	return true;
+}
+
+void RayTracingFramework::Denoiser::runPass(Pass pass) {
+	//Each thread processes a band of rows. Every pass only reads what the previous one wrote, so threads just need to be joined between passes.
+	int bands = std::min(numThreads, height);
+	std::vector<std::thread> threads;
+	for (int t = 1; t < bands; t++)
+		threads.push_back(std::thread(&Denoiser::processRows, this, pass, height * t / bands, height * (t + 1) / bands));
+	processRows(pass, 0, bands > 0 ? height / bands : height);
+	for (size_t t = 0; t < threads.size(); t++)
+		threads[t].join();
+}
+
+void RayTracingFramework::Denoiser::processRows(Pass pass, int y0, int y1) {
+	for (int y = y0; y < y1; y++) {
+		switch (pass) {
+		case PASS_GATHER: gatherRow(y); break;
+		case PASS_ESTIMATE_VARIANCE: estimateVarianceRow(y); break;
+		case PASS_PREPARE_ITERATION: prepareIterationRow(y); break;
+		case PASS_FILTER: filterRow(y); break;
+		case PASS_WRITE: writeRow(y); break;
+		}
+	}
+}
+
+void RayTracingFramework::Denoiser::gatherRow(int y) {
+	int originX = frameBuffer->getOriginX(), originY = frameBuffer->getOriginY();
+	for (int x = 0; x < width; x++) {
+		size_t i = (size_t)y * width + x;
+		float pixelDepth = frameBuffer->getDepth(originX + x, originY + y);
+		if (frameBuffer->getWeight(originX + x, originY + y) <= 0 || pixelDepth == FLT_MAX)
+			continue;
+		valid[i] = 1.0f;
+		depth[i] = pixelDepth;
+		Colour colour = frameBuffer->getColour(originX + x, originY + y);
+		Colour albedo = frameBuffer->getAlbedo(originX + x, originY + y);
+		//Normals averaged over the samples of the pixel are shorter than 1.
+		glm::vec3 normal = frameBuffer->getNormal(originX + x, originY + y);
+		if (glm::length(normal) > 0)
+			normal = glm::normalize(normal);
+		for (int c = 0; c < 3; c++) {
+			float factor = (albedo[c] >= MIN_ALBEDO) ? albedo[c] : 1.0f;
+			demodulation[c * planeSize + i] = factor;
+			colourPlanes[0][c * planeSize + i] = colour[c] / factor;
+			albedoPlanes[c * planeSize + i] = albedo[c];
+			normalPlanes[c * planeSize + i] = normal[c];
+		}
+		//Variance of the pixel from its samples (approximately scaled as the colour was, by the luminance of the albedo), or -1 if it has too few.
+		if (frameBuffer->getWeight(originX + x, originY + y) >= MIN_SAMPLES_FOR_VARIANCE) {
+			float scale = luminance(demodulation[i], demodulation[planeSize + i], demodulation[2 * planeSize + i]);
+			variance[0][i] = frameBuffer->getLuminanceVariance(originX + x, originY + y) / (scale * scale);
+		}
+		else
+			variance[0][i] = -1.0f;
+	}
+}
+
+void RayTracingFramework::Denoiser::estimateVarianceRow(int y) {
+	const float* colours = &colourPlanes[0][0];
+	for (int x = 0; x < width; x++) {
+		size_t i = (size_t)y * width + x;
+		if (valid[i] == 0)
+			continue;
+		estimateDepthGradient(i, x, y);
+		if (variance[0][i] >= 0)
+			continue;
+		//Variance of the luminance over the 3x3 neighbourhood (pixels with a few samples have too few to estimate it on their own).
+		float sum = 0, sumSquares = 0, count = 0;
+		for (int qy = std::max(y - 1, 0); qy <= std::min(y + 1, height - 1); qy++)
+			for (int qx = std::max(x - 1, 0); qx <= std::min(x + 1, width - 1); qx++) {
+				size_t j = (size_t)qy * width + qx;
+				if (valid[j] == 0)
+					continue;
+				float l = luminance(colours[j], colours[planeSize + j], colours[2 * planeSize + j]);
+				sum += l;
+				sumSquares += l * l;
+				count++;
+			}
+		float mean = sum / count;
+		variance[0][i] = std::max(sumSquares / count - mean * mean, 0.0f);
+	}
+}
+
+void RayTracingFramework::Denoiser::estimateDepthGradient(size_t i, int x, int y) {
+	//Depth gradient: the smaller one sided difference along each axis (the larger one may cross a silhouette).
+	float gradient[2];
+	for (int axis = 0; axis < 2; axis++) {
+		int dx = (axis == 0), dy = (axis == 1);
+		float difference = FLT_MAX;
+		for (int sign = -1; sign <= 1; sign += 2) {
+			int qx = x + sign * dx, qy = y + sign * dy;
+			if (qx < 0 || qy < 0 || qx >= width || qy >= height || valid[(size_t)qy * width + qx] == 0)
+				continue;
+			difference = std::min(difference, std::fabs(depth[(size_t)qy * width + qx] - depth[i]));
+		}
+		gradient[axis] = (difference == FLT_MAX) ? 0.0f : difference;
+	}
+	depthScale[i] = settings.sigmaDepth * std::sqrt(gradient[0] * gradient[0] + gradient[1] * gradient[1]);
+}
+
+void RayTracingFramework::Denoiser::prepareIterationRow(int y) {
+	//The luminance tolerance uses the variance blurred over 3x3 pixels, which is a steadier estimate.
+	const float* input = &variance[current][0];
+	for (int x = 0; x < width; x++) {
+		size_t i = (size_t)y * width + x;
+		if (valid[i] == 0)
+			continue;
+		float sum = 0, weightSum = 0;
+		for (int dy = -1; dy <= 1; dy++)
+			for (int dx = -1; dx <= 1; dx++) {
+				int qx = x + dx, qy = y + dy;
+				if (qx < 0 || qy < 0 || qx >= width || qy >= height || valid[(size_t)qy * width + qx] == 0)
+					continue;
+				float weight = (dx == 0 ? 0.5f : 0.25f) * (dy == 0 ? 0.5f : 0.25f);
+				sum += weight * input[(size_t)qy * width + qx];
+				weightSum += weight;
+			}
+		luminanceScale[i] = 1.0f / (settings.sigmaLuminance * std::sqrt(sum / weightSum) + 1e-4f);
+	}
+}
+
+void RayTracingFramework::Denoiser::filterRow(int y) {
+	const float* input = &colourPlanes[current][0];
+	const float* inputVariance = &variance[current][0];
+	float* output = &colourPlanes[1 - current][0];
+	float* outputVariance = &variance[1 - current][0];
+	size_t row = (size_t)y * width;
+	int x = 0;
+#ifdef DENOISER_USE_SSE
+	//Blocks of 4 pixels whose taps are all inside the image (the others are filtered one at a time).
+	if (y - 2 * step >= 0 && y + 2 * step < height) {
+		const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+		const __m128 sigmaNormal = _mm_set1_ps(settings.sigmaNormal), inverseSigmaAlbedo = _mm_set1_ps(1.0f / settings.sigmaAlbedo);
+		const __m128 depthEpsilon = _mm_set1_ps(RELATIVE_DEPTH_EPSILON);
+		const __m128 lumR = _mm_set1_ps(0.2126f), lumG = _mm_set1_ps(0.7152f), lumB = _mm_set1_ps(0.0722f);
+		for (; x < 2 * step; x++)
+			filterPixel(row + x, x, y, input, inputVariance, output, outputVariance);
+		for (; x + 3 + 2 * step < width; x += 4) {
+			size_t i = row + x;
+			__m128 centreValid = _mm_cmpgt_ps(_mm_loadu_ps(&valid[i]), zero);
+			__m128 r = _mm_loadu_ps(input + i), g = _mm_loadu_ps(input + planeSize + i), b = _mm_loadu_ps(input + 2 * planeSize + i);
+			__m128 v = _mm_loadu_ps(inputVariance + i);
+			if (_mm_movemask_ps(centreValid) == 0) {
+				_mm_storeu_ps(output + i, r);
+				_mm_storeu_ps(output + planeSize + i, g);
+				_mm_storeu_ps(output + 2 * planeSize + i, b);
+				_mm_storeu_ps(outputVariance + i, v);
+				continue;
+			}
+			__m128 lum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(lumR, r), _mm_mul_ps(lumG, g)), _mm_mul_ps(lumB, b));
+			__m128 lumScale = _mm_loadu_ps(&luminanceScale[i]);
+			__m128 nx = _mm_loadu_ps(&normalPlanes[i]), ny = _mm_loadu_ps(&normalPlanes[planeSize + i]), nz = _mm_loadu_ps(&normalPlanes[2 * planeSize + i]);
+			__m128 z = _mm_loadu_ps(&depth[i]), zScale = _mm_loadu_ps(&depthScale[i]), zEpsilon = _mm_mul_ps(z, depthEpsilon);
+			__m128 ar = _mm_loadu_ps(&albedoPlanes[i]), ag = _mm_loadu_ps(&albedoPlanes[planeSize + i]), ab = _mm_loadu_ps(&albedoPlanes[2 * planeSize + i]);
+			__m128 sumR = zero, sumG = zero, sumB = zero, sumWeights = zero, sumVariance = zero;
+			for (int dy = -2; dy <= 2; dy++) {
+				for (int dx = -2; dx <= 2; dx++) {
+					size_t j = i + (ptrdiff_t)(dy * width + dx) * step;
+					__m128 h = _mm_set1_ps(KERNEL[dx + 2] * KERNEL[dy + 2]);
+					if (dx == 0 && dy == 0) {
+						//The pixel itself always gets the full weight of the centre of the kernel.
+						sumR = _mm_add_ps(sumR, _mm_mul_ps(h, r));
+						sumG = _mm_add_ps(sumG, _mm_mul_ps(h, g));
+						sumB = _mm_add_ps(sumB, _mm_mul_ps(h, b));
+						sumWeights = _mm_add_ps(sumWeights, h);
+						sumVariance = _mm_add_ps(sumVariance, _mm_mul_ps(_mm_mul_ps(h, h), v));
+						continue;
+					}
+					__m128 distance = _mm_set1_ps(step * std::sqrt((float)(dx * dx + dy * dy)));
+					__m128 qr = _mm_loadu_ps(input + j), qg = _mm_loadu_ps(input + planeSize + j), qb = _mm_loadu_ps(input + 2 * planeSize + j);
+					__m128 qLum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(lumR, qr), _mm_mul_ps(lumG, qg)), _mm_mul_ps(lumB, qb));
+					__m128 cosine = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, _mm_loadu_ps(&normalPlanes[j])), _mm_mul_ps(ny, _mm_loadu_ps(&normalPlanes[planeSize + j]))), _mm_mul_ps(nz, _mm_loadu_ps(&normalPlanes[2 * planeSize + j])));
+					__m128 albedoDifference = _mm_add_ps(_mm_add_ps(absolute(_mm_sub_ps(ar, _mm_loadu_ps(&albedoPlanes[j]))), absolute(_mm_sub_ps(ag, _mm_loadu_ps(&albedoPlanes[planeSize + j])))), absolute(_mm_sub_ps(ab, _mm_loadu_ps(&albedoPlanes[2 * planeSize + j]))));
+					__m128 exponent = _mm_mul_ps(absolute(_mm_sub_ps(lum, qLum)), lumScale);
+					exponent = _mm_add_ps(exponent, _mm_mul_ps(sigmaNormal, _mm_max_ps(_mm_sub_ps(one, cosine), zero)));
+					exponent = _mm_add_ps(exponent, _mm_div_ps(absolute(_mm_sub_ps(z, _mm_loadu_ps(&depth[j]))), _mm_add_ps(_mm_mul_ps(zScale, distance), zEpsilon)));
+					exponent = _mm_add_ps(exponent, _mm_mul_ps(albedoDifference, inverseSigmaAlbedo));
+					__m128 weight = _mm_mul_ps(_mm_mul_ps(h, _mm_loadu_ps(&valid[j])), expNegative(exponent));
+					sumR = _mm_add_ps(sumR, _mm_mul_ps(weight, qr));
+					sumG = _mm_add_ps(sumG, _mm_mul_ps(weight, qg));
+					sumB = _mm_add_ps(sumB, _mm_mul_ps(weight, qb));
+					sumWeights = _mm_add_ps(sumWeights, weight);
+					sumVariance = _mm_add_ps(sumVariance, _mm_mul_ps(_mm_mul_ps(weight, weight), _mm_loadu_ps(inputVariance + j)));
+				}
+			}
+			//Pixels that are not valid keep their input (their sums may be 0).
+			__m128 inverseWeight = _mm_div_ps(one, sumWeights);
+			_mm_storeu_ps(output + i, _mm_or_ps(_mm_and_ps(centreValid, _mm_mul_ps(sumR, inverseWeight)), _mm_andnot_ps(centreValid, r)));
+			_mm_storeu_ps(output + planeSize + i, _mm_or_ps(_mm_and_ps(centreValid, _mm_mul_ps(sumG, inverseWeight)), _mm_andnot_ps(centreValid, g)));
+			_mm_storeu_ps(output + 2 * planeSize + i, _mm_or_ps(_mm_and_ps(centreValid, _mm_mul_ps(sumB, inverseWeight)), _mm_andnot_ps(centreValid, b)));
+			__m128 filteredVariance = _mm_mul_ps(sumVariance, _mm_mul_ps(inverseWeight, inverseWeight));
+			_mm_storeu_ps(outputVariance + i, _mm_or_ps(_mm_and_ps(centreValid, filteredVariance), _mm_andnot_ps(centreValid, v)));
+		}
+	}
+#endif
+	for (; x < width; x++)
+		filterPixel(row + x, x, y, input, inputVariance, output, outputVariance);
+}
+
+void RayTracingFramework::Denoiser::filterPixel(size_t i, int x, int y, const float* input, const float* inputVariance, float* output, float* outputVariance) {
+	if (valid[i] == 0) {
+		for (int c = 0; c < 3; c++)
+			output[c * planeSize + i] = input[c * planeSize + i];
+		outputVariance[i] = inputVariance[i];
+		return;
+	}
+	float r = input[i], g = input[planeSize + i], b = input[2 * planeSize + i];
+	float lum = luminance(r, g, b);
+	float zEpsilon = depth[i] * RELATIVE_DEPTH_EPSILON;
+	float sumR = 0, sumG = 0, sumB = 0, sumWeights = 0, sumVariance = 0;
+	for (int dy = -2; dy <= 2; dy++) {
+		int qy = y + dy * step;
+		if (qy < 0 || qy >= height)
+			continue;
+		for (int dx = -2; dx <= 2; dx++) {
+			int qx = x + dx * step;
+			if (qx < 0 || qx >= width)
+				continue;
+			size_t j = (size_t)qy * width + qx;
+			if (valid[j] == 0)
+				continue;
+			float qr = input[j], qg = input[planeSize + j], qb = input[2 * planeSize + j];
+			//The pixel itself always gets the full weight of the centre of the kernel.
+			float exponent = 0;
+			if (j != i) {
+				float distance = step * std::sqrt((float)(dx * dx + dy * dy));
+				float cosine = normalPlanes[i] * normalPlanes[j] + normalPlanes[planeSize + i] * normalPlanes[planeSize + j] + normalPlanes[2 * planeSize + i] * normalPlanes[2 * planeSize + j];
+				float albedoDifference = std::fabs(albedoPlanes[i] - albedoPlanes[j]) + std::fabs(albedoPlanes[planeSize + i] - albedoPlanes[planeSize + j]) + std::fabs(albedoPlanes[2 * planeSize + i] - albedoPlanes[2 * planeSize + j]);
+				exponent = std::fabs(lum - luminance(qr, qg, qb)) * luminanceScale[i];
+				exponent += settings.sigmaNormal * std::max(1.0f - cosine, 0.0f);
+				exponent += std::fabs(depth[i] - depth[j]) / (depthScale[i] * distance + zEpsilon);
+				exponent += albedoDifference * (1.0f / settings.sigmaAlbedo);
+			}
+			float weight = KERNEL[dx + 2] * KERNEL[dy + 2] * expNegative(exponent);
+			sumR += weight * qr;
+			sumG += weight * qg;
+			sumB += weight * qb;
+			sumWeights += weight;
+			sumVariance += weight * weight * inputVariance[j];
+		}
+	}
+	output[i] = sumR / sumWeights;
+	output[planeSize + i] = sumG / sumWeights;
+	output[2 * planeSize + i] = sumB / sumWeights;
+	outputVariance[i] = sumVariance / (sumWeights * sumWeights);
+}
+
+void RayTracingFramework::Denoiser::writeRow(int y) {
+	const float* colours = &colourPlanes[current][0];
+	for (int x = 0; x < width; x++) {
+		size_t i = (size_t)y * width + x;
+		if (valid[i] == 0)
+			continue;
+		Colour colour;
+		for (int c = 0; c < 3; c++)
+			colour[c] = colours[c * planeSize + i] * demodulation[c * planeSize + i];
+		frameBuffer->setColour(frameBuffer->getOriginX() + x, frameBuffer->getOriginY() + y, colour);
+	}
+}
@@ -0,0 +1,81 @@
+/**
+	CLASS: Denoiser
+	DESCRIPTION: Image space denoiser for images with few samples per pixel (e.g. a few progressive passes of path tracing), guided by the AOVs of the
+	FrameBuffer. It is an edge avoiding a-trous wavelet filter (H. Dammertz et al., "Edge-avoiding a-trous wavelet transform for fast global illumination
+	filtering"), with the luminance weights of SVGF (C. Schied et al.):
+	- Colours are divided by the albedo of the primary hit before filtering (and multiplied back afterwards), so textures are not blurred, only lighting.
+	- Each iteration applies a 5x5 B3 spline kernel whose taps are spread twice as far as in the previous one (1, 2, 4, 8... pixels apart), so 3 iterations
+	cover 29x29 pixels with just 25 taps per pixel each.
+	- Taps are weighted down when their normal, depth (relative to the depth gradient of the pixel), albedo or luminance differ from the ones of the pixel.
+	The luminance tolerance grows with the standard deviation of the noise of the pixel (estimated from its samples, or from its neighbourhood if it has just a few),
+	which is filtered along with the colour.
+	Only the lighting of the primary hits is guided by the AOVs: reflections and refractions are kept apart just by the luminance weights, so they are smoothed less.
+	Pixels without samples or that hit nothing are neither changed nor used. Rows are shared among several threads, and 4 pixels are filtered at a time
+	with SSE instructions (when available); the result does not depend on the number of threads.
+*/
+#ifndef _DENOISER_RAYTRACINGFRAMEWORK
+#define _DENOISER_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include <vector>
+
+namespace RayTracingFramework{
+	class FrameBuffer;
+
+	class Denoiser
+	{
+	public:
+		struct Settings {
+			int iterations;				//Number of a-trous iterations (the footprint of the filter doubles with each one).
+			float sigmaLuminance;		//Luminance tolerance, in standard deviations of the noise.
+			float sigmaNormal;			//Normal sharpness (weights fall as exp(-sigmaNormal * (1 - cos(angle between the normals)))).
+			float sigmaDepth;			//Depth tolerance, relative to the change of depth expected from the depth gradient.
+			float sigmaAlbedo;			//Albedo tolerance (sum of the differences of the 3 channels).
+			Settings(int iterations = 3, float sigmaLuminance = 2.0f, float sigmaNormal = 128.0f, float sigmaDepth = 1.0f, float sigmaAlbedo = 0.1f)
+				: iterations(iterations), sigmaLuminance(sigmaLuminance), sigmaNormal(sigmaNormal), sigmaDepth(sigmaDepth), sigmaAlbedo(sigmaAlbedo) { ; }
+		};
+
+		/**
+			@param numThreads: Threads used (0 -> one per hardware thread).
+		*/
+		Denoiser(Settings settings = Settings(), int numThreads = 0);
+
+		inline Settings& getSettings() { return settings; }
+
+		/**
+			Replaces the colours of frameBuffer by denoised ones. Returns false (leaving it unchanged) if it has no AOVs.
+		*/
+		bool denoise(FrameBuffer& frameBuffer);
+
+	private:
+		enum Pass { PASS_GATHER, PASS_ESTIMATE_VARIANCE, PASS_PREPARE_ITERATION, PASS_FILTER, PASS_WRITE };
+
+		Settings settings;
+		int numThreads;
+		//Working buffers (planes of width x height values, kept between calls).
+		FrameBuffer* frameBuffer;
+		int width, height;
+		size_t planeSize;
+		std::vector<float> colourPlanes[2];		//Demodulated colours (R, G, B planes), input and output of each iteration.
+		std::vector<float> variance[2];			//Variance of the luminance of the demodulated colours, filtered along with them.
+		std::vector<float> luminanceScale;		//1 / (sigmaLuminance * standard deviation) of each pixel in the current iteration.
+		std::vector<float> normalPlanes;		//X, Y, Z planes.
+		std::vector<float> albedoPlanes;		//R, G, B planes (as in the frame buffer).
+		std::vector<float> demodulation;		//R, G, B planes: albedo, or 1 for channels without albedo.
+		std::vector<float> depth;
+		std::vector<float> depthScale;			//sigmaDepth * depth gradient of each pixel (change of depth expected per pixel).
+		std::vector<float> valid;				//1 for pixels with samples and a primary hit, 0 otherwise.
+		int current;							//Planes (of colourPlanes/variance) holding the input of the next iteration.
+		int step;								//Distance between the taps of the current iteration.
+
+		void runPass(Pass pass);
+		void processRows(Pass pass, int y0, int y1);
+		void gatherRow(int y);
+		void estimateVarianceRow(int y);
+		void estimateDepthGradient(size_t i, int x, int y);
+		void prepareIterationRow(int y);
+		void filterRow(int y);
+		void filterPixel(size_t i, int x, int y, const float* input, const float* inputVariance, float* output, float* outputVariance);
+		void writeRow(int y);
+	};
+};
+#endif
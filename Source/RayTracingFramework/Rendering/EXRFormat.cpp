@@ -0,0 +1,110 @@
+#include "EXRFormat.h"
+#include <cstring>
+
+bool RayTracingFramework::EXRFormat::Channel::operator<(const Channel& other) const {
+	return strcmp(name, other.name) < 0;
+}
+
+int RayTracingFramework::EXRFormat::seek(FILE* file, long long offset, int origin) {
+#ifdef _MSC_VER
+	return _fseeki64(file, offset, origin);
+#else
+	return fseeko(file, (off_t)offset, origin);
+#endif
+}
+
+long long RayTracingFramework::EXRFormat::tell(FILE* file) {
+#ifdef _MSC_VER
+	return _ftelli64(file);
+#else
+	return (long long)ftello(file);
+#endif
+}
+
+void RayTracingFramework::EXRFormat::writeAttribute(std::vector<char>& header, const char* name, const char* type, const void* data, int size) {
+	header.insert(header.end(), name, name + strlen(name) + 1);
+	header.insert(header.end(), type, type + strlen(type) + 1);
+	header.insert(header.end(), (const char*)&size, (const char*)&size + 4);
+	header.insert(header.end(), (const char*)data, (const char*)data + size);
+}
+
+void RayTracingFramework::EXRFormat::createHeader(std::vector<char>& header, const std::vector<Channel>& channels, Compression compression,
+	int x0, int y0, int width, int height, int tileWidth, int tileHeight) {
+	header.clear();
+	uint32_t magic = 20000630, version = 2;
+	if (tileWidth > 0)
+		version |= 0x200;	//Single part, tiled.
+	header.insert(header.end(), (const char*)&magic, (const char*)&magic + 4);
+	header.insert(header.end(), (const char*)&version, (const char*)&version + 4);
+	//Attributes, in alphabetical order.
+	std::vector<char> channelList;
+	for (size_t c = 0; c < channels.size(); c++) {
+		int32_t description[4] = { channels[c].pixelType, 0, 1, 1 };	//Type, pLinear + reserved, x sampling, y sampling.
+		channelList.insert(channelList.end(), channels[c].name, channels[c].name + strlen(channels[c].name) + 1);
+		channelList.insert(channelList.end(), (const char*)description, (const char*)description + 16);
+	}
+	channelList.push_back(0);
+	writeAttribute(header, "channels", "chlist", &channelList[0], (int)channelList.size());
+	unsigned char compressionValue = (unsigned char)compression;
+	unsigned char lineOrder = (tileWidth > 0) ? 2 : 0;	//RANDOM_Y (tiles are written as they are finished) : INCREASING_Y.
+	writeAttribute(header, "compression", "compression", &compressionValue, 1);
+	int32_t window[4] = { x0, y0, x0 + width - 1, y0 + height - 1 };
+	writeAttribute(header, "dataWindow", "box2i", window, 16);
+	writeAttribute(header, "displayWindow", "box2i", window, 16);
+	writeAttribute(header, "lineOrder", "lineOrder", &lineOrder, 1);
+	float aspectRatio = 1.0f, screenCentre[2] = { 0, 0 }, screenWidth = 1.0f;
+	writeAttribute(header, "pixelAspectRatio", "float", &aspectRatio, 4);
+	writeAttribute(header, "screenWindowCenter", "v2f", screenCentre, 8);
+	writeAttribute(header, "screenWindowWidth", "float", &screenWidth, 4);
+	if (tileWidth > 0) {
+		unsigned char tileDescription[9];
+		uint32_t size[2] = { (uint32_t)tileWidth, (uint32_t)tileHeight };
+		memcpy(tileDescription, size, 8);
+		tileDescription[8] = 0;	//ONE_LEVEL, ROUND_DOWN.
+		writeAttribute(header, "tiles", "tiledesc", tileDescription, 9);
+	}
+	header.push_back(0);
+}
+
+int RayTracingFramework::EXRFormat::compressRLE(const unsigned char* input, int size, std::vector<unsigned char>& scratch, std::vector<signed char>& output) {
+	const int MIN_RUN_LENGTH = 3, MAX_RUN_LENGTH = 127;
+	scratch.resize(size);
+	//1. Split even and odd bytes.
+	unsigned char* t1 = &scratch[0];
+	unsigned char* t2 = &scratch[0] + (size + 1) / 2;
+	for (int i = 0; i < size; i++)
+		*((i % 2 == 0) ? t1++ : t2++) = input[i];
+	//2. Delta predictor.
+	int previous = scratch[0];
+	for (int i = 1; i < size; i++) {
+		int d = (int)scratch[i] - previous + (128 + 256);
+		previous = scratch[i];
+		scratch[i] = (unsigned char)d;
+	}
+	//3. Runs. Worst case (no runs): a count byte for every MAX_RUN_LENGTH literals.
+	output.resize(size + (size + MAX_RUN_LENGTH - 1) / MAX_RUN_LENGTH + 2);
+	const signed char* in = (const signed char*)&scratch[0];
+	const signed char* inEnd = in + size;
+	const signed char* runStart = in;
+	const signed char* runEnd = in + 1;
+	signed char* out = &output[0];
+	while (runStart < inEnd) {
+		while (runEnd < inEnd && *runStart == *runEnd && runEnd - runStart - 1 < MAX_RUN_LENGTH)
+			++runEnd;
+		if (runEnd - runStart >= MIN_RUN_LENGTH) {
+			*out++ = (signed char)((runEnd - runStart) - 1);
+			*out++ = *runStart;
+			runStart = runEnd;
+		}
+		else {
+			while (runEnd < inEnd && ((runEnd + 1 >= inEnd || *runEnd != *(runEnd + 1)) || (runEnd + 2 >= inEnd || *(runEnd + 1) != *(runEnd + 2)))
+				&& runEnd - runStart < MAX_RUN_LENGTH)
+				++runEnd;
+			*out++ = (signed char)(runStart - runEnd);
+			while (runStart < runEnd)
+				*out++ = *runStart++;
+		}
+		++runEnd;
+	}
+	return (int)(out - &output[0]);
+}
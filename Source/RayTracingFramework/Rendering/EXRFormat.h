@@ -0,0 +1,47 @@
+/**
+	CLASS: EXRFormat
+	DESCRIPTION: The parts of the OpenEXR file format shared by the writers of the framework (FrameBuffer::writeEXR for whole images,
+	TiledEXRWriter for images streamed tile by tile): header creation and RLE compression of the pixel data of a chunk.
+	Only what these writers need is supported: 32 bit float/uint channels, no or RLE compression, single part scanline or tiled (one level) files.
+*/
+#ifndef _EXRFORMAT_RAYTRACINGFRAMEWORK
+#define _EXRFORMAT_RAYTRACINGFRAMEWORK
+#include <vector>
+#include <cstdio>
+#include <stdint.h>
+
+namespace RayTracingFramework{
+	class EXRFormat
+	{
+	public:
+		enum PixelType { PIXEL_UINT = 0, PIXEL_FLOAT = 2 };
+		enum Compression { NO_COMPRESSION = 0, RLE_COMPRESSION = 1 };
+
+		struct Channel {
+			const char* name;
+			PixelType pixelType;
+			bool operator<(const Channel& other) const;
+		};
+
+		/**
+			Builds the header (magic number, version, attributes) of a single part file covering pixels [x0, x0 + width) x [y0, y0 + height).
+			Channels must be sorted alphabetically. If tileWidth > 0, the header describes a tiled file (one level, tiles stored in any order).
+		*/
+		static void createHeader(std::vector<char>& header, const std::vector<Channel>& channels, Compression compression,
+			int x0, int y0, int width, int height, int tileWidth = 0, int tileHeight = 0);
+
+		/**
+			OpenEXR RLE compression (byte reordering + delta predictor + run length encoding), as in the OpenEXR library.
+			Returns the compressed size. Chunks that do not get smaller must be stored uncompressed (readers detect it from their size).
+		*/
+		static int compressRLE(const unsigned char* input, int size, std::vector<unsigned char>& scratch, std::vector<signed char>& output);
+
+		//64 bit file positions (offset tables of big images point beyond 2GB).
+		static int seek(FILE* file, long long offset, int origin = SEEK_SET);
+		static long long tell(FILE* file);
+
+	private:
+		static void writeAttribute(std::vector<char>& header, const char* name, const char* type, const void* data, int size);
+	};
+};
+#endif
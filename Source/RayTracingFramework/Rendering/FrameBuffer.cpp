@@ -0,0 +1,379 @@
+#include "FrameBuffer.h"
+#include "EXRFormat.h"
+#include "RayTracingFramework\Ray.h"
+#include "RayTracingFramework\Material.h"
+#include "RayTracingFramework\VirtualObject\ISceneManager.h"
+#include "RayTracingFramework\VirtualObject\IVirtualObject.h"
+#include "RayTracingFramework\ShadingModels\IShadingModel.h"
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define FRAMEBUFFER_USE_SSE
+#include <emmintrin.h>
+#endif
+
+namespace {
+	//Maps [0, inf) colours to [0, 1] with the selected operator, 4 values at a time when SSE is available.
+	void toneMapValues(float* values, int count, RayTracingFramework::FrameBuffer::ToneMapping settings) {
+		float scale = std::pow(2.0f, settings.exposure);
+		int i = 0;
+#ifdef FRAMEBUFFER_USE_SSE
+		__m128 vScale = _mm_set1_ps(scale), zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+		for (; i + 4 <= count; i += 4) {
+			__m128 x = _mm_mul_ps(_mm_loadu_ps(values + i), vScale);
+			if (settings.op == RayTracingFramework::FrameBuffer::TONEMAP_REINHARD)
+				x = _mm_div_ps(x, _mm_add_ps(one, x));
+			else if (settings.op == RayTracingFramework::FrameBuffer::TONEMAP_ACES) {
+				__m128 numerator = _mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(2.51f)), _mm_set1_ps(0.03f)));
+				__m128 denominator = _mm_add_ps(_mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(2.43f)), _mm_set1_ps(0.59f))), _mm_set1_ps(0.14f));
+				x = _mm_div_ps(numerator, denominator);
+			}
+			_mm_storeu_ps(values + i, _mm_min_ps(_mm_max_ps(x, zero), one));
+		}
+#endif
+		for (; i < count; i++) {
+			float x = values[i] * scale;
+			if (settings.op == RayTracingFramework::FrameBuffer::TONEMAP_REINHARD)
+				x = x / (1.0f + x);
+			else if (settings.op == RayTracingFramework::FrameBuffer::TONEMAP_ACES)
+				x = (x * (2.51f * x + 0.03f)) / (x * (2.43f * x + 0.59f) + 0.14f);
+			values[i] = (x < 0) ? 0 : (x > 1 ? 1 : x);
+		}
+		if (settings.gamma != 1.0f)
+			for (i = 0; i < count; i++)
+				values[i] = std::pow(values[i], 1.0f / settings.gamma);
+	}
+
+	//[0,1] -> [0,255] (truncating, as the original conversion in main.cpp).
+	void convertToBytes(const float* values, unsigned char* bytes, int count) {
+		int i = 0;
+#ifdef FRAMEBUFFER_USE_SSE
+		__m128 vScale = _mm_set1_ps(255.0f);
+		for (; i + 8 <= count; i += 8) {
+			__m128i low = _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(values + i), vScale));
+			__m128i high = _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(values + i + 4), vScale));
+			__m128i words = _mm_packs_epi32(low, high);
+			_mm_storel_epi64((__m128i*)(bytes + i), _mm_packus_epi16(words, words));
+		}
+#endif
+		for (; i < count; i++)
+			bytes[i] = (unsigned char)(values[i] * 255.0f);
+	}
+}
+
+RayTracingFramework::FrameBuffer::FrameBuffer(int width, int height, bool enableAOVs, int originX, int originY)
+	: width(width)
+	, height(height)
+	, originX(originX)
+	, originY(originY)
+	, planeSize((size_t)width * height)
+{
+	colourPlanes.assign(3 * planeSize, 0.0f);
+	weights.assign(planeSize, 0.0f);
+	if (enableAOVs) {
+		depth.assign(planeSize, FLT_MAX);
+		normalPlanes.assign(3 * planeSize, 0.0f);
+		albedoPlanes.assign(3 * planeSize, 0.0f);
+		objectIDs.assign(planeSize, (uint32_t)IVirtualObject::INVALID_OBJECT_ID);
+		luminanceMoments.assign(planeSize, 0.0f);
+		aovSamples.assign(planeSize, 0.0f);
+	}
+}
+
+size_t RayTracingFramework::FrameBuffer::getMemoryBytes() {
+	return sizeof(FrameBuffer) + (colourPlanes.capacity() + weights.capacity() + depth.capacity() + normalPlanes.capacity() + albedoPlanes.capacity()
+		+ luminanceMoments.capacity() + aovSamples.capacity()) * sizeof(float) + objectIDs.capacity() * sizeof(uint32_t);
+}
+
+void RayTracingFramework::FrameBuffer::clear() {
+	std::fill(colourPlanes.begin(), colourPlanes.end(), 0.0f);
+	std::fill(weights.begin(), weights.end(), 0.0f);
+	std::fill(depth.begin(), depth.end(), FLT_MAX);
+	std::fill(normalPlanes.begin(), normalPlanes.end(), 0.0f);
+	std::fill(albedoPlanes.begin(), albedoPlanes.end(), 0.0f);
+	std::fill(objectIDs.begin(), objectIDs.end(), (uint32_t)IVirtualObject::INVALID_OBJECT_ID);
+	std::fill(luminanceMoments.begin(), luminanceMoments.end(), 0.0f);
+	std::fill(aovSamples.begin(), aovSamples.end(), 0.0f);
+}
+
+RayTracingFramework::Colour RayTracingFramework::FrameBuffer::getColour(int x, int y) {
+	size_t i = pixelIndex(x, y);
+	if (weights[i] <= 0)
+		return Colour(0, 0, 0);
+	return Colour(colourPlanes[i], colourPlanes[planeSize + i], colourPlanes[2 * planeSize + i]) / weights[i];
+}
+
+float RayTracingFramework::FrameBuffer::getLuminanceVariance(int x, int y) {
+	size_t i = pixelIndex(x, y);
+	float count = weights[i];
+	if (count < 2)
+		return 0;
+	Colour mean = Colour(colourPlanes[i], colourPlanes[planeSize + i], colourPlanes[2 * planeSize + i]) / count;
+	float meanLuminance = 0.2126f * mean.r + 0.7152f * mean.g + 0.0722f * mean.b;
+	//Unbiased variance of the samples, then of their average.
+	float sampleVariance = std::max(luminanceMoments[i] - count * meanLuminance * meanLuminance, 0.0f) / (count - 1);
+	return sampleVariance / count;
+}
+
+void RayTracingFramework::FrameBuffer::setColour(int x, int y, Colour colour) {
+	size_t i = pixelIndex(x, y);
+	if (weights[i] <= 0)
+		return;
+	colourPlanes[i] = colour.r * weights[i];
+	colourPlanes[planeSize + i] = colour.g * weights[i];
+	colourPlanes[2 * planeSize + i] = colour.b * weights[i];
+}
+
+void RayTracingFramework::FrameBuffer::setAOVs(int x, int y, Ray& ray, IScene& scene) {
+	if (!hasAOVs())
+		return;
+	size_t i = pixelIndex(x, y);
+	Ray::Intersection intersection = ray.getClosestIntersection();
+	if (intersection.t_distance == FLT_MAX) {
+		if (aovSamples[i] == 0) {
+			depth[i] = FLT_MAX;
+			objectIDs[i] = IVirtualObject::INVALID_OBJECT_ID;
+		}
+		return;
+	}
+	glm::vec4 point = toMatrix(intersection.fromObjectToWorldCoords) * intersection.collisionPoint_InObjectCoords;
+	point /= point.w;
+	glm::vec3 normal = glm::normalize(glm::vec3(toMatrix(intersection.fromObjectToWorldCoords) * intersection.collisionNormalVector_InObjectCoords));
+	Material& material = scene.getNodeByID(intersection.collidingObjectID).getMaterial();
+	Colour albedo, specular;
+	scene.getShadingModel().getSurfaceColours(intersection, material, albedo, specular);
+	if (aovSamples[i] == 0) {
+		depth[i] = glm::length(glm::vec3(point) - glm::vec3(ray.origin_InWorldCoords));
+		objectIDs[i] = intersection.collidingObjectID;
+	}
+	//Running averages (the planes always hold the average, for the writers).
+	float samples = ++aovSamples[i];
+	for (int c = 0; c < 3; c++) {
+		normalPlanes[c * planeSize + i] += (normal[c] - normalPlanes[c * planeSize + i]) / samples;
+		albedoPlanes[c * planeSize + i] += (albedo[c] - albedoPlanes[c * planeSize + i]) / samples;
+	}
+}
+
+void RayTracingFramework::FrameBuffer::resolveRow(int y, float* red, float* green, float* blue) {
+	size_t row = (size_t)y * width;
+	const float* w = &weights[row];
+	const float* sums[3] = { &colourPlanes[row], &colourPlanes[planeSize + row], &colourPlanes[2 * planeSize + row] };
+	float* outputs[3] = { red, green, blue };
+	int x = 0;
+#ifdef FRAMEBUFFER_USE_SSE
+	__m128 zero = _mm_setzero_ps();
+	for (; x + 4 <= width; x += 4) {
+		__m128 weight = _mm_loadu_ps(w + x);
+		__m128 valid = _mm_cmpgt_ps(weight, zero);
+		__m128 inverse = _mm_and_ps(valid, _mm_div_ps(_mm_set1_ps(1.0f), _mm_max_ps(weight, _mm_set1_ps(1e-30f))));
+		for (int c = 0; c < 3; c++)
+			_mm_storeu_ps(outputs[c] + x, _mm_mul_ps(_mm_loadu_ps(sums[c] + x), inverse));
+	}
+#endif
+	for (; x < width; x++)
+		for (int c = 0; c < 3; c++)
+			outputs[c][x] = (w[x] > 0) ? sums[c][x] / w[x] : 0.0f;
+}
+
+void RayTracingFramework::FrameBuffer::toneMap(cimg_library::CImg<unsigned char>& image, ToneMapping settings, int y0, int y1) {
+	//Rows of the image covered by this buffer.
+	y0 = std::max(y0, originY);
+	if (y1 < 0 || y1 > originY + height)
+		y1 = originY + height;
+	std::vector<float> row(3 * width);
+	std::vector<unsigned char> bytes(3 * width);
+	for (int y = y0; y < y1; y++) {
+		resolveRow(y - originY, &row[0], &row[width], &row[2 * width]);
+		toneMapValues(&row[0], 3 * width, settings);
+		convertToBytes(&row[0], &bytes[0], 3 * width);
+		const float* w = &weights[(size_t)(y - originY) * width];
+		for (int c = 0; c < 3 && c < image.spectrum(); c++)
+			for (int x = 0; x < width; x++)
+				if (w[x] > 0)
+					image(originX + x, y, 0, c) = bytes[c * width + x];
+	}
+}
+
+bool RayTracingFramework::FrameBuffer::writePFM(const char* fileName, Output output) {
+	if (output != OUTPUT_COLOUR && !hasAOVs())
+		return false;
+	FILE* file = fopen(fileName, "wb");
+	if (!file)
+		return false;
+	int channels = (output == OUTPUT_DEPTH || output == OUTPUT_OBJECT_ID) ? 1 : 3;
+	//Negative scale -> little endian. Rows are stored from the bottom to the top.
+	bool ok = fprintf(file, "%s\n%d %d\n-1.0\n", channels == 3 ? "PF" : "Pf", width, height) > 0;
+	std::vector<float> planes(3 * width), interleaved(channels * width);
+	for (int y = height - 1; ok && y >= 0; y--) {
+		size_t row = (size_t)y * width;
+		if (output == OUTPUT_COLOUR)
+			resolveRow(y, &planes[0], &planes[width], &planes[2 * width]);
+		for (int x = 0; x < width; x++) {
+			switch (output) {
+			case OUTPUT_COLOUR:
+				for (int c = 0; c < 3; c++) interleaved[3 * x + c] = planes[c * width + x];
+				break;
+			case OUTPUT_NORMAL:
+				for (int c = 0; c < 3; c++) interleaved[3 * x + c] = normalPlanes[c * planeSize + row + x];
+				break;
+			case OUTPUT_ALBEDO:
+				for (int c = 0; c < 3; c++) interleaved[3 * x + c] = albedoPlanes[c * planeSize + row + x];
+				break;
+			case OUTPUT_DEPTH:
+				interleaved[x] = depth[row + x];
+				break;
+			case OUTPUT_OBJECT_ID:
+				interleaved[x] = (float)objectIDs[row + x];
+				break;
+			}
+		}
+		ok = fwrite(&interleaved[0], sizeof(float), interleaved.size(), file) == interleaved.size();
+	}
+	fclose(file);
+	return ok;
+}
+
+void RayTracingFramework::FrameBuffer::getEXRChannels(std::vector<EXRFormat::Channel>& channels) {
+	channels.clear();
+	EXRFormat::Channel colourChannels[3] = { { "R", EXRFormat::PIXEL_FLOAT }, { "G", EXRFormat::PIXEL_FLOAT }, { "B", EXRFormat::PIXEL_FLOAT } };
+	channels.insert(channels.end(), colourChannels, colourChannels + 3);
+	if (hasAOVs()) {
+		EXRFormat::Channel aovChannels[8] = { { "Z", EXRFormat::PIXEL_FLOAT }, { "N.X", EXRFormat::PIXEL_FLOAT }, { "N.Y", EXRFormat::PIXEL_FLOAT },
+			{ "N.Z", EXRFormat::PIXEL_FLOAT }, { "albedo.R", EXRFormat::PIXEL_FLOAT }, { "albedo.G", EXRFormat::PIXEL_FLOAT },
+			{ "albedo.B", EXRFormat::PIXEL_FLOAT }, { "objectID", EXRFormat::PIXEL_UINT } };
+		channels.insert(channels.end(), aovChannels, aovChannels + 8);
+	}
+	std::sort(channels.begin(), channels.end());
+}
+
+void RayTracingFramework::FrameBuffer::packEXRRow(const std::vector<EXRFormat::Channel>& channels, int y, int x0, int x1, unsigned char* output) {
+	int count = x1 - x0;
+	size_t row = pixelIndex(x0, y);
+	std::vector<float> resolved(3 * width);
+	resolveRow(y - originY, &resolved[0], &resolved[width], &resolved[2 * width]);
+	const float* resolvedRow = &resolved[x0 - originX];
+	for (size_t c = 0; c < channels.size(); c++) {
+		const char* name = channels[c].name;
+		const void* source = NULL;
+		if (!strcmp(name, "R")) source = resolvedRow;
+		else if (!strcmp(name, "G")) source = resolvedRow + width;
+		else if (!strcmp(name, "B")) source = resolvedRow + 2 * width;
+		else if (!strcmp(name, "Z")) source = &depth[row];
+		else if (!strcmp(name, "N.X")) source = &normalPlanes[row];
+		else if (!strcmp(name, "N.Y")) source = &normalPlanes[planeSize + row];
+		else if (!strcmp(name, "N.Z")) source = &normalPlanes[2 * planeSize + row];
+		else if (!strcmp(name, "albedo.R")) source = &albedoPlanes[row];
+		else if (!strcmp(name, "albedo.G")) source = &albedoPlanes[planeSize + row];
+		else if (!strcmp(name, "albedo.B")) source = &albedoPlanes[2 * planeSize + row];
+		else if (!strcmp(name, "objectID")) source = &objectIDs[row];
+		if (source)
+			memcpy(output, source, 4 * count);
+		else
+			memset(output, 0, 4 * count);
+		output += 4 * count;
+	}
+}
+
+void RayTracingFramework::FrameBuffer::serialize(std::vector<unsigned char>& data) {
+	int32_t window[5] = { width, height, originX, originY, hasAOVs() ? 1 : 0 };
+	data.assign((const unsigned char*)window, (const unsigned char*)(window + 5));
+	const std::vector<float>* planes[7] = { &colourPlanes, &weights, &depth, &normalPlanes, &albedoPlanes, &luminanceMoments, &aovSamples };
+	for (int p = 0; p < 7; p++)
+		if (!planes[p]->empty())
+			data.insert(data.end(), (const unsigned char*)&(*planes[p])[0], (const unsigned char*)(&(*planes[p])[0] + planes[p]->size()));
+	if (!objectIDs.empty())
+		data.insert(data.end(), (const unsigned char*)&objectIDs[0], (const unsigned char*)(&objectIDs[0] + objectIDs.size()));
+}
+
+size_t RayTracingFramework::FrameBuffer::getSerializedSize() {
+	//Window, then 4 planes (colour and weight) or 14 with the AOVs, 4 bytes per value.
+	return 5 * sizeof(int32_t) + 4 * planeSize * (hasAOVs() ? 14 : 4);
+}
+
+bool RayTracingFramework::FrameBuffer::accumulate(const unsigned char* data, size_t size) {
+	int32_t window[5];
+	if (size < sizeof(window))
+		return false;
+	memcpy(window, data, sizeof(window));
+	int w = window[0], h = window[1], x0 = window[2], y0 = window[3];
+	bool aovs = window[4] != 0;
+	size_t pixels = (size_t)w * h;
+	if (w < 0 || h < 0 || size != sizeof(window) + 4 * pixels * (aovs ? 14 : 4))
+		return false;
+	const float* colour = (const float*)(data + sizeof(window));
+	const float* weight = colour + 3 * pixels;
+	const float* aovDepth = weight + pixels;
+	const float* aovNormal = aovDepth + pixels;
+	const float* aovAlbedo = aovNormal + 3 * pixels;
+	const float* aovMoments = aovAlbedo + 3 * pixels;
+	const float* aovSampleCounts = aovMoments + pixels;
+	const uint32_t* aovIDs = (const uint32_t*)(aovSampleCounts + pixels);
+	bool copyAOVs = aovs && hasAOVs();
+	//Pixels shared by both windows.
+	int xBegin = std::max(x0, originX), xEnd = std::min(x0 + w, originX + width);
+	int yBegin = std::max(y0, originY), yEnd = std::min(y0 + h, originY + height);
+	for (int y = yBegin; y < yEnd; y++) {
+		for (int x = xBegin; x < xEnd; x++) {
+			size_t source = (size_t)(y - y0) * w + (x - x0), target = pixelIndex(x, y);
+			for (int c = 0; c < 3; c++)
+				colourPlanes[c * planeSize + target] += colour[c * pixels + source];
+			weights[target] += weight[source];
+			if (copyAOVs) {
+				//Moments are sums, like the colours.
+				luminanceMoments[target] += aovMoments[source];
+				depth[target] = aovDepth[source];
+				aovSamples[target] = aovSampleCounts[source];
+				objectIDs[target] = aovIDs[source];
+				for (int c = 0; c < 3; c++) {
+					normalPlanes[c * planeSize + target] = aovNormal[c * pixels + source];
+					albedoPlanes[c * planeSize + target] = aovAlbedo[c * pixels + source];
+				}
+			}
+		}
+	}
+	return true;
+}
+
+bool RayTracingFramework::FrameBuffer::writeEXR(const char* fileName, EXRCompression compression) {
+	//1. Channels and header.
+	std::vector<EXRFormat::Channel> channels;
+	getEXRChannels(channels);
+	std::vector<char> header;
+	EXRFormat::createHeader(header, channels, (EXRFormat::Compression)compression, originX, originY, width, height);
+
+	FILE* file = fopen(fileName, "wb");
+	if (!file)
+		return false;
+	bool ok = fwrite(&header[0], 1, header.size(), file) == header.size();
+	//2. Offset table (one chunk per scanline). Its values are only known once the (compressed) chunks have been written.
+	long long tablePosition = (long long)header.size();
+	std::vector<uint64_t> offsets(height, 0);
+	ok = ok && fwrite(&offsets[0], sizeof(uint64_t), offsets.size(), file) == offsets.size();
+	uint64_t position = (uint64_t)tablePosition + sizeof(uint64_t) * offsets.size();
+
+	//3. Chunks: y, size, then one row of each channel.
+	int rowBytes = width * 4 * (int)channels.size();
+	std::vector<unsigned char> rowData(rowBytes), scratch;
+	std::vector<signed char> compressed;
+	for (int y = 0; ok && y < height; y++) {
+		packEXRRow(channels, originY + y, originX, originX + width, &rowData[0]);
+		const void* chunk = &rowData[0];
+		int32_t chunkHeader[2] = { originY + y, rowBytes };
+		if (compression == EXR_RLE_COMPRESSION) {
+			int compressedSize = EXRFormat::compressRLE(&rowData[0], rowBytes, scratch, compressed);
+			if (compressedSize < rowBytes) {//Otherwise the row is stored uncompressed (readers detect it from the size).
+				chunk = &compressed[0];
+				chunkHeader[1] = compressedSize;
+			}
+		}
+		offsets[y] = position;
+		ok = fwrite(chunkHeader, 4, 2, file) == 2 && fwrite(chunk, 1, chunkHeader[1], file) == (size_t)chunkHeader[1];
+		position += 8 + chunkHeader[1];
+	}
+	ok = ok && EXRFormat::seek(file, tablePosition) == 0 && fwrite(&offsets[0], sizeof(uint64_t), offsets.size(), file) == offsets.size();
+	fclose(file);
+	return ok;
+}
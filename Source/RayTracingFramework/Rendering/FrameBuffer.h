@@ -0,0 +1,159 @@
+/**
+	CLASS: FrameBuffer
+	DESCRIPTION: High dynamic range (float) image, where the renderers accumulate their samples. Pixel colours are never clamped here: they can be averaged
+	over many samples, written to HDR files (PFM, OpenEXR) and only converted to 8 bits (tone mapping) for display or BMP/PNG output.
+	Besides colour, it can keep arbitrary output variables (AOVs) of the primary hit of each pixel: depth, normal, object ID and albedo (for compositing/denoising),
+	and the second moment of the luminance of its samples (how noisy it is, for denoising).
+	All buffers are stored as planes (one array per channel), like CImg, so conversions can process 4 consecutive pixels of a channel with SSE instructions.
+	A buffer can also cover just a window (e.g. a tile) of a bigger image: pixel coordinates are always image coordinates.
+*/
+#ifndef _FRAMEBUFFER_RAYTRACINGFRAMEWORK
+#define _FRAMEBUFFER_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include "EXRFormat.h"
+#include <vector>
+#include <stdint.h>
+
+namespace RayTracingFramework{
+	class FrameBuffer
+	{
+	public:
+		enum ToneMapOperator { TONEMAP_CLAMP, TONEMAP_REINHARD, TONEMAP_ACES };
+		enum EXRCompression { EXR_NO_COMPRESSION = 0, EXR_RLE_COMPRESSION = 1 };
+		enum Output { OUTPUT_COLOUR, OUTPUT_DEPTH, OUTPUT_NORMAL, OUTPUT_OBJECT_ID, OUTPUT_ALBEDO };
+
+		//Conversion from HDR colours to 8 bits. The default (clamp, no exposure, gamma 1) matches the original conversion of main.cpp.
+		struct ToneMapping {
+			ToneMapOperator op;
+			float exposure;		//In stops (colours are multiplied by 2^exposure before the operator).
+			float gamma;		//Display gamma (e.g. 2.2). 1 -> linear output.
+			ToneMapping(ToneMapOperator op = TONEMAP_CLAMP, float exposure = 0.0f, float gamma = 1.0f) : op(op), exposure(exposure), gamma(gamma) { ; }
+		};
+
+		/**
+			@param enableAOVs: Allocates the depth, normal, object ID and albedo buffers (otherwise only colour and sample weights are stored).
+			@param originX, originY: First pixel of the window of the image covered by the buffer (pixels [originX, originX + width) x [originY, originY + height)).
+		*/
+		FrameBuffer(int width, int height, bool enableAOVs = false, int originX = 0, int originY = 0);
+
+		inline int getWidth() { return width; }
+		inline int getHeight() { return height; }
+		inline int getOriginX() { return originX; }
+		inline int getOriginY() { return originY; }
+		inline bool hasAOVs() { return !depth.empty(); }
+
+		/**
+			Memory used by the buffer (all its planes).
+		*/
+		size_t getMemoryBytes();
+
+		/**
+			Clears all samples (and AOVs).
+		*/
+		void clear();
+
+		/**
+			Accumulates a (weighted) sample of the colour of a pixel. The pixel colour is the weighted average of its samples.
+		*/
+		inline void addSample(int x, int y, Colour colour, float weight = 1.0f) {
+			size_t i = pixelIndex(x, y);
+			colourPlanes[i] += weight * colour.r;
+			colourPlanes[planeSize + i] += weight * colour.g;
+			colourPlanes[2 * planeSize + i] += weight * colour.b;
+			weights[i] += weight;
+			if (!luminanceMoments.empty()) {
+				float luminance = 0.2126f * colour.r + 0.7152f * colour.g + 0.0722f * colour.b;
+				luminanceMoments[i] += weight * luminance * luminance;
+			}
+		}
+
+		/**
+			Average colour of a pixel (black if it has no samples).
+		*/
+		Colour getColour(int x, int y);
+		inline float getWeight(int x, int y) { return weights[pixelIndex(x, y)]; }
+
+		/**
+			Replaces the colour of a pixel that has samples (e.g. by a filtered one), keeping its weight. Pixels without samples are left untouched.
+		*/
+		void setColour(int x, int y, Colour colour);
+
+		//AOVs of a pixel (only valid if hasAOVs()). The normal is an average (not normalized) if the pixel has several samples.
+		inline float getDepth(int x, int y) { return depth[pixelIndex(x, y)]; }
+		inline glm::vec3 getNormal(int x, int y) { size_t i = pixelIndex(x, y); return glm::vec3(normalPlanes[i], normalPlanes[planeSize + i], normalPlanes[2 * planeSize + i]); }
+		inline Colour getAlbedo(int x, int y) { size_t i = pixelIndex(x, y); return Colour(albedoPlanes[i], albedoPlanes[planeSize + i], albedoPlanes[2 * planeSize + i]); }
+		inline uint32_t getObjectID(int x, int y) { return objectIDs[pixelIndex(x, y)]; }
+
+		/**
+			Variance of the average luminance of a pixel (i.e. of the luminance of its samples, divided by their number), estimated from its samples.
+			Assumes samples of weight 1. Only valid if hasAOVs(); 0 for pixels with less than 2 samples.
+		*/
+		float getLuminanceVariance(int x, int y);
+
+		/**
+			Stores the AOVs of the closest intersection of ray (a primary ray through pixel (x, y)). Does nothing if AOVs are disabled.
+			When called for several samples of a pixel, normal and albedo are averaged over the ones that hit something (so on antialiased edges they blend both
+			sides, as the colour does), while depth and object ID stay those of the first hit.
+		*/
+		void setAOVs(int x, int y, Ray& ray, IScene& scene);
+
+		/**
+			Converts rows [y0, y1) (all rows of the buffer by default) to 8 bits, writing them into image. Pixels without samples are left untouched (background).
+		*/
+		void toneMap(cimg_library::CImg<unsigned char>& image, ToneMapping settings = ToneMapping(), int y0 = 0, int y1 = -1);
+
+		/**
+			Portable float map (RGB for colour/normal/albedo, greyscale for depth/object ID). Rows are converted and written one at a time.
+		*/
+		bool writePFM(const char* fileName, Output output = OUTPUT_COLOUR);
+
+		/**
+			OpenEXR scanline file (32 bit float channels): R, G, B and, if enabled, the AOVs (Z, N.X/N.Y/N.Z, albedo.R/G/B and objectID as an unsigned int channel).
+			Rows are converted, compressed and written in a single pass (the offset table is filled in at the end).
+		*/
+		bool writeEXR(const char* fileName, EXRCompression compression = EXR_NO_COMPRESSION);
+
+		/**
+			Channels written to EXR files (sorted alphabetically, as OpenEXR requires).
+		*/
+		void getEXRChannels(std::vector<EXRFormat::Channel>& channels);
+
+		/**
+			Writes pixels [x0, x1) of row y of each channel into output, one channel after the other (4 bytes per value), as stored in EXR chunks.
+		*/
+		void packEXRRow(const std::vector<EXRFormat::Channel>& channels, int y, int x0, int x1, unsigned char* output);
+
+		/**
+			Raw copy of the buffer (window, samples and AOVs), e.g. to send a rendered tile to another process.
+		*/
+		void serialize(std::vector<unsigned char>& data);
+
+		/**
+			Number of bytes written by serialize.
+		*/
+		size_t getSerializedSize();
+
+		/**
+			Adds the samples of a buffer copied by serialize to the pixels it shares with this one (its AOVs replace ours, if both have them).
+			Returns false if data is not a valid copy.
+		*/
+		bool accumulate(const unsigned char* data, size_t size);
+
+	private:
+		int width, height;
+		int originX, originY;
+		size_t planeSize;
+		std::vector<float> colourPlanes;		//Weighted sums (R plane, G plane, B plane).
+		std::vector<float> weights;				//Sum of the weights of the samples of each pixel.
+		std::vector<float> depth;				//Distance to the primary hit (FLT_MAX if none).
+		std::vector<float> normalPlanes;		//World normal of the primary hit (X, Y, Z planes).
+		std::vector<float> albedoPlanes;		//Diffuse colour of the primary hit (R, G, B planes).
+		std::vector<uint32_t> objectIDs;		//Object of the primary hit (INVALID_OBJECT_ID if none).
+		std::vector<float> luminanceMoments;	//Weighted sum of the squared luminance of the samples (stored with the AOVs).
+		std::vector<float> aovSamples;			//Number of hits averaged in the normal and albedo of each pixel.
+
+		inline size_t pixelIndex(int x, int y) { return (size_t)(y - originY) * width + (x - originX); }
+		void resolveRow(int y, float* red, float* green, float* blue);		//y: Row of the buffer.
+	};
+};
+#endif
@@ -0,0 +1,222 @@
+#include "PrimaryVisibilityBuffer.h"
+#include "RayTracingFramework\Ray.h"
+#include "RayTracingFramework\VirtualObject\ISceneManager.h"
+#include "RayTracingFramework\VirtualObject\SceneBVH.h"
+#include "RayTracingFramework\VirtualObject\Camera\Camera.h"
+#include "RayTracingFramework\GeometricPrimitives\IGeometry.h"
+#include "RayTracingFramework\Profiling\Profiler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	//Points closer to the camera plane than this (scale of their ray direction) are not projected.
+	const float MIN_SCALE = 1e-4f;
+	//Distance bounds are lowered a little, and coverage extended a little (in pixels), to absorb rounding errors of the rasteriser and of the primitives.
+	const float DEPTH_SAFETY = 1.0f - 1e-4f;
+	const float COVERAGE_MARGIN = 1e-3f;
+
+	//First/last pixel touching [minimum, maximum] (clamped first, so huge projections do not overflow).
+	inline int firstPixel(float minimum) { return (int)std::floor(std::max(minimum - COVERAGE_MARGIN, 0.0f)); }
+	inline int lastPixel(float maximum, int size) { return (int)std::floor(std::min(maximum + COVERAGE_MARGIN, (float)(size - 1))); }
+}
+
+RayTracingFramework::PrimaryVisibilityBuffer::PrimaryVisibilityBuffer(IScene& scene, Camera& camera)
+	: scene(scene)
+	, camera(camera)
+	, valid(false)
+	, width(0)
+	, height(0)
+	, numVerified(0)
+	, numFallbacks(0)
+{
+	;
+}
+
+bool RayTracingFramework::PrimaryVisibilityBuffer::build() {
+	PROFILE_SCOPE("PrimaryVisibilityBuffer::build");
+	numVerified = numFallbacks = 0;
+	unboundedObjects.clear();
+	valid = camera.getPinholeRays(origin, topLeft, columnIncrement, rowIncrement);
+	if (!valid) {
+		objects.clear(); depths.clear(); otherDepths.clear();
+		return false;
+	}
+	width = camera.getPixelWidth();
+	height = camera.getPixelHeight();
+	worldToImage = glm::inverse(glm::mat3(columnIncrement, rowIncrement, topLeft));
+	objects.assign((size_t)width * height, NULL);
+	depths.assign(objects.size(), FLT_MAX);
+	otherDepths.assign(objects.size(), FLT_MAX);
+
+	std::vector<IVirtualObject*> sceneObjects;
+	scene.getAttachedObjects(sceneObjects);
+	std::vector<glm::vec3> triangles;
+	for (size_t o = 0; o < sceneObjects.size(); o++) {
+		IVirtualObject* object = sceneObjects[o];
+		if (!object->hasGeometry())
+			continue;
+		glm::vec3 minimum, maximum;
+		if (!object->getGeometry().getLocalBounds(minimum, maximum)) {
+			unboundedObjects.push_back(object);
+			continue;
+		}
+		triangles.clear();
+		if (!object->isMoving() && object->getGeometry().getLocalTriangles(triangles)) {
+			glm::mat4 toWorld = object->getFromObjectToWorldCoordinates();
+			for (size_t v = 0; v + 2 < triangles.size(); v += 3)
+				drawTriangle(object, glm::vec3(toWorld * glm::vec4(triangles[v], 1.0f)), glm::vec3(toWorld * glm::vec4(triangles[v + 1], 1.0f)), glm::vec3(toWorld * glm::vec4(triangles[v + 2], 1.0f)));
+		}
+		else {
+			glm::vec3 worldMinimum, worldMaximum;
+			SceneBVH::getWorldBounds(*object, minimum, maximum, 0.0f, 1.0f, worldMinimum, worldMaximum);
+			drawBox(object, worldMinimum, worldMaximum);
+		}
+	}
+	return true;
+}
+
+void RayTracingFramework::PrimaryVisibilityBuffer::drawFragment(int x, int y, IVirtualObject* object, float depth) {
+	size_t pixel = (size_t)y * width + x;
+	if (object == objects[pixel]) {
+		depths[pixel] = std::min(depths[pixel], depth);
+		return;
+	}
+	if (depth < depths[pixel]) {
+		//The previous closest object becomes the closest of the others.
+		otherDepths[pixel] = depths[pixel];
+		depths[pixel] = depth;
+		objects[pixel] = object;
+	}
+	else
+		otherDepths[pixel] = std::min(otherDepths[pixel], depth);
+}
+
+void RayTracingFramework::PrimaryVisibilityBuffer::drawBox(IVirtualObject* object, glm::vec3 minimum, glm::vec3 maximum) {
+	//Distance from the camera to the box: a bound for every ray.
+	float depth = glm::length(glm::clamp(origin, minimum, maximum) - origin) * DEPTH_SAFETY;
+	//Pixels covered by the projected corners (all pixels if the box reaches behind the camera).
+	int x0 = 0, y0 = 0, x1 = width - 1, y1 = height - 1;
+	glm::vec2 low(FLT_MAX), high(-FLT_MAX);
+	bool inFront = true;
+	for (int corner = 0; corner < 8 && inFront; corner++) {
+		glm::vec3 p((corner & 1) ? maximum.x : minimum.x, (corner & 2) ? maximum.y : minimum.y, (corner & 4) ? maximum.z : minimum.z);
+		glm::vec3 q = worldToImage * (p - origin);
+		if (q.z < MIN_SCALE)
+			inFront = false;
+		else {
+			low = glm::min(low, glm::vec2(q) / q.z);
+			high = glm::max(high, glm::vec2(q) / q.z);
+		}
+	}
+	if (inFront) {
+		if (high.x < 0 || high.y < 0 || low.x > (float)width || low.y > (float)height)
+			return;
+		x0 = firstPixel(low.x); x1 = lastPixel(high.x, width);
+		y0 = firstPixel(low.y); y1 = lastPixel(high.y, height);
+	}
+	for (int y = y0; y <= y1; y++)
+		for (int x = x0; x <= x1; x++)
+			drawFragment(x, y, object, depth);
+}
+
+void RayTracingFramework::PrimaryVisibilityBuffer::drawTriangle(IVirtualObject* object, glm::vec3 a, glm::vec3 b, glm::vec3 c) {
+	glm::vec3 normal = glm::cross(b - a, c - a);
+	float normalLength = glm::length(normal);
+	if (normalLength <= 0)
+		return;
+	//Clip the triangle (in image space) against the camera plane.
+	glm::vec3 q[3] = { worldToImage * (a - origin), worldToImage * (b - origin), worldToImage * (c - origin) };
+	glm::vec2 polygon[4];
+	int n = 0;
+	for (int i = 0; i < 3; i++) {
+		glm::vec3 current = q[i], next = q[(i + 1) % 3];
+		if (current.z >= MIN_SCALE)
+			polygon[n++] = glm::vec2(current) / current.z;
+		if ((current.z >= MIN_SCALE) != (next.z >= MIN_SCALE)) {
+			glm::vec3 crossing = current + (MIN_SCALE - current.z) / (next.z - current.z) * (next - current);
+			polygon[n++] = glm::vec2(crossing) / crossing.z;
+		}
+	}
+	if (n < 3)
+		return;
+	glm::vec2 low(FLT_MAX), high(-FLT_MAX);
+	float area = 0;
+	for (int i = 0; i < n; i++) {
+		low = glm::min(low, polygon[i]);
+		high = glm::max(high, polygon[i]);
+		glm::vec2 next = polygon[(i + 1) % n];
+		area += polygon[i].x * next.y - polygon[i].y * next.x;
+	}
+	if (high.x < 0 || high.y < 0 || low.x > (float)width || low.y > (float)height)
+		return;
+	float orientation = (area >= 0) ? 1.0f : -1.0f;
+	//Distance bounds: the distance to the plane of the triangle bounds all rays; along a ray, the distance is s * |direction| with s = planeOffset / dot(direction, normal).
+	float planeOffset = glm::dot(a - origin, normal);
+	float planeDistance = std::abs(planeOffset) / normalLength;
+	int x0 = firstPixel(low.x), x1 = lastPixel(high.x, width);
+	int y0 = firstPixel(low.y), y1 = lastPixel(high.y, height);
+	for (int y = y0; y <= y1; y++)
+		for (int x = x0; x <= x1; x++) {
+			glm::vec2 corners[4] = { glm::vec2(x, y), glm::vec2(x + 1, y), glm::vec2(x, y + 1), glm::vec2(x + 1, y + 1) };
+			//Separating axes: the pixel is outside if all its corners are outside one of the edges of the polygon.
+			bool covered = true;
+			for (int i = 0; i < n && covered; i++) {
+				glm::vec2 edge = polygon[(i + 1) % n] - polygon[i];
+				float margin = -COVERAGE_MARGIN * glm::length(edge);
+				covered = false;
+				for (int k = 0; k < 4 && !covered; k++) {
+					glm::vec2 r = corners[k] - polygon[i];
+					covered = orientation * (edge.x * r.y - edge.y * r.x) >= margin;
+				}
+			}
+			if (!covered)
+				continue;
+			float depth = planeDistance;
+			//dot(direction, normal) is linear across the pixel: if it keeps its sign, s is smallest at the corner where it is largest.
+			float largest = 0;
+			bool sameSide = true;
+			for (int k = 0; k < 4; k++) {
+				float projection = glm::dot(topLeft + corners[k].x * columnIncrement + corners[k].y * rowIncrement, normal);
+				sameSide = sameSide && projection * planeOffset > 0;
+				largest = std::max(largest, std::abs(projection));
+			}
+			if (sameSide)
+				depth = std::max(depth, std::abs(planeOffset) / largest * getMinimumRayLength(x, y));
+			drawFragment(x, y, object, depth * DEPTH_SAFETY);
+		}
+}
+
+float RayTracingFramework::PrimaryVisibilityBuffer::getMinimumRayLength(int x, int y) {
+	//The rays of a pixel have directions topLeft + u * columnIncrement + v * rowIncrement: with perpendicular increments, the shortest one is at the
+	//point of the pixel closest to the centre of projection. Otherwise, the distance to the image plane is a (looser) bound.
+	float columnLength2 = glm::dot(columnIncrement, columnIncrement), rowLength2 = glm::dot(rowIncrement, rowIncrement);
+	if (std::abs(glm::dot(columnIncrement, rowIncrement)) > 1e-6f * std::sqrt(columnLength2 * rowLength2))
+		return std::abs(glm::dot(topLeft, glm::normalize(glm::cross(columnIncrement, rowIncrement))));
+	float u = glm::clamp(-glm::dot(topLeft, columnIncrement) / columnLength2, (float)x, (float)(x + 1));
+	float v = glm::clamp(-glm::dot(topLeft, rowIncrement) / rowLength2, (float)y, (float)(y + 1));
+	return glm::length(topLeft + u * columnIncrement + v * rowIncrement);
+}
+
+void RayTracingFramework::PrimaryVisibilityBuffer::intersect(Ray& ray, int x, int y) {
+	PROFILE_SCOPE("PrimaryVisibilityBuffer::intersect");
+	if (!valid || x < 0 || y < 0 || x >= width || y >= height) {
+		scene.intersect(ray);
+		return;
+	}
+	size_t pixel = (size_t)y * width + x;
+	//Verification: the object of the pixel and the unbounded objects (which are not in the buffer).
+	for (size_t o = 0; o < unboundedObjects.size(); o++)
+		unboundedObjects[o]->getGeometry().testLocalCollision(ray);
+	if (objects[pixel])
+		objects[pixel]->getGeometry().testLocalCollision(ray);
+	//Hits behind the origin (e.g. planes and spheres report them) are discarded by the renderers anyway: compare the first one in front.
+	while (ray.getClosestIntersection().t_distance < 0) ray.discardClosestIntersection();
+	if (ray.getClosestIntersection().t_distance <= otherDepths[pixel]) {
+		numVerified.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	//Another object may be closer (or the object of the pixel was missed): traverse the whole scene.
+	numFallbacks.fetch_add(1, std::memory_order_relaxed);
+	ray.firstIntersection = ray.numIntersections = 0;
+	scene.intersect(ray);
+}
@@ -0,0 +1,60 @@
+/**
+	CLASS: PrimaryVisibilityBuffer
+	DESCRIPTION: First hit of primary rays without traversing the scene. The objects are rasterised (on the CPU) into a buffer with one entry per pixel of the
+	camera: the object closest to the camera in that pixel, and a lower bound of the distance to any other object. Objects made of a few triangles (see
+	IGeometry::getLocalTriangles) are drawn as their triangles, the rest as their bounding boxes. Rasterisation is conservative (every pixel a primitive touches,
+	and distances valid for every ray through the pixel), so a primary ray only needs to test the object of its pixel (and the unbounded objects, e.g. planes):
+	if the hit found is not further than the bound of the other objects, it is the closest hit of the scene. Otherwise the ray traverses the whole scene.
+	Only pinhole cameras are supported (see Camera::getPinholeRays); with other cameras every ray traverses the scene.
+	The buffer is a snapshot: build it again after moving the camera or the objects (moving objects are drawn with their bounds over the shutter interval).
+*/
+#ifndef _PRIMARYVISIBILITYBUFFER_RAYTRACINGFRAMEWORK
+#define _PRIMARYVISIBILITYBUFFER_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include <vector>
+#include <atomic>
+
+namespace RayTracingFramework{
+	class Camera;
+
+	class PrimaryVisibilityBuffer
+	{
+	public:
+		PrimaryVisibilityBuffer(IScene& scene, Camera& camera);
+
+		/**
+			Rasterises the objects of the scene graph. Returns false if the camera is not supported (intersect then traverses the scene for every ray).
+		*/
+		bool build();
+
+		/**
+			Adds the intersections of ray, a primary ray of pixel (x, y) of the camera. The closest intersection is the one scene.intersect would find (the ones
+			behind it may be missing when the pixel is verified: enough to shade the ray, whose secondary rays traverse the scene).
+		*/
+		void intersect(Ray& ray, int x, int y);
+
+		//Rays resolved with the buffer, and rays that had to traverse the whole scene (since the last build).
+		inline unsigned long long getNumVerified() { return numVerified; }
+		inline unsigned long long getNumFallbacks() { return numFallbacks; }
+
+	private:
+		IScene& scene;
+		Camera& camera;
+		bool valid;
+		int width, height;
+		//Rays of the camera (see Camera::getPinholeRays), and the matrix taking a point (relative to origin) to (u * s, v * s, s): image position (u, v) and scale s along its ray.
+		glm::vec3 origin, topLeft, columnIncrement, rowIncrement;
+		glm::mat3 worldToImage;
+		//Per pixel: object with the smallest distance bound (NULL: no bounded object), that bound, and the smallest bound of any other object.
+		std::vector<IVirtualObject*> objects;
+		std::vector<float> depths, otherDepths;
+		std::vector<IVirtualObject*> unboundedObjects;
+		std::atomic<unsigned long long> numVerified, numFallbacks;
+
+		void drawFragment(int x, int y, IVirtualObject* object, float depth);
+		void drawBox(IVirtualObject* object, glm::vec3 minimum, glm::vec3 maximum);
+		void drawTriangle(IVirtualObject* object, glm::vec3 a, glm::vec3 b, glm::vec3 c);
+		float getMinimumRayLength(int x, int y);
+	};
+};
+#endif
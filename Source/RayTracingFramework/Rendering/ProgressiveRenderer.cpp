@@ -0,0 +1,69 @@
+#include "ProgressiveRenderer.h"
+#include "RayTracingFramework\Ray.h"
+#include "RayTracingFramework\VirtualObject\ISceneManager.h"
+#include "RayTracingFramework\VirtualObject\Camera\Camera.h"
+#include "RayTracingFramework\ShadingModels\IShadingModel.h"
+#include "PrimaryVisibilityBuffer.h"
+#include "RayTracingFramework\Profiling\Profiler.h"
+#include <thread>
+
+RayTracingFramework::ProgressiveRenderer::ProgressiveRenderer(IScene& scene, Camera& camera, FrameBuffer& frameBuffer, int numThreads, uint32_t seed, Sampler::Sequence sequence)
+	: scene(scene)
+	, camera(camera)
+	, frameBuffer(frameBuffer)
+	, numThreads(numThreads > 0 ? numThreads : (int)std::thread::hardware_concurrency())
+	, seed(seed)
+	, sequence(sequence)
+	, numPasses(0)
+	, primaryVisibility(NULL)
+{
+	if (this->numThreads < 1)
+		this->numThreads = 1;
+	reset();
+}
+
+void RayTracingFramework::ProgressiveRenderer::reset() {
+	frameBuffer.clear();
+	numPasses = 0;
+}
+
+void RayTracingFramework::ProgressiveRenderer::renderRows(int firstRow, int rowStep) {
+	int width = frameBuffer.getWidth(), height = frameBuffer.getHeight();
+	int x0 = frameBuffer.getOriginX(), y0 = frameBuffer.getOriginY();
+	Sampler sampler(sequence, seed);
+	Sampler* previousSampler = &Sampler::getThreadSampler();
+	Sampler::setThreadSampler(&sampler);
+	for (int r = firstRow; r < height; r += rowStep) {
+		PROFILE_SCOPE("ProgressiveRenderer::renderRows");
+		Profiler::TileTimer rowTimer(x0, y0 + r, x0 + width, y0 + r + 1);
+		for (int c = 0; c < width; c++) {
+			//Sample numPasses of the pixel (image coordinates, so a window of the image gets the same samples as the whole image).
+			//The camera draws the position inside the pixel, on the lens and in the shutter interval, then shading continues with the next dimensions.
+			sampler.startSample(x0 + c, y0 + r, numPasses);
+			Ray ray = camera.createPrimaryRay(x0 + c, y0 + r, sampler);
+			if (primaryVisibility)
+				primaryVisibility->intersect(ray, x0 + c, y0 + r);
+			else
+				scene.intersect(ray);
+			//Discard collisions behind camera.
+			while (ray.getClosestIntersection().t_distance < 0) ray.discardClosestIntersection();
+			frameBuffer.setAOVs(x0 + c, y0 + r, ray, scene);
+			//Samples that hit nothing are not stored (as in main.cpp, pixels without samples keep the background of the image).
+			if (ray.getClosestIntersection().t_distance == FLT_MAX)
+				continue;
+			frameBuffer.addSample(x0 + c, y0 + r, scene.getShadingModel().computeShading(ray, scene, 0));
+		}
+	}
+	Sampler::setThreadSampler(previousSampler);
+}
+
+void RayTracingFramework::ProgressiveRenderer::renderPass() {
+	//Rows are interleaved among the threads (neighbouring rows usually cost about the same).
+	std::vector<std::thread> threads;
+	for (int t = 1; t < numThreads; t++)
+		threads.push_back(std::thread(&ProgressiveRenderer::renderRows, this, t, numThreads));
+	renderRows(0, numThreads);
+	for (size_t t = 0; t < threads.size(); t++)
+		threads[t].join();
+	numPasses++;
+}
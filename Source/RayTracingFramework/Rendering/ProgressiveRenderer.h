@@ -0,0 +1,63 @@
+/**
+	CLASS: ProgressiveRenderer
+	DESCRIPTION: Renders an image in passes of one sample per pixel, accumulated in a FrameBuffer, so it can be displayed (or stopped) at any time and refined
+	for as long as needed (e.g. path tracing with many samples). Each pass jitters the position of the samples in their pixel (and on the lens), and their time in the shutter interval (motion blur).
+	Rows are shared among several threads, but the random numbers of each pixel are a function of the pixel and the pass (see Sampler; shading models draw
+	from the same sampler), so the result only depends on the seed, the sequence and the number of passes: not on the number of threads, nor on whether
+	the render was resumed (RenderCheckpoint). The irradiance cache is the exception: its records depend on which thread reaches a point first.
+*/
+#ifndef _PROGRESSIVERENDERER_RAYTRACINGFRAMEWORK
+#define _PROGRESSIVERENDERER_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include "RayTracingFramework\Sampling\Sampler.h"
+#include "FrameBuffer.h"
+#include <vector>
+#include <stdint.h>
+
+namespace RayTracingFramework{
+	class Camera;
+	class PrimaryVisibilityBuffer;
+
+	class ProgressiveRenderer
+	{
+		friend class RenderCheckpoint;
+	public:
+		/**
+			@param numThreads: Threads used by each pass (0 -> one per hardware thread).
+			@param seed: Seed of the samplers of the pixels.
+			@param sequence: Sequence of sample values (low discrepancy sequences converge faster than random values).
+		*/
+		ProgressiveRenderer(IScene& scene, Camera& camera, FrameBuffer& frameBuffer, int numThreads = 0, uint32_t seed = 0, Sampler::Sequence sequence = Sampler::SEQUENCE_SOBOL);
+
+		/**
+			Adds one sample to every pixel (and to its AOVs: see FrameBuffer::setAOVs).
+		*/
+		void renderPass();
+
+		/**
+			Clears the frame buffer and starts again from the first pass.
+		*/
+		void reset();
+
+		inline int getNumPasses() { return numPasses; }
+		inline FrameBuffer& getFrameBuffer() { return frameBuffer; }
+
+		/**
+			Primary rays find their first hit with buffer (built for the camera of the renderer) instead of traversing the scene. NULL (default) disables it.
+		*/
+		inline void setPrimaryVisibility(PrimaryVisibilityBuffer* buffer) { primaryVisibility = buffer; }
+
+	private:
+		IScene& scene;
+		Camera& camera;
+		FrameBuffer& frameBuffer;
+		int numThreads;
+		uint32_t seed;
+		Sampler::Sequence sequence;
+		int numPasses;
+		PrimaryVisibilityBuffer* primaryVisibility;
+
+		void renderRows(int firstRow, int rowStep);
+	};
+};
+#endif
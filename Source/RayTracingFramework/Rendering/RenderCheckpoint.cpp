@@ -0,0 +1,116 @@
+#include "RenderCheckpoint.h"
+#include "ProgressiveRenderer.h"
+#include <cstdio>
+#include <cstring>
+
+namespace {
+	const char MAGIC[4] = { 'R', 'T', 'C', 'P' };
+	const uint32_t VERSION = 3;
+
+	//Fixed size part of the file. It is followed by the frame buffer (FrameBuffer::serialize).
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		int32_t width, height, hasAOVs, numPasses;
+		uint32_t seed;
+		int32_t sequence;
+		uint64_t frameBufferSize;
+	};
+}
+
+RayTracingFramework::RenderCheckpoint::RenderCheckpoint(const char* fileName)
+	: fileName(fileName)
+	, writing(false)
+	, lastWriteSucceeded(true)
+{
+	;
+}
+
+RayTracingFramework::RenderCheckpoint::~RenderCheckpoint() {
+	wait();
+}
+
+bool RayTracingFramework::RenderCheckpoint::wait() {
+	if (writer.joinable())
+		writer.join();
+	return lastWriteSucceeded;
+}
+
+void RayTracingFramework::RenderCheckpoint::remove() {
+	wait();
+	std::remove(fileName.c_str());
+}
+
+bool RayTracingFramework::RenderCheckpoint::save(ProgressiveRenderer& renderer) {
+	if (writing)
+		return false;
+	if (writer.joinable())
+		writer.join();
+	//1. Snapshot (only copies: this is the only part the render waits for).
+	FrameBuffer& frameBuffer = renderer.getFrameBuffer();
+	std::vector<unsigned char> frameBufferData;
+	frameBuffer.serialize(frameBufferData);
+	Header header;
+	memcpy(header.magic, MAGIC, 4);
+	header.version = VERSION;
+	header.width = frameBuffer.getWidth();
+	header.height = frameBuffer.getHeight();
+	header.hasAOVs = frameBuffer.hasAOVs() ? 1 : 0;
+	header.numPasses = renderer.numPasses;
+	header.seed = renderer.seed;
+	header.sequence = (int32_t)renderer.sequence;
+	header.frameBufferSize = frameBufferData.size();
+	snapshot.resize(sizeof(header) + frameBufferData.size());
+	memcpy(&snapshot[0], &header, sizeof(header));
+	memcpy(&snapshot[sizeof(header)], &frameBufferData[0], frameBufferData.size());
+	//2. Write it in the background.
+	writing = true;
+	writer = std::thread(&RenderCheckpoint::write, this);
+	return true;
+}
+
+void RayTracingFramework::RenderCheckpoint::write() {
+	std::string temporaryName = fileName + ".tmp";
+	FILE* file = fopen(temporaryName.c_str(), "wb");
+	bool ok = file != NULL;
+	if (file) {
+		ok = fwrite(&snapshot[0], 1, snapshot.size(), file) == snapshot.size();
+		ok = (fclose(file) == 0) && ok;
+	}
+#ifdef _WIN32
+	if (ok)
+		std::remove(fileName.c_str());	//rename does not replace existing files on Windows.
+#endif
+	ok = ok && std::rename(temporaryName.c_str(), fileName.c_str()) == 0;
+	lastWriteSucceeded = ok;
+	writing = false;
+}
+
+bool RayTracingFramework::RenderCheckpoint::load(ProgressiveRenderer& renderer) {
+	wait();
+	FILE* file = fopen(fileName.c_str(), "rb");
+	if (!file)
+		return false;
+	FrameBuffer& frameBuffer = renderer.getFrameBuffer();
+	Header header;
+	bool ok = fread(&header, sizeof(header), 1, file) == 1 && !memcmp(header.magic, MAGIC, 4) && header.version == VERSION
+		&& header.width == frameBuffer.getWidth() && header.height == frameBuffer.getHeight()
+		&& header.hasAOVs == (frameBuffer.hasAOVs() ? 1 : 0) && header.seed == renderer.seed && header.sequence == (int32_t)renderer.sequence
+		&& header.frameBufferSize == frameBuffer.getSerializedSize();	//Checked before allocating: the size comes from the file.
+	std::vector<unsigned char> frameBufferData;
+	if (ok) {
+		frameBufferData.resize((size_t)header.frameBufferSize);
+		ok = fread(&frameBufferData[0], 1, frameBufferData.size(), file) == frameBufferData.size();
+	}
+	fclose(file);
+	if (!ok)
+		return false;
+	//The samples are added to an empty buffer, which restores them exactly.
+	frameBuffer.clear();
+	if (!frameBuffer.accumulate(&frameBufferData[0], frameBufferData.size())) {
+		renderer.reset();
+		return false;
+	}
+	renderer.numPasses = header.numPasses;
+	return true;
+}
@@ -0,0 +1,62 @@
+/**
+	CLASS: RenderCheckpoint
+	DESCRIPTION: Saves the state of a progressive render (ProgressiveRenderer) to a binary file, so a long render can be resumed after the process is killed.
+	The state is everything needed to continue with identical results: the accumulation buffer (sums of the samples and per-pixel weights = sample counts,
+	plus the AOVs) and the number of passes done (the sample values of each pass only depend on the pixel, the pass, the seed and the sequence).
+	Writes are asynchronous: save only copies the state (a memcpy of the buffers) and a background thread writes it. The file is written under a temporary
+	name and then renamed, so an interruption during a write leaves the previous checkpoint intact.
+*/
+#ifndef _RENDERCHECKPOINT_RAYTRACINGFRAMEWORK
+#define _RENDERCHECKPOINT_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <stdint.h>
+
+namespace RayTracingFramework{
+	class ProgressiveRenderer;
+
+	class RenderCheckpoint
+	{
+	public:
+		RenderCheckpoint(const char* fileName);
+		/**
+			Waits for the write in progress (if any).
+		*/
+		virtual ~RenderCheckpoint();
+
+		/**
+			Copies the state of renderer and writes it in the background. If the previous write has not finished yet, nothing is done
+			(so the render never waits for the disk) and false is returned.
+		*/
+		bool save(ProgressiveRenderer& renderer);
+
+		/**
+			Restores the state of renderer from the file. Returns false (leaving renderer untouched) if there is no valid checkpoint for it
+			(same image size, AOVs, seed and sequence).
+		*/
+		bool load(ProgressiveRenderer& renderer);
+
+		/**
+			Waits for the write in progress. Returns false if the last write failed.
+		*/
+		bool wait();
+
+		/**
+			Deletes the file (e.g. once the render is finished).
+		*/
+		void remove();
+
+	private:
+		std::string fileName;
+		std::vector<unsigned char> snapshot;		//Data of the write in progress.
+		std::thread writer;
+		std::atomic<bool> writing;
+		bool lastWriteSucceeded;
+
+		void write();
+	};
+};
+#endif
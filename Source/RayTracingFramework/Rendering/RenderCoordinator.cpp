@@ -0,0 +1,242 @@
+#include "RenderCoordinator.h"
+#include "RenderWorker.h"
+#include "FrameBuffer.h"
+#include <cstring>
+#include <algorithm>
+#ifndef _WIN32
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#endif
+
+RayTracingFramework::RenderCoordinator::RenderCoordinator(int width, int height, int tileSize, bool enableAOVs)
+	: width(width)
+	, height(height)
+	, tileSize(tileSize)
+	, enableAOVs(enableAOVs)
+	, nextJobID(0)
+	, numReissuedJobs(0)
+{
+	;
+}
+
+RayTracingFramework::RenderCoordinator::~RenderCoordinator() {
+	stopWorkers();
+	for (size_t f = 0; f < frames.size(); f++)
+		delete frames[f].frameBuffer;
+}
+
+int RayTracingFramework::RenderCoordinator::getNumWorkers() {
+	return (int)workers.size();
+}
+
+int RayTracingFramework::RenderCoordinator::startWorkers(int count, const char* executable, const std::vector<std::string>& arguments, std::string* error) {
+#ifndef _WIN32
+	int started = 0;
+	for (int i = 0; i < count; i++) {
+		//The worker reports a failed exec through a pipe that a successful exec closes (close on exec), so we get either errno or end of file.
+		int sockets[2], execStatus[2];
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0)
+			break;
+		if (pipe(execStatus) != 0) {
+			close(sockets[0]);
+			close(sockets[1]);
+			break;
+		}
+		fcntl(execStatus[1], F_SETFD, FD_CLOEXEC);
+		pid_t processID = fork();
+		if (processID < 0) {
+			close(sockets[0]);
+			close(sockets[1]);
+			close(execStatus[0]);
+			close(execStatus[1]);
+			break;
+		}
+		if (processID == 0) {
+			//Worker: keep only its own end of the connection, and replace this process with the worker program.
+			close(sockets[0]);
+			close(execStatus[0]);
+			for (size_t w = 0; w < workers.size(); w++)
+				close(workers[w].connection);
+			std::string connection = std::to_string(sockets[1]);
+			std::vector<char*> argv;
+			argv.push_back((char*)executable);
+			for (size_t a = 0; a < arguments.size(); a++)
+				argv.push_back((char*)arguments[a].c_str());
+			argv.push_back((char*)connection.c_str());
+			argv.push_back(NULL);
+			//argv[0] is only a path if the program was started with one, /proc/self/exe always is (on Linux).
+			execv("/proc/self/exe", &argv[0]);
+			int execError = errno;
+			execvp(executable, &argv[0]);
+			if (execError == ENOENT)
+				execError = errno;//No /proc: the error of the fallback is the one that matters.
+			while (write(execStatus[1], &execError, sizeof(execError)) < 0 && errno == EINTR)
+				;
+			_exit(127);
+		}
+		close(sockets[1]);
+		close(execStatus[1]);
+		int execError = 0;
+		ssize_t received;
+		while ((received = read(execStatus[0], &execError, sizeof(execError))) < 0 && errno == EINTR)
+			;
+		close(execStatus[0]);
+		if (received > 0) {
+			close(sockets[0]);
+			waitpid(processID, NULL, 0);
+			if (error)
+				*error = std::string("Cannot run render worker ") + executable + ": " + strerror(execError);
+			break;
+		}
+		Worker worker;
+		worker.connection = sockets[0];
+		worker.processID = processID;
+		workers.push_back(worker);
+		started++;
+	}
+	return started;
+#else
+	return 0;
+#endif
+}
+
+void RayTracingFramework::RenderCoordinator::stopWorkers() {
+	while (!workers.empty())
+		removeWorker(workers.size() - 1);
+}
+
+void RayTracingFramework::RenderCoordinator::removeWorker(size_t w) {
+#ifndef _WIN32
+	//Jobs it did not finish go back to the front of the queue.
+	for (size_t j = workers[w].jobs.size(); j > 0; j--) {
+		pendingJobs.push_front(workers[w].jobs[j - 1]);
+		numReissuedJobs++;
+	}
+	close(workers[w].connection);
+	waitpid(workers[w].processID, NULL, 0);
+	workers.erase(workers.begin() + w);
+#endif
+}
+
+bool RayTracingFramework::RenderCoordinator::jobFinished(const RenderJob& job, const unsigned char* tile, size_t size, IFrameListener& listener) {
+	for (size_t f = 0; f < frames.size(); f++) {
+		if (frames[f].frame != job.frame)
+			continue;
+		//A malformed tile changes nothing (accumulate checks it first), and the job is not finished.
+		if (!frames[f].frameBuffer->accumulate(tile, size))
+			return false;
+		listener.tileFinished(job, *frames[f].frameBuffer);
+		if (--frames[f].tilesLeft == 0) {
+			Frame finished = frames[f];
+			frames.erase(frames.begin() + f);
+			listener.frameFinished(finished.frame, *finished.frameBuffer);
+			delete finished.frameBuffer;
+		}
+		return true;
+	}
+	return true;
+}
+
+bool RayTracingFramework::RenderCoordinator::receive(Worker& worker, IFrameListener& listener) {
+#ifndef _WIN32
+	unsigned char buffer[65536];
+	ssize_t received = recv(worker.connection, buffer, sizeof(buffer), 0);
+	if (received < 0 && errno == EINTR)
+		return true;
+	if (received <= 0)
+		return false;
+	worker.received.insert(worker.received.end(), buffer, buffer + received);
+	//Handle all the complete messages.
+	size_t consumed = 0;
+	RenderWorker::MessageHeader header;
+	while (worker.received.size() - consumed >= sizeof(header)) {
+		memcpy(&header, &worker.received[consumed], sizeof(header));
+		if (worker.received.size() - consumed - sizeof(header) < header.size)
+			break;
+		const unsigned char* payload = &worker.received[consumed + sizeof(header)];
+		if (header.type != RenderWorker::MESSAGE_RESULT || header.size < sizeof(RenderJob))
+			return false;
+		RenderJob job;
+		memcpy(&job, payload, sizeof(job));
+		for (size_t j = 0; j < worker.jobs.size(); j++) {
+			if (worker.jobs[j].ID == job.ID) {
+				//A tile we cannot read: drop the worker (its jobs, this one included, are reissued).
+				if (!jobFinished(job, payload + sizeof(job), header.size - sizeof(job), listener))
+					return false;
+				worker.jobs.erase(worker.jobs.begin() + j);
+				break;
+			}
+		}
+		consumed += sizeof(header) + header.size;
+	}
+	worker.received.erase(worker.received.begin(), worker.received.begin() + consumed);
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool RayTracingFramework::RenderCoordinator::renderFrames(int firstFrame, int lastFrame, IFrameListener& listener) {
+#ifndef _WIN32
+	//1. Jobs: every tile of every frame, frame by frame (so only a couple of frames are in progress at a time).
+	int tilesPerFrame = ((width + tileSize - 1) / tileSize) * ((height + tileSize - 1) / tileSize);
+	for (int frame = firstFrame; frame <= lastFrame; frame++) {
+		for (int y = 0; y < height; y += tileSize) {
+			for (int x = 0; x < width; x += tileSize) {
+				RenderJob job = { nextJobID++, frame, x, y, std::min(x + tileSize, width), std::min(y + tileSize, height), enableAOVs ? 1 : 0 };
+				pendingJobs.push_back(job);
+			}
+		}
+	}
+	//2. Hand out jobs and collect tiles until all frames are finished.
+	std::vector<struct pollfd> connections;
+	while (!pendingJobs.empty() || !frames.empty()) {
+		if (workers.empty()) {
+			//Nobody left to render: drop the unfinished frames.
+			for (size_t f = 0; f < frames.size(); f++)
+				delete frames[f].frameBuffer;
+			frames.clear();
+			pendingJobs.clear();
+			return false;
+		}
+		for (size_t w = 0; w < workers.size() && !pendingJobs.empty(); w++) {
+			while (workers[w].jobs.size() < (size_t)MAX_JOBS_PER_WORKER && !pendingJobs.empty()) {
+				RenderJob job = pendingJobs.front();
+				bool frameStarted = false;
+				for (size_t f = 0; f < frames.size(); f++)
+					frameStarted = frameStarted || frames[f].frame == job.frame;
+				if (!frameStarted) {
+					Frame frame = { job.frame, tilesPerFrame, new FrameBuffer(width, height, enableAOVs) };
+					frames.push_back(frame);
+				}
+				pendingJobs.pop_front();
+				workers[w].jobs.push_back(job);	//Before sending: if it fails, the job is reissued with the rest.
+				if (!RenderWorker::sendMessage(workers[w].connection, RenderWorker::MESSAGE_JOB, &job, sizeof(job)))
+					break;
+			}
+		}
+		connections.resize(workers.size());
+		for (size_t w = 0; w < workers.size(); w++) {
+			connections[w].fd = workers[w].connection;
+			connections[w].events = POLLIN;
+			connections[w].revents = 0;
+		}
+		if (poll(&connections[0], connections.size(), -1) < 0 && errno != EINTR)
+			return false;
+		//Read from the workers with data (or closed connections), removing the dead ones.
+		for (size_t w = workers.size(); w > 0; w--) {
+			if (connections[w - 1].revents == 0)
+				continue;
+			if (!receive(workers[w - 1], listener))
+				removeWorker(w - 1);
+		}
+	}
+	return true;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,86 @@
+/**
+	CLASS: RenderCoordinator
+	DESCRIPTION: Coordinator side of distributed rendering: splits frames into tile jobs and hands them to worker processes on the same machine,
+	connected by local (UNIX domain) sockets. Workers are started once and keep their scene loaded between jobs (and frames).
+	Each worker gets up to MAX_JOBS_PER_WORKER jobs at a time (so it never waits for the next one). If a worker dies (its connection closes)
+	or returns a tile that cannot be read, it is dropped and the jobs it had not returned are given to the others. Rendering only fails if every worker is gone.
+	Tiles are merged into one FrameBuffer per frame; frames are handed to a listener as soon as all their tiles are back (so frames of a range
+	can finish out of order). Only available on POSIX systems: startWorkers returns 0 elsewhere.
+*/
+#ifndef _RENDERCOORDINATOR_RAYTRACINGFRAMEWORK
+#define _RENDERCOORDINATOR_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include "RenderJob.h"
+#include <vector>
+#include <deque>
+#include <string>
+
+namespace RayTracingFramework{
+	class RenderCoordinator
+	{
+	public:
+		static const int MAX_JOBS_PER_WORKER = 2;
+
+		class IFrameListener {
+		public:
+			/**
+				A tile has been merged into the frame buffer of its frame (e.g. to update a preview).
+			*/
+			virtual void tileFinished(const RenderJob& job, FrameBuffer& frameBuffer) { ; }
+			/**
+				All the tiles of a frame are in frameBuffer (which is deleted after this call).
+			*/
+			virtual void frameFinished(int frame, FrameBuffer& frameBuffer) = 0;
+			virtual ~IFrameListener() { ; }
+		};
+
+		RenderCoordinator(int width, int height, int tileSize = 64, bool enableAOVs = true);
+		virtual ~RenderCoordinator();
+
+		/**
+			Starts count worker processes running this program (/proc/self/exe) with arguments, or executable (searched in the PATH if it has no slash,
+			e.g. argv[0]) where /proc is not available. The socket descriptor of its connection is appended to the arguments of each worker (its program
+			must pass it to RenderWorker::run). Returns the number of workers started.
+			@param error: Set to why a worker could not be started (e.g. the program could not be executed).
+		*/
+		int startWorkers(int count, const char* executable, const std::vector<std::string>& arguments, std::string* error = NULL);
+
+		/**
+			Closes the connections to the workers (they exit) and waits for them.
+		*/
+		void stopWorkers();
+
+		/**
+			Renders frames [firstFrame, lastFrame] with the workers. Returns false if all workers died before the end.
+		*/
+		bool renderFrames(int firstFrame, int lastFrame, IFrameListener& listener);
+
+		int getNumWorkers();
+		inline unsigned int getNumReissuedJobs() { return numReissuedJobs; }
+
+	private:
+		struct Worker {
+			int connection;
+			int processID;
+			std::vector<RenderJob> jobs;				//Sent, but not returned yet.
+			std::vector<unsigned char> received;		//Bytes received (messages are handled once complete).
+		};
+		struct Frame {
+			int frame;
+			int tilesLeft;
+			FrameBuffer* frameBuffer;
+		};
+		int width, height, tileSize;
+		bool enableAOVs;
+		std::vector<Worker> workers;
+		std::deque<RenderJob> pendingJobs;
+		std::vector<Frame> frames;						//Frames with jobs in progress.
+		uint32_t nextJobID;
+		unsigned int numReissuedJobs;
+
+		void removeWorker(size_t w);
+		bool receive(Worker& worker, IFrameListener& listener);
+		bool jobFinished(const RenderJob& job, const unsigned char* tile, size_t size, IFrameListener& listener);
+	};
+};
+#endif
@@ -0,0 +1,35 @@
+/**
+	CLASS: RenderJob, ITileRenderer
+	DESCRIPTION: A unit of work of distributed rendering (a tile of a frame), and the interface of whatever renders it in a worker process
+	(the worker knows the scene and camera; the job only says which pixels of which frame to render).
+*/
+#ifndef _RENDERJOB_RAYTRACINGFRAMEWORK
+#define _RENDERJOB_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include <stdint.h>
+
+namespace RayTracingFramework{
+	class FrameBuffer;
+
+	//Plain data: it is sent as is between processes of the same machine.
+	struct RenderJob {
+		uint32_t ID;
+		int32_t frame;
+		int32_t x0, y0, x1, y1;		//Pixels [x0, x1) x [y0, y1).
+		int32_t enableAOVs;
+	};
+
+	class ITileRenderer {
+	public:
+		/**
+			Renders the pixels of job into frameBuffer (which covers exactly those pixels, with AOVs if the job asks for them).
+		*/
+		virtual void renderTile(const RenderJob& job, FrameBuffer& frameBuffer) = 0;
+		/**
+			Called (from one thread) before the tiles of a new frame are rendered, once the scene and camera are set up for it, by renderers that go through frames in order (AnimationRenderer).
+		*/
+		virtual void prepareFrame(int frame) { ; }
+		virtual ~ITileRenderer() { ; }
+	};
+};
+#endif
@@ -0,0 +1,307 @@
+#include "RenderServer.h"
+#include "RenderWorker.h"
+#include "RenderJob.h"
+#include "FrameBuffer.h"
+#include "ProgressiveRenderer.h"
+#include "RayTracingFramework\VirtualObject\SceneCache.h"
+#include "RayTracingFramework\VirtualObject\Camera\Camera.h"
+#include "RayTracingFramework\ShadingModels\IShadingModel.h"
+#include "RayTracingFramework\Profiling\Profiler.h"
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <chrono>
+#ifndef _WIN32
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+namespace {
+	//Camera at eye looking at target (cameras look along their +z axis, with +y up and +x to the right of the image).
+	//Returns false if there is no such camera: eye == target, up is 0 or parallel to the view direction, or values are not finite (the comparisons fail for NaN).
+	bool lookAtCameraToWorld(glm::vec3 eye, glm::vec3 target, glm::vec3 up, glm::mat4& cameraToWorld) {
+		glm::vec3 view = target - eye;
+		if (!(glm::length(view) > 1e-6f))
+			return false;
+		glm::vec3 forward = glm::normalize(view);
+		glm::vec3 right = glm::cross(up, forward);
+		if (!(glm::length(right) > 1e-6f * glm::length(up)))
+			return false;
+		right = glm::normalize(right);
+		glm::vec3 cameraUp = glm::cross(forward, right);
+		cameraToWorld = glm::mat4(glm::vec4(right, 0), glm::vec4(cameraUp, 0), glm::vec4(forward, 0), glm::vec4(eye, 1));
+		return true;
+	}
+
+	bool hasExtension(const std::string& fileName, const char* extension) {
+		size_t length = strlen(extension);
+		return fileName.size() >= length && fileName.compare(fileName.size() - length, length, extension) == 0;
+	}
+
+#ifndef _WIN32
+	bool makeAddress(const char* socketPath, sockaddr_un& address) {
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		if (strlen(socketPath) >= sizeof(address.sun_path))
+			return false;
+		strcpy(address.sun_path, socketPath);
+		return true;
+	}
+#endif
+}
+
+RayTracingFramework::RenderServer::Client::~Client() {
+#ifndef _WIN32
+	close(connection);
+#endif
+}
+
+RayTracingFramework::RenderServer::RenderServer(SceneCache& scenes, int numThreads, int tileSize)
+	: scenes(scenes)
+	, pool(numThreads)
+	, tileSize(tileSize)
+	, numQueuedJobs(0)
+	, numFinishedJobs(0)
+	, stopping(false)
+{
+	;
+}
+
+RayTracingFramework::RenderServer::~RenderServer() {
+	;
+}
+
+void RayTracingFramework::RenderServer::stop() {
+	std::lock_guard<std::mutex> lock(mutex);
+	stopping = true;
+	jobQueued.notify_all();
+}
+
+bool RayTracingFramework::RenderServer::send(Client& client, int type, const void* payload, size_t size, const void* extraPayload, size_t extraSize) {
+	if (client.closed)
+		return false;
+	std::lock_guard<std::mutex> lock(client.sendMutex);
+	if (!RenderWorker::sendMessage(client.connection, (RenderWorker::MessageType)type, payload, size, extraPayload, extraSize)) {
+		client.closed = true;
+		return false;
+	}
+	return true;
+}
+
+int RayTracingFramework::RenderServer::connect(const char* socketPath) {
+#ifndef _WIN32
+	sockaddr_un address;
+	if (!makeAddress(socketPath, address))
+		return -1;
+	int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (connection < 0)
+		return -1;
+	if (::connect(connection, (sockaddr*)&address, sizeof(address)) != 0) {
+		close(connection);
+		return -1;
+	}
+	return connection;
+#else
+	return -1;
+#endif
+}
+
+int RayTracingFramework::RenderServer::run(const char* socketPath) {
+#ifndef _WIN32
+	sockaddr_un address;
+	if (!makeAddress(socketPath, address))
+		return 1;
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener < 0)
+		return 1;
+	unlink(socketPath);//Socket file of a previous server.
+	if (bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 16) != 0) {
+		close(listener);
+		return 1;
+	}
+	stopping = false;
+	std::thread renderer(&RenderServer::renderJobs, this);
+	std::vector<ClientPointer> clients;
+	while (!stopping) {
+		//Wake up regularly to notice stop() and to forget the clients that left.
+		pollfd listening = { listener, POLLIN, 0 };
+		int ready = poll(&listening, 1, 100);
+		if (ready < 0 && errno != EINTR)
+			break;
+		if (ready > 0 && (listening.revents & POLLIN)) {
+			int connection = accept(listener, NULL, NULL);
+			if (connection >= 0) {
+				ClientPointer client(new Client(connection));
+				client->reader = std::thread(&RenderServer::readClient, this, client);
+				clients.push_back(client);
+			}
+		}
+		for (size_t c = clients.size(); c > 0; c--)
+			if (clients[c - 1]->closed) {
+				clients[c - 1]->reader.join();
+				clients.erase(clients.begin() + (c - 1));
+			}
+	}
+	stop();
+	renderer.join();
+	//Wake up the readers (blocked in receive) and wait for them.
+	for (size_t c = 0; c < clients.size(); c++) {
+		clients[c]->closed = true;
+		shutdown(clients[c]->connection, SHUT_RDWR);
+		clients[c]->reader.join();
+	}
+	clients.clear();
+	std::lock_guard<std::mutex> lock(mutex);
+	while (!queue.empty())
+		queue.pop();
+	close(listener);
+	unlink(socketPath);
+	return 0;
+#else
+	return 1;
+#endif
+}
+
+void RayTracingFramework::RenderServer::readClient(ClientPointer client) {
+	RenderWorker::MessageHeader header;
+	std::vector<unsigned char> payload;
+	//Clients only send jobs (and SHUTDOWN, without payload): anything bigger is not a client of ours.
+	while (!client->closed && RenderWorker::receiveMessage(client->connection, header, payload, sizeof(Job))) {
+		if (header.type == RenderWorker::MESSAGE_SUBMIT && header.size == sizeof(Job)) {
+			QueuedJob queued;
+			memcpy(&queued.job, &payload[0], sizeof(Job));
+			queued.client = client;
+			std::lock_guard<std::mutex> lock(mutex);
+			queued.order = numQueuedJobs++;
+			queue.push(queued);
+			jobQueued.notify_one();
+		}
+		else if (header.type == RenderWorker::MESSAGE_SHUTDOWN)
+			stop();
+		else
+			break;//Not a client of ours.
+	}
+	//Its queued jobs are dropped when they reach the front of the queue.
+	client->closed = true;
+}
+
+void RayTracingFramework::RenderServer::renderJobs() {
+	while (true) {
+		QueuedJob queued;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			while (!stopping && queue.empty())
+				jobQueued.wait(lock);
+			if (stopping)
+				return;
+			queued = queue.top();
+			queue.pop();
+		}
+		if (queued.client->closed)
+			continue;
+		renderJob(queued.job, queued.client);
+		numFinishedJobs++;
+	}
+}
+
+void RayTracingFramework::RenderServer::renderJob(Job& job, ClientPointer client) {
+	PROFILE_SCOPE("RenderServer::renderJob");
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	Result result;
+	memset(&result, 0, sizeof(result));
+	result.ID = job.ID;
+	result.status = STATUS_OK;
+	job.sceneFileName[MAX_PATH_LENGTH - 1] = job.outputFileName[MAX_PATH_LENGTH - 1] = '\0';
+	std::string error;
+	bool wasResident = false;
+	SceneCache::ScenePointer cached = scenes.get(job.sceneFileName, &error, &wasResident);
+	result.sceneWasResident = wasResident ? 1 : 0;
+	if (!cached)
+		result.status = STATUS_SCENE_ERROR;
+	else if (job.width == 0 && job.height == 0) {
+		job.width = cached->settings.width;
+		job.height = cached->settings.height;
+	}
+	//Jobs too big for the memory of the server are refused, rather than failing to allocate their frame buffer.
+	if (cached && (job.width < 1 || job.height < 1 || (int64_t)job.width * job.height > MAX_JOB_PIXELS
+		|| job.samplesPerPixel < 1 || job.samplesPerPixel > MAX_SAMPLES_PER_PIXEL)) {
+		result.status = STATUS_INVALID_JOB;
+		error = "Invalid resolution or number of samples";
+		cached.reset();
+	}
+	glm::mat4 cameraToWorld = cached ? cached->settings.cameraToWorld : glm::mat4(1.0f);
+	if (cached && !job.useSceneCamera && (!lookAtCameraToWorld(glm::vec3(job.eye[0], job.eye[1], job.eye[2]), glm::vec3(job.target[0], job.target[1], job.target[2]), glm::vec3(job.up[0], job.up[1], job.up[2]), cameraToWorld)
+		|| job.verticalFOV >= 180.0f)) {
+		result.status = STATUS_INVALID_JOB;
+		error = "Invalid camera";
+		cached.reset();
+	}
+
+	if (cached) {
+		//The camera of the job is an object of the (shared) scene while the job renders (it has no geometry, so the hierarchy stays valid).
+		ISceneManager& scene = cached->scene;
+		const SceneFile::Settings& settings = cached->settings;
+		Camera* camera = new Camera(scene, job.width, job.height, settings.top, settings.bottom, settings.left, settings.right, settings.nearPlane, settings.farPlane);
+		camera->setLocalToParent(cameraToWorld);
+		if (!job.useSceneCamera && job.verticalFOV > 0)
+			camera->setPerspective(job.verticalFOV, settings.nearPlane, settings.farPlane);
+		camera->prepareFrame();
+		scene.getShadingModel().setPixelSpreadAngle(camera->getPixelSpreadAngle());
+
+		FrameBuffer frameBuffer(job.width, job.height, true);
+		int tilesX = (job.width + tileSize - 1) / tileSize, tilesY = (job.height + tileSize - 1) / tileSize;
+		Progress progress = { job.ID, 0, tilesX * tilesY };
+		send(*client, RenderWorker::MESSAGE_PROGRESS, &progress, sizeof(progress));
+		std::mutex frameMutex;
+		pool.parallelFor(tilesX * tilesY, [&](int t) {
+			if (client->closed)
+				return;//Nobody is waiting for the result.
+			RenderJob tileJob = { job.ID, 0, (t % tilesX) * tileSize, (t / tilesX) * tileSize, 0, 0, 1 };
+			tileJob.x1 = glm::min(tileJob.x0 + tileSize, job.width);
+			tileJob.y1 = glm::min(tileJob.y0 + tileSize, job.height);
+			//All the samples of the tile (the samples of a pixel do not depend on the tiles, see ProgressiveRenderer).
+			FrameBuffer tile(tileJob.x1 - tileJob.x0, tileJob.y1 - tileJob.y0, true, tileJob.x0, tileJob.y0);
+			ProgressiveRenderer renderer(scene, *camera, tile, 1);
+			for (int s = 0; s < job.samplesPerPixel; s++)
+				renderer.renderPass();
+			std::vector<unsigned char> data;
+			tile.serialize(data);
+			std::lock_guard<std::mutex> lock(frameMutex);
+			frameBuffer.accumulate(&data[0], data.size());
+			progress.tilesFinished++;
+			send(*client, RenderWorker::MESSAGE_TILE, &tileJob, sizeof(tileJob), &data[0], data.size());
+			send(*client, RenderWorker::MESSAGE_PROGRESS, &progress, sizeof(progress));
+		});
+		delete camera;
+
+		if (client->closed)
+			return;
+		std::string outputFileName = job.outputFileName;
+		bool written = true;
+		if (hasExtension(outputFileName, ".exr"))
+			written = frameBuffer.writeEXR(outputFileName.c_str(), FrameBuffer::EXR_RLE_COMPRESSION);
+		else if (hasExtension(outputFileName, ".pfm"))
+			written = frameBuffer.writePFM(outputFileName.c_str());
+		else if (!outputFileName.empty()) {
+			cimg_library::CImg<unsigned char> image(job.width, job.height, 1, 3);
+			image.fill((const unsigned char)15);
+			frameBuffer.toneMap(image, FrameBuffer::ToneMapping());
+			try {
+				image.save(outputFileName.c_str());
+			}
+			catch (cimg_library::CImgException&) {
+				written = false;
+			}
+		}
+		if (!written) {
+			result.status = STATUS_OUTPUT_ERROR;
+			error = "Cannot write " + outputFileName;
+		}
+	}
+	result.seconds = (float)std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	strncpy(result.message, error.c_str(), sizeof(result.message) - 1);
+	send(*client, RenderWorker::MESSAGE_FINISHED, &result, sizeof(result));
+}
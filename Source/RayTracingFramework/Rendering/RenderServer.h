@@ -0,0 +1,123 @@
+/**
+	CLASS: RenderServer
+	DESCRIPTION: Long-running render process. Clients connect to a local (UNIX domain) socket and submit jobs: a scene file, a camera, a resolution,
+	a number of samples per pixel and an output file. Jobs wait in a priority queue (higher priorities first, then in order of arrival) and are rendered
+	one at a time, their tiles spread over a ThreadPool. Scenes stay loaded between jobs (see SceneCache), so only the first job of a scene pays for
+	loading it and building its hierarchy.
+	Messages use the framing of RenderWorker (header + payload):
+	- SUBMIT (client -> server): a Job.
+	- PROGRESS (server -> client): a Progress, when the job starts and after each tile.
+	- TILE (server -> client): a RenderJob (ID of the job, pixels of the tile) + FrameBuffer::serialize of the tile, as soon as it is rendered (all its samples).
+	- FINISHED (server -> client): a Result, once the output file is written (or the job failed).
+	- SHUTDOWN (client -> server): stops the server once the job in progress is finished (queued jobs are dropped).
+	Jobs of a client that disconnects are dropped (the one in progress stops after its current tiles). Only available on POSIX systems: run returns 1 elsewhere.
+*/
+#ifndef _RENDERSERVER_RAYTRACINGFRAMEWORK
+#define _RENDERSERVER_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include "ThreadPool.h"
+#include <vector>
+#include <queue>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <stdint.h>
+
+namespace RayTracingFramework{
+	class SceneCache;
+
+	class RenderServer
+	{
+	public:
+		static const int MAX_PATH_LENGTH = 512;
+		//Largest job accepted (its frame buffer, with AOVs, takes about 56 bytes per pixel: 3.5 GB at this size).
+		static const int64_t MAX_JOB_PIXELS = 8192LL * 8192LL;
+		static const int MAX_SAMPLES_PER_PIXEL = 65536;
+		enum JobStatus { STATUS_OK = 0, STATUS_INVALID_JOB = 1, STATUS_SCENE_ERROR = 2, STATUS_OUTPUT_ERROR = 3 };
+
+		//Plain data: it is sent as is between processes of the same machine.
+		struct Job {
+			uint32_t ID;								//Chosen by the client (the messages about the job carry it).
+			int32_t priority;							//Higher first.
+			int32_t width, height, samplesPerPixel;		//0 x 0: image size of the scene file. At most MAX_JOB_PIXELS pixels and MAX_SAMPLES_PER_PIXEL samples.
+			int32_t useSceneCamera;						//1: camera of the scene file. 0: camera at eye, looking at target (verticalFOV > 0: perspective with that field of view, in degrees, below 180; otherwise the frustum of the scene file). Eye and target must differ, and up must not be parallel to the view direction.
+			float eye[3], target[3], up[3], verticalFOV;
+			char sceneFileName[MAX_PATH_LENGTH];
+			char outputFileName[MAX_PATH_LENGTH];		//.exr, .pfm or an image format of CImg (e.g. .bmp). Empty: nothing is written (the client only gets the tiles).
+		};
+		struct Progress {
+			uint32_t ID;
+			int32_t tilesFinished, numTiles;
+		};
+		struct Result {
+			uint32_t ID;
+			int32_t status;								//See JobStatus.
+			int32_t sceneWasResident;					//1 if the scene was already loaded (see SceneCache).
+			float seconds;								//From the start of the job (scene loading included) to the output being written.
+			char message[256];							//Why the job failed.
+		};
+
+		/**
+			@param numThreads: Threads rendering the tiles of a job (0 -> one per hardware thread).
+		*/
+		RenderServer(SceneCache& scenes, int numThreads = 0, int tileSize = 64);
+		~RenderServer();
+
+		/**
+			Listens on socketPath (replacing a stale socket file) and serves jobs until stop is called or a client sends SHUTDOWN.
+			Returns 0 once stopped, 1 on errors.
+		*/
+		int run(const char* socketPath);
+
+		/**
+			Makes run return once the job in progress is finished (from any thread).
+		*/
+		void stop();
+
+		/**
+			Client side: connects to the server listening on socketPath. Returns the socket descriptor (for RenderWorker::sendMessage/receiveMessage), or -1.
+		*/
+		static int connect(const char* socketPath);
+
+		inline unsigned long long getNumFinishedJobs() { return numFinishedJobs; }
+
+	private:
+		struct Client {
+			int connection;
+			std::atomic<bool> closed;
+			std::mutex sendMutex;						//Tiles are sent from the threads of the pool.
+			std::thread reader;
+			Client(int connection) : connection(connection), closed(false) { ; }
+			~Client();
+		};
+		typedef std::shared_ptr<Client> ClientPointer;
+		struct QueuedJob {
+			Job job;
+			ClientPointer client;
+			unsigned long long order;					//Order of arrival.
+		};
+		struct QueueOrder {
+			bool operator()(const QueuedJob& a, const QueuedJob& b) const {
+				return a.job.priority != b.job.priority ? a.job.priority < b.job.priority : a.order > b.order;
+			}
+		};
+
+		SceneCache& scenes;
+		ThreadPool pool;
+		int tileSize;
+		std::priority_queue<QueuedJob, std::vector<QueuedJob>, QueueOrder> queue;
+		unsigned long long numQueuedJobs;
+		std::atomic<unsigned long long> numFinishedJobs;
+		std::atomic<bool> stopping;
+		std::mutex mutex;
+		std::condition_variable jobQueued;
+
+		void readClient(ClientPointer client);
+		void renderJobs();
+		void renderJob(Job& job, ClientPointer client);
+		static bool send(Client& client, int type, const void* payload, size_t size, const void* extraPayload = 0, size_t extraSize = 0);
+	};
+};
+#endif
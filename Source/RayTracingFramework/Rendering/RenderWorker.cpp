@@ -0,0 +1,87 @@
+#include "RenderWorker.h"
+#include "FrameBuffer.h"
+#include <cstring>
+#ifndef _WIN32
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#endif
+
+namespace {
+#ifndef _WIN32
+	bool sendAll(int connection, const void* data, size_t size) {
+		const char* bytes = (const char*)data;
+		while (size > 0) {
+#ifdef MSG_NOSIGNAL
+			ssize_t sent = send(connection, bytes, size, MSG_NOSIGNAL);	//A dead peer must not raise SIGPIPE.
+#else
+			ssize_t sent = send(connection, bytes, size, 0);
+#endif
+			if (sent < 0 && errno == EINTR)
+				continue;
+			if (sent <= 0)
+				return false;
+			bytes += sent;
+			size -= (size_t)sent;
+		}
+		return true;
+	}
+
+	bool receiveAll(int connection, void* data, size_t size) {
+		char* bytes = (char*)data;
+		while (size > 0) {
+			ssize_t received = recv(connection, bytes, size, 0);
+			if (received < 0 && errno == EINTR)
+				continue;
+			if (received <= 0)
+				return false;
+			bytes += received;
+			size -= (size_t)received;
+		}
+		return true;
+	}
+#endif
+}
+
+bool RayTracingFramework::RenderWorker::sendMessage(int connection, MessageType type, const void* payload, size_t size, const void* extraPayload, size_t extraSize) {
+#ifndef _WIN32
+	MessageHeader header = { (uint32_t)type, (uint32_t)(size + extraSize) };
+	return sendAll(connection, &header, sizeof(header)) && sendAll(connection, payload, size)
+		&& (extraSize == 0 || sendAll(connection, extraPayload, extraSize));
+#else
+	return false;
+#endif
+}
+
+bool RayTracingFramework::RenderWorker::receiveMessage(int connection, MessageHeader& header, std::vector<unsigned char>& payload, uint32_t maxSize) {
+#ifndef _WIN32
+	if (!receiveAll(connection, &header, sizeof(header)) || header.size > maxSize)
+		return false;
+	payload.resize(header.size);
+	return header.size == 0 || receiveAll(connection, &payload[0], header.size);
+#else
+	return false;
+#endif
+}
+
+int RayTracingFramework::RenderWorker::run(int connection, ITileRenderer& renderer) {
+#ifndef _WIN32
+	MessageHeader header;
+	std::vector<unsigned char> payload, tile;
+	while (receiveMessage(connection, header, payload, sizeof(RenderJob))) {
+		if (header.type != MESSAGE_JOB || header.size != sizeof(RenderJob))
+			return 1;
+		RenderJob job;
+		memcpy(&job, &payload[0], sizeof(job));
+		FrameBuffer frameBuffer(job.x1 - job.x0, job.y1 - job.y0, job.enableAOVs != 0, job.x0, job.y0);
+		renderer.renderTile(job, frameBuffer);
+		frameBuffer.serialize(tile);
+		if (!sendMessage(connection, MESSAGE_RESULT, &job, sizeof(job), &tile[0], tile.size()))
+			return 1;
+	}
+	close(connection);
+	return 0;
+#else
+	return 1;
+#endif
+}
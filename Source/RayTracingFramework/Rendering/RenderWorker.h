@@ -0,0 +1,43 @@
+/**
+	CLASS: RenderWorker
+	DESCRIPTION: Worker side of distributed rendering. A worker is a process started by RenderCoordinator, connected to it by a local socket.
+	It loads the scene once (before calling run) and keeps it for all its jobs: run just receives jobs, renders them and sends the tiles back,
+	until the coordinator closes the connection.
+	Messages are a header (type, payload size) followed by the payload: JOB (a RenderJob), RESULT (the RenderJob + FrameBuffer::serialize of the tile).
+	Only available on POSIX systems (the Windows build renders locally instead).
+*/
+#ifndef _RENDERWORKER_RAYTRACINGFRAMEWORK
+#define _RENDERWORKER_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include "RenderJob.h"
+#include <vector>
+#include <stdint.h>
+
+namespace RayTracingFramework{
+	class RenderWorker
+	{
+	public:
+		//The last ones are the messages of RenderServer and its clients (same framing, see RenderServer).
+		enum MessageType { MESSAGE_JOB = 1, MESSAGE_RESULT = 2, MESSAGE_SUBMIT = 3, MESSAGE_PROGRESS = 4, MESSAGE_TILE = 5, MESSAGE_FINISHED = 6, MESSAGE_SHUTDOWN = 7 };
+		static const uint32_t MAX_MESSAGE_SIZE = 256 * 1024 * 1024;	//Default limit of the payloads receiveMessage accepts.
+		struct MessageHeader {
+			uint32_t type;
+			uint32_t size;
+		};
+
+		/**
+			Serves jobs from the coordinator connected to connection (a socket descriptor, passed to the worker on its command line).
+			Returns 0 when the coordinator closes the connection, 1 on errors.
+		*/
+		static int run(int connection, ITileRenderer& renderer);
+
+		/**
+			Blocking transfer of a whole message (used by both sides). They return false if the connection is closed or fails.
+			receiveMessage also fails (without reading the payload) if the header announces more than maxSize bytes: sizes come from the peer, so a side
+			that only expects small messages passes their size, and a broken or hostile peer cannot make it allocate memory.
+		*/
+		static bool sendMessage(int connection, MessageType type, const void* payload, size_t size, const void* extraPayload = 0, size_t extraSize = 0);
+		static bool receiveMessage(int connection, MessageHeader& header, std::vector<unsigned char>& payload, uint32_t maxSize = MAX_MESSAGE_SIZE);
+	};
+};
+#endif
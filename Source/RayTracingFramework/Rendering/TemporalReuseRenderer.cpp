@@ -0,0 +1,186 @@
+#include "TemporalReuseRenderer.h"
+#include "FrameBuffer.h"
+#include "PrimaryVisibilityBuffer.h"
+#include "RayTracingFramework\Ray.h"
+#include "RayTracingFramework\VirtualObject\ISceneManager.h"
+#include "RayTracingFramework\VirtualObject\Animation.h"
+#include "RayTracingFramework\VirtualObject\Camera\Camera.h"
+#include "RayTracingFramework\ShadingModels\IShadingModel.h"
+#include "RayTracingFramework\Sampling\Sampler.h"
+#include "RayTracingFramework\Profiling\Profiler.h"
+#include <cmath>
+#include <algorithm>
+
+namespace {
+	//History matches a hit if its normal is within about 25 degrees of the normal of the hit.
+	const float MIN_NORMAL_COSINE = 0.9f;
+	//Matching history whose shadow intensities differ more than this is on the edge of a shadow: it is traced again.
+	const float MAX_SHADOW_DIFFERENCE = 0.05f;
+}
+
+RayTracingFramework::TemporalReuseRenderer::TemporalReuseRenderer(IScene& scene, Camera& camera, Animation* animation)
+	: scene(scene)
+	, camera(camera)
+	, animation(animation)
+	, primaryVisibility(NULL)
+	, depthTolerance(0.01f)
+	, refreshInterval(8)
+	, blendFactor(0.5f)
+	, current(0)
+	, width(0)
+	, height(0)
+	, frame(0)
+	, previousFrame(0)
+	, hasFrame(false)
+	, hasPreviousFrame(false)
+	, reusePrevious(false)
+	, pinhole(false)
+	, numReused(0)
+	, numTraced(0)
+{
+	;
+}
+
+void RayTracingFramework::TemporalReuseRenderer::reset() {
+	hasFrame = hasPreviousFrame = reusePrevious = false;
+	numReused = numTraced = 0;
+}
+
+void RayTracingFramework::TemporalReuseRenderer::prepareFrame(int frame) {
+	//The frame rendered last becomes the previous one.
+	hasPreviousFrame = hasFrame;
+	hasFrame = true;
+	bool previousPinhole = pinhole;
+	if (hasPreviousFrame) {
+		current = 1 - current;
+		previousFrame = this->frame;
+		previousOrigin = origin;
+		previousWorldToImage = worldToImage;
+	}
+	glm::vec3 topLeft, columnIncrement, rowIncrement;
+	pinhole = camera.getPinholeRays(origin, topLeft, columnIncrement, rowIncrement);
+	if (pinhole)
+		worldToImage = glm::inverse(glm::mat3(columnIncrement, rowIncrement, topLeft));
+	//Same image size, pinhole cameras both times, and nothing but the camera moved.
+	reusePrevious = hasPreviousFrame && pinhole && previousPinhole && width == camera.getPixelWidth() && height == camera.getPixelHeight()
+		&& (!animation || animation->movesOnly(camera, (float)previousFrame, (float)frame));
+	this->frame = frame;
+	width = camera.getPixelWidth();
+	height = camera.getPixelHeight();
+	History& history = histories[current];
+	size_t pixels = (size_t)width * height;
+	history.depths.resize(pixels);
+	history.objectIDs.resize(pixels);
+	history.normals.resize(pixels);
+	history.diffuseIntensities.resize(pixels);
+	history.shadowIntensities.resize(pixels);
+	history.ages.resize(pixels);
+}
+
+bool RayTracingFramework::TemporalReuseRenderer::reproject(glm::vec3 point, glm::vec3 normal, uint32_t objectID, float& diffuseIntensity, float& shadowIntensity, int& age) {
+	glm::vec3 q = previousWorldToImage * (point - previousOrigin);
+	if (q.z <= 0)
+		return false;
+	float depth = glm::length(point - previousOrigin);
+	//Bilinear interpolation between the 4 primary rays around the point (the ray of pixel (x, y) goes through image position (x, y)), over the ones that saw the same surface.
+	float u = q.x / q.z, v = q.y / q.z;
+	if (!(u > -1.0f && v > -1.0f && u < (float)width && v < (float)height))
+		return false;
+	int x0 = (int)std::floor(u), y0 = (int)std::floor(v);
+	float fx = u - (float)x0, fy = v - (float)y0;
+	const History& history = histories[1 - current];
+	float totalWeight = 0, minimumShadow = 1, maximumShadow = 0;
+	diffuseIntensity = 0;
+	shadowIntensity = 0;
+	age = 0;
+	for (int k = 0; k < 4; k++) {
+		int x = x0 + (k & 1), y = y0 + (k >> 1);
+		if (x < 0 || y < 0 || x >= width || y >= height)
+			continue;
+		size_t i = (size_t)y * width + x;
+		if (history.objectIDs[i] != objectID || std::abs(history.depths[i] - depth) > depthTolerance * depth || glm::dot(history.normals[i], normal) < MIN_NORMAL_COSINE)
+			continue;
+		minimumShadow = std::min(minimumShadow, history.shadowIntensities[i]);
+		maximumShadow = std::max(maximumShadow, history.shadowIntensities[i]);
+		float weight = ((k & 1) ? fx : 1.0f - fx) * ((k >> 1) ? fy : 1.0f - fy);
+		diffuseIntensity += weight * history.diffuseIntensities[i];
+		shadowIntensity += weight * history.shadowIntensities[i];
+		age = std::max(age, (int)history.ages[i]);
+		totalWeight += weight;
+	}
+	if (totalWeight <= 1e-3f || maximumShadow - minimumShadow > MAX_SHADOW_DIFFERENCE)
+		return false;
+	diffuseIntensity /= totalWeight;
+	shadowIntensity /= totalWeight;
+	return true;
+}
+
+void RayTracingFramework::TemporalReuseRenderer::renderTile(const RenderJob& job, FrameBuffer& frameBuffer) {
+	PROFILE_SCOPE("TemporalReuseRenderer::renderTile");
+	Profiler::TileTimer tileTimer(job.x0, job.y0, job.x1, job.y1);
+	IShadingModel& shadingModel = scene.getShadingModel();
+	History& history = histories[current];
+	//Sample values depend on the pixel and the frame, so blended soft shadows average different samples.
+	Sampler sampler;
+	Sampler* previousSampler = &Sampler::getThreadSampler();
+	Sampler::setThreadSampler(&sampler);
+	unsigned long long reused = 0, traced = 0;
+	for (int y = job.y0; y < job.y1; y++) {
+		for (int x = job.x0; x < job.x1; x++) {
+			size_t i = (size_t)y * width + x;
+			history.objectIDs[i] = 0;	//INVALID_OBJECT_ID
+			Ray ray = camera.createPrimaryRay(x, y);
+			sampler.startSample(x, y, (uint32_t)frame);
+			if (primaryVisibility)
+				primaryVisibility->intersect(ray, x, y);
+			else
+				scene.intersect(ray);
+			while (ray.getClosestIntersection().t_distance < 0) ray.discardClosestIntersection();
+			if (ray.getClosestIntersection().t_distance == FLT_MAX)
+				continue;
+
+			Colour outputColour, colour;
+			ShadingInfo shadingInfo = shadingModel.createShadingInfo(ray, scene, 0, outputColour);
+			if (shadingModel.isExitingObject(shadingInfo))
+				colour = shadingModel.computeShading(ray, scene, 0);	//Camera inside a transparent object: no diffuse terms to keep.
+			else {
+				glm::vec3 point(shadingInfo.collisionPoint), normal(shadingInfo.collisionNormal);
+				float diffuseIntensity, shadowIntensity;
+				int age;
+				bool found = reusePrevious && reproject(point, normal, shadingInfo.originalObjectId, diffuseIntensity, shadowIntensity, age);
+				if (found && age + 1 < refreshInterval) {
+					shadingInfo.shadowIntensity = shadowIntensity;
+					age++;
+					reused++;
+				}
+				else {
+					float tracedIntensity = shadingModel.computeViewIndependentLighting(shadingInfo);
+					if (found) {
+						diffuseIntensity += blendFactor * (tracedIntensity - diffuseIntensity);
+						shadingInfo.shadowIntensity = shadowIntensity + blendFactor * (shadingInfo.shadowIntensity - shadowIntensity);
+						age = 0;
+					}
+					else {
+						diffuseIntensity = tracedIntensity;
+						//New pixels start at different ages, so that their terms are not all traced again in the same frame.
+						age = (x + 3 * y) % std::max(refreshInterval, 1);
+					}
+					traced++;
+				}
+				//The material colour (textures) and ambient light of this hit are applied here, every frame.
+				colour = shadingModel.computeViewDependentColour(shadingInfo, diffuseIntensity);
+				history.depths[i] = glm::length(point - origin);
+				history.objectIDs[i] = shadingInfo.originalObjectId;
+				history.normals[i] = normal;
+				history.diffuseIntensities[i] = diffuseIntensity;
+				history.shadowIntensities[i] = shadingInfo.shadowIntensity;
+				history.ages[i] = (uint8_t)std::min(age, 255);
+			}
+			frameBuffer.addSample(x, y, colour);
+			frameBuffer.setAOVs(x, y, ray, scene);
+		}
+	}
+	Sampler::setThreadSampler(previousSampler);
+	numReused += reused;
+	numTraced += traced;
+}
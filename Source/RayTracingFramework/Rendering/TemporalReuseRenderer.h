@@ -0,0 +1,92 @@
+/**
+	CLASS: TemporalReuseRenderer
+	DESCRIPTION: Tile renderer for animations where only the camera moves (fly-throughs), with the default shading model (see IShadingModel, split shading).
+	Shadows and diffuse lighting do not depend on the point of view, so each pixel keeps them (with the depth and object ID of its primary hit) for the next
+	frame. There, the primary hit of a pixel is reprojected into the previous frame: if the pixels around it saw the same object at the same depth (facing
+	the same way), their terms are interpolated and reused (no shadow ray). Only disoccluded pixels (and pixels on the edge of a shadow, which interpolation
+	would blur frame after frame) trace them again, and only view dependent terms (specular highlights,
+	reflected and refracted rays) are traced for every pixel (none for diffuse materials). Reused terms are traced again every few frames (at
+	different frames for different pixels) and blended with their history, so they do not drift, and noisy ones (soft shadows) converge over the frames.
+	History is kept while the camera is a pinhole camera (see Camera::getPinholeRays) and, with an Animation, while no other object moves.
+	Otherwise (or after reset), the next frame is traced in full. prepareFrame must be called before the tiles of each frame (AnimationRenderer does).
+*/
+#ifndef _TEMPORALREUSERENDERER_RAYTRACINGFRAMEWORK
+#define _TEMPORALREUSERENDERER_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include "RenderJob.h"
+#include <vector>
+#include <atomic>
+#include <stdint.h>
+
+namespace RayTracingFramework{
+	class Camera;
+	class Animation;
+	class PrimaryVisibilityBuffer;
+
+	class TemporalReuseRenderer : public ITileRenderer
+	{
+	public:
+		/**
+			@param animation: Animation being rendered, to know when objects other than the camera move (NULL: the caller must call reset when they do).
+		*/
+		TemporalReuseRenderer(IScene& scene, Camera& camera, Animation* animation = NULL);
+
+		/**
+			Primary rays find their first hit with buffer (built for each frame) instead of traversing the scene. NULL (default) disables it.
+		*/
+		inline void setPrimaryVisibility(PrimaryVisibilityBuffer* buffer) { primaryVisibility = buffer; }
+
+		/**
+			@param depthTolerance: History matches a hit if its depth is within this fraction of the depth of the hit (and it saw the same object).
+			@param refreshInterval: Reused terms are traced again after this number of frames.
+			@param blendFactor: Weight of the terms traced again, when blended with their history (1: history is replaced).
+		*/
+		inline void setReuseParameters(float depthTolerance, int refreshInterval, float blendFactor) {
+			this->depthTolerance = depthTolerance; this->refreshInterval = refreshInterval; this->blendFactor = blendFactor;
+		}
+
+		/**
+			Forgets the previous frame (the next one is traced in full).
+		*/
+		void reset();
+
+		virtual void prepareFrame(int frame);
+		virtual void renderTile(const RenderJob& job, FrameBuffer& frameBuffer);
+
+		//Pixels whose shadow and diffuse terms were reused / traced (since the last reset).
+		inline unsigned long long getNumReused() { return numReused; }
+		inline unsigned long long getNumTraced() { return numTraced; }
+
+	private:
+		//Per pixel terms of a frame (objectID INVALID_OBJECT_ID: no history).
+		struct History {
+			std::vector<float> depths;			//Distance from the camera to the primary hit.
+			std::vector<uint32_t> objectIDs;
+			std::vector<glm::vec3> normals;
+			std::vector<float> diffuseIntensities;	//Lighting only: textures and ambient are evaluated again (see IShadingModel::computeViewIndependentLighting).
+			std::vector<float> shadowIntensities;
+			std::vector<uint8_t> ages;			//Frames since the terms were traced.
+		};
+		IScene& scene;
+		Camera& camera;
+		Animation* animation;
+		PrimaryVisibilityBuffer* primaryVisibility;
+		float depthTolerance;
+		int refreshInterval;
+		float blendFactor;
+		History histories[2];
+		int current;							//History written by this frame (the other one is the previous frame).
+		int width, height;
+		int frame, previousFrame;
+		bool hasFrame, hasPreviousFrame;		//A frame was prepared since the last reset / before this one.
+		bool reusePrevious;
+		//Pinhole rays of the camera (see Camera::getPinholeRays) in this frame and the previous one, as the matrix and origin projecting a point to the image.
+		bool pinhole;
+		glm::vec3 origin, previousOrigin;
+		glm::mat3 worldToImage, previousWorldToImage;
+		std::atomic<unsigned long long> numReused, numTraced;
+
+		bool reproject(glm::vec3 point, glm::vec3 normal, uint32_t objectID, float& diffuseIntensity, float& shadowIntensity, int& age);
+	};
+};
+#endif
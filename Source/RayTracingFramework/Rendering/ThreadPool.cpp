@@ -0,0 +1,70 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+RayTracingFramework::ThreadPool::ThreadPool(int numThreads)
+	: body(NULL)
+	, count(0)
+	, next(0)
+	, busyWorkers(0)
+	, generation(0)
+	, stopping(false)
+{
+	if (numThreads <= 0)
+		numThreads = std::max((int)std::thread::hardware_concurrency(), 1);
+	for (int t = 1; t < numThreads; t++)
+		workers.push_back(std::thread(&ThreadPool::run, this));
+}
+
+RayTracingFramework::ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	started.notify_all();
+	for (size_t t = 0; t < workers.size(); t++)
+		workers[t].join();
+}
+
+void RayTracingFramework::ThreadPool::parallelFor(int count, const std::function<void(int)>& body) {
+	std::lock_guard<std::mutex> loopLock(loopMutex);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		this->body = &body;
+		this->count = count;
+		next = 0;
+		busyWorkers = (int)workers.size();
+		generation++;
+	}
+	started.notify_all();
+	work();
+	//The loop (and body) must outlive the workers still finishing their last index.
+	std::unique_lock<std::mutex> lock(mutex);
+	finished.wait(lock, [this] { return busyWorkers == 0; });
+	this->body = NULL;
+}
+
+void RayTracingFramework::ThreadPool::run() {
+	unsigned int lastGeneration = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			started.wait(lock, [this, lastGeneration] { return stopping || generation != lastGeneration; });
+			if (stopping)
+				return;
+			lastGeneration = generation;
+		}
+		work();
+		bool last;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			last = --busyWorkers == 0;
+		}
+		if (last)
+			finished.notify_one();
+	}
+}
+
+void RayTracingFramework::ThreadPool::work() {
+	for (int i = next++; i < count; i = next++)
+		(*body)(i);
+}
@@ -0,0 +1,49 @@
+/**
+	CLASS: ThreadPool
+	DESCRIPTION: Worker threads that are started once and reused, so that renderers called many times (e.g. once per frame of an animation) do not create
+	and join threads for every call. parallelFor hands out the indices of a loop to the workers and to the calling thread, which returns once all of
+	them are done. Only one parallelFor runs at a time (concurrent calls wait for each other).
+*/
+#ifndef _THREADPOOL_RAYTRACINGFRAMEWORK
+#define _THREADPOOL_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+
+namespace RayTracingFramework{
+	class ThreadPool
+	{
+	public:
+		/**
+			@param numThreads: Threads working on each loop, counting the caller (0 -> one per hardware thread).
+		*/
+		ThreadPool(int numThreads = 0);
+		~ThreadPool();
+
+		/**
+			Calls body(i) for every i in [0, count), from any of the threads (indices are handed out in order, one at a time).
+		*/
+		void parallelFor(int count, const std::function<void(int)>& body);
+
+		inline int getNumThreads() { return (int)workers.size() + 1; }
+
+	private:
+		std::vector<std::thread> workers;
+		std::mutex mutex, loopMutex;
+		std::condition_variable started, finished;
+		const std::function<void(int)>* body;		//Loop in progress.
+		int count;
+		std::atomic<int> next;
+		int busyWorkers;
+		unsigned int generation;					//Incremented for every loop, so that workers know there is a new one.
+		bool stopping;
+
+		void run();
+		void work();
+	};
+};
+#endif
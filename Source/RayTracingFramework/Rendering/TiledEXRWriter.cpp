@@ -0,0 +1,130 @@
+#include "TiledEXRWriter.h"
+#include <cstring>
+
+RayTracingFramework::TiledEXRWriter::TiledEXRWriter(int width, int height, int tileWidth, int tileHeight, bool includeAOVs, FrameBuffer::EXRCompression compression)
+	: width(width)
+	, height(height)
+	, tileWidth(tileWidth)
+	, tileHeight(tileHeight)
+	, numTilesX((width + tileWidth - 1) / tileWidth)
+	, numTilesY((height + tileHeight - 1) / tileHeight)
+	, numTilesWritten(0)
+	, compression(compression)
+	, file(NULL)
+	, endOfFile(0)
+{
+	//Same channels as the frame buffers of the tiles (a 1x1 buffer is enough to list them).
+	FrameBuffer(1, 1, includeAOVs).getEXRChannels(channels);
+	EXRFormat::createHeader(header, channels, (EXRFormat::Compression)compression, 0, 0, width, height, tileWidth, tileHeight);
+	offsets.assign((size_t)numTilesX * numTilesY, 0);
+}
+
+RayTracingFramework::TiledEXRWriter::~TiledEXRWriter() {
+	close();
+}
+
+void RayTracingFramework::TiledEXRWriter::close() {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (file)
+		fclose(file);
+	file = NULL;
+}
+
+bool RayTracingFramework::TiledEXRWriter::open(const char* fileName, bool resume) {
+	close();
+	std::lock_guard<std::mutex> lock(mutex);
+	std::fill(offsets.begin(), offsets.end(), 0);
+	numTilesWritten = 0;
+	if (resume) {
+		file = fopen(fileName, "r+b");
+		if (file && readOffsetTable())
+			return true;
+		if (file)
+			fclose(file);
+		std::fill(offsets.begin(), offsets.end(), 0);
+		numTilesWritten = 0;
+	}
+	//New file: header and an empty offset table (tiles are appended after it).
+	file = fopen(fileName, "w+b");
+	if (!file)
+		return false;
+	bool ok = fwrite(&header[0], 1, header.size(), file) == header.size()
+		&& fwrite(&offsets[0], sizeof(uint64_t), offsets.size(), file) == offsets.size()
+		&& fflush(file) == 0;
+	endOfFile = (long long)(header.size() + sizeof(uint64_t) * offsets.size());
+	if (!ok) {
+		fclose(file);
+		file = NULL;
+	}
+	return ok;
+}
+
+bool RayTracingFramework::TiledEXRWriter::readOffsetTable() {
+	//The header must be the one these settings produce (same size, channels, tiles and compression).
+	std::vector<char> existingHeader(header.size());
+	if (fread(&existingHeader[0], 1, existingHeader.size(), file) != existingHeader.size() || existingHeader != header)
+		return false;
+	if (fread(&offsets[0], sizeof(uint64_t), offsets.size(), file) != offsets.size())
+		return false;
+	if (EXRFormat::seek(file, 0, SEEK_END) != 0)
+		return false;
+	endOfFile = EXRFormat::tell(file);
+	//Entries are only set once their tile is complete, but the file could have been truncated (e.g. copied while rendering).
+	for (size_t i = 0; i < offsets.size(); i++) {
+		if (offsets[i] >= (uint64_t)endOfFile)
+			offsets[i] = 0;
+		if (offsets[i])
+			numTilesWritten++;
+	}
+	return true;
+}
+
+void RayTracingFramework::TiledEXRWriter::getTileBounds(int tileX, int tileY, int& x0, int& y0, int& x1, int& y1) {
+	x0 = tileX * tileWidth;
+	y0 = tileY * tileHeight;
+	x1 = (x0 + tileWidth < width) ? x0 + tileWidth : width;
+	y1 = (y0 + tileHeight < height) ? y0 + tileHeight : height;
+}
+
+bool RayTracingFramework::TiledEXRWriter::writeTile(int tileX, int tileY, FrameBuffer& frameBuffer) {
+	int x0, y0, x1, y1;
+	getTileBounds(tileX, tileY, x0, y0, x1, y1);
+	if (x0 < frameBuffer.getOriginX() || y0 < frameBuffer.getOriginY()
+		|| x1 > frameBuffer.getOriginX() + frameBuffer.getWidth() || y1 > frameBuffer.getOriginY() + frameBuffer.getHeight())
+		return false;
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!file)
+		return false;
+	//1. Pixel data: for each row of the tile, one row of each channel.
+	int rowBytes = (x1 - x0) * 4 * (int)channels.size();
+	int dataSize = rowBytes * (y1 - y0);
+	tileData.resize(dataSize);
+	for (int y = y0; y < y1; y++)
+		frameBuffer.packEXRRow(channels, y, x0, x1, &tileData[(size_t)(y - y0) * rowBytes]);
+	const void* chunk = &tileData[0];
+	int32_t chunkHeader[5] = { tileX, tileY, 0, 0, dataSize };	//Tile coordinates, level (x, y), data size.
+	if (compression == FrameBuffer::EXR_RLE_COMPRESSION) {
+		int compressedSize = EXRFormat::compressRLE(&tileData[0], dataSize, scratch, compressed);
+		if (compressedSize < dataSize) {
+			chunk = &compressed[0];
+			chunkHeader[4] = compressedSize;
+		}
+	}
+	//2. Append the chunk, and only once it is in the file, point the offset table at it.
+	uint64_t position = (uint64_t)endOfFile;
+	bool ok = EXRFormat::seek(file, endOfFile) == 0
+		&& fwrite(chunkHeader, 4, 5, file) == 5
+		&& fwrite(chunk, 1, chunkHeader[4], file) == (size_t)chunkHeader[4]
+		&& fflush(file) == 0;
+	if (!ok)
+		return false;
+	endOfFile += 20 + chunkHeader[4];
+	size_t index = (size_t)tileY * numTilesX + tileX;
+	long long tableEntry = (long long)(header.size() + sizeof(uint64_t) * index);
+	ok = EXRFormat::seek(file, tableEntry) == 0 && fwrite(&position, sizeof(uint64_t), 1, file) == 1 && fflush(file) == 0;
+	if (ok && !offsets[index])
+		numTilesWritten++;
+	if (ok)
+		offsets[index] = position;
+	return ok;
+}
@@ -0,0 +1,76 @@
+/**
+	CLASS: TiledEXRWriter
+	DESCRIPTION: Streams an image to a tiled OpenEXR file as its tiles are finished, so images far bigger than memory (e.g. 32K x 32K posters) can be rendered:
+	only the tile being written (and the offset table, 8 bytes per tile) is ever held in memory.
+	Each tile is appended to the file and only then its entry of the offset table is updated (and both flushed). Tiles listed in the table are therefore
+	always complete, which lets an interrupted render resume: reopening the file keeps the tiles already written, and isTileWritten tells which ones to skip.
+	Tiles can be written in any order, and from several threads.
+*/
+#ifndef _TILEDEXRWRITER_RAYTRACINGFRAMEWORK
+#define _TILEDEXRWRITER_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include "EXRFormat.h"
+#include "FrameBuffer.h"
+#include <vector>
+#include <mutex>
+#include <cstdio>
+#include <stdint.h>
+
+namespace RayTracingFramework{
+	class TiledEXRWriter
+	{
+	public:
+		/**
+			@param width, height: Size of the whole image.
+			@param tileWidth, tileHeight: Size of the tiles (use tileWidth = width for scanline bands).
+			@param includeAOVs: Writes the AOV channels (the frame buffers of the tiles must have them enabled).
+		*/
+		TiledEXRWriter(int width, int height, int tileWidth, int tileHeight, bool includeAOVs = false,
+			FrameBuffer::EXRCompression compression = FrameBuffer::EXR_RLE_COMPRESSION);
+		virtual ~TiledEXRWriter();
+
+		/**
+			Opens the output file. If resume is true and the file was written by a writer with the same settings, the tiles it contains are kept;
+			otherwise the file is (re)created empty. Returns false if the file could not be opened.
+		*/
+		bool open(const char* fileName, bool resume = true);
+
+		/**
+			Closes the file. Missing tiles can still be written later, reopening it.
+		*/
+		void close();
+
+		inline int getNumTilesX() { return numTilesX; }
+		inline int getNumTilesY() { return numTilesY; }
+		inline int getNumTilesWritten() { return numTilesWritten; }
+		inline bool isComplete() { return numTilesWritten == numTilesX * numTilesY; }
+		inline bool isTileWritten(int tileX, int tileY) { return offsets[(size_t)tileY * numTilesX + tileX] != 0; }
+
+		/**
+			Pixels [x0, x1) x [y0, y1) covered by a tile (edge tiles are smaller).
+		*/
+		void getTileBounds(int tileX, int tileY, int& x0, int& y0, int& x1, int& y1);
+
+		/**
+			Writes a tile, taking its pixels from frameBuffer (which must cover the tile, e.g. a buffer of the size of the tile with its origin at the tile).
+			Returns false if the file is not open or could not be written.
+		*/
+		bool writeTile(int tileX, int tileY, FrameBuffer& frameBuffer);
+
+	private:
+		int width, height, tileWidth, tileHeight;
+		int numTilesX, numTilesY, numTilesWritten;
+		FrameBuffer::EXRCompression compression;
+		std::vector<EXRFormat::Channel> channels;
+		std::vector<char> header;
+		std::vector<uint64_t> offsets;			//File position of each tile (row by row), 0 if not written yet.
+		FILE* file;
+		long long endOfFile;					//Where the next tile is appended.
+		std::vector<unsigned char> tileData, scratch;
+		std::vector<signed char> compressed;
+		std::mutex mutex;
+
+		bool readOffsetTable();
+	};
+};
+#endif
@@ -0,0 +1,377 @@
+#include "WavefrontRenderer.h"
+#include "PrimaryVisibilityBuffer.h"
+#include "RayTracingFramework\VirtualObject\ISceneManager.h"
+#include "RayTracingFramework\VirtualObject\Camera\Camera.h"
+#include "RayTracingFramework\Sampling\Sampler.h"
+#include "RayTracingFramework\Profiling\Profiler.h"
+#include <algorithm>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define WAVEFRONT_USE_SSE
+#include <emmintrin.h>
+#endif
+
+namespace {
+	//Spreads the lower 10 bits of v, so that there are two zero bits between each of them (Morton code helper).
+	inline uint64_t spreadBits(uint64_t v) {
+		v &= 0x3FF;
+		v = (v | (v << 16)) & 0x030000FF;
+		v = (v | (v << 8)) & 0x0300F00F;
+		v = (v | (v << 4)) & 0x030C30C3;
+		v = (v | (v << 2)) & 0x09249249;
+		return v;
+	}
+
+	struct SortKeyLess {
+		template <class T> bool operator()(const T& a, const T& b) const { return a.sortKey < b.sortKey; }
+	};
+}
+
+RayTracingFramework::WavefrontRenderer::WavefrontRenderer(IScene& scene, Camera& camera)
+	: scene(scene)
+	, camera(camera)
+	, aovTarget(NULL)
+	, primaryVisibility(NULL)
+{
+	materials.compile(scene);
+}
+
+void RayTracingFramework::WavefrontRenderer::renderTile(int x0, int y0, int x1, int y1, cimg_library::CImg<unsigned char>& image) {
+	aovTarget = NULL;
+	traceTile(x0, y0, x1, y1);
+	//Copy the tile to the image (same conversion as main.cpp).
+	for (int y = y0; y < y1; y++) {
+		for (int x = x0; x < x1; x++) {
+			int pixel = (y - y0) * tileWidth + (x - x0);
+			if (!tileCovered[pixel])
+				continue;
+			Colour c = tileColours[pixel];
+			image(x, y, 0) = (unsigned char)((c.r <= 1 ? c.r : 1) * 255);
+			image(x, y, 1) = (unsigned char)((c.g <= 1 ? c.g : 1) * 255);
+			image(x, y, 2) = (unsigned char)((c.b <= 1 ? c.b : 1) * 255);
+		}
+	}
+}
+
+void RayTracingFramework::WavefrontRenderer::renderTile(int x0, int y0, int x1, int y1, FrameBuffer& frameBuffer) {
+	aovTarget = &frameBuffer;
+	traceTile(x0, y0, x1, y1);
+	aovTarget = NULL;
+	for (int y = y0; y < y1; y++)
+		for (int x = x0; x < x1; x++) {
+			int pixel = (y - y0) * tileWidth + (x - x0);
+			if (tileCovered[pixel])
+				frameBuffer.addSample(x, y, tileColours[pixel]);
+		}
+}
+
+void RayTracingFramework::WavefrontRenderer::traceTile(int x0, int y0, int x1, int y1) {
+	PROFILE_SCOPE("WavefrontRenderer::traceTile");
+	Profiler::TileTimer tileTimer(x0, y0, x1, y1);
+	tileX0 = x0; tileY0 = y0;
+	tileWidth = x1 - x0;
+	int tileHeight = y1 - y0;
+	tileColours.assign(tileWidth * tileHeight, Colour(0, 0, 0));
+	tileCovered.assign(tileWidth * tileHeight, false);
+
+	//1. Generate all primary rays of the tile in one call (they are already coherent, no need to sort them).
+	camera.createPrimaryRays(x0, y0, x1, y1, primaryRays);
+	rays.clear();
+	for (int i = 0; i < primaryRays.size(); i++) {
+		QueuedRay queued = { glm::vec4(primaryRays.originX[i], primaryRays.originY[i], primaryRays.originZ[i], 1.0f)
+			, glm::vec4(primaryRays.directionX[i], primaryRays.directionY[i], primaryRays.directionZ[i], 0.0f)
+			, (unsigned int)i, 1.0f, 0, 1.0f, 0, Ray::MediumStack(), primaryRays.differentials[i] };
+		rays.push_back(queued);
+	}
+
+	//2. Process one generation of rays at a time: intersect, trace shadows, shade (spawning the next generation).
+	while (!rays.empty()) {
+		traceQueue();
+		traceShadows();
+		shadeHits();
+		rays.swap(nextRays);
+		nextRays.clear();
+		sortQueue(rays);
+	}
+}
+
+bool RayTracingFramework::WavefrontRenderer::traceClosest(QueuedRay& queuedRay, Ray& scratchRay) {
+	scratchRay.reset(queuedRay.origin, queuedRay.direction, queuedRay.refractiveIndex);
+	scratchRay.media = queuedRay.media;
+	scratchRay.differentials = queuedRay.differentials;
+	if (primaryVisibility && queuedRay.recursiveLevel == 0)
+		primaryVisibility->intersect(scratchRay, tileX0 + queuedRay.pixel % tileWidth, tileY0 + queuedRay.pixel / tileWidth);
+	else
+		scene.intersect(scratchRay);
+	return scratchRay.getClosestIntersection().t_distance != FLT_MAX;
+}
+
+void RayTracingFramework::WavefrontRenderer::traceQueue() {
+	IShadingModel& shadingModel = scene.getShadingModel();
+	Ray scratchRay(glm::vec4(0, 0, 0, 1), glm::vec4(0, 0, 1, 0));
+	hits.clear();
+	for (unsigned int r = 0; r < rays.size(); r++) {
+		QueuedRay& queuedRay = rays[r];
+		if (!traceClosest(queuedRay, scratchRay)) {
+			//Secondary rays that escape see the background. Primary rays leave the pixel untouched.
+			if (queuedRay.recursiveLevel > 0)
+				tileColours[queuedRay.pixel] += queuedRay.weight * shadingModel.getBackgroundColour();
+			continue;
+		}
+		if (queuedRay.recursiveLevel == 0) {
+			tileCovered[queuedRay.pixel] = true;
+			if (aovTarget)
+				aovTarget->setAOVs(tileX0 + queuedRay.pixel % tileWidth, tileY0 + queuedRay.pixel / tileWidth, scratchRay, scene);
+		}
+		//Beyond the recursion limit, objects contribute black (as in IShadingModel::computeShading).
+		if (queuedRay.recursiveLevel >= shadingModel.getRecursionLimit())
+			continue;
+		QueuedHit hit;
+		hit.material = materials.getMaterialID(scratchRay.getClosestIntersection().collidingObjectID);
+		if (hit.material == MaterialTable::NO_MATERIAL)
+			continue;	//Nothing to shade it with.
+		ShadingInfo shadingInfo = shadingModel.createShadingInfo(scratchRay, scene, queuedRay.recursiveLevel, hit.ambientColour);
+		hit.ray = r;
+		hit.objectID = shadingInfo.originalObjectId;
+		hit.collisionPoint = shadingInfo.collisionPoint;
+		hit.collisionNormal = shadingInfo.collisionNormal;
+		hit.lightDirection = shadingInfo.lightSource->lightDirectionAtPoint(shadingInfo.collisionPoint);
+		hit.diffuseColour = shadingInfo.diffuseColour;
+		hit.specularColour = shadingInfo.specularColour;
+		hit.exiting = shadingModel.isExitingObject(shadingInfo);
+		hit.differentials = shadingInfo.differentials;
+		hits.push_back(hit);
+	}
+	sortHitsByMaterial();
+}
+
+void RayTracingFramework::WavefrontRenderer::sortHitsByMaterial() {
+	//Counting sort: material IDs are dense, and hits keep their order within each material.
+	materialStarts.assign(materials.getNumMaterials() + 1, 0);
+	for (size_t h = 0; h < hits.size(); h++)
+		materialStarts[hits[h].material + 1]++;
+	for (uint32_t m = 0; m < materials.getNumMaterials(); m++)
+		materialStarts[m + 1] += materialStarts[m];
+	std::vector<unsigned int> next(materialStarts.begin(), materialStarts.end() - 1);
+	gBuffer.resize(hits.size());
+	for (size_t h = 0; h < hits.size(); h++)
+		gBuffer.set(next[hits[h].material]++, hits[h], rays[hits[h].ray]);
+}
+
+void RayTracingFramework::WavefrontRenderer::GBuffer::resize(size_t size) {
+	ray.resize(size); objectID.resize(size); material.resize(size); exiting.resize(size);
+	pointX.resize(size); pointY.resize(size); pointZ.resize(size);
+	normalX.resize(size); normalY.resize(size); normalZ.resize(size);
+	directionX.resize(size); directionY.resize(size); directionZ.resize(size);
+	lightX.resize(size); lightY.resize(size); lightZ.resize(size);
+	ambientR.resize(size); ambientG.resize(size); ambientB.resize(size);
+	diffuseR.resize(size); diffuseG.resize(size); diffuseB.resize(size);
+	specularR.resize(size); specularG.resize(size); specularB.resize(size);
+	shadowIntensity.resize(size); differentials.resize(size);
+	localR.resize(size); localG.resize(size); localB.resize(size); diffuseIntensity.resize(size);
+}
+
+void RayTracingFramework::WavefrontRenderer::GBuffer::set(size_t i, const QueuedHit& hit, const QueuedRay& queuedRay) {
+	ray[i] = hit.ray; objectID[i] = hit.objectID; material[i] = hit.material; exiting[i] = hit.exiting ? 1 : 0;
+	pointX[i] = hit.collisionPoint.x; pointY[i] = hit.collisionPoint.y; pointZ[i] = hit.collisionPoint.z;
+	normalX[i] = hit.collisionNormal.x; normalY[i] = hit.collisionNormal.y; normalZ[i] = hit.collisionNormal.z;
+	directionX[i] = queuedRay.direction.x; directionY[i] = queuedRay.direction.y; directionZ[i] = queuedRay.direction.z;
+	lightX[i] = hit.lightDirection.x; lightY[i] = hit.lightDirection.y; lightZ[i] = hit.lightDirection.z;
+	ambientR[i] = hit.ambientColour.r; ambientG[i] = hit.ambientColour.g; ambientB[i] = hit.ambientColour.b;
+	diffuseR[i] = hit.diffuseColour.r; diffuseG[i] = hit.diffuseColour.g; diffuseB[i] = hit.diffuseColour.b;
+	specularR[i] = hit.specularColour.r; specularG[i] = hit.specularColour.g; specularB[i] = hit.specularColour.b;
+	shadowIntensity[i] = 0.0f;
+	differentials[i] = hit.differentials;
+}
+
+RayTracingFramework::ShadingInfo RayTracingFramework::WavefrontRenderer::rebuildShadingInfo(unsigned int hit, Colour& outputColour, Ray& scratchRay) {
+	QueuedRay& queuedRay = rays[gBuffer.ray[hit]];
+	scratchRay.reset(queuedRay.origin, queuedRay.direction, queuedRay.refractiveIndex);
+	scratchRay.media = queuedRay.media;
+	scratchRay.differentials = queuedRay.differentials;
+	scratchRay.importance = queuedRay.weight;
+	outputColour = Colour(gBuffer.ambientR[hit], gBuffer.ambientG[hit], gBuffer.ambientB[hit]);
+	ShadingInfo shadingInfo = {
+		outputColour, scene, scene.getLights()[0], materials.getMaterial(gBuffer.material[hit])
+		, glm::vec4(gBuffer.pointX[hit], gBuffer.pointY[hit], gBuffer.pointZ[hit], 1.0f), glm::vec4(gBuffer.normalX[hit], gBuffer.normalY[hit], gBuffer.normalZ[hit], 0.0f)
+		, scratchRay, gBuffer.objectID[hit], queuedRay.recursiveLevel, gBuffer.shadowIntensity[hit]
+		, Colour(gBuffer.diffuseR[hit], gBuffer.diffuseG[hit], gBuffer.diffuseB[hit]), Colour(gBuffer.specularR[hit], gBuffer.specularG[hit], gBuffer.specularB[hit])
+		, gBuffer.differentials[hit]
+	};
+	return shadingInfo;
+}
+
+void RayTracingFramework::WavefrontRenderer::traceShadows() {
+	IShadingModel& shadingModel = scene.getShadingModel();
+	Ray scratchRay(glm::vec4(0, 0, 0, 1), glm::vec4(0, 0, 1, 0));
+	Colour outputColour;
+	//1. One shadow ray per hit (field "pixel" keeps the index of the hit it belongs to). Hits leaving a transparent object are not lit, so they need none.
+	//Lights with an extent are sampled with the values of the pixel, at dimensions given by the depth of the hit (independent of the order of the queue).
+	Sampler sampler;
+	Sampler* previousSampler = &Sampler::getThreadSampler();
+	Sampler::setThreadSampler(&sampler);
+	shadowRays.clear();
+	for (unsigned int h = 0; h < gBuffer.size(); h++) {
+		if (gBuffer.exiting[h])
+			continue;
+		QueuedRay& queuedRay = rays[gBuffer.ray[h]];
+		sampler.startSample(tileX0 + queuedRay.pixel % tileWidth, tileY0 + queuedRay.pixel / tileWidth, 0);
+		sampler.setDimension(4 * queuedRay.recursiveLevel);
+		Ray shadowRay = shadingModel.createShadowRay(rebuildShadingInfo(h, outputColour, scratchRay));
+		QueuedRay queued = { shadowRay.origin_InWorldCoords, shadowRay.direction_InWorldCoords, h, 1.0f, 0, 1.0f, 0, Ray::MediumStack(), RayDifferentials() };
+		shadowRays.push_back(queued);
+	}
+	Sampler::setThreadSampler(previousSampler);
+	//2. Trace them as a coherent batch.
+	sortQueue(shadowRays);
+	Ray tracedRay(glm::vec4(0, 0, 0, 1), glm::vec4(0, 0, 1, 0));
+	for (unsigned int s = 0; s < shadowRays.size(); s++) {
+		unsigned int h = shadowRays[s].pixel;
+		tracedRay.reset(shadowRays[s].origin, shadowRays[s].direction);
+		scene.intersect(tracedRay);
+		//As IShadingModel::accumulateShadowIntensity, with the transparency of the occluders read from the material table.
+		float shadowIntensity = 0.0f;
+		while (tracedRay.getClosestIntersection().collidingObjectID == gBuffer.objectID[h])
+			tracedRay.discardClosestIntersection();
+		while (tracedRay.getClosestIntersection().t_distance != FLT_MAX && shadowIntensity < 1.0f) {
+			uint32_t occluder = materials.getMaterialID(tracedRay.getClosestIntersection().collidingObjectID);
+			shadowIntensity += 1.0f - ((occluder != MaterialTable::NO_MATERIAL) ? materials.K_t[occluder] : 0.0f);
+			tracedRay.discardClosestIntersection();
+		}
+		gBuffer.shadowIntensity[h] = (shadowIntensity > 1.0f) ? 1.0f : shadowIntensity;
+	}
+}
+
+void RayTracingFramework::WavefrontRenderer::shadeMaterial(uint32_t material, unsigned int begin, unsigned int end, Colour lightColour) {
+	//Local shading of opaque, entering hits: computeShadingTerms (calculateDiffuseIntensity and calculateSpecularComponent), with the same operations in the same order.
+	//The ambient term (K_a * diffuse colour) is already in the ambient colour of the hits (see createShadingInfo).
+	const float K_d = materials.K_d[material], K_s = materials.K_s[material];
+	const float K_t = materials.K_t[material], K_r = materials.K_r[material];
+	const float exponent = materials.shininess[material] / 4.0f;
+	GBuffer& g = gBuffer;
+	unsigned int h = begin;
+#ifdef WAVEFRONT_USE_SSE
+	const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f), signBit = _mm_set1_ps(-0.0f);
+	const __m128 kd = _mm_set1_ps(K_d), ks = _mm_set1_ps(K_s), transmitted = _mm_set1_ps(1.0f - K_t), notReflected = _mm_set1_ps(1.0f - K_r);
+	const __m128 lightR = _mm_set1_ps(lightColour.r), lightG = _mm_set1_ps(lightColour.g), lightB = _mm_set1_ps(lightColour.b);
+	for (; h + 4 <= end; h += 4) {
+		__m128 nx = _mm_loadu_ps(&g.normalX[h]), ny = _mm_loadu_ps(&g.normalY[h]), nz = _mm_loadu_ps(&g.normalZ[h]);
+		//Direction towards the light, and the cosine of its angle with the normal.
+		__m128 tx = _mm_xor_ps(_mm_loadu_ps(&g.lightX[h]), signBit), ty = _mm_xor_ps(_mm_loadu_ps(&g.lightY[h]), signBit), tz = _mm_xor_ps(_mm_loadu_ps(&g.lightZ[h]), signBit);
+		__m128 cosAngle = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, tx), _mm_mul_ps(ny, ty)), _mm_mul_ps(nz, tz));
+		__m128 intensity = _mm_mul_ps(_mm_mul_ps(_mm_min_ps(_mm_max_ps(cosAngle, zero), one), kd), _mm_sub_ps(one, _mm_loadu_ps(&g.shadowIntensity[h])));
+		_mm_storeu_ps(&g.diffuseIntensity[h], intensity);
+		//(ambient + diffuse) * (1 - K_t) * (1 - K_r)
+		__m128 r = _mm_mul_ps(_mm_mul_ps(_mm_add_ps(_mm_loadu_ps(&g.ambientR[h]), _mm_mul_ps(_mm_mul_ps(intensity, _mm_loadu_ps(&g.diffuseR[h])), lightR)), transmitted), notReflected);
+		__m128 gr = _mm_mul_ps(_mm_mul_ps(_mm_add_ps(_mm_loadu_ps(&g.ambientG[h]), _mm_mul_ps(_mm_mul_ps(intensity, _mm_loadu_ps(&g.diffuseG[h])), lightG)), transmitted), notReflected);
+		__m128 b = _mm_mul_ps(_mm_mul_ps(_mm_add_ps(_mm_loadu_ps(&g.ambientB[h]), _mm_mul_ps(_mm_mul_ps(intensity, _mm_loadu_ps(&g.diffuseB[h])), lightB)), transmitted), notReflected);
+		//+ specular (skipped by materials without it, as it adds 0).
+		if (K_s != 0.0f) {
+			//Light reflected about the normal, and the cosine of its angle with the ray (there is no vector pow, so that is taken lane by lane).
+			__m128 rx = _mm_sub_ps(tx, _mm_mul_ps(_mm_mul_ps(nx, cosAngle), two));
+			__m128 ry = _mm_sub_ps(ty, _mm_mul_ps(_mm_mul_ps(ny, cosAngle), two));
+			__m128 rz = _mm_sub_ps(tz, _mm_mul_ps(_mm_mul_ps(nz, cosAngle), two));
+			__m128 specAngle = _mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, _mm_loadu_ps(&g.directionX[h])), _mm_mul_ps(ry, _mm_loadu_ps(&g.directionY[h]))), _mm_mul_ps(rz, _mm_loadu_ps(&g.directionZ[h])));
+			float angles[4], powers[4];
+			_mm_storeu_ps(angles, _mm_max_ps(specAngle, zero));
+			for (int k = 0; k < 4; k++)
+				powers[k] = glm::pow(angles[k], exponent);
+			__m128 weight = _mm_mul_ps(_mm_loadu_ps(powers), ks);
+			r = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(weight, _mm_loadu_ps(&g.specularR[h])), lightR));
+			gr = _mm_add_ps(gr, _mm_mul_ps(_mm_mul_ps(weight, _mm_loadu_ps(&g.specularG[h])), lightG));
+			b = _mm_add_ps(b, _mm_mul_ps(_mm_mul_ps(weight, _mm_loadu_ps(&g.specularB[h])), lightB));
+		}
+		_mm_storeu_ps(&g.localR[h], r);
+		_mm_storeu_ps(&g.localG[h], gr);
+		_mm_storeu_ps(&g.localB[h], b);
+	}
+#endif
+	for (; h < end; h++) {
+		float tx = -g.lightX[h], ty = -g.lightY[h], tz = -g.lightZ[h];
+		float cosAngle = (g.normalX[h] * tx + g.normalY[h] * ty) + g.normalZ[h] * tz;
+		float intensity = (cosAngle > 1 ? 1 : (cosAngle < 0 ? 0 : cosAngle)) * K_d * (1.0f - g.shadowIntensity[h]);
+		g.diffuseIntensity[h] = intensity;
+		Colour diffuse = Colour(g.ambientR[h], g.ambientG[h], g.ambientB[h]) + intensity * Colour(g.diffuseR[h], g.diffuseG[h], g.diffuseB[h]) * lightColour;
+		Colour local = diffuse * (1.0f - K_t) * (1.0f - K_r);
+		if (K_s != 0.0f) {
+			glm::vec3 reflected = glm::vec3(tx, ty, tz) - glm::vec3(g.normalX[h], g.normalY[h], g.normalZ[h]) * cosAngle * 2.0f;
+			float specAngle = glm::max((reflected.x * g.directionX[h] + reflected.y * g.directionY[h]) + reflected.z * g.directionZ[h], 0.0f);
+			local += glm::pow(specAngle, exponent) * K_s * Colour(g.specularR[h], g.specularG[h], g.specularB[h]) * lightColour;
+		}
+		g.localR[h] = local.r; g.localG[h] = local.g; g.localB[h] = local.b;
+	}
+}
+
+void RayTracingFramework::WavefrontRenderer::shadeHits() {
+	IShadingModel& shadingModel = scene.getShadingModel();
+	Colour lightColour = scene.getLights()[0]->baseColour();
+	float minimumWeight = shadingModel.getMinimumRayWeight();
+	Ray scratchRay(glm::vec4(0, 0, 0, 1), glm::vec4(0, 0, 1, 0));
+	Colour outputColour;
+	for (uint32_t m = 0; m < materials.getNumMaterials(); m++) {
+		unsigned int begin = materialStarts[m], end = materialStarts[m + 1];
+		if (begin == end)
+			continue;
+		//Opaque materials are shaded in batches. Transparent ones (which need the Fresnel terms of their interface) go through computeShadingTerms.
+		bool batched = (materials.K_t[m] == 0.0f);
+		if (batched)
+			shadeMaterial(m, begin, end, lightColour);
+		for (unsigned int h = begin; h < end; h++) {
+			QueuedRay& queuedRay = rays[gBuffer.ray[h]];
+			ShadingTerms terms;
+			if (batched && !gBuffer.exiting[h]) {
+				terms.localColour = Colour(gBuffer.localR[h], gBuffer.localG[h], gBuffer.localB[h]);
+				terms.transmissionWeight = terms.fresnelReflectionWeight = 0.0f;
+				terms.reflectionWeight = materials.K_r[m] * (gBuffer.diffuseIntensity[h] + materials.K_a[m]);
+			}
+			else
+				terms = shadingModel.computeShadingTerms(rebuildShadingInfo(h, outputColour, scratchRay));
+			tileColours[queuedRay.pixel] += queuedRay.weight * terms.localColour;
+			//Spawn the secondary rays of the next generation (only if they can change the pixel, as IShadingModel does).
+			bool transmission = queuedRay.weight * terms.transmissionWeight >= minimumWeight;
+			bool fresnelReflection = queuedRay.weight * terms.fresnelReflectionWeight >= minimumWeight;
+			bool reflection = queuedRay.weight * terms.reflectionWeight >= minimumWeight;
+			if (!transmission && !fresnelReflection && !reflection)
+				continue;
+			ShadingInfo shadingInfo = rebuildShadingInfo(h, outputColour, scratchRay);
+			if (transmission) {
+				Ray transmissionRay = shadingModel.createTransmissionRay(shadingInfo);
+				queueSecondaryRay(transmissionRay, queuedRay, terms.transmissionWeight);
+			}
+			if (fresnelReflection) {
+				Ray fresnelReflectionRay = shadingModel.createFresnelReflectionRay(shadingInfo);
+				queueSecondaryRay(fresnelReflectionRay, queuedRay, terms.fresnelReflectionWeight);
+			}
+			if (reflection) {
+				Ray reflectionRay = shadingModel.createReflectionRay(shadingInfo);
+				reflectionRay.media = queuedRay.media;
+				reflectionRay.refractiveIndex = queuedRay.refractiveIndex;
+				queueSecondaryRay(reflectionRay, queuedRay, terms.reflectionWeight);
+			}
+		}
+	}
+}
+
+void RayTracingFramework::WavefrontRenderer::queueSecondaryRay(Ray& secondaryRay, QueuedRay& parent, float weight) {
+	QueuedRay queued = { secondaryRay.origin_InWorldCoords, secondaryRay.direction_InWorldCoords, parent.pixel, parent.weight * weight, parent.recursiveLevel + 1, secondaryRay.refractiveIndex, 0, secondaryRay.media, secondaryRay.differentials };
+	nextRays.push_back(queued);
+}
+
+void RayTracingFramework::WavefrontRenderer::sortQueue(std::vector<QueuedRay>& queue) {
+	if (queue.size() < 2)
+		return;
+	//Key = direction octant (3 bits) + Morton code of the origin (30 bits), quantised inside the bounds of the queue.
+	glm::vec3 minBound(FLT_MAX), maxBound(-FLT_MAX);
+	for (size_t r = 0; r < queue.size(); r++) {
+		minBound = glm::min(minBound, glm::vec3(queue[r].origin));
+		maxBound = glm::max(maxBound, glm::vec3(queue[r].origin));
+	}
+	glm::vec3 extent = glm::max(maxBound - minBound, glm::vec3(1e-6f));
+	for (size_t r = 0; r < queue.size(); r++) {
+		glm::vec3 cell = (glm::vec3(queue[r].origin) - minBound) / extent * 1023.0f;
+		uint64_t morton = spreadBits((uint64_t)cell.x) | (spreadBits((uint64_t)cell.y) << 1) | (spreadBits((uint64_t)cell.z) << 2);
+		uint64_t octant = (queue[r].direction.x < 0 ? 1 : 0) | (queue[r].direction.y < 0 ? 2 : 0) | (queue[r].direction.z < 0 ? 4 : 0);
+		queue[r].sortKey = (octant << 30) | morton;
+	}
+	std::stable_sort(queue.begin(), queue.end(), SortKeyLess());
+}
@@ -0,0 +1,125 @@
+#ifndef _WAVEFRONTRENDERER_RAYTRACINGFRAMEWORK
+#define _WAVEFRONTRENDERER_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include "RayTracingFramework\Ray.h"
+#include "RayTracingFramework\RayPacket.h"
+#include "RayTracingFramework\ShadingModels\IShadingModel.h"
+#include "RayTracingFramework\ShadingModels\MaterialTable.h"
+#include "FrameBuffer.h"
+#include <vector>
+#include <stdint.h>
+
+namespace RayTracingFramework{
+	class Camera;
+	class PrimaryVisibilityBuffer;
+
+	/**
+		CLASS: WavefrontRenderer
+		DESCRIPTION: Breadth-first alternative to the per pixel loop of main.cpp (IShadingModel::computeShading traces its secondary rays depth-first, one at a time).
+		All primary rays of a tile are generated into a queue and intersected in bulk. Hits are then written into a G-buffer sorted by material, and the shadow, reflection and
+		transmission rays they spawn are written into new queues, sorted by origin and direction (so that consecutive rays visit the same objects) and traced as a batch. This repeats
+		until no rays are left.
+		Materials are read from a MaterialTable compiled when the renderer is created (call updateMaterials after changing the materials of the scene). The local shading of opaque
+		materials is computed 4 hits at a time (SSE), with the same operations as the staged methods of IShadingModel, which shade the rest (transparent materials, interfaces)
+		and create the secondary rays; so the result is the same as the depth-first renderer.
+	*/
+	class WavefrontRenderer
+	{
+	public:
+		WavefrontRenderer(IScene& scene, Camera& camera);
+
+		/**
+			Renders pixels [x0, x1) x [y0, y1). Pixels whose primary ray hits an object are written to image (clamped to 8 bits). The rest are left untouched (background).
+		*/
+		void renderTile(int x0, int y0, int x1, int y1, cimg_library::CImg<unsigned char>& image);
+
+		/**
+			Renders pixels [x0, x1) x [y0, y1), adding one sample per pixel to frameBuffer (HDR, no clamping), plus the AOVs of the primary hits (if enabled).
+		*/
+		void renderTile(int x0, int y0, int x1, int y1, FrameBuffer& frameBuffer);
+
+		/**
+			Compiles the materials of the scene again (after objects were added or their materials changed).
+		*/
+		inline void updateMaterials() { materials.compile(scene); }
+
+		/**
+			Primary rays find their first hit with buffer (built for the camera of the renderer) instead of traversing the scene. NULL (default) disables it.
+		*/
+		inline void setPrimaryVisibility(PrimaryVisibilityBuffer* buffer) { primaryVisibility = buffer; }
+
+	private:
+		//Compact description of a queued ray (the intersections are only stored for the closest hit).
+		struct QueuedRay {
+			glm::vec4 origin, direction;
+			unsigned int pixel;				//Index of the pixel (within the tile) that receives the contribution of this ray.
+			float weight;					//Weight of the colour found by this ray in the final pixel colour.
+			int recursiveLevel;
+			float refractiveIndex;			//Refractive index of the medium the ray travels through.
+			uint64_t sortKey;
+			Ray::MediumStack media;			//Transparent objects the ray is inside of.
+			RayDifferentials differentials;	//Footprint of the pixel (primary rays and their reflections/refractions; invalid for shadow rays).
+		};
+		//A ray that hit an object, waiting to be shaded (the fields of ShadingInfo that do not depend on the ray), as found by traceQueue.
+		struct QueuedHit {
+			unsigned int ray;				//Index into the current ray queue.
+			uint32_t material;				//Material ID (see MaterialTable).
+			unsigned int objectID;
+			glm::vec4 collisionPoint, collisionNormal;
+			glm::vec4 lightDirection;		//Direction of the light at the collision point (lightDirectionAtPoint).
+			Colour ambientColour;
+			Colour diffuseColour, specularColour;
+			bool exiting;					//The ray leaves a transparent object here (see IShadingModel::isExitingObject).
+			RayDifferentials differentials;	//Differentials of the ray moved to the collision point (see ShadingInfo).
+		};
+		//G-buffer: the hits of the current queue as a structure of arrays, sorted by material ID, so that consecutive hits share their material and 4 of them can be
+		//shaded with each SSE instruction. Directions and normals have w = 0 (and points w = 1) in the ShadingInfo they stand for.
+		struct GBuffer {
+			std::vector<unsigned int> ray, objectID;
+			std::vector<uint32_t> material;
+			std::vector<uint8_t> exiting;
+			std::vector<float> pointX, pointY, pointZ;
+			std::vector<float> normalX, normalY, normalZ;
+			std::vector<float> directionX, directionY, directionZ;		//Direction of the ray.
+			std::vector<float> lightX, lightY, lightZ;
+			std::vector<float> ambientR, ambientG, ambientB;
+			std::vector<float> diffuseR, diffuseG, diffuseB;
+			std::vector<float> specularR, specularG, specularB;
+			std::vector<float> shadowIntensity;
+			std::vector<RayDifferentials> differentials;
+			//Filled by shadeMaterial: local colour of the hit (see ShadingTerms) and the diffuse intensity that weights its reflection.
+			std::vector<float> localR, localG, localB, diffuseIntensity;
+
+			void resize(size_t size);
+			void set(size_t i, const QueuedHit& hit, const QueuedRay& queuedRay);
+			inline size_t size() { return ray.size(); }
+		};
+
+		IScene& scene;
+		Camera& camera;
+		MaterialTable materials;
+		//Queues are kept between tiles, to avoid reallocating them.
+		RayPacket primaryRays;
+		std::vector<QueuedRay> rays, nextRays, shadowRays;
+		std::vector<QueuedHit> hits;
+		GBuffer gBuffer;
+		std::vector<unsigned int> materialStarts;		//Hits of material m are gBuffer[materialStarts[m], materialStarts[m + 1]).
+		std::vector<Colour> tileColours;
+		std::vector<bool> tileCovered;
+		int tileX0, tileY0, tileWidth;
+		FrameBuffer* aovTarget;			//Receives the AOVs of primary hits (NULL -> not needed).
+		PrimaryVisibilityBuffer* primaryVisibility;
+
+		void traceTile(int x0, int y0, int x1, int y1);
+		void traceQueue();
+		void traceShadows();
+		void shadeHits();
+		void sortHitsByMaterial();
+		void shadeMaterial(uint32_t material, unsigned int begin, unsigned int end, Colour lightColour);
+		void sortQueue(std::vector<QueuedRay>& queue);
+		bool traceClosest(QueuedRay& queuedRay, Ray& scratchRay);
+		void queueSecondaryRay(Ray& secondaryRay, QueuedRay& parent, float weight);
+		ShadingInfo rebuildShadingInfo(unsigned int hit, Colour& outputColour, Ray& scratchRay);
+	};
+};
+#endif
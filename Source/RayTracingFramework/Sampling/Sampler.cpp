@@ -0,0 +1,233 @@
+#include "Sampler.h"
+#include <vector>
+#include <cmath>
+
+namespace {
+	//Sampler selected with setThreadSampler (if any).
+	thread_local RayTracingFramework::Sampler* selectedSampler = NULL;
+
+	const uint32_t NO_BLOCK = 0xFFFFFFFFu;
+
+	//Direction numbers of the first 4 Sobol dimensions (32 bits each).
+	struct SobolDirections {
+		uint32_t v[4][32];
+		SobolDirections() {
+			//Dimension 0 is the van der Corput sequence. The others use the primitive polynomials and initial direction numbers of S. Joe and F. Kuo.
+			for (int i = 0; i < 32; i++)
+				v[0][i] = 1u << (31 - i);
+			const int degrees[3] = { 1, 2, 3 };
+			const uint32_t coefficients[3] = { 0, 1, 1 };
+			const uint32_t initial[3][3] = { { 1, 0, 0 }, { 1, 3, 0 }, { 1, 3, 1 } };
+			for (int d = 1; d < 4; d++) {
+				int s = degrees[d - 1];
+				for (int i = 0; i < 32; i++) {
+					if (i < s) {
+						v[d][i] = initial[d - 1][i] << (31 - i);
+						continue;
+					}
+					uint32_t value = v[d][i - s] ^ (v[d][i - s] >> s);
+					for (int k = 1; k < s; k++)
+						if ((coefficients[d - 1] >> (s - 1 - k)) & 1)
+							value ^= v[d][i - k];
+					v[d][i] = value;
+				}
+			}
+		}
+	};
+
+	inline uint32_t reverseBits(uint32_t x) {
+		x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+		x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+		x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+		x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+		return (x >> 16) | (x << 16);
+	}
+
+	const int MASK_SIZE = RayTracingFramework::Sampler::BLUE_NOISE_SIZE, MASK_PIXELS = MASK_SIZE * MASK_SIZE;
+
+	//Adds (sign = 1) or removes (sign = -1) the energy of a pixel of the binary pattern.
+	void splatEnergy(std::vector<float>& energy, const std::vector<float>& kernel, int pixel, float sign) {
+		int px = pixel % MASK_SIZE, py = pixel / MASK_SIZE;
+		for (int y = 0; y < MASK_SIZE; y++)
+			for (int x = 0; x < MASK_SIZE; x++)
+				energy[y * MASK_SIZE + x] += sign * kernel[((y - py + MASK_SIZE) % MASK_SIZE) * MASK_SIZE + (x - px + MASK_SIZE) % MASK_SIZE];
+	}
+
+	//Pixel with the highest (tightest cluster, among ones) or lowest (largest void, among zeros) energy.
+	int findPixel(const std::vector<float>& energy, const std::vector<char>& pattern, char value, bool highest) {
+		int best = -1;
+		for (int i = 0; i < MASK_PIXELS; i++)
+			if (pattern[i] == value && (best == -1 || (highest ? energy[i] > energy[best] : energy[i] < energy[best])))
+				best = i;
+		return best;
+	}
+
+	//Blue noise mask (void and cluster method, R. Ulichney): values are the ranks of the pixels, in [0, 1).
+	std::vector<float> createBlueNoiseMask() {
+		const int N = MASK_SIZE, COUNT = MASK_PIXELS;
+		//Gaussian energy filter (sigma = 1.5) over the torus: kernel[dy * N + dx] for the offset (dx, dy) between two pixels.
+		std::vector<float> kernel(COUNT);
+		for (int dy = 0; dy < N; dy++)
+			for (int dx = 0; dx < N; dx++) {
+				int wx = glm::min(dx, N - dx), wy = glm::min(dy, N - dy);
+				kernel[dy * N + dx] = std::exp(-(float)(wx * wx + wy * wy) / (2.0f * 1.5f * 1.5f));
+			}
+		std::vector<char> pattern(COUNT, 0);
+		std::vector<float> energy(COUNT, 0.0f);
+		//1. Initial binary pattern (10% of the pixels, random), relaxed until moving the tightest cluster does not change it.
+		int ones = 0;
+		for (uint32_t i = 0; ones < COUNT / 10; i++) {
+			uint32_t v[4] = { i, 0x2545F491u, 0, 0 };
+			RayTracingFramework::Sampler::hash4(v);
+			int pixel = (int)(v[0] % COUNT);
+			if (pattern[pixel])
+				continue;
+			pattern[pixel] = 1;
+			splatEnergy(energy, kernel, pixel, 1.0f);
+			ones++;
+		}
+		for (int iteration = 0; iteration < COUNT; iteration++) {
+			int cluster = findPixel(energy, pattern, 1, true);
+			pattern[cluster] = 0;
+			splatEnergy(energy, kernel, cluster, -1.0f);
+			int largestVoid = findPixel(energy, pattern, 0, false);
+			pattern[largestVoid] = 1;
+			splatEnergy(energy, kernel, largestVoid, 1.0f);
+			if (largestVoid == cluster)
+				break;
+		}
+		//2. Ranks of the initial pattern: remove its tightest clusters one by one.
+		std::vector<int> ranks(COUNT, 0);
+		std::vector<char> removing(pattern);
+		std::vector<float> removingEnergy(energy);
+		for (int rank = ones - 1; rank >= 0; rank--) {
+			int cluster = findPixel(removingEnergy, removing, 1, true);
+			removing[cluster] = 0;
+			splatEnergy(removingEnergy, kernel, cluster, -1.0f);
+			ranks[cluster] = rank;
+		}
+		//3. Ranks of the other pixels: fill the largest voids one by one.
+		for (int rank = ones; rank < COUNT; rank++) {
+			int largestVoid = findPixel(energy, pattern, 0, false);
+			pattern[largestVoid] = 1;
+			splatEnergy(energy, kernel, largestVoid, 1.0f);
+			ranks[largestVoid] = rank;
+		}
+		std::vector<float> mask(COUNT);
+		for (int i = 0; i < COUNT; i++)
+			mask[i] = ((float)ranks[i] + 0.5f) / (float)COUNT;
+		return mask;
+	}
+}
+
+RayTracingFramework::Sampler::Sampler(Sequence sequence, uint32_t seed)
+	: sequence(sequence)
+	, seed(seed)
+	, pixelX(0)
+	, pixelY(0)
+	, sampleIndex(0)
+	, dimension(0)
+	, cachedBlock(NO_BLOCK)
+{
+	//The seed is hashed before being mixed with the blocks, so that different seeds do not just shift them.
+	seedHash[0] = seed;
+	seedHash[1] = 0x68E31DA4u;
+	seedHash[2] = 0xB5297A4Du;
+	seedHash[3] = 0x1B56C4E9u;
+	hash4(seedHash);
+}
+
+void RayTracingFramework::Sampler::startSample(uint32_t x, uint32_t y, uint32_t newSampleIndex) {
+	pixelX = x;
+	pixelY = y;
+	sampleIndex = newSampleIndex;
+	dimension = 0;
+	cachedBlock = NO_BLOCK;
+}
+
+float RayTracingFramework::Sampler::getValue(uint32_t x, uint32_t y, uint32_t index, uint32_t valueDimension) {
+	float values[4];
+	computeBlock(x, y, index, valueDimension >> 2, values);
+	return values[valueDimension & 3];
+}
+
+RayTracingFramework::Sampler& RayTracingFramework::Sampler::getThreadSampler() {
+	if (selectedSampler)
+		return *selectedSampler;
+	static thread_local Sampler defaultSampler;
+	return defaultSampler;
+}
+
+void RayTracingFramework::Sampler::setThreadSampler(Sampler* sampler) {
+	selectedSampler = sampler;
+}
+
+void RayTracingFramework::Sampler::hash4(uint32_t v[4]) {
+	for (int i = 0; i < 4; i++)
+		v[i] = v[i] * 1664525u + 1013904223u;
+	v[0] += v[1] * v[3]; v[1] += v[2] * v[0]; v[2] += v[0] * v[1]; v[3] += v[1] * v[2];
+	for (int i = 0; i < 4; i++)
+		v[i] ^= v[i] >> 16;
+	v[0] += v[1] * v[3]; v[1] += v[2] * v[0]; v[2] += v[0] * v[1]; v[3] += v[1] * v[2];
+}
+
+void RayTracingFramework::Sampler::computeBlock(uint32_t block) {
+	computeBlock(pixelX, pixelY, sampleIndex, block, cachedValues);
+	cachedBlock = block;
+}
+
+void RayTracingFramework::Sampler::computeBlock(uint32_t x, uint32_t y, uint32_t index, uint32_t block, float values[4]) {
+	if (sequence == SEQUENCE_RANDOM) {
+		uint32_t v[4] = { x, y, index, block ^ seedHash[0] };
+		hash4(v);
+		for (int d = 0; d < 4; d++)
+			values[d] = toFloat(v[d]);
+		return;
+	}
+	//Scrambling of the block: per pixel for Sobol, shared by all the pixels for blue noise (the mask decorrelates them instead).
+	bool perPixel = (sequence == SEQUENCE_SOBOL);
+	uint32_t scrambling[4] = { perPixel ? x : 0u, perPixel ? y : 0u, block, seedHash[1] };
+	hash4(scrambling);
+	uint32_t shuffle[4] = { scrambling[0], scrambling[1], scrambling[2], scrambling[3] ^ seedHash[2] };
+	hash4(shuffle);
+	uint32_t shuffledIndex = nestedUniformScramble(index, shuffle[0]);
+	for (int d = 0; d < 4; d++)
+		values[d] = toFloat(nestedUniformScramble(sobol(shuffledIndex, d), scrambling[d]));
+	if (sequence != SEQUENCE_BLUE_NOISE)
+		return;
+	//Cranley-Patterson rotation by the blue noise mask, with a different toroidal offset for each dimension.
+	const float* mask = blueNoiseMask();
+	uint32_t offsets[4] = { block, seedHash[3], 0x9E3779B9u, 0 };
+	hash4(offsets);
+	for (int d = 0; d < 4; d++) {
+		uint32_t maskX = (x + (offsets[d] & 0xFFFF)) % BLUE_NOISE_SIZE, maskY = (y + (offsets[d] >> 16)) % BLUE_NOISE_SIZE;
+		float value = values[d] + mask[maskY * BLUE_NOISE_SIZE + maskX];
+		values[d] = (value >= 1.0f) ? value - 1.0f : value;
+	}
+}
+
+uint32_t RayTracingFramework::Sampler::sobol(uint32_t index, int sobolDimension) {
+	static const SobolDirections directions;
+	uint32_t result = 0;
+	for (int bit = 0; index; bit++, index >>= 1)
+		if (index & 1)
+			result ^= directions.v[sobolDimension][bit];
+	return result;
+}
+
+uint32_t RayTracingFramework::Sampler::nestedUniformScramble(uint32_t x, uint32_t scrambleSeed) {
+	//Laine-Karras style hash on the reversed bits (improved constants by N. Vegdahl): each bit only depends on the bits above it, as Owen scrambling requires.
+	x = reverseBits(x);
+	x ^= x * 0x3D20ADEAu;
+	x += scrambleSeed;
+	x *= (scrambleSeed >> 16) | 1u;
+	x ^= x * 0x05526C56u;
+	x ^= x * 0x53A22864u;
+	return reverseBits(x);
+}
+
+const float* RayTracingFramework::Sampler::blueNoiseMask() {
+	//Built once (about 4096 x 8192 operations), the first time a blue noise sample is drawn.
+	static const std::vector<float> mask = createBlueNoiseMask();
+	return &mask[0];
+}
@@ -0,0 +1,107 @@
+/**
+	CLASS: Sampler
+	DESCRIPTION: Counter based source of sample values for all sampled features (pixel jitter, lens, shutter time, soft shadows, path tracing...).
+	A value is a pure function of (seed, pixel, sample index, dimension): there is no sequential state shared between pixels or threads, so images are
+	identical whatever the number of threads, the order of the tiles, or whether the render was resumed. Each sample of a pixel draws its values
+	in order (dimension 0, 1, 2...), so the same use of a dimension gets the same value every time the sample is rendered.
+	This does not hold for state that samples share: with the IrradianceCache enabled, a pixel may interpolate records created by other threads first.
+	Sequences:
+	- SEQUENCE_RANDOM: Independent uniform values (pcg4d hash, by M. Jarzynski and M. Olano, over (pixel x, pixel y, sample index, dimension block)).
+	- SEQUENCE_SOBOL: Owen scrambled Sobol points (B. Burley, "Practical hash-based Owen scrambling"). Dimensions are taken in blocks of 4 (the
+	first 4 Sobol dimensions), each block with its own scrambling and shuffled index, so any number of dimensions can be drawn. Each pixel gets an independent
+	scrambling, so it converges much faster than random values with the same decorrelation between pixels.
+	- SEQUENCE_BLUE_NOISE: The same scrambled Sobol points for all the pixels, shifted (modulo 1) by a blue noise mask tiled over the image (a different
+	toroidal offset per dimension). Errors are then distributed as blue noise in screen space, which looks much smoother at low sample counts.
+	Renderers select the sampler of the pixel being rendered with setThreadSampler (shading models and lights draw from getThreadSampler).
+*/
+#ifndef _SAMPLER_RAYTRACINGFRAMEWORK
+#define _SAMPLER_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include <stdint.h>
+
+namespace RayTracingFramework{
+	class Sampler
+	{
+	public:
+		enum Sequence { SEQUENCE_RANDOM, SEQUENCE_SOBOL, SEQUENCE_BLUE_NOISE };
+		static const int BLUE_NOISE_SIZE = 64;		//Side of the blue noise mask (in pixels).
+
+		Sampler(Sequence sequence = SEQUENCE_RANDOM, uint32_t seed = 0);
+
+		inline Sequence getSequence() { return sequence; }
+		inline uint32_t getSeed() { return seed; }
+
+		/**
+			Starts drawing the values of sample sampleIndex of pixel (x, y), from dimension 0. Values not tied to a pixel can use any other key in x and y
+			(e.g. a hash of a position).
+		*/
+		void startSample(uint32_t x, uint32_t y, uint32_t sampleIndex);
+
+		/**
+			Skips to a dimension of the current sample (e.g. so that a stage always uses the same dimensions, whatever was drawn before it).
+		*/
+		inline void setDimension(uint32_t newDimension) { dimension = newDimension; }
+		inline uint32_t getDimension() { return dimension; }
+
+		/**
+			Next value of the sample, in [0, 1).
+		*/
+		inline float next1D() {
+			if ((dimension >> 2) != cachedBlock)
+				computeBlock(dimension >> 2);
+			return cachedValues[dimension++ & 3];
+		}
+
+		/**
+			Next two values of the sample (both from the same 4 dimensional block, when possible, so they are stratified together).
+		*/
+		inline glm::vec2 next2D() {
+			if ((dimension & 3) == 3)
+				dimension++;
+			float u = next1D();
+			return glm::vec2(u, next1D());
+		}
+
+		/**
+			Value of dimension of sample sampleIndex of pixel (x, y), without changing the current sample.
+		*/
+		float getValue(uint32_t x, uint32_t y, uint32_t sampleIndex, uint32_t dimension);
+
+		/**
+			Sampler used by the calling thread (see setThreadSampler). If none was selected, a thread local random sampler that is never restarted
+			is returned: that one is only reproducible when everything is rendered by a single thread.
+		*/
+		static Sampler& getThreadSampler();
+
+		/**
+			Makes the calling thread draw from sampler (NULL goes back to the default one). Renderers select (and start) one for each pixel sample they shade.
+		*/
+		static void setThreadSampler(Sampler* sampler);
+
+		/**
+			Hash of 4 values into 4 independent values (pcg4d). Handy for any other counter based random number.
+		*/
+		static void hash4(uint32_t v[4]);
+
+		/**
+			Converts 32 random bits into a float in [0, 1).
+		*/
+		static inline float toFloat(uint32_t bits) { return (bits >> 8) * (1.0f / 16777216.0f); }
+
+	private:
+		Sequence sequence;
+		uint32_t seed;
+		uint32_t seedHash[4];
+		uint32_t pixelX, pixelY, sampleIndex;
+		uint32_t dimension;
+		uint32_t cachedBlock;			//Block of 4 dimensions held in cachedValues (0xFFFFFFFF -> none).
+		float cachedValues[4];
+
+		void computeBlock(uint32_t block);
+		void computeBlock(uint32_t x, uint32_t y, uint32_t index, uint32_t block, float values[4]);
+		static uint32_t sobol(uint32_t index, int dimension);
+		static uint32_t nestedUniformScramble(uint32_t x, uint32_t seed);
+		static const float* blueNoiseMask();
+	};
+};
+#endif
@@ -1,23 +1,86 @@
 #include "IShadingModel.h"
+#include "RayTracingFramework\Sampling\Sampler.h"
+#include "RayTracingFramework\Profiling\Profiler.h"
 
 
 RayTracingFramework::Colour RayTracingFramework::IShadingModel::computeShading(RayTracingFramework::Ray& ray, RayTracingFramework::IScene& scene, int recursiveLevel) {
 	if (recursiveLevel >= recursionLimit)
 		return RayTracingFramework::Colour(0, 0, 0);
+	PROFILE_SCOPE("IShadingModel::computeShading");
 
+	//Let's get the intersection we need to shade, and initially equate output colour with the ambient component of the shading model.
+	Colour outputColour;
+	ShadingInfo shadingInfo = createShadingInfo(ray, scene, recursiveLevel, outputColour);
+	//The stages below are timed under the object being shaded (i.e. its material).
+	PROFILE_SCOPE("surface", shadingInfo.originalObjectId);
+
+	//Leaving a transparent object: this is just the interface with the medium behind it (no lighting from inside the object).
+	if (isExitingObject(shadingInfo))
+		return traceInterface(shadingInfo, 1.0f);
+
+	//Shadow and diffuse shading (the same from any point of view), then the rest.
+	float diffuseIntensity = computeViewIndependentLighting(shadingInfo);
+	return computeViewDependentColour(shadingInfo, diffuseIntensity);
+}
+
+float RayTracingFramework::IShadingModel::computeViewIndependentLighting(ShadingInfo& shadingInfo) {
+	//Get intensity of shadow at collision point.
+	shadingInfo.shadowIntensity = getShadowIntensity(shadingInfo);
+
+	//Lambert term (shadowed), without the colours of the material.
+	return calculateDiffuseIntensity(shadingInfo);
+}
+
+RayTracingFramework::Colour RayTracingFramework::IShadingModel::computeViewDependentColour(ShadingInfo& shadingInfo, float diffuseIntensity) {
+	Colour& outputColour = shadingInfo.outputColour;
+
+	//Apply diffuse shading to output colour (which holds the ambient component).
+	outputColour = computeDiffuse(shadingInfo, diffuseIntensity);
+
+	//Apply transparency.
+	outputColour = getNextLayerColour(shadingInfo);
+
+	//Apply potential reflections.
+	outputColour = checkForReflection(shadingInfo);
+
+	//Apply specular shading.
+	outputColour = computeSpecular(shadingInfo);
+
+	return outputColour;
+}
+
+RayTracingFramework::ShadingInfo RayTracingFramework::IShadingModel::createShadingInfo(RayTracingFramework::Ray& ray, RayTracingFramework::IScene& scene, int recursiveLevel, RayTracingFramework::Colour& outputColour) {
+	PROFILE_SCOPE("IShadingModel::createShadingInfo");
 	//Let's get the intersection we need to shade and the material applied to that point. 
 	Ray::Intersection intersection = ray.getClosestIntersection();
 	IVirtualObject& collidedObject = scene.getNodeByID(intersection.collidingObjectID);
 	RayTracingFramework::Material& material = collidedObject.getMaterial();
 
 	//Calculate collision point and collision normal.
-	glm::vec4 normalInWorld = glm::normalize(intersection.fromObjectToWorldCoords * intersection.collisionNormalVector_InObjectCoords);
-	glm::vec4 collisionPointInWorld = intersection.fromObjectToWorldCoords * intersection.collisionPoint_InObjectCoords;
+	glm::vec4 normalInWorld = glm::normalize(toMatrix(intersection.fromObjectToWorldCoords) * intersection.collisionNormalVector_InObjectCoords);
+	glm::vec4 collisionPointInWorld = toMatrix(intersection.fromObjectToWorldCoords) * intersection.collisionPoint_InObjectCoords;
 	collisionPointInWorld /= collisionPointInWorld.w;
 
+	//Footprint of the pixel at this point (rays without differentials estimate it from the pixel spread angle).
+	RayDifferentials differentials = ray.differentials;
+	float footprintWidth = pixelSpreadAngle * intersection.t_distance;
+	if (differentials.valid) {
+		differentials.transfer(intersection.t_distance, glm::vec3(ray.direction_InWorldCoords), glm::vec3(normalInWorld));
+		footprintWidth = differentials.getWidth(0);
+	}
+
+	//Colours of the material at this point (textured).
+	Colour diffuseColour, specularColour;
+	getSurfaceColours(intersection, material, footprintWidth, diffuseColour, specularColour);
+
 	//Initially equate output colour with the ambient component of the shading model.
-	Colour ambientComponent = material.K_a * material.diffuseColour;
-	Colour outputColour = ambientComponent;
+	Colour ambientComponent = material.K_a * diffuseColour;
+	//If enabled, use the indirect light arriving at primary hits instead of a constant ambient light level (secondary hits keep the constant term).
+	if (irradianceCache && recursiveLevel == 0) {
+		glm::vec3 facingNormal = (glm::dot(normalInWorld, ray.direction_InWorldCoords) > 0) ? -glm::vec3(normalInWorld) : glm::vec3(normalInWorld);
+		ambientComponent *= irradianceCache->getIrradiance(glm::vec3(collisionPointInWorld), facingNormal, intersection.collidingObjectID, scene, *this);
+	}
+	outputColour = ambientComponent;
 
 	//Get our light source.
 	RayTracingFramework::ILight* lightSource = scene.getLights()[0];
@@ -25,66 +88,233 @@ RayTracingFramework::Colour RayTracingFramework::IShadingModel::computeShading(R
 	//Create ShadingInfo struct.
 	ShadingInfo shadingInfo = {
 		outputColour, scene, lightSource, material, collisionPointInWorld, normalInWorld, ray, 
-		intersection.collidingObjectID, recursiveLevel, 0.0f, 
+		intersection.collidingObjectID, recursiveLevel, 0.0f, diffuseColour, specularColour, differentials,
 	};
+	return shadingInfo;
+}
 
-	//Get intensity of shadow at collision point.
-	shadingInfo.shadowIntensity = getShadowIntensity(shadingInfo);
+void RayTracingFramework::IShadingModel::getSurfaceColours(Ray::Intersection& intersection, Material& material, Colour& diffuseColour, Colour& specularColour) {
+	getSurfaceColours(intersection, material, pixelSpreadAngle * intersection.t_distance, diffuseColour, specularColour);
+}
 
-	//Apply diffuse shading to output colour.
-	outputColour = computeDiffuse(shadingInfo);
+void RayTracingFramework::IShadingModel::getSurfaceColours(Ray::Intersection& intersection, Material& material, float footprintWidth, Colour& diffuseColour, Colour& specularColour) {
+	diffuseColour = material.diffuseColour;
+	specularColour = material.specularColour;
+	if (!material.diffuseTexture && !material.diffuseMap && !material.specularTexture && !material.specularMap)
+		return;
+	//Size of the area seen by the pixel, converted to UV units.
+	float footprint = footprintWidth * intersection.textureCoordinatesScale;
+	Texture* diffuseTexture = material.diffuseTexture ? material.diffuseTexture : (material.diffuseMap ? textureCache.getTexture(material.diffuseMap) : NULL);
+	if (diffuseTexture)
+		diffuseColour *= textureCache.sample(*diffuseTexture, intersection.textureCoordinates, footprint);
+	Texture* specularTexture = material.specularTexture ? material.specularTexture : (material.specularMap ? textureCache.getTexture(material.specularMap) : NULL);
+	if (specularTexture)
+		specularColour *= textureCache.sample(*specularTexture, intersection.textureCoordinates, footprint);
+}
 
-	//Apply transparency.
-	outputColour = getNextLayerColour(shadingInfo);
+RayTracingFramework::ShadingTerms RayTracingFramework::IShadingModel::computeShadingTerms(const ShadingInfo& shadingInfo) {
+	PROFILE_SCOPE("IShadingModel::computeShadingTerms");
+	ShadingTerms terms;
+	//Exiting a transparent object: the interface splits the energy between the refracted and the internally reflected ray.
+	if (isExitingObject(shadingInfo)) {
+		Interface surface = computeInterface(shadingInfo);
+		terms.localColour = Colour(0, 0, 0);
+		terms.transmissionWeight = 1.0f - surface.reflectance;
+		terms.fresnelReflectionWeight = surface.reflectance;
+		terms.reflectionWeight = 0;
+		return terms;
+	}
+	//Same result as computeShading, expanded: local = ((ambient + diffuse) * (1 - K_t)) * (1 - K_r) + specular
+	float diffuseIntensity = calculateDiffuseIntensity(shadingInfo);
+	Colour diffuseColour = shadingInfo.outputColour + diffuseIntensity * shadingInfo.diffuseColour * shadingInfo.lightSource->baseColour();
+	terms.localColour = diffuseColour * (1.0f - shadingInfo.material.K_t) * (1.0f - shadingInfo.material.K_r) + calculateSpecularComponent(shadingInfo);
+	float transparency = shadingInfo.material.K_t * (1.0f - shadingInfo.material.K_r);
+	float reflectance = (transparency > 0) ? computeInterface(shadingInfo).reflectance : 0.0f;
+	terms.transmissionWeight = transparency * (1.0f - reflectance);
+	terms.fresnelReflectionWeight = transparency * reflectance;
+	terms.reflectionWeight = shadingInfo.material.K_r * (diffuseIntensity + shadingInfo.material.K_a);
+	return terms;
+}
 
-	//Apply potential reflections.
-	outputColour = checkForReflection(shadingInfo);
+bool RayTracingFramework::IShadingModel::isExitingObject(const ShadingInfo& shadingInfo) {
+	return shadingInfo.ray.media.contains(shadingInfo.originalObjectId);
+}
 
-	//Apply specular shading.
-	outputColour = computeSpecular(shadingInfo);
+RayTracingFramework::IShadingModel::Interface RayTracingFramework::IShadingModel::computeInterface(const ShadingInfo& shadingInfo) {
+	Interface surface;
+	glm::vec3 direction = glm::normalize(glm::vec3(shadingInfo.ray.direction_InWorldCoords));
+	surface.normal = glm::normalize(glm::vec3(shadingInfo.collisionNormal));
+	if (glm::dot(direction, surface.normal) > 0)
+		surface.normal = -surface.normal;
+	//Entering or exiting is decided by the media the ray is in (not by the normal, which some primitives do not orient consistently).
+	surface.exiting = isExitingObject(shadingInfo);
+	float n1 = shadingInfo.ray.refractiveIndex, n2;
+	if (surface.exiting) {
+		Ray::MediumStack remaining = shadingInfo.ray.media;
+		remaining.remove(shadingInfo.originalObjectId);
+		n2 = remaining.currentIndex(1.0f);
+	}
+	else
+		n2 = shadingInfo.material.refractiveIndex;
+	surface.nextRefractiveIndex = n2;
 
-	return outputColour;
+	float cosIncident = -glm::dot(direction, surface.normal);
+	surface.reflectedDirection = direction + 2.0f * cosIncident * surface.normal;
+	surface.cosIncident = surface.cosTransmitted = cosIncident;
+	surface.eta = 1.0f;
+	if (n1 == n2) {
+		//Matched indices: no reflection and no bending.
+		surface.refractedDirection = direction;
+		surface.reflectance = 0;
+		return surface;
+	}
+	float eta = n1 / n2;
+	surface.eta = eta;
+	float sinTransmitted2 = eta * eta * (1.0f - cosIncident * cosIncident);
+	if (sinTransmitted2 >= 1.0f) {
+		//Total internal reflection.
+		surface.refractedDirection = surface.reflectedDirection;
+		surface.reflectance = 1;
+		surface.cosTransmitted = 0;
+		return surface;
+	}
+	float cosTransmitted = glm::sqrt(1.0f - sinTransmitted2);
+	surface.cosTransmitted = cosTransmitted;
+	surface.refractedDirection = glm::normalize(eta * direction + (eta * cosIncident - cosTransmitted) * surface.normal);
+	//Schlick's approximation (using the angle on the less dense side of the interface).
+	float r0 = (n1 - n2) / (n1 + n2);
+	r0 *= r0;
+	float c = 1.0f - ((n1 <= n2) ? cosIncident : cosTransmitted);
+	surface.reflectance = r0 + (1.0f - r0) * c * c * c * c * c;
+	return surface;
 }
 
-//For transparency.
-//Get next object behind one collided with and merge colours using materials.
-//(Or merge with background.)
-RayTracingFramework::Colour RayTracingFramework::IShadingModel::getNextLayerColour(ShadingInfo shadingInfo) {
-	//By default, set the colour of the next layer to the background colour.
-	Colour nextLayerColour = backgroundColour;
-	//Move origin of ray a little forward to prevent finding identical collision to the one that triggered this.
-	glm::vec4 origin = shadingInfo.collisionPoint + 0.1f * shadingInfo.ray.direction_InWorldCoords;
-	//Create a ray that is a continuing (identical) version of the ray that collided.
-	Ray continuingRay = Ray(origin, shadingInfo.ray.direction_InWorldCoords);
-	//Test for collisions with scene.
-	shadingInfo.scene.getRootNode().testCollision(continuingRay, glm::mat4(1.0f));
-	
-	//Remove any intersections found with the same object that triggered this check.
-	while (continuingRay.getClosestIntersection().collidingObjectID == shadingInfo.originalObjectId) continuingRay.discardClosestIntersection();
-	
-	//Remove any intersections behind ray origin.
-	while (continuingRay.getClosestIntersection().t_distance < 0) continuingRay.discardClosestIntersection();
+RayTracingFramework::Ray RayTracingFramework::IShadingModel::createTransmissionRay(const ShadingInfo& shadingInfo) {
+	Interface surface = computeInterface(shadingInfo);
+	return createTransmissionRay(shadingInfo, surface);
+}
 
-	//Check if any other collisions occured.
-	if (continuingRay.getClosestIntersection().t_distance != FLT_MAX)
-		//Set colour of next layer to whatever the computed value of the next closest collision is.
-		nextLayerColour = computeShading(continuingRay, shadingInfo.scene, shadingInfo.recursiveLevel + 1);
-	//Return current layer and next layer merged based on material.
-	return shadingInfo.outputColour * (1.0f - shadingInfo.material.K_t) + nextLayerColour * shadingInfo.material.K_t;
+RayTracingFramework::Ray RayTracingFramework::IShadingModel::createTransmissionRay(const ShadingInfo& shadingInfo, Interface& surface) {
+	if (surface.reflectance >= 1.0f)
+		return createFresnelReflectionRay(shadingInfo, surface);
+	//Start on the far side of the surface, so that we do not find the collision that triggered this ray again.
+	glm::vec3 origin = glm::vec3(shadingInfo.collisionPoint) - surfaceOffset * surface.normal;
+	Ray transmissionRay(glm::vec4(origin, 1.0f), glm::vec4(surface.refractedDirection, 0.0f), surface.nextRefractiveIndex, shadingInfo.ray.time);
+	transmissionRay.media = shadingInfo.ray.media;
+	if (surface.exiting)
+		transmissionRay.media.remove(shadingInfo.originalObjectId);
+	else
+		transmissionRay.media.push(shadingInfo.originalObjectId, surface.nextRefractiveIndex);
+	transmissionRay.importance = shadingInfo.ray.importance;
+	if (shadingInfo.differentials.valid) {
+		transmissionRay.differentials = shadingInfo.differentials;
+		transmissionRay.differentials.refract(surface.normal, surface.eta, surface.cosIncident, surface.cosTransmitted);
+		transmissionRay.differentials.normalizeDirection(surface.refractedDirection);
+	}
+	return transmissionRay;
 }
 
-float RayTracingFramework::IShadingModel::getShadowIntensity(ShadingInfo shadingInfo) {
-	//By default, shadow intensity is zero.
-	float shadowIntensity = 0.0f;
-	//Fire shadow ray back towards light source.
-	glm::vec4 shadowRayDirection = -shadingInfo.lightSource->lightDirectionAtPoint(shadingInfo.collisionPoint);
+RayTracingFramework::Ray RayTracingFramework::IShadingModel::createFresnelReflectionRay(const ShadingInfo& shadingInfo) {
+	Interface surface = computeInterface(shadingInfo);
+	return createFresnelReflectionRay(shadingInfo, surface);
+}
+
+RayTracingFramework::Ray RayTracingFramework::IShadingModel::createFresnelReflectionRay(const ShadingInfo& shadingInfo, Interface& surface) {
+	//Reflected rays stay in the medium of the incoming ray.
+	glm::vec3 origin = glm::vec3(shadingInfo.collisionPoint) + surfaceOffset * surface.normal;
+	Ray reflectionRay(glm::vec4(origin, 1.0f), glm::vec4(surface.reflectedDirection, 0.0f), shadingInfo.ray.refractiveIndex, shadingInfo.ray.time);
+	reflectionRay.media = shadingInfo.ray.media;
+	reflectionRay.importance = shadingInfo.ray.importance;
+	if (shadingInfo.differentials.valid) {
+		reflectionRay.differentials = shadingInfo.differentials;
+		reflectionRay.differentials.reflect(surface.normal);
+	}
+	return reflectionRay;
+}
+
+RayTracingFramework::Ray RayTracingFramework::IShadingModel::createShadowRay(const ShadingInfo& shadingInfo) {
+	//Fire shadow ray back towards (a point of) the light source.
+	glm::vec4 shadowRayDirection = -shadingInfo.lightSource->sampleLightDirectionAtPoint(shadingInfo.collisionPoint, Sampler::getThreadSampler());
 	//Origin of shadow ray is at collision point.
 	//(+0.1f to avoid self collision due to rounding errors.)
 	glm::vec4 shadowRayOrigin = shadingInfo.collisionPoint + 0.1f * shadowRayDirection;
+	Ray shadowRay(shadowRayOrigin, shadowRayDirection, 1, shadingInfo.ray.time);
+	//The shadow ray covers the footprint of the point it starts from (so occluders are intersected at a matching level of detail).
+	if (shadingInfo.differentials.valid) {
+		shadowRay.differentials = shadingInfo.differentials;
+		shadowRay.differentials.dDirectionX = shadowRay.differentials.dDirectionY = glm::vec3(0, 0, 0);
+	}
+	return shadowRay;
+}
+
+RayTracingFramework::Ray RayTracingFramework::IShadingModel::createReflectionRay(const ShadingInfo& shadingInfo) {
+	glm::vec3 lightDirection = -shadingInfo.ray.direction_InWorldCoords;
+	glm::vec3 normal = shadingInfo.collisionNormal;
+	glm::vec3 reflectionDirection = glm::normalize(normal + (normal - lightDirection));
+	glm::vec3 reflectionOrigin = glm::vec3(shadingInfo.collisionPoint) + 0.1f * reflectionDirection;
+	Ray reflectionRay(glm::vec4(reflectionOrigin, 1.0f), glm::vec4(reflectionDirection, 0.0f), 1, shadingInfo.ray.time);
+	if (shadingInfo.differentials.valid) {
+		//The direction is normalize(2 * normal - lightDirection), so it changes as the incoming direction does (normal assumed constant).
+		reflectionRay.differentials = shadingInfo.differentials;
+		reflectionRay.differentials.normalizeDirection(normal + (normal - lightDirection));
+	}
+	return reflectionRay;
+}
+
+//Traces a secondary ray and shades whatever it finds (or returns the background).
+//weight is the contribution of its colour to the colour being computed. Rays that cannot change the pixel are not traced (they return black).
+RayTracingFramework::Colour RayTracingFramework::IShadingModel::traceSecondaryRay(const ShadingInfo& shadingInfo, Ray& secondaryRay, float weight) {
+	PROFILE_SCOPE("IShadingModel::traceSecondaryRay");
+	secondaryRay.importance = shadingInfo.ray.importance * weight;
+	if (secondaryRay.importance < minimumRayWeight)
+		return Colour(0, 0, 0);
+	shadingInfo.scene.intersect(secondaryRay);
+	if (secondaryRay.getClosestIntersection().t_distance == FLT_MAX)
+		return backgroundColour;
+	return computeShading(secondaryRay, shadingInfo.scene, shadingInfo.recursiveLevel + 1);
+}
+
+//Colour seen through a transparent surface: refracted and reflected rays, weighted by the Fresnel reflectance of the interface.
+//weight is the contribution of this interface to the colour of the current ray (used to skip branches that do not matter).
+RayTracingFramework::Colour RayTracingFramework::IShadingModel::traceInterface(const ShadingInfo& shadingInfo, float weight) {
+	Interface surface = computeInterface(shadingInfo);
+	Colour result(0, 0, 0);
+	if (surface.reflectance < 1.0f) {
+		Ray transmissionRay = createTransmissionRay(shadingInfo, surface);
+		result += (1.0f - surface.reflectance) * traceSecondaryRay(shadingInfo, transmissionRay, weight * (1.0f - surface.reflectance));
+	}
+	if (surface.reflectance > 0.0f) {
+		Ray reflectionRay = createFresnelReflectionRay(shadingInfo, surface);
+		result += surface.reflectance * traceSecondaryRay(shadingInfo, reflectionRay, weight * surface.reflectance);
+	}
+	return result;
+}
+
+//For transparency.
+//Get the colour seen through the object (refracted, plus what the interface reflects) and merge colours using materials.
+//(Or merge with background.)
+RayTracingFramework::Colour RayTracingFramework::IShadingModel::getNextLayerColour(const ShadingInfo& shadingInfo) {
+	PROFILE_SCOPE("IShadingModel::getNextLayerColour");
+	if (shadingInfo.material.K_t <= 0)
+		return shadingInfo.outputColour;
+	//The layer behind ends up weighted by K_t * (1 - K_r) once reflections are blended in (see checkForReflection).
+	Colour nextLayerColour = traceInterface(shadingInfo, shadingInfo.material.K_t * (1.0f - shadingInfo.material.K_r));
+	//Return current layer and next layer merged based on material.
+	return shadingInfo.outputColour * (1.0f - shadingInfo.material.K_t) + nextLayerColour * shadingInfo.material.K_t;
+}
+
+float RayTracingFramework::IShadingModel::getShadowIntensity(const ShadingInfo& shadingInfo) {
+	PROFILE_SCOPE("IShadingModel::getShadowIntensity");
 	//Create ray.
-	Ray shadowRay = Ray(shadowRayOrigin, shadowRayDirection);
+	Ray shadowRay = createShadowRay(shadingInfo);
 	//Test shadow ray for collisions with scene.
-	shadingInfo.scene.getRootNode().testCollision(shadowRay, glm::mat4(1.0f));
+	shadingInfo.scene.intersect(shadowRay);
+	return accumulateShadowIntensity(shadingInfo, shadowRay);
+}
+
+float RayTracingFramework::IShadingModel::accumulateShadowIntensity(const ShadingInfo& shadingInfo, Ray& shadowRay) {
+	//By default, shadow intensity is zero.
+	float shadowIntensity = 0.0f;
 	//Get rid of self shadows.
 	while (shadowRay.getClosestIntersection().collidingObjectID == shadingInfo.originalObjectId)
 		shadowRay.discardClosestIntersection();
@@ -102,32 +332,23 @@ float RayTracingFramework::IShadingModel::getShadowIntensity(ShadingInfo shading
 	return (shadowIntensity > 1.0f) ? 1.0f : shadowIntensity;
 }
 
-RayTracingFramework::Colour RayTracingFramework::IShadingModel::checkForReflection(ShadingInfo shadingInfo) {
-	//Create reflection ray.
-	glm::vec3 lightDirection = -shadingInfo.ray.direction_InWorldCoords;
-	glm::vec3 normal = shadingInfo.collisionNormal;
-	glm::vec3 reflectionDirection = glm::normalize(normal + (normal - lightDirection));
-	glm::vec3 reflectionOrigin = glm::vec3(shadingInfo.collisionPoint) + 0.1f * reflectionDirection;
-	Ray reflectionRay = Ray(glm::vec4(reflectionOrigin, 1.0f), glm::vec4(reflectionDirection, 0.0f));
-	//Test reflection ray for collisions with scene.
-	shadingInfo.scene.getRootNode().testCollision(reflectionRay, glm::mat4(1.0f));
-	//Initialise reflection colour as ambient background colour (White).
-	float offWhite = 200.0f / 256.0f;
-	Colour reflectionColour = backgroundColour;
-	//Remove any intersections behind ray origin.
-	while (reflectionRay.getClosestIntersection().t_distance < 0) reflectionRay.discardClosestIntersection();
-	//Check if collision was found.
-	if (reflectionRay.getClosestIntersection().t_distance != FLT_MAX) {
-		//Compute shading for next surface found.
-		reflectionColour = computeShading(reflectionRay, shadingInfo.scene, shadingInfo.recursiveLevel + 1);
-	}
-	//Apply diffuse intensity gradient to reflection.
-	Colour newColour = reflectionColour * shadingInfo.material.K_r * (calculateDiffuseIntensity(shadingInfo) + shadingInfo.material.K_a);
+RayTracingFramework::Colour RayTracingFramework::IShadingModel::checkForReflection(const ShadingInfo& shadingInfo) {
+	PROFILE_SCOPE("IShadingModel::checkForReflection");
+	//Weight of the reflection (diffuse intensity gradient applied to it).
+	float reflectionWeight = shadingInfo.material.K_r * (calculateDiffuseIntensity(shadingInfo) + shadingInfo.material.K_a);
+	if (reflectionWeight <= 0)
+		return shadingInfo.outputColour * (1.0f - shadingInfo.material.K_r);
+	//Create reflection ray, and shade the surface it finds (background colour if none).
+	Ray reflectionRay = createReflectionRay(shadingInfo);
+	reflectionRay.media = shadingInfo.ray.media;
+	reflectionRay.refractiveIndex = shadingInfo.ray.refractiveIndex;
+	Colour reflectionColour = traceSecondaryRay(shadingInfo, reflectionRay, reflectionWeight);
+	Colour newColour = reflectionColour * reflectionWeight;
 	//Blend with output colour.
 	return shadingInfo.outputColour * (1.0f - shadingInfo.material.K_r) + newColour;
 }
 
-float RayTracingFramework::IShadingModel::calculateDiffuseIntensity(ShadingInfo shadingInfo) {
+float RayTracingFramework::IShadingModel::calculateDiffuseIntensity(const ShadingInfo& shadingInfo) {
 	glm::vec4 intersectionPointToLight_Direction = -1.0f * (shadingInfo.lightSource->lightDirectionAtPoint(shadingInfo.collisionPoint));
 	float cos_angle = glm::dot(shadingInfo.collisionNormal, intersectionPointToLight_Direction);
 	cos_angle = (cos_angle > 1 ? 1 : (cos_angle < 0 ? 0 : cos_angle));
@@ -135,19 +356,25 @@ float RayTracingFramework::IShadingModel::calculateDiffuseIntensity(ShadingInfo
 	return cos_angle * shadingInfo.material.K_d * (1.0f - shadingInfo.shadowIntensity);
 }
 
-RayTracingFramework::Colour RayTracingFramework::IShadingModel::computeDiffuse(ShadingInfo shadingInfo) {
+RayTracingFramework::Colour RayTracingFramework::IShadingModel::computeDiffuse(const ShadingInfo& shadingInfo, float diffuseIntensity) {
+	PROFILE_SCOPE("IShadingModel::computeDiffuse");
 	//K_d: DIFFUSE COMPONENT
 	RayTracingFramework::Colour diffuseComponent(0, 0, 0);
-	diffuseComponent = calculateDiffuseIntensity(shadingInfo) * shadingInfo.material.diffuseColour * shadingInfo.lightSource->baseColour();
+	diffuseComponent = diffuseIntensity * shadingInfo.diffuseColour * shadingInfo.lightSource->baseColour();
 	return shadingInfo.outputColour + diffuseComponent;
 }
 
-RayTracingFramework::Colour RayTracingFramework::IShadingModel::computeSpecular(ShadingInfo shadingInfo) {
+RayTracingFramework::Colour RayTracingFramework::IShadingModel::computeSpecular(const ShadingInfo& shadingInfo) {
+	PROFILE_SCOPE("IShadingModel::computeSpecular");
+	return shadingInfo.outputColour + calculateSpecularComponent(shadingInfo);
+}
+
+RayTracingFramework::Colour RayTracingFramework::IShadingModel::calculateSpecularComponent(const ShadingInfo& shadingInfo) {
 	RayTracingFramework::Colour specularComponent(0, 0, 0);
 
 	glm::vec4 reflect = glm::reflect(-shadingInfo.lightSource->lightDirectionAtPoint(shadingInfo.collisionPoint), shadingInfo.collisionNormal);
 	float spec_angle = glm::max(glm::dot(reflect, shadingInfo.ray.direction_InWorldCoords), 0.0f);
 
-	specularComponent = glm::pow(spec_angle, shadingInfo.material.shininess / 4.0f) * shadingInfo.material.K_s * shadingInfo.material.specularColour * shadingInfo.lightSource->baseColour();
-	return shadingInfo.outputColour + specularComponent;
+	specularComponent = glm::pow(spec_angle, shadingInfo.material.shininess / 4.0f) * shadingInfo.material.K_s * shadingInfo.specularColour * shadingInfo.lightSource->baseColour();
+	return specularComponent;
 }
\ No newline at end of file
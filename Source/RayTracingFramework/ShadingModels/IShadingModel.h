@@ -6,6 +6,8 @@
 #include "RayTracingFramework\Material.h"
 #include "RayTracingFramework\GeometricPrimitives\IGeometry.h"
 #include "RayTracingFramework\VirtualObject\ISceneManager.h"
+#include "IrradianceCache.h"
+#include "RayTracingFramework\Textures\TextureCache.h"
 
 /*
  * Currently, shading model only accounts for 1 light.
@@ -25,12 +27,24 @@ namespace RayTracingFramework{
 		unsigned int originalObjectId;
 		int recursiveLevel;
 		float shadowIntensity;	//0.0f -> 1.0f
+		Colour diffuseColour, specularColour;	//Colours of the material at the collision point (textures applied).
+		RayDifferentials differentials;			//Differentials of the ray moved to the collision point (footprint of the pixel on the surface). Invalid if the ray had none.
+	};
+
+	//Shading of an intersection, split into the part we can compute locally and the weights of the colours returned by its secondary rays.
+	//output = localColour + transmissionWeight * (refracted colour) + fresnelReflectionWeight * (colour reflected by the interface) + reflectionWeight * (reflected colour)
+	struct ShadingTerms {
+		Colour localColour;
+		float transmissionWeight;
+		float fresnelReflectionWeight;
+		float reflectionWeight;
 	};
 
 	class IShadingModel
 	{
 	protected:
 	public:
+		IShadingModel() : irradianceCache(NULL), pixelSpreadAngle(0) { ; }
 		virtual ~IShadingModel() { ; }
 		/**
 		Given an Intersection (the closest to the camera, in ray), this method will compute a particular shading, depending on the object's properties.
@@ -45,7 +59,91 @@ namespace RayTracingFramework{
 
 		*/
 		virtual RayTracingFramework::Colour computeShading(Ray& ray, RayTracingFramework::IScene& scene, int recursiveLevel = 0);
+
+		/**
+			Enables indirect diffuse lighting (global illumination) using an irradiance cache. The cached indirect light replaces the constant ambient light level for primary hits.
+			Passing NULL (default) goes back to the constant ambient term. The shading model does not take ownership of the cache.
+		*/
+		inline void setIrradianceCache(IrradianceCache* cache) {
+			irradianceCache = cache;
+		}
+		inline IrradianceCache* getIrradianceCache() {
+			return irradianceCache;
+		}
+
+		/**
+			Cache used to sample the textures of the materials (diffuseMap/specularMap, diffuseTexture/specularTexture). Its memory budget can be changed here.
+		*/
+		inline TextureCache& getTextureCache() {
+			return textureCache;
+		}
+
+		/**
+			Angle covered by a pixel (see Camera::getPixelSpreadAngle). It sets the size of the area filtered by texture lookups for rays without differentials
+			(0 -> always use the full resolution). Rays with differentials use the footprint of their pixel on the surface instead.
+		*/
+		inline void setPixelSpreadAngle(float angle) {
+			pixelSpreadAngle = angle;
+		}
+
+		/**
+			Colours of a material at an intersection, modulated by its textures (if any), filtered over an area of footprintWidth (world units).
+			The first version estimates the footprint from the pixel spread angle and the distance of the intersection.
+		*/
+		void getSurfaceColours(Ray::Intersection& intersection, Material& material, Colour& diffuseColour, Colour& specularColour);
+		void getSurfaceColours(Ray::Intersection& intersection, Material& material, float footprintWidth, Colour& diffuseColour, Colour& specularColour);
+
+		inline Colour getBackgroundColour() {
+			return backgroundColour;
+		}
+
+		inline int getRecursionLimit() {
+			return recursionLimit;
+		}
+
+		//Secondary rays whose contribution to the pixel (ray.importance * weight) is below this value are not traced.
+		inline float getMinimumRayWeight() {
+			return minimumRayWeight;
+		}
+
+		/**
+			STAGED SHADING: The same shading computed by computeShading, split into stages. This allows a renderer to trace the secondary rays itself (e.g. in batches, see WavefrontRenderer) instead of recursively.
+			1. createShadingInfo: Describes the closest intersection of ray (outputColour receives the ambient component). The differentials of the ray are moved to the
+			   intersection, and the secondary rays created below carry them on (reflected/refracted as their rays).
+			2. createShadowRay + accumulateShadowIntensity: Shadow ray to trace, and the intensity of the shadow once it has been traced (store it in shadingInfo.shadowIntensity).
+			3. computeShadingTerms: Local shading and weights of the secondary rays (created with createTransmissionRay/createFresnelReflectionRay/createReflectionRay).
+			Hits where the ray leaves a transparent object (isExitingObject) are pure interfaces: they have no local shading and do not need a shadow ray.
+		*/
+		ShadingInfo createShadingInfo(Ray& ray, IScene& scene, int recursiveLevel, Colour& outputColour);
+		Ray createShadowRay(const ShadingInfo& shadingInfo);		//Lights with an extent are sampled with the sampler of the thread (Sampler::getThreadSampler).
+		float accumulateShadowIntensity(const ShadingInfo& shadingInfo, Ray& tracedShadowRay);
+		ShadingTerms computeShadingTerms(const ShadingInfo& shadingInfo);
+		Ray createTransmissionRay(const ShadingInfo& shadingInfo);			//Refracted ray (Snell's law). Its medium stack says which objects it travels inside of.
+		Ray createFresnelReflectionRay(const ShadingInfo& shadingInfo);	//Ray reflected by the interface (Fresnel reflection, or total internal reflection).
+		Ray createReflectionRay(const ShadingInfo& shadingInfo);
+		bool isExitingObject(const ShadingInfo& shadingInfo);
+
+		/**
+			SPLIT SHADING: computeShading of an intersection (from createShadingInfo, not exiting an object) in two parts, so that a renderer can keep the first one
+			while the camera moves (see TemporalReuseRenderer).
+			1. computeViewIndependentLighting: Traces the shadow ray (storing its intensity in shadingInfo.shadowIntensity) and returns the diffuse intensity (Lambert
+			   term with the shadow applied). Neither depends on the colours of the material, so they can be kept while textures are sampled again.
+			2. computeViewDependentColour: Applies diffuseIntensity (from step 1, or cached for the same point with its shadow intensity) to the material colour of
+			   this hit and adds its ambient component, then blends transparency, reflections and the specular highlight, tracing their rays.
+			   Returns the colour of the intersection.
+		*/
+		float computeViewIndependentLighting(ShadingInfo& shadingInfo);
+		Colour computeViewDependentColour(ShadingInfo& shadingInfo, float diffuseIntensity);
 	private:
+		//Interface between the medium the ray travels through and the one it would refract into.
+		struct Interface {
+			glm::vec3 normal;						//Normal facing the incoming ray.
+			glm::vec3 refractedDirection, reflectedDirection;
+			float reflectance;						//Fraction of the energy reflected (Schlick's approximation, 1 for total internal reflection).
+			float nextRefractiveIndex;				//Refractive index on the other side.
+			float eta, cosIncident, cosTransmitted;	//Ratio of refractive indices and cosines of the angles with the normal (needed to refract ray differentials).
+			bool exiting;
+		};
 
 		//Number of times the compute shading function can be recursively called before exiting.
 		const int recursionLimit = 3;
@@ -54,15 +152,34 @@ namespace RayTracingFramework{
 		const float lightLevel = 15.0f / 256.0f;
 		const Colour backgroundColour = Colour(lightLevel, lightLevel, lightLevel);
 
+		//Rays contributing less than this to the pixel cannot change an 8 bit colour.
+		const float minimumRayWeight = 1.0f / 512.0f;
+
+		//Offset of the origin of refracted/reflected rays along the normal (to avoid finding the collision that triggered them).
+		const float surfaceOffset = 0.1f;
+
+		//Optional cache of indirect lighting (NULL -> constant ambient).
+		IrradianceCache* irradianceCache;
+
+		//Texture tiles (loaded on demand) and the size of the area each lookup filters.
+		TextureCache textureCache;
+		float pixelSpreadAngle;
+
 		//Phong shading
-		float calculateDiffuseIntensity(ShadingInfo shadingInfo);
-		Colour computeDiffuse(ShadingInfo shadingInfo);
-		Colour computeSpecular(ShadingInfo shadingInfo);
+		float calculateDiffuseIntensity(const ShadingInfo& shadingInfo);
+		Colour computeDiffuse(const ShadingInfo& shadingInfo, float diffuseIntensity);
+		Colour computeSpecular(const ShadingInfo& shadingInfo);
+		Colour calculateSpecularComponent(const ShadingInfo& shadingInfo);
 
 		//Global illumination.
-		Colour getNextLayerColour(ShadingInfo shadingInfo);
-		float getShadowIntensity(ShadingInfo shadingInfo);
-		Colour checkForReflection(ShadingInfo shadingInfo);
+		Interface computeInterface(const ShadingInfo& shadingInfo);
+		Ray createTransmissionRay(const ShadingInfo& shadingInfo, Interface& surface);
+		Ray createFresnelReflectionRay(const ShadingInfo& shadingInfo, Interface& surface);
+		Colour traceSecondaryRay(const ShadingInfo& shadingInfo, Ray& secondaryRay, float weight);
+		Colour traceInterface(const ShadingInfo& shadingInfo, float weight);
+		Colour getNextLayerColour(const ShadingInfo& shadingInfo);
+		float getShadowIntensity(const ShadingInfo& shadingInfo);
+		Colour checkForReflection(const ShadingInfo& shadingInfo);
 	};
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,229 @@
+#include "IrradianceCache.h"
+#include "IShadingModel.h"
+#include "RayTracingFramework\Ray.h"
+#include "RayTracingFramework\VirtualObject\ISceneManager.h"
+#include "RayTracingFramework\Sampling\Sampler.h"
+#include <cstring>
+
+RayTracingFramework::IrradianceCache::OctreeNode::OctreeNode(glm::vec3 centre, float halfSize)
+	: centre(centre)
+	, halfSize(halfSize)
+{
+	for (int i = 0; i < 8; i++)
+		children[i] = NULL;
+}
+
+RayTracingFramework::IrradianceCache::OctreeNode::~OctreeNode() {
+	for (int i = 0; i < 8; i++)
+		if (children[i]) delete children[i];
+}
+
+RayTracingFramework::IrradianceCache::IrradianceCache(float errorTolerance, int thetaSamples, int phiSamples, float minRadius, float maxRadius)
+	: errorTolerance(errorTolerance)
+	, thetaSamples(thetaSamples)
+	, phiSamples(phiSamples)
+	, minRadius(minRadius)
+	, maxRadius(maxRadius)
+	, root(new OctreeNode(glm::vec3(0, 0, 0), 1024.0f))
+{
+	;
+}
+
+RayTracingFramework::IrradianceCache::~IrradianceCache() {
+	delete root;
+}
+
+void RayTracingFramework::IrradianceCache::clear() {
+	std::unique_lock<std::shared_timed_mutex> lock(mutex);
+	records.clear();
+	delete root;
+	root = new OctreeNode(glm::vec3(0, 0, 0), 1024.0f);
+}
+
+RayTracingFramework::Colour RayTracingFramework::IrradianceCache::getIrradiance(glm::vec3 position, glm::vec3 normal, unsigned int objectID, IScene& scene, IShadingModel& shadingModel) {
+	//1. Try to reuse the records around this point.
+	Colour result;
+	{
+		std::shared_lock<std::shared_timed_mutex> lock(mutex);
+		if (interpolate(position, normal, result))
+			return result;
+	}
+	//2. None of them is valid here -> Sample the hemisphere (without holding the lock, other threads keep using the cache) and store a new record.
+	//Two threads may add records for the same area: both are valid, and records only depend on their position (see computeRecord).
+	Record record = computeRecord(position, normal, objectID, scene, shadingModel);
+	std::unique_lock<std::shared_timed_mutex> lock(mutex);
+	records.push_back(record);
+	insert((unsigned int)records.size() - 1);
+	return record.irradiance;
+}
+
+size_t RayTracingFramework::IrradianceCache::getNumRecords() {
+	std::shared_lock<std::shared_timed_mutex> lock(mutex);
+	return records.size();
+}
+
+bool RayTracingFramework::IrradianceCache::interpolate(glm::vec3 position, glm::vec3 normal, Colour& result) {
+	Colour weightedSum(0, 0, 0);
+	float totalWeight = 0;
+	lookup(root, position, normal, weightedSum, totalWeight);
+	if (totalWeight <= 0)
+		return false;
+	result = glm::max(weightedSum / totalWeight, Colour(0, 0, 0));
+	return true;
+}
+
+void RayTracingFramework::IrradianceCache::lookup(OctreeNode* node, glm::vec3 position, glm::vec3 normal, Colour& weightedSum, float& totalWeight) {
+	//Records stored in a node have an area of influence smaller than the node, so we only need to visit nodes whose (expanded) volume contains the point.
+	glm::vec3 d = glm::abs(position - node->centre);
+	float extent = 2.0f * node->halfSize;
+	if (d.x > extent || d.y > extent || d.z > extent)
+		return;
+	for (size_t i = 0; i < node->recordIndices.size(); i++) {
+		Record& r = records[node->recordIndices[i]];
+		glm::vec3 offset = position - r.position;
+		//Discard records "in front" of the point (they see a different part of the scene).
+		if (glm::dot(offset, (normal + r.normal) * 0.5f) < -0.05f * r.radius)
+			continue;
+		//Ward's weight: penalises distance (relative to the harmonic mean distance) and change of orientation.
+		float normalTerm = 1.0f - glm::dot(normal, r.normal);
+		float error = glm::length(offset) / r.radius + glm::sqrt(normalTerm > 0 ? normalTerm : 0);
+		if (error * errorTolerance >= 1.0f)
+			continue;
+		float weight = (error > 1e-6f) ? 1.0f / error : 1e6f;
+		//Extrapolate the record to our point using its gradients.
+		glm::vec3 rotation = glm::cross(r.normal, normal);
+		Colour value = r.irradiance;
+		for (int c = 0; c < 3; c++)
+			value[c] += glm::dot(rotation, r.rotationalGradient[c]) + glm::dot(offset, r.translationalGradient[c]);
+		weightedSum += weight * value;
+		totalWeight += weight;
+	}
+	for (int i = 0; i < 8; i++)
+		if (node->children[i])
+			lookup(node->children[i], position, normal, weightedSum, totalWeight);
+}
+
+void RayTracingFramework::IrradianceCache::insert(unsigned int recordIndex) {
+	Record& r = records[recordIndex];
+	float validRadius = r.radius / errorTolerance;
+	//Grow the root until it contains the record.
+	while (glm::abs(r.position.x - root->centre.x) > root->halfSize
+		|| glm::abs(r.position.y - root->centre.y) > root->halfSize
+		|| glm::abs(r.position.z - root->centre.z) > root->halfSize) {
+		OctreeNode* oldRoot = root;
+		glm::vec3 direction(r.position.x < oldRoot->centre.x ? -1 : 1, r.position.y < oldRoot->centre.y ? -1 : 1, r.position.z < oldRoot->centre.z ? -1 : 1);
+		root = new OctreeNode(oldRoot->centre + direction * oldRoot->halfSize, 2.0f * oldRoot->halfSize);
+		//The old root becomes the octant opposite to the growth direction.
+		int octant = (direction.x < 0 ? 1 : 0) | (direction.y < 0 ? 2 : 0) | (direction.z < 0 ? 4 : 0);
+		root->children[octant] = oldRoot;
+	}
+	//Descend while the child is still large enough to hold the area of influence of the record.
+	OctreeNode* node = root;
+	while (node->halfSize * 0.5f >= validRadius) {
+		int octant = (r.position.x > node->centre.x ? 1 : 0) | (r.position.y > node->centre.y ? 2 : 0) | (r.position.z > node->centre.z ? 4 : 0);
+		if (!node->children[octant]) {
+			float h = node->halfSize * 0.5f;
+			glm::vec3 childCentre = node->centre + glm::vec3((octant & 1) ? h : -h, (octant & 2) ? h : -h, (octant & 4) ? h : -h);
+			node->children[octant] = new OctreeNode(childCentre, h);
+		}
+		node = node->children[octant];
+	}
+	node->recordIndices.push_back(recordIndex);
+}
+
+RayTracingFramework::IrradianceCache::Record RayTracingFramework::IrradianceCache::computeRecord(glm::vec3 position, glm::vec3 normal, unsigned int objectID, IScene& scene, IShadingModel& shadingModel) {
+	const float PI = 3.14159265f;
+	int M = thetaSamples, N = phiSamples;
+	//Build an orthonormal basis (u, v, normal) around the normal.
+	glm::vec3 helper = (glm::abs(normal.x) > 0.9f) ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0);
+	glm::vec3 u = glm::normalize(glm::cross(helper, normal));
+	glm::vec3 v = glm::cross(normal, u);
+
+	//The jitter of the strata only depends on the record (its position and object), so a record is the same whichever thread computes it, and whenever.
+	uint32_t key[4] = { 0, 0, 0, objectID };
+	memcpy(key, &position, sizeof(float) * 3);
+	Sampler::hash4(key);
+	Sampler sampler(Sampler::SEQUENCE_RANDOM);
+	sampler.startSample(key[0], key[1], key[2]);
+	//The shading of the samples (e.g. soft shadows) draws from it too, and then we give the renderer its sampler back.
+	Sampler* previousSampler = &Sampler::getThreadSampler();
+	Sampler::setThreadSampler(&sampler);
+
+	//Radiance and hit distance of each stratum (j: elevation, k: azimuth).
+	std::vector<Colour> L(M * N);
+	std::vector<float> distance(M * N);
+	Colour sum(0, 0, 0);
+	float inverseDistanceSum = 0;
+	for (int j = 0; j < M; j++) {
+		for (int k = 0; k < N; k++) {
+			//Cosine weighted stratified sample (jittered inside its stratum).
+			glm::vec2 jitter = sampler.next2D();
+			float sinTheta = glm::sqrt((j + jitter.x) / M);
+			float cosTheta = glm::sqrt(1.0f - sinTheta * sinTheta);
+			float phi = 2.0f * PI * (k + jitter.y) / N;
+			glm::vec3 direction = glm::normalize(sinTheta * glm::cos(phi) * u + sinTheta * glm::sin(phi) * v + cosTheta * normal);
+			//Trace it (origin moved a little forward to avoid self collisions, as in the rest of the framework).
+			Ray sampleRay(glm::vec4(position + 0.1f * direction, 1.0f), glm::vec4(direction, 0.0f));
+			scene.intersect(sampleRay);
+			while (sampleRay.getClosestIntersection().t_distance != FLT_MAX && sampleRay.getClosestIntersection().collidingObjectID == objectID)
+				sampleRay.discardClosestIntersection();
+			Colour radiance = shadingModel.getBackgroundColour();
+			float r = FLT_MAX;
+			if (sampleRay.getClosestIntersection().t_distance != FLT_MAX) {
+				r = sampleRay.getClosestIntersection().t_distance;
+				radiance = shadingModel.computeShading(sampleRay, scene, 1);
+			}
+			L[j * N + k] = radiance;
+			distance[j * N + k] = r;
+			sum += radiance;
+			inverseDistanceSum += (r < FLT_MAX) ? 1.0f / r : 0.0f;
+		}
+	}
+	Sampler::setThreadSampler(previousSampler);
+
+	Record record;
+	record.position = position;
+	record.normal = normal;
+	record.irradiance = sum / (float)(M * N);
+	record.radius = (inverseDistanceSum > 0) ? (M * N) / inverseDistanceSum : maxRadius;
+	record.radius = glm::clamp(record.radius, minRadius, maxRadius);
+
+	//Gradients (Ward & Heckbert 1992), divided by PI to match the way we store irradiance.
+	glm::vec3 rotational[3] = { glm::vec3(0), glm::vec3(0), glm::vec3(0) };
+	glm::vec3 translational[3] = { glm::vec3(0), glm::vec3(0), glm::vec3(0) };
+	for (int k = 0; k < N; k++) {
+		float phiCentre = 2.0f * PI * (k + 0.5f) / N;
+		float phiMinus = 2.0f * PI * k / N;
+		glm::vec3 u_k = glm::cos(phiCentre) * u + glm::sin(phiCentre) * v;
+		glm::vec3 v_k = -glm::sin(phiCentre) * u + glm::cos(phiCentre) * v;
+		glm::vec3 v_kMinus = -glm::sin(phiMinus) * u + glm::cos(phiMinus) * v;
+		int kPrev = (k + N - 1) % N;
+		for (int j = 0; j < M; j++) {
+			float sinThetaCentre = glm::sqrt((j + 0.5f) / M);
+			float tanThetaCentre = sinThetaCentre / glm::sqrt(1.0f - sinThetaCentre * sinThetaCentre);
+			float sinThetaMinus = glm::sqrt((float)j / M);
+			float cosThetaMinus = glm::sqrt(1.0f - (float)j / M);
+			float cosThetaPlus = glm::sqrt(1.0f - (float)(j + 1) / M);
+			Colour Ljk = L[j * N + k];
+			//Rotational gradient.
+			Colour rot = -tanThetaCentre * Ljk / (float)(M * N);
+			//Translational gradient: change between neighbouring strata in elevation (j-1, j) and azimuth (k-1, k).
+			Colour dTheta(0, 0, 0), dPhi(0, 0, 0);
+			if (j > 0) {
+				float minDist = glm::min(distance[j * N + k], distance[(j - 1) * N + k]);
+				dTheta = (2.0f * PI / N) * (sinThetaMinus * cosThetaMinus * cosThetaMinus / minDist) * (Ljk - L[(j - 1) * N + k]) / PI;
+			}
+			float minDist = glm::min(distance[j * N + k], distance[j * N + kPrev]);
+			dPhi = ((cosThetaMinus - cosThetaPlus) / (sinThetaCentre * minDist)) * (Ljk - L[j * N + kPrev]) / PI;
+			for (int c = 0; c < 3; c++) {
+				rotational[c] += v_k * rot[c];
+				translational[c] += u_k * dTheta[c] + v_kMinus * dPhi[c];
+			}
+		}
+	}
+	for (int c = 0; c < 3; c++) {
+		record.rotationalGradient[c] = rotational[c];
+		record.translationalGradient[c] = translational[c];
+	}
+	return record;
+}
@@ -0,0 +1,80 @@
+#ifndef _IRRADIANCECACHE_RAYTRACINGFRAMEWORK
+#define _IRRADIANCECACHE_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include <vector>
+#include <shared_mutex>
+
+namespace RayTracingFramework{
+	class IScene;
+	class IShadingModel;
+
+	/**
+		CLASS: IrradianceCache
+		DESCRIPTION: Sparse cache of indirect (diffuse) lighting, as described by Ward et al.
+		Indirect irradiance is only computed (by sampling the hemisphere above the point) at a few points of the scene. These records are stored in an octree,
+		and the irradiance at any other point is interpolated from the records around it, using their rotational and translational gradients.
+		Irradiance values are stored divided by PI (i.e. as the cosine weighted average of incoming radiance), so they can directly replace the ambient light level.
+		The cache can be shared by the threads of a renderer: lookups share a lock, and new records are computed without it and then inserted under an exclusive lock.
+		Which records exist depends on the order in which the threads reach their points, so images rendered with the cache enabled may change slightly with the
+		number of threads or the order of the tiles (the Sampler only makes the values drawn for each record reproducible).
+	*/
+	class IrradianceCache
+	{
+	public:
+		/**
+			A single irradiance sample. Gradients are stored per colour channel (gradient[c] is the spatial gradient of channel c).
+		*/
+		struct Record {
+			glm::vec3 position, normal;
+			Colour irradiance;
+			float radius;								//Harmonic mean distance to the surfaces seen from this point (clamped). Controls the area of influence of the record.
+			glm::vec3 rotationalGradient[3];
+			glm::vec3 translationalGradient[3];
+		};
+
+		/**
+			Creates an empty cache.
+			@param errorTolerance: Maximum allowed interpolation error (Ward's "a"). Smaller values produce more records (higher quality, slower).
+			@param thetaSamples, phiSamples: Stratification of the hemisphere used to compute each record (M x N rays per record).
+			@param minRadius, maxRadius: Clamp the area of influence of the records (in world units).
+		*/
+		IrradianceCache(float errorTolerance = 0.25f, int thetaSamples = 6, int phiSamples = 18, float minRadius = 1.0f, float maxRadius = 40.0f);
+		~IrradianceCache();
+
+		/**
+			Returns the indirect irradiance (divided by PI) arriving at a point. It interpolates nearby records if any is valid, or computes (and stores) a new record otherwise.
+			@param shadingModel: Used to compute the radiance arriving along each hemisphere sample (it is invoked with recursive level 1, so it does not query the cache again).
+		*/
+		Colour getIrradiance(glm::vec3 position, glm::vec3 normal, unsigned int objectID, IScene& scene, IShadingModel& shadingModel);
+
+		/**
+			Discards all records (e.g. after the scene changes).
+		*/
+		void clear();
+
+		size_t getNumRecords();
+
+	private:
+		struct OctreeNode {
+			glm::vec3 centre;
+			float halfSize;
+			OctreeNode* children[8];
+			std::vector<unsigned int> recordIndices;
+			OctreeNode(glm::vec3 centre, float halfSize);
+			~OctreeNode();
+		};
+
+		float errorTolerance;
+		int thetaSamples, phiSamples;
+		float minRadius, maxRadius;
+		std::vector<Record> records;
+		OctreeNode* root;
+		std::shared_timed_mutex mutex;
+
+		bool interpolate(glm::vec3 position, glm::vec3 normal, Colour& result);
+		void lookup(OctreeNode* node, glm::vec3 position, glm::vec3 normal, Colour& weightedSum, float& totalWeight);
+		Record computeRecord(glm::vec3 position, glm::vec3 normal, unsigned int objectID, IScene& scene, IShadingModel& shadingModel);
+		void insert(unsigned int recordIndex);
+	};
+};
+#endif
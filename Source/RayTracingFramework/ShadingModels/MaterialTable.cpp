@@ -0,0 +1,60 @@
+#include "MaterialTable.h"
+#include "RayTracingFramework\VirtualObject\ISceneManager.h"
+#include "RayTracingFramework\VirtualObject\IVirtualObject.h"
+#include "RayTracingFramework\Material.h"
+#include <map>
+#include <string>
+#include <cstring>
+
+namespace {
+	template <class T> inline void appendBytes(std::string& key, const T& value) {
+		char bytes[sizeof(T)];
+		memcpy(bytes, &value, sizeof(T));
+		key.append(bytes, sizeof(T));
+	}
+
+	//Everything that tells two materials apart (field by field, so that padding is not compared).
+	std::string getParameterKey(RayTracingFramework::Material& m) {
+		std::string key;
+		float values[] = { m.diffuseColour.r, m.diffuseColour.g, m.diffuseColour.b, m.specularColour.r, m.specularColour.g, m.specularColour.b
+			, m.K_a, m.K_d, m.K_s, m.shininess, m.K_t, m.K_r, m.refractiveIndex, m.emissiveColour.r, m.emissiveColour.g, m.emissiveColour.b };
+		for (size_t v = 0; v < sizeof(values) / sizeof(float); v++)
+			appendBytes(key, values[v]);
+		appendBytes(key, m.diffuseMap);
+		appendBytes(key, m.specularMap);
+		appendBytes(key, m.diffuseTexture);
+		appendBytes(key, m.specularTexture);
+		return key;
+	}
+}
+
+void RayTracingFramework::MaterialTable::compile(IScene& scene) {
+	K_a.clear(); K_d.clear(); K_s.clear(); shininess.clear();
+	K_t.clear(); K_r.clear(); refractiveIndex.clear();
+	materials.clear();
+	materialBySlot.clear();
+	std::vector<IVirtualObject*> objects;
+	scene.getObjects(objects);
+	std::map<std::string, uint32_t> materialIDs;
+	for (size_t o = 0; o < objects.size(); o++) {
+		uint32_t slot = ObjectTable::getSlot(objects[o]->getID());
+		if (slot >= materialBySlot.size())
+			materialBySlot.resize(slot + 1, (uint32_t)NO_MATERIAL);
+		if (!objects[o]->hasMaterial())
+			continue;
+		Material& material = objects[o]->getMaterial();
+		std::map<std::string, uint32_t>::iterator it = materialIDs.insert(std::make_pair(getParameterKey(material), (uint32_t)materials.size())).first;
+		if (it->second == materials.size()) {
+			//New material.
+			materials.push_back(&material);
+			K_a.push_back(material.K_a);
+			K_d.push_back(material.K_d);
+			K_s.push_back(material.K_s);
+			shininess.push_back(material.shininess);
+			K_t.push_back(material.K_t);
+			K_r.push_back(material.K_r);
+			refractiveIndex.push_back(material.refractiveIndex);
+		}
+		materialBySlot[slot] = it->second;
+	}
+}
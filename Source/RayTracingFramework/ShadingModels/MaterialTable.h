@@ -0,0 +1,58 @@
+/**
+	CLASS: MaterialTable
+	DESCRIPTION: The materials of a scene compiled into a structure of arrays (one array per coefficient), indexed by material ID, for shading code that processes
+	many hits of the same material at a time (see WavefrontRenderer). Objects whose materials have the same parameters (and textures) share a material ID,
+	and the material ID of an object is found from the slot of its ID (see ObjectTable), without going through the object or its Material.
+	The table is a snapshot: compile it again after adding objects or changing their materials.
+*/
+#ifndef _MATERIALTABLE_RAYTRACINGFRAMEWORK
+#define _MATERIALTABLE_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include "RayTracingFramework\VirtualObject\ObjectTable.h"
+#include <vector>
+#include <stdint.h>
+
+namespace RayTracingFramework{
+	class Material;
+
+	class MaterialTable {
+	public:
+		static const uint32_t NO_MATERIAL = 0xFFFFFFFFu;
+
+		//Coefficients of each material (see Material).
+		std::vector<float> K_a, K_d, K_s, shininess;
+		std::vector<float> K_t, K_r, refractiveIndex;
+
+		MaterialTable() { ; }
+
+		/**
+			Compiles the materials of all the objects of scene (objects without a material get NO_MATERIAL).
+		*/
+		void compile(IScene& scene);
+
+		inline uint32_t getNumMaterials() { return (uint32_t)materials.size(); }
+
+		/**
+			Material ID of the object with objectID (NO_MATERIAL if it has none or was not in the scene when the table was compiled).
+		*/
+		inline uint32_t getMaterialID(unsigned int objectID) {
+			uint32_t slot = ObjectTable::getSlot(objectID);
+			return (slot < materialBySlot.size()) ? materialBySlot[slot] : NO_MATERIAL;
+		}
+
+		/**
+			One of the Materials with material ID (all of them have the same parameters), e.g. for code that still works on a Material.
+		*/
+		inline Material& getMaterial(uint32_t materialID) { return *materials[materialID]; }
+
+		inline size_t getMemoryBytes() {
+			return sizeof(MaterialTable) + (K_a.capacity() + K_d.capacity() + K_s.capacity() + shininess.capacity() + K_t.capacity() + K_r.capacity() + refractiveIndex.capacity()) * sizeof(float)
+				+ materials.capacity() * sizeof(Material*) + materialBySlot.capacity() * sizeof(uint32_t);
+		}
+
+	private:
+		std::vector<Material*> materials;
+		std::vector<uint32_t> materialBySlot;
+	};
+};
+#endif
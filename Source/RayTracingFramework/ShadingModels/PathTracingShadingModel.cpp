@@ -0,0 +1,191 @@
+#include "PathTracingShadingModel.h"
+#include "RayTracingFramework\Profiling\Profiler.h"
+
+namespace {
+	const float PI = 3.14159265f;
+	//Offset applied to the origin of secondary rays (along the normal), to avoid self intersections due to rounding errors.
+	const float RAY_EPSILON = 0.01f;
+
+	inline float luminance(RayTracingFramework::Colour c) {
+		return 0.2126f * c.r + 0.7152f * c.g + 0.0722f * c.b;
+	}
+
+	//Returns a direction expressed in the frame (tangent, bitangent, axis).
+	inline glm::vec3 toFrame(glm::vec3 axis, float cosTheta, float phi) {
+		glm::vec3 helper = (glm::abs(axis.x) > 0.9f) ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0);
+		glm::vec3 tangent = glm::normalize(glm::cross(helper, axis));
+		glm::vec3 bitangent = glm::cross(axis, tangent);
+		float sinTheta = glm::sqrt(glm::max(0.0f, 1.0f - cosTheta * cosTheta));
+		return glm::normalize(sinTheta * glm::cos(phi) * tangent + sinTheta * glm::sin(phi) * bitangent + cosTheta * axis);
+	}
+}
+
+RayTracingFramework::PathTracingShadingModel::PathTracingShadingModel(int samplesPerCall, int maxDepth, int rouletteDepth)
+	: samplesPerCall(samplesPerCall)
+	, maxDepth(maxDepth)
+	, rouletteDepth(rouletteDepth)
+{
+	;
+}
+
+RayTracingFramework::Colour RayTracingFramework::PathTracingShadingModel::computeShading(RayTracingFramework::Ray& ray, RayTracingFramework::IScene& scene, int recursiveLevel) {
+	PROFILE_SCOPE("PathTracingShadingModel::computeShading");
+	Ray::Intersection intersection = ray.getClosestIntersection();
+	if (intersection.t_distance == FLT_MAX)
+		return getBackgroundColour();
+	//The first vertex is shared by all the paths.
+	glm::vec3 wo = -glm::normalize(glm::vec3(ray.direction_InWorldCoords));
+	SurfaceSample firstVertex;
+	fillSurfaceSample(intersection, scene.getNodeByID(intersection.collidingObjectID).getMaterial(), -wo, firstVertex);
+	//Rays are created once and reused by all the paths (at the time of the camera ray).
+	Ray pathRay(glm::vec4(0, 0, 0, 1), glm::vec4(0, 0, 1, 0), 1, ray.time);
+	Ray shadowRay(glm::vec4(0, 0, 0, 1), glm::vec4(0, 0, 1, 0), 1, ray.time);
+	Sampler& sampler = Sampler::getThreadSampler();
+	Colour sum(0, 0, 0);
+	for (int s = 0; s < samplesPerCall; s++)
+		sum += tracePath(firstVertex, wo, scene, sampler, pathRay, shadowRay);
+	return sum / (float)samplesPerCall;
+}
+
+RayTracingFramework::Colour RayTracingFramework::PathTracingShadingModel::tracePath(SurfaceSample& firstVertex, glm::vec3 wo, IScene& scene, Sampler& sampler, Ray& pathRay, Ray& shadowRay) {
+	PROFILE_SCOPE("PathTracingShadingModel::tracePath");
+	Colour radiance = firstVertex.emission;
+	Colour throughput(1, 1, 1);
+	SurfaceSample surface = firstVertex;
+	for (int depth = 0; depth < maxDepth; depth++) {
+		//1. Next event estimation (lights are delta lights, so BSDF sampling can never hit them -> MIS weight 1).
+		radiance += throughput * sampleLights(surface, wo, scene, sampler, shadowRay);
+
+		//2. Choose a lobe proportionally to its albedo.
+		float weights[4] = { luminance(surface.diffuseAlbedo), luminance(surface.glossyAlbedo), luminance(surface.mirrorAlbedo), luminance(surface.transmissionAlbedo) };
+		float totalWeight = weights[0] + weights[1] + weights[2] + weights[3];
+		if (totalWeight <= 0)
+			break;
+		float pDiffuse = weights[0] / totalWeight, pGlossy = weights[1] / totalWeight, pMirror = weights[2] / totalWeight;
+		float u = sampler.next1D();
+		glm::vec3 wi, origin;
+		if (u < pDiffuse + pGlossy) {
+			//Continuous lobes: sample one of them, but weight with the pdf of the whole mixture (one-sample MIS, balance heuristic).
+			glm::vec2 direction = sampler.next2D();
+			if (u < pDiffuse)
+				wi = toFrame(surface.normal, glm::sqrt(direction.x), 2.0f * PI * direction.y);
+			else {
+				glm::vec3 mirror = glm::reflect(-wo, surface.normal);
+				wi = toFrame(mirror, glm::pow(direction.x, 1.0f / (surface.shininess + 1.0f)), 2.0f * PI * direction.y);
+			}
+			float cosTheta = glm::dot(wi, surface.normal);
+			if (cosTheta <= 0)
+				break;
+			float pdf;
+			Colour f = evaluateBSDF(surface, wo, wi, pDiffuse, pGlossy, pdf);
+			if (pdf <= 0)
+				break;
+			throughput *= f * cosTheta / pdf;
+			origin = surface.position + RAY_EPSILON * surface.normal;
+		}
+		else if (u < pDiffuse + pGlossy + pMirror) {
+			wi = glm::reflect(-wo, surface.normal);
+			throughput *= surface.mirrorAlbedo / pMirror;
+			origin = surface.position + RAY_EPSILON * surface.normal;
+		}
+		else {
+			//Transmission goes straight through (as in IShadingModel).
+			wi = -wo;
+			throughput *= surface.transmissionAlbedo / (1.0f - pDiffuse - pGlossy - pMirror);
+			origin = surface.position - RAY_EPSILON * surface.normal;
+		}
+
+		//3. Russian roulette.
+		if (depth + 1 >= rouletteDepth) {
+			float survival = glm::min(0.95f, glm::max(throughput.r, glm::max(throughput.g, throughput.b)));
+			if (sampler.next1D() >= survival)
+				break;
+			throughput /= survival;
+		}
+
+		//4. Find next vertex.
+		pathRay.reset(glm::vec4(origin, 1.0f), glm::vec4(wi, 0.0f));
+		scene.intersect(pathRay);
+		Ray::Intersection next = pathRay.getClosestIntersection();
+		if (next.t_distance == FLT_MAX) {
+			radiance += throughput * getBackgroundColour();
+			break;
+		}
+		wo = -wi;
+		fillSurfaceSample(next, scene.getNodeByID(next.collidingObjectID).getMaterial(), wi, surface);
+		//Emitters are not sampled by NEE, so BSDF sampling is their only strategy (MIS weight 1).
+		radiance += throughput * surface.emission;
+	}
+	return radiance;
+}
+
+void RayTracingFramework::PathTracingShadingModel::fillSurfaceSample(Ray::Intersection& intersection, Material& material, glm::vec3 incomingDirection, SurfaceSample& surface) {
+	//Timed under the object hit (i.e. its material).
+	PROFILE_SCOPE("PathTracingShadingModel::fillSurfaceSample", intersection.collidingObjectID);
+	glm::vec4 point = toMatrix(intersection.fromObjectToWorldCoords) * intersection.collisionPoint_InObjectCoords;
+	surface.position = glm::vec3(point / point.w);
+	surface.normal = glm::normalize(glm::vec3(toMatrix(intersection.fromObjectToWorldCoords) * intersection.collisionNormalVector_InObjectCoords));
+	if (glm::dot(surface.normal, incomingDirection) > 0)
+		surface.normal = -surface.normal;
+	surface.objectID = intersection.collidingObjectID;
+	surface.shininess = material.shininess;
+	surface.emission = material.emissiveColour;
+	//Same blending as IShadingModel: transmission first, then reflection, the rest is local (diffuse + specular) shading.
+	Colour diffuseColour, specularColour;
+	getSurfaceColours(intersection, material, diffuseColour, specularColour);
+	float opaque = 1.0f - material.K_t;
+	surface.transmissionAlbedo = Colour(material.K_t);
+	surface.mirrorAlbedo = Colour(opaque * material.K_r);
+	surface.diffuseAlbedo = opaque * (1.0f - material.K_r) * material.K_d * diffuseColour;
+	surface.glossyAlbedo = opaque * (1.0f - material.K_r) * material.K_s * specularColour;
+}
+
+RayTracingFramework::Colour RayTracingFramework::PathTracingShadingModel::evaluateBSDF(SurfaceSample& surface, glm::vec3 wo, glm::vec3 wi, float diffuseProbability, float glossyProbability, float& pdf) {
+	float cosTheta = glm::dot(wi, surface.normal);
+	if (cosTheta <= 0) {
+		pdf = 0;
+		return Colour(0, 0, 0);
+	}
+	//Lambertian.
+	Colour f = surface.diffuseAlbedo / PI;
+	pdf = diffuseProbability * cosTheta / PI;
+	//Normalised Phong, around the mirror direction.
+	float cosAlpha = glm::dot(glm::reflect(-wo, surface.normal), wi);
+	if (cosAlpha > 0) {
+		float lobe = glm::pow(cosAlpha, surface.shininess);
+		f += surface.glossyAlbedo * (surface.shininess + 2.0f) / (2.0f * PI) * lobe;
+		pdf += glossyProbability * (surface.shininess + 1.0f) / (2.0f * PI) * lobe;
+	}
+	return f;
+}
+
+RayTracingFramework::Colour RayTracingFramework::PathTracingShadingModel::sampleLights(SurfaceSample& surface, glm::vec3 wo, IScene& scene, Sampler& sampler, Ray& shadowRay) {
+	PROFILE_SCOPE("PathTracingShadingModel::sampleLights");
+	Colour result(0, 0, 0);
+	const std::vector<ILight*>& lights = scene.getLights();
+	for (size_t l = 0; l < lights.size(); l++) {
+		glm::vec4 pointInWorld(surface.position, 1.0f);
+		glm::vec3 wi = -glm::vec3(lights[l]->sampleLightDirectionAtPoint(pointInWorld, sampler));
+		float cosTheta = glm::dot(wi, surface.normal);
+		if (cosTheta <= 0)
+			continue;
+		float pdf;
+		Colour f = evaluateBSDF(surface, wo, wi, 0, 0, pdf);
+		if (f == Colour(0, 0, 0))
+			continue;
+		//Visibility: transparent occluders let part of the light through.
+		float lightDistance = lights[l]->lightDistanceFromPoint(pointInWorld);
+		shadowRay.reset(glm::vec4(surface.position + RAY_EPSILON * surface.normal, 1.0f), glm::vec4(wi, 0.0f));
+		scene.intersect(shadowRay);
+		float transmittance = 1.0f;
+		while (transmittance > 0 && shadowRay.getClosestIntersection().t_distance < lightDistance) {
+			transmittance *= scene.getNodeByID(shadowRay.getClosestIntersection().collidingObjectID).getMaterial().K_t;
+			shadowRay.discardClosestIntersection();
+		}
+		if (transmittance <= 0)
+			continue;
+		//Illuminance 1 produces the perceived light colour on a white Lambertian surface (see DirectionalLight) -> scale by PI.
+		result += f * cosTheta * PI * lights[l]->illuminanceAtPoint(pointInWorld) * lights[l]->baseColour() * transmittance;
+	}
+	return result;
+}
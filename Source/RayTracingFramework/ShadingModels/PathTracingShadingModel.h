@@ -0,0 +1,51 @@
+#ifndef _PATHTRACINGSHADINGMODEL_RAYTRACINGFRAMEWORK
+#define _PATHTRACINGSHADINGMODEL_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include "IShadingModel.h"
+#include "RayTracingFramework\Sampling\Sampler.h"
+
+namespace RayTracingFramework{
+
+	/**
+		CLASS: PathTracingShadingModel
+		DESCRIPTION: Physically based alternative to IShadingModel (unidirectional path tracer). Use it with ISceneManager::setShadingModel.
+		- Materials are interpreted as a mix of lobes, weighted as in IShadingModel: transmission (K_t), perfect mirror (K_r), Lambertian diffuse (K_d) and normalised Phong glossy (K_s, shininess).
+		- Next event estimation: the lights are sampled explicitly at each vertex (with shadow rays).
+		- BSDF sampling picks one lobe proportionally to its albedo. The non-delta lobes are combined with multiple importance sampling (one-sample model, balance heuristic).
+		- Russian roulette terminates the paths with low throughput (unbiased).
+		Random numbers come from the sampler selected by the renderer for the pixel (Sampler::getThreadSampler), and the sample loop does not allocate memory (rays are reused).
+	*/
+	class PathTracingShadingModel : public IShadingModel
+	{
+	public:
+		/**
+			@param samplesPerCall: Number of paths traced (and averaged) for each primary intersection.
+			@param maxDepth: Hard limit on the number of bounces.
+			@param rouletteDepth: Russian roulette is only applied after this number of bounces.
+		*/
+		PathTracingShadingModel(int samplesPerCall = 16, int maxDepth = 8, int rouletteDepth = 3);
+
+		/**
+			Estimates the radiance arriving through the ray (using its closest intersection as the first vertex of the paths). Parameter recursiveLevel is ignored (see maxDepth).
+		*/
+		virtual RayTracingFramework::Colour computeShading(Ray& ray, RayTracingFramework::IScene& scene, int recursiveLevel = 0);
+
+	private:
+		int samplesPerCall, maxDepth, rouletteDepth;
+
+		//Description of the scattering at a path vertex. Lobe weights already include the blending used by IShadingModel.
+		struct SurfaceSample {
+			glm::vec3 position, normal;		//Normal faces the incoming ray.
+			unsigned int objectID;
+			Colour emission, diffuseAlbedo, glossyAlbedo, mirrorAlbedo, transmissionAlbedo;
+			float shininess;
+		};
+
+		Colour tracePath(SurfaceSample& firstVertex, glm::vec3 wo, IScene& scene, Sampler& sampler, Ray& pathRay, Ray& shadowRay);
+		void fillSurfaceSample(Ray::Intersection& intersection, Material& material, glm::vec3 incomingDirection, SurfaceSample& surface);
+		//Non-delta part of the BSDF (diffuse + glossy), and its pdf for the lobe mixture.
+		Colour evaluateBSDF(SurfaceSample& surface, glm::vec3 wo, glm::vec3 wi, float diffuseProbability, float glossyProbability, float& pdf);
+		Colour sampleLights(SurfaceSample& surface, glm::vec3 wo, IScene& scene, Sampler& sampler, Ray& shadowRay);
+	};
+};
+#endif
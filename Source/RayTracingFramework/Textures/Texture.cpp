@@ -0,0 +1,141 @@
+#include "Texture.h"
+#include <atomic>
+#include <cstring>
+#include <algorithm>
+
+namespace {
+	const char TILED_FILE_MAGIC[4] = { 'R', 'T', 'T', '1' };
+	const long long TILED_FILE_HEADER_SIZE = 16;	//Magic + width + height + number of levels.
+	std::atomic<unsigned int> nextTextureID(1);
+
+	//64 bit seek (tiled files of large textures can be bigger than 2GB).
+	inline int seekFile(FILE* file, long long offset) {
+#ifdef _MSC_VER
+		return _fseeki64(file, offset, SEEK_SET);
+#else
+		return fseeko(file, (off_t)offset, SEEK_SET);
+#endif
+	}
+}
+
+RayTracingFramework::Texture::Texture(cimg_library::CImg<unsigned char>& image)
+	: ID(nextTextureID++)
+	, numLevels(0)
+	, image(&image)
+	, file(NULL)
+	, fileDataOffset(0)
+{
+	if (image.width() > 0 && image.height() > 0)
+		computeLevels(image.width(), image.height());
+}
+
+RayTracingFramework::Texture::Texture(const char* tiledFileName)
+	: ID(nextTextureID++)
+	, numLevels(0)
+	, image(NULL)
+	, file(NULL)
+	, fileDataOffset(TILED_FILE_HEADER_SIZE)
+{
+	file = fopen(tiledFileName, "rb");
+	if (!file)
+		return;
+	char magic[4];
+	int header[3];
+	if (fread(magic, 1, 4, file) != 4 || memcmp(magic, TILED_FILE_MAGIC, 4) != 0
+		|| fread(header, sizeof(int), 3, file) != 3 || header[0] <= 0 || header[1] <= 0) {
+		fclose(file);
+		file = NULL;
+		return;
+	}
+	computeLevels(header[0], header[1]);
+	if (numLevels != header[2]) {//Not written by this version of writeTiledFile.
+		numLevels = 0;
+		fclose(file);
+		file = NULL;
+	}
+}
+
+RayTracingFramework::Texture::~Texture() {
+	if (file)
+		fclose(file);
+}
+
+void RayTracingFramework::Texture::computeLevels(int width, int height) {
+	//Halve the size (rounding down, minimum 1) until we reach a 1x1 level.
+	widths.clear(); heights.clear(); firstTile.clear();
+	long long tiles = 0;
+	int w = width, h = height;
+	while (true) {
+		widths.push_back(w);
+		heights.push_back(h);
+		firstTile.push_back(tiles);
+		tiles += (long long)((w + TILE_SIZE - 1) / TILE_SIZE) * ((h + TILE_SIZE - 1) / TILE_SIZE);
+		if (w == 1 && h == 1)
+			break;
+		w = (w > 1) ? w / 2 : 1;
+		h = (h > 1) ? h / 2 : 1;
+	}
+	numLevels = (int)widths.size();
+}
+
+void RayTracingFramework::Texture::loadTile(int level, int tileX, int tileY, unsigned char* texels) {
+	if (image) {
+		generateTile(level, tileX, tileY, texels);
+		return;
+	}
+	long long tile = firstTile[level] + (long long)tileY * getTilesX(level) + tileX;
+	std::lock_guard<std::mutex> lock(fileMutex);
+	if (!file || seekFile(file, fileDataOffset + tile * TILE_BYTES) != 0
+		|| fread(texels, 1, TILE_BYTES, file) != (size_t)TILE_BYTES)
+		memset(texels, 0, TILE_BYTES);
+}
+
+void RayTracingFramework::Texture::generateTile(int level, int tileX, int tileY, unsigned char* texels) {
+	memset(texels, 0, TILE_BYTES);
+	long long baseWidth = widths[0], baseHeight = heights[0];
+	long long levelWidth = widths[level], levelHeight = heights[level];
+	int spectrum = image->spectrum();
+	for (int y = 0; y < TILE_SIZE; y++) {
+		long long levelY = (long long)tileY * TILE_SIZE + y;
+		if (levelY >= levelHeight)
+			break;
+		//Texels of the image covered by this texel (box filter).
+		long long y0 = levelY * baseHeight / levelHeight, y1 = std::max(y0 + 1, (levelY + 1) * baseHeight / levelHeight);
+		for (int x = 0; x < TILE_SIZE; x++) {
+			long long levelX = (long long)tileX * TILE_SIZE + x;
+			if (levelX >= levelWidth)
+				break;
+			long long x0 = levelX * baseWidth / levelWidth, x1 = std::max(x0 + 1, (levelX + 1) * baseWidth / levelWidth);
+			unsigned long long sum[3] = { 0, 0, 0 };
+			for (long long sy = y0; sy < y1; sy++)
+				for (long long sx = x0; sx < x1; sx++)
+					for (int c = 0; c < 3; c++)
+						sum[c] += (*image)((int)sx, (int)sy, 0, c < spectrum ? c : spectrum - 1);
+			unsigned long long count = (unsigned long long)((x1 - x0) * (y1 - y0));
+			unsigned char* texel = texels + 3 * (y * TILE_SIZE + x);
+			for (int c = 0; c < 3; c++)
+				texel[c] = (unsigned char)((sum[c] + count / 2) / count);
+		}
+	}
+}
+
+bool RayTracingFramework::Texture::writeTiledFile(cimg_library::CImg<unsigned char>& image, const char* tiledFileName) {
+	Texture source(image);
+	if (!source.isValid())
+		return false;
+	FILE* output = fopen(tiledFileName, "wb");
+	if (!output)
+		return false;
+	int header[3] = { source.getWidth(0), source.getHeight(0), source.getNumLevels() };
+	bool ok = fwrite(TILED_FILE_MAGIC, 1, 4, output) == 4 && fwrite(header, sizeof(int), 3, output) == 3;
+	//Tiles are written level by level, in rows (the order assumed by loadTile).
+	std::vector<unsigned char> texels(TILE_BYTES);
+	for (int level = 0; ok && level < source.getNumLevels(); level++)
+		for (int tileY = 0; ok && tileY < source.getTilesY(level); tileY++)
+			for (int tileX = 0; ok && tileX < source.getTilesX(level); tileX++) {
+				source.generateTile(level, tileX, tileY, &texels[0]);
+				ok = fwrite(&texels[0], 1, TILE_BYTES, output) == (size_t)TILE_BYTES;
+			}
+	fclose(output);
+	return ok;
+}
@@ -0,0 +1,73 @@
+/**
+	CLASS: Texture
+	DESCRIPTION: A mipmapped RGB texture, split into square tiles (TILE_SIZE x TILE_SIZE texels) so that it can be streamed by TextureCache.
+	The texture itself keeps no texels in memory. It only knows where each tile comes from:
+	- In memory images (e.g. Material::diffuseMap): tiles of each mip level are generated on demand, averaging the texels of the image they cover.
+	- Tiled files (written by writeTiledFile): tiles of all levels are stored in the file, and each one is read (seek + read) only when needed.
+	This lets scenes reference much more texture data than fits in memory: only the tiles kept by the cache are resident.
+*/
+#ifndef _TEXTURE_RAYTRACINGFRAMEWORK
+#define _TEXTURE_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include <vector>
+#include <mutex>
+#include <cstdio>
+
+namespace RayTracingFramework{
+	class Texture
+	{
+	public:
+		static const int TILE_SIZE = 64;
+		static const int TILE_BYTES = TILE_SIZE * TILE_SIZE * 3;
+
+		/**
+			Texture backed by an image in memory (the texture does not copy it, so it must outlive the texture).
+			Grey scale images are expanded to RGB. Extra channels (e.g. alpha) are ignored.
+		*/
+		Texture(cimg_library::CImg<unsigned char>& image);
+
+		/**
+			Texture backed by a tiled file (see writeTiledFile). Only the header is read here. Check isValid() before using it.
+		*/
+		Texture(const char* tiledFileName);
+
+		virtual ~Texture();
+
+		/**
+			Converts an image into a tiled file with all its mip levels (each tile stored contiguously), so that it can be streamed later.
+			This is an offline step (the image needs to fit in memory once). Returns false if the file could not be written.
+		*/
+		static bool writeTiledFile(cimg_library::CImg<unsigned char>& image, const char* tiledFileName);
+
+		inline bool isValid() { return numLevels > 0; }
+		inline unsigned int getID() { return ID; }
+		inline int getNumLevels() { return numLevels; }
+		inline int getWidth(int level) { return widths[level]; }
+		inline int getHeight(int level) { return heights[level]; }
+		inline int getTilesX(int level) { return (widths[level] + TILE_SIZE - 1) / TILE_SIZE; }
+		inline int getTilesY(int level) { return (heights[level] + TILE_SIZE - 1) / TILE_SIZE; }
+
+		/**
+			Writes the texels of a tile (TILE_BYTES, RGB interleaved, rows of TILE_SIZE texels) into texels. Texels outside the level are left at zero.
+			Safe to call from several threads.
+		*/
+		void loadTile(int level, int tileX, int tileY, unsigned char* texels);
+
+		//Memory used by the texture itself (its texels are in the images or files it reads, or in the tiles of a TextureCache).
+		inline size_t getMemoryBytes() { return sizeof(Texture) + (widths.capacity() + heights.capacity()) * sizeof(int) + firstTile.capacity() * sizeof(long long); }
+
+	private:
+		unsigned int ID;						//Unique identifier (used by the cache to name the tiles of this texture).
+		int numLevels;
+		std::vector<int> widths, heights;		//Size of each mip level (level 0 = full resolution).
+		std::vector<long long> firstTile;		//Index (within the file) of the first tile of each level.
+		cimg_library::CImg<unsigned char>* image;
+		FILE* file;
+		long long fileDataOffset;
+		std::mutex fileMutex;
+
+		void computeLevels(int width, int height);
+		void generateTile(int level, int tileX, int tileY, unsigned char* texels);
+	};
+};
+#endif
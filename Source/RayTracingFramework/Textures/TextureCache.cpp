@@ -0,0 +1,150 @@
+#include "TextureCache.h"
+#include <cmath>
+
+RayTracingFramework::TextureCache::TextureCache(size_t memoryBudget)
+	: mostRecent(-1)
+	, leastRecent(-1)
+	, numTileLoads(0)
+{
+	setMemoryBudget(memoryBudget);
+}
+
+RayTracingFramework::TextureCache::~TextureCache() {
+	for (std::map<cimg_library::CImg<unsigned char>*, Texture*>::iterator it = imageTextures.begin(); it != imageTextures.end(); it++)
+		delete it->second;
+}
+
+void RayTracingFramework::TextureCache::setMemoryBudget(size_t memoryBudget) {
+	std::lock_guard<std::mutex> lock(mutex);
+	maxTiles = memoryBudget / Texture::TILE_BYTES;
+	if (maxTiles < 16)//A trilinear lookup touches up to 8 tiles: they must all fit.
+		maxTiles = 16;
+	tiles.clear();
+	texels.clear();
+	residentTiles.clear();
+	mostRecent = leastRecent = -1;
+}
+
+void RayTracingFramework::TextureCache::clear() {
+	std::lock_guard<std::mutex> lock(mutex);
+	tiles.clear();
+	texels.clear();
+	residentTiles.clear();
+	mostRecent = leastRecent = -1;
+}
+
+RayTracingFramework::Texture* RayTracingFramework::TextureCache::getTexture(cimg_library::CImg<unsigned char>* image) {
+	std::lock_guard<std::mutex> lock(mutex);
+	Texture*& texture = imageTextures[image];
+	if (!texture)
+		texture = new Texture(*image);
+	return texture;
+}
+
+size_t RayTracingFramework::TextureCache::getMemoryBytes() {
+	std::lock_guard<std::mutex> lock(mutex);
+	//Hash table: a node per tile (key, value and link) and a pointer per bucket.
+	size_t bytes = sizeof(TextureCache) + tiles.capacity() * sizeof(Tile) + texels.capacity()
+		+ residentTiles.size() * (sizeof(std::pair<const uint64_t, int>) + sizeof(void*)) + residentTiles.bucket_count() * sizeof(void*);
+	for (std::map<cimg_library::CImg<unsigned char>*, Texture*>::iterator it = imageTextures.begin(); it != imageTextures.end(); it++)
+		bytes += it->second->getMemoryBytes();
+	return bytes;
+}
+
+uint64_t RayTracingFramework::TextureCache::tileKey(Texture& texture, int level, int tileX, int tileY) {
+	//24 bits texture ID | 6 bits level | 17 bits tile row | 17 bits tile column.
+	return ((uint64_t)(texture.getID() & 0xFFFFFF) << 40) | ((uint64_t)level << 34) | ((uint64_t)tileY << 17) | (uint64_t)tileX;
+}
+
+void RayTracingFramework::TextureCache::unlink(int slot) {
+	Tile& tile = tiles[slot];
+	if (tile.previous != -1) tiles[tile.previous].next = tile.next;
+	else mostRecent = tile.next;
+	if (tile.next != -1) tiles[tile.next].previous = tile.previous;
+	else leastRecent = tile.previous;
+}
+
+void RayTracingFramework::TextureCache::pushFront(int slot) {
+	tiles[slot].previous = -1;
+	tiles[slot].next = mostRecent;
+	if (mostRecent != -1) tiles[mostRecent].previous = slot;
+	mostRecent = slot;
+	if (leastRecent == -1) leastRecent = slot;
+}
+
+unsigned char* RayTracingFramework::TextureCache::getTile(Texture& texture, int level, int tileX, int tileY) {
+	uint64_t key = tileKey(texture, level, tileX, tileY);
+	std::unordered_map<uint64_t, int>::iterator found = residentTiles.find(key);
+	int slot;
+	if (found != residentTiles.end()) {
+		//Hit: move it to the front of the list.
+		slot = found->second;
+		if (slot != mostRecent) {
+			unlink(slot);
+			pushFront(slot);
+		}
+		return &texels[(size_t)slot * Texture::TILE_BYTES];
+	}
+	//Miss: use a new slot while within budget, otherwise evict the least recently used tile.
+	if (tiles.size() < maxTiles) {
+		slot = (int)tiles.size();
+		Tile tile = { key, -1, -1 };
+		tiles.push_back(tile);
+		texels.resize(tiles.size() * (size_t)Texture::TILE_BYTES);
+	}
+	else {
+		slot = leastRecent;
+		unlink(slot);
+		residentTiles.erase(tiles[slot].key);
+		tiles[slot].key = key;
+	}
+	pushFront(slot);
+	residentTiles[key] = slot;
+	unsigned char* data = &texels[(size_t)slot * Texture::TILE_BYTES];
+	texture.loadTile(level, tileX, tileY, data);
+	numTileLoads++;
+	return data;
+}
+
+glm::vec3 RayTracingFramework::TextureCache::fetch(Texture& texture, int level, int x, int y) {
+	unsigned char* tile = getTile(texture, level, x / Texture::TILE_SIZE, y / Texture::TILE_SIZE);
+	unsigned char* texel = tile + 3 * ((y % Texture::TILE_SIZE) * Texture::TILE_SIZE + (x % Texture::TILE_SIZE));
+	return glm::vec3(texel[0], texel[1], texel[2]) * (1.0f / 255.0f);
+}
+
+glm::vec3 RayTracingFramework::TextureCache::bilinear(Texture& texture, int level, glm::vec2 uv) {
+	int width = texture.getWidth(level), height = texture.getHeight(level);
+	//Texel centres are at half integer coordinates. Repeat the texture outside [0,1].
+	float x = uv.x * width - 0.5f, y = uv.y * height - 0.5f;
+	float fx = std::floor(x), fy = std::floor(y);
+	float wx = x - fx, wy = y - fy;
+	int x0 = ((int)fx % width + width) % width, y0 = ((int)fy % height + height) % height;
+	int x1 = (x0 + 1) % width, y1 = (y0 + 1) % height;
+	glm::vec3 top = (1.0f - wx) * fetch(texture, level, x0, y0) + wx * fetch(texture, level, x1, y0);
+	glm::vec3 bottom = (1.0f - wx) * fetch(texture, level, x0, y1) + wx * fetch(texture, level, x1, y1);
+	return (1.0f - wy) * top + wy * bottom;
+}
+
+RayTracingFramework::Colour RayTracingFramework::TextureCache::sampleLevel(Texture& texture, int level, glm::vec2 uv) {
+	if (!texture.isValid())
+		return Colour(1, 1, 1);
+	level = glm::clamp(level, 0, texture.getNumLevels() - 1);
+	std::lock_guard<std::mutex> lock(mutex);
+	return bilinear(texture, level, uv);
+}
+
+RayTracingFramework::Colour RayTracingFramework::TextureCache::sample(Texture& texture, glm::vec2 uv, float footprint) {
+	if (!texture.isValid())
+		return Colour(1, 1, 1);
+	//Level whose texels are as big as the footprint.
+	float texelsCovered = footprint * (float)glm::max(texture.getWidth(0), texture.getHeight(0));
+	float level = (texelsCovered > 1.0f) ? std::log2(texelsCovered) : 0.0f;
+	level = glm::min(level, (float)(texture.getNumLevels() - 1));
+	int lower = (int)level;
+	float blend = level - (float)lower;
+	std::lock_guard<std::mutex> lock(mutex);
+	glm::vec3 colour = bilinear(texture, lower, uv);
+	if (blend > 0 && lower + 1 < texture.getNumLevels())
+		colour = (1.0f - blend) * colour + blend * bilinear(texture, lower + 1, uv);
+	return colour;
+}
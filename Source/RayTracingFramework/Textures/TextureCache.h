@@ -0,0 +1,84 @@
+/**
+	CLASS: TextureCache
+	DESCRIPTION: Keeps the most recently used texture tiles in memory, within a fixed memory budget, and performs filtered lookups on them.
+	Tiles are loaded lazily (the first time a lookup touches them). When the budget is full, the least recently used tile is evicted and its slot reused,
+	so the resident set never grows beyond the budget, however large the textures are.
+	Lookups use the mip level matching the size of the filtered area (trilinear filtering: bilinear in the two closest levels, blended).
+*/
+#ifndef _TEXTURECACHE_RAYTRACINGFRAMEWORK
+#define _TEXTURECACHE_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include "Texture.h"
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <stdint.h>
+
+namespace RayTracingFramework{
+	class TextureCache
+	{
+	public:
+		/**
+			@param memoryBudget: Maximum memory (in bytes) used by resident tiles (at least 16 tiles are always kept).
+		*/
+		TextureCache(size_t memoryBudget = 64 * 1024 * 1024);
+		virtual ~TextureCache();
+
+		/**
+			Changes the memory budget. Resident tiles are dropped (they will be loaded again when needed).
+		*/
+		void setMemoryBudget(size_t memoryBudget);
+
+		/**
+			Returns the texture used to sample an image in memory (e.g. Material::diffuseMap), creating it the first time. The cache owns these textures.
+		*/
+		Texture* getTexture(cimg_library::CImg<unsigned char>* image);
+
+		/**
+			Filtered lookup (trilinear). Textures repeat outside [0,1].
+			@param footprint: Size (in UV units) of the area covered by the lookup. Zero samples the full resolution level.
+		*/
+		Colour sample(Texture& texture, glm::vec2 uv, float footprint);
+
+		/**
+			Bilinear lookup in a single mip level.
+		*/
+		Colour sampleLevel(Texture& texture, int level, glm::vec2 uv);
+
+		/**
+			Drops all resident tiles (textures created by getTexture are kept).
+		*/
+		void clear();
+
+		inline size_t getResidentBytes() { return tiles.size() * (size_t)Texture::TILE_BYTES; }
+
+		/**
+			Memory used by the cache: its tile slots (allocated ones, which may exceed the resident tiles after clear), lookup table and the textures it created.
+		*/
+		size_t getMemoryBytes();
+		inline unsigned long long getNumTileLoads() { return numTileLoads; }
+
+	private:
+		//Slot of the cache. Slots are kept in a doubly linked list, from most to least recently used.
+		struct Tile {
+			uint64_t key;
+			int previous, next;
+		};
+		size_t maxTiles;
+		std::vector<Tile> tiles;
+		std::vector<unsigned char> texels;				//TILE_BYTES per slot.
+		std::unordered_map<uint64_t, int> residentTiles;	//Tile key -> slot.
+		int mostRecent, leastRecent;
+		unsigned long long numTileLoads;
+		std::map<cimg_library::CImg<unsigned char>*, Texture*> imageTextures;
+		std::mutex mutex;
+
+		static uint64_t tileKey(Texture& texture, int level, int tileX, int tileY);
+		unsigned char* getTile(Texture& texture, int level, int tileX, int tileY);
+		glm::vec3 fetch(Texture& texture, int level, int x, int y);
+		glm::vec3 bilinear(Texture& texture, int level, glm::vec2 uv);
+		void unlink(int slot);
+		void pushFront(int slot);
+	};
+};
+#endif
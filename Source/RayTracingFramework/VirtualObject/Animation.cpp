@@ -0,0 +1,98 @@
+#include "Animation.h"
+#include "ISceneManager.h"
+#include "IVirtualObject.h"
+#include <algorithm>
+
+void RayTracingFramework::Animation::addKey(IVirtualObject& object, float frame, glm::mat4 localToParent) {
+	Track* track = findTrack(object.getID());
+	if (!track) {
+		tracks.push_back(Track());
+		track = &tracks.back();
+		track->objectID = object.getID();
+	}
+	size_t k = std::lower_bound(track->frames.begin(), track->frames.end(), frame) - track->frames.begin();
+	if (k < track->frames.size() && track->frames[k] == frame) {
+		track->keys[k] = localToParent;
+		return;
+	}
+	track->frames.insert(track->frames.begin() + k, frame);
+	track->keys.insert(track->keys.begin() + k, localToParent);
+}
+
+float RayTracingFramework::Animation::getFirstFrame() {
+	if (tracks.empty())
+		return 0.0f;
+	float first = tracks[0].frames.front();
+	for (size_t t = 1; t < tracks.size(); t++)
+		first = std::min(first, tracks[t].frames.front());
+	return first;
+}
+
+float RayTracingFramework::Animation::getLastFrame() {
+	if (tracks.empty())
+		return 0.0f;
+	float last = tracks[0].frames.back();
+	for (size_t t = 1; t < tracks.size(); t++)
+		last = std::max(last, tracks[t].frames.back());
+	return last;
+}
+
+bool RayTracingFramework::Animation::isAnimated(IVirtualObject& object) {
+	return findTrack(object.getID()) != NULL;
+}
+
+bool RayTracingFramework::Animation::getLocalToParent(unsigned int objectID, float frame, glm::mat4& localToParent) {
+	Track* track = findTrack(objectID);
+	if (!track)
+		return false;
+	localToParent = evaluate(*track, frame);
+	return true;
+}
+
+bool RayTracingFramework::Animation::movesOnly(IVirtualObject& object, float fromFrame, float toFrame) {
+	for (size_t t = 0; t < tracks.size(); t++)
+		if (tracks[t].objectID != object.getID() && evaluate(tracks[t], fromFrame) != evaluate(tracks[t], toFrame))
+			return false;
+	return true;
+}
+
+void RayTracingFramework::Animation::applyFrame(IScene& scene, float frame, float shutter, int numShutterKeys) {
+	std::vector<glm::mat4> keyframes;
+	for (size_t t = 0; t < tracks.size(); t++) {
+		IVirtualObject* object = scene.findNodeByID(tracks[t].objectID);
+		if (!object)
+			continue;//Deleted.
+		if (shutter <= 0 || numShutterKeys < 2) {
+			object->setLocalToParent(evaluate(tracks[t], frame));
+			continue;
+		}
+		keyframes.resize(numShutterKeys);
+		bool moving = false;
+		for (int k = 0; k < numShutterKeys; k++) {
+			keyframes[k] = evaluate(tracks[t], frame + shutter * (float)k / (float)(numShutterKeys - 1));
+			moving = moving || keyframes[k] != keyframes[0];
+		}
+		//Objects that stay still during the shutter are not treated as moving (which would make their rays slower).
+		if (moving)
+			object->setLocalToParentKeyframes(keyframes);
+		else
+			object->setLocalToParent(keyframes[0]);
+	}
+}
+
+RayTracingFramework::Animation::Track* RayTracingFramework::Animation::findTrack(unsigned int objectID) {
+	for (size_t t = 0; t < tracks.size(); t++)
+		if (tracks[t].objectID == objectID)
+			return &tracks[t];
+	return NULL;
+}
+
+glm::mat4 RayTracingFramework::Animation::evaluate(const Track& track, float frame) {
+	if (frame <= track.frames.front())
+		return track.keys.front();
+	if (frame >= track.frames.back())
+		return track.keys.back();
+	size_t k = std::upper_bound(track.frames.begin(), track.frames.end(), frame) - track.frames.begin();
+	float alpha = (frame - track.frames[k - 1]) / (track.frames[k] - track.frames[k - 1]);
+	return (1.0f - alpha) * track.keys[k - 1] + alpha * track.keys[k];
+}
@@ -0,0 +1,63 @@
+/**
+	CLASS: Animation
+	DESCRIPTION: Keyframed transforms (fromLocalToParent) of objects of a scene, including cameras, over a range of frames. Between keys, matrices are
+	interpolated linearly (as the keyframes of motion blur are: keep keys close enough for rotations); before the first key and after the last one, the object
+	stays at that key. applyFrame moves the objects to a frame (and can make them move over the shutter interval, for motion blur), so the same scene
+	is rendered frame after frame (see AnimationRenderer). Objects are referred to by their IDs: the ones deleted from the scene are ignored.
+*/
+#ifndef _ANIMATION_RAYTRACINGFRAMEWORK
+#define _ANIMATION_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include <vector>
+
+namespace RayTracingFramework{
+	class Animation
+	{
+	public:
+		Animation() { ; }
+
+		/**
+			Object has transform localToParent at frame (replacing its key at that frame, if any). Keys can be added in any order.
+		*/
+		void addKey(IVirtualObject& object, float frame, glm::mat4 localToParent);
+
+		inline bool isEmpty() { return tracks.empty(); }
+		//First/last key of all the objects (0 if there are no keys).
+		float getFirstFrame();
+		float getLastFrame();
+
+		/**
+			True if object has keys.
+		*/
+		bool isAnimated(IVirtualObject& object);
+
+		/**
+			Transform of the object with objectID at frame. Returns false if it has no keys.
+		*/
+		bool getLocalToParent(unsigned int objectID, float frame, glm::mat4& localToParent);
+
+		/**
+			True if object (e.g. the camera) is the only one whose transform changes between fromFrame and toFrame.
+		*/
+		bool movesOnly(IVirtualObject& object, float fromFrame, float toFrame);
+
+		/**
+			Moves the animated objects of scene to frame. With shutter > 0, they move from frame to frame + shutter during the shutter interval of the
+			camera (numShutterKeys keyframes: see IVirtualObject::setLocalToParentKeyframes); otherwise they are static.
+			Cameras need to be prepared again (Camera::prepareFrame) and acceleration structures refit (ISceneManager::refitBVH) afterwards.
+		*/
+		void applyFrame(IScene& scene, float frame, float shutter = 0.0f, int numShutterKeys = 2);
+
+	private:
+		struct Track {
+			unsigned int objectID;
+			std::vector<float> frames;			//Sorted.
+			std::vector<glm::mat4> keys;
+		};
+		std::vector<Track> tracks;
+
+		Track* findTrack(unsigned int objectID);
+		static glm::mat4 evaluate(const Track& track, float frame);
+	};
+};
+#endif
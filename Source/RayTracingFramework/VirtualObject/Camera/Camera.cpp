@@ -1,5 +1,27 @@
 #include "Camera.h"
 #include "RayTracingFramework\Ray.h"
+#include "RayTracingFramework\RayPacket.h"
+#include "RayTracingFramework\Sampling\Sampler.h"
+
+namespace {
+	//Maps a point of [0,1)^2 to the unit disk, preserving stratification (Shirley & Chiu concentric mapping).
+	glm::vec2 concentricDiskSample(glm::vec2 u) {
+		const float PI = 3.14159265f;
+		glm::vec2 offset = 2.0f * u - glm::vec2(1.0f, 1.0f);
+		if (offset.x == 0 && offset.y == 0)
+			return glm::vec2(0, 0);
+		float r, theta;
+		if (glm::abs(offset.x) > glm::abs(offset.y)) {
+			r = offset.x;
+			theta = (PI / 4.0f) * (offset.y / offset.x);
+		}
+		else {
+			r = offset.y;
+			theta = (PI / 2.0f) - (PI / 4.0f) * (offset.x / offset.y);
+		}
+		return r * glm::vec2(glm::cos(theta), glm::sin(theta));
+	}
+}
 
 RayTracingFramework::Camera::Camera(IScene& scene, int width, int height, float top, float bottom, float left, float right, float n, float f)
     : IVirtualObject(NULL,NULL,scene)
@@ -10,44 +32,189 @@ RayTracingFramework::Camera::Camera(IScene& scene, int width, int height, float
 	, bottomRight(right, bottom, n, 1.0f)
 	, _near(n)
 	, _far(f)
+	, projection(PERSPECTIVE)
+	, apertureRadius(0)
+	, focalDistance(1)
 {
-	;
+	prepareFrame();
 }
 
 
 RayTracingFramework::Camera::~Camera()
 {
-	//We need to release any memory we allocated dynamically, suring object creation. 
+	//We need to release any memory we allocated dynamically, suring object creation.
 	//As all our variables are basic objects (no pointers), we have nothing to do.
 }
 
+void RayTracingFramework::Camera::setPerspective(float verticalFOV, float n, float f) {
+	float top = n * glm::tan(glm::radians(verticalFOV) * 0.5f);
+	float right = top * (float)pixelWidth / (float)pixelHeight;
+	topLeft = glm::vec4(-right, top, n, 1.0f);
+	topRight = glm::vec4(right, top, n, 1.0f);
+	bottomLeft = glm::vec4(-right, -top, n, 1.0f);
+	bottomRight = glm::vec4(right, -top, n, 1.0f);
+	_near = n;
+	_far = f;
+	projection = PERSPECTIVE;
+	prepareFrame();
+}
+
+void RayTracingFramework::Camera::setOrthographic(float viewWidth, float viewHeight) {
+	topLeft = glm::vec4(-viewWidth / 2, viewHeight / 2, _near, 1.0f);
+	topRight = glm::vec4(viewWidth / 2, viewHeight / 2, _near, 1.0f);
+	bottomLeft = glm::vec4(-viewWidth / 2, -viewHeight / 2, _near, 1.0f);
+	bottomRight = glm::vec4(viewWidth / 2, -viewHeight / 2, _near, 1.0f);
+	projection = ORTHOGRAPHIC;
+	prepareFrame();
+}
+
+void RayTracingFramework::Camera::setThinLens(float _apertureRadius, float _focalDistance) {
+	apertureRadius = _apertureRadius;
+	focalDistance = _focalDistance;
+	prepareFrame();
+}
+
+void RayTracingFramework::Camera::_prepareLocalIncrements(glm::vec3& topLeftLocal, glm::vec3& columnIncrement, glm::vec3& rowIncrement) {
+	float nearWidth = topRight.x - topLeft.x;
+	float nearHeight = bottomLeft.y - topLeft.y;
+	topLeftLocal = glm::vec3(topLeft);
+	columnIncrement = glm::vec3(nearWidth / (float)pixelWidth, 0, 0);
+	rowIncrement = glm::vec3(0, nearHeight / (float)pixelHeight, 0);
+}
+
+void RayTracingFramework::Camera::prepareFrame() {
+	_preparedCameraToWorld = this->getFromObjectToWorldCoordinates();
+	_preparedWorldToCamera = this->getFromWorldToObjectCoordinates();
+	//Directions are transformed with w=0 (only rotation/scale apply, translation must not leak into them).
+	glm::mat3 rotation(_preparedCameraToWorld);
+	glm::vec3 topLeftLocal, columnIncrement, rowIncrement;
+	_prepareLocalIncrements(topLeftLocal, columnIncrement, rowIncrement);
+	_originWorld = glm::vec3(_preparedCameraToWorld * glm::vec4(0, 0, 0, 1));
+	_rightWorld = glm::normalize(rotation * glm::vec3(1, 0, 0));
+	_upWorld = glm::normalize(rotation * glm::vec3(0, 1, 0));
+	_forwardWorld = glm::normalize(rotation * glm::vec3(0, 0, 1));
+	_columnIncrementWorld = rotation * columnIncrement;
+	_rowIncrementWorld = rotation * rowIncrement;
+	if (projection == PERSPECTIVE)
+		_topLeftWorld = rotation * topLeftLocal;
+	else
+		_topLeftWorld = glm::vec3(_preparedCameraToWorld * glm::vec4(topLeftLocal.x, topLeftLocal.y, 0, 1));
+}
+
 RayTracingFramework::Ray RayTracingFramework::Camera::createPrimaryRay(int x_pixel, int y_pixel){
-	//1. Compute the ray on coordinates local to the camera (Workshop 2)
-	glm::vec4 origin_local(0, 0, 0, 1);
-	glm::vec4 direction_local = _createLocalPrimaryRay(x_pixel, y_pixel);
-	//2. Transform it to world coordinates (explained in workshop 3):
-	glm::vec4 origin_world=this->getFromObjectToWorldCoordinates() * origin_local;
-	glm::vec4 direction_world=this->getFromObjectToWorldCoordinates() * direction_local;
-	//3. Return ray in world coordinates.
-	return  RayTracingFramework::Ray(origin_world, direction_world);
-}
-
-glm::vec4 RayTracingFramework::Camera::_createLocalPrimaryRay(int x_pixel, int y_pixel){
-	//0. Check if we are in bounds (in pixel space).	
+	//0. Check if we are in bounds (in pixel space).
 	if (x_pixel < 0 || x_pixel >= pixelWidth
 		|| y_pixel < 0 || y_pixel >= pixelHeight)
-		return glm::vec4(0, 0, 0, 0.0f);
+		return RayTracingFramework::Ray(glm::vec4(_originWorld, 1.0f), glm::vec4(0, 0, 0, 0));
+	return createPrimaryRay((float)x_pixel, (float)y_pixel);
+}
 
-	//2. Compute position of pixel P(x_pixel, y_pixel)
-	float nearWidth = topRight.x - topLeft.x;
-	float nearHeight = bottomLeft.y - topLeft.y;
-	float proportionWidth = (float)x_pixel / (float)pixelWidth;
-	float proportionHeight = (float)y_pixel / (float)pixelHeight;
-	glm::vec3 P = glm::vec3(topLeft) + glm::vec3(nearWidth * proportionWidth, nearHeight * proportionHeight, 0);
+RayTracingFramework::Ray RayTracingFramework::Camera::createPrimaryRay(int x_pixel, int y_pixel, Sampler& sampler) {
+	glm::vec2 jitter = sampler.next2D();
+	glm::vec2 lensSample = sampler.next2D();
+	float time = sampler.next1D();
+	return createPrimaryRay((float)x_pixel + jitter.x, (float)y_pixel + jitter.y, lensSample, time);
+}
 
-	//O->P
-	glm::vec3 OP = glm::normalize(P);
+RayTracingFramework::Ray RayTracingFramework::Camera::createPrimaryRay(float x_image, float y_image, glm::vec2 lensSample, float time) {
+	glm::vec3 origin, direction;
+	//Differentials: change of the ray from one pixel to the next (the thin lens keeps those of the pinhole ray, as all rays converge in the focal plane).
+	RayDifferentials differentials;
+	differentials.valid = true;
+	if (projection == PERSPECTIVE) {
+		origin = _originWorld;
+		direction = glm::normalize(_topLeftWorld + x_image * _columnIncrementWorld + y_image * _rowIncrementWorld);
+		differentials.dOriginX = differentials.dOriginY = glm::vec3(0, 0, 0);
+		differentials.dDirectionX = _columnIncrementWorld;
+		differentials.dDirectionY = _rowIncrementWorld;
+		differentials.normalizeDirection(_topLeftWorld + x_image * _columnIncrementWorld + y_image * _rowIncrementWorld);
+	}
+	else {
+		origin = _topLeftWorld + x_image * _columnIncrementWorld + y_image * _rowIncrementWorld;
+		direction = _forwardWorld;
+		differentials.dOriginX = _columnIncrementWorld;
+		differentials.dOriginY = _rowIncrementWorld;
+		differentials.dDirectionX = differentials.dDirectionY = glm::vec3(0, 0, 0);
+	}
+	if (apertureRadius > 0) {
+		//Thin lens: all rays through the lens converge at the point in focus of the pinhole ray.
+		glm::vec3 focusPoint = origin + direction * (focalDistance / glm::dot(direction, _forwardWorld));
+		glm::vec2 lens = apertureRadius * concentricDiskSample(lensSample);
+		origin += lens.x * _rightWorld + lens.y * _upWorld;
+		direction = glm::normalize(focusPoint - origin);
+	}
+	if (isMoving()) {
+		//Camera with motion blur: move the ray from the prepared position (shutter open) to the position at its time.
+		glm::mat4 motion = getFromObjectToWorldCoordinates(time) * _preparedWorldToCamera;
+		origin = glm::vec3(motion * glm::vec4(origin, 1.0f));
+		direction = glm::normalize(glm::vec3(motion * glm::vec4(direction, 0.0f)));
+		glm::mat3 rotation(motion);
+		differentials.dOriginX = rotation * differentials.dOriginX;
+		differentials.dOriginY = rotation * differentials.dOriginY;
+		differentials.dDirectionX = rotation * differentials.dDirectionX;
+		differentials.dDirectionY = rotation * differentials.dDirectionY;
+	}
+	RayTracingFramework::Ray ray(glm::vec4(origin, 1.0f), glm::vec4(direction, 0.0f), 1, time);
+	ray.differentials = differentials;
+	return ray;
+}
+
+void RayTracingFramework::Camera::createPrimaryRays(int x0, int y0, int x1, int y1, RayTracingFramework::RayPacket& packet, glm::vec2 pixelOffset, glm::vec2 lensSample) {
+	int width = x1 - x0, height = y1 - y0;
+	packet.resize(x0, y0, width, height);
+	//The lens offset is the same for the whole tile.
+	glm::vec3 lensOffset(0, 0, 0);
+	if (apertureRadius > 0) {
+		glm::vec2 lens = apertureRadius * concentricDiskSample(lensSample);
+		lensOffset = lens.x * _rightWorld + lens.y * _upWorld;
+	}
+	int i = 0;
+	for (int y = 0; y < height; y++) {
+		//Start of the row, then one increment per column.
+		glm::vec3 point = _topLeftWorld + ((float)x0 + pixelOffset.x) * _columnIncrementWorld + ((float)(y0 + y) + pixelOffset.y) * _rowIncrementWorld;
+		for (int x = 0; x < width; x++, i++, point += _columnIncrementWorld) {
+			glm::vec3 origin, direction;
+			//Differentials as in createPrimaryRay (the lens keeps those of the pinhole ray).
+			RayDifferentials& rayDifferentials = packet.differentials[i];
+			rayDifferentials.valid = true;
+			if (projection == PERSPECTIVE) {
+				origin = _originWorld;
+				direction = glm::normalize(point);
+				rayDifferentials.dOriginX = rayDifferentials.dOriginY = glm::vec3(0, 0, 0);
+				rayDifferentials.dDirectionX = _columnIncrementWorld;
+				rayDifferentials.dDirectionY = _rowIncrementWorld;
+				rayDifferentials.normalizeDirection(point);
+			}
+			else {
+				origin = point;
+				direction = _forwardWorld;
+				rayDifferentials.dOriginX = _columnIncrementWorld;
+				rayDifferentials.dOriginY = _rowIncrementWorld;
+				rayDifferentials.dDirectionX = rayDifferentials.dDirectionY = glm::vec3(0, 0, 0);
+			}
+			if (apertureRadius > 0) {
+				glm::vec3 focusPoint = origin + direction * (focalDistance / glm::dot(direction, _forwardWorld));
+				origin += lensOffset;
+				direction = glm::normalize(focusPoint - origin);
+			}
+			packet.originX[i] = origin.x; packet.originY[i] = origin.y; packet.originZ[i] = origin.z;
+			packet.directionX[i] = direction.x; packet.directionY[i] = direction.y; packet.directionZ[i] = direction.z;
+		}
+	}
+}
 
-	//3. Return direction vector OP. Normalize before returning (glm::normalize(<your vector>)) 
-	return glm::vec4(OP, 1.0f);
-}
\ No newline at end of file
+bool RayTracingFramework::Camera::getPinholeRays(glm::vec3& origin, glm::vec3& topLeft, glm::vec3& columnIncrement, glm::vec3& rowIncrement) {
+	if (projection != PERSPECTIVE || apertureRadius > 0 || isMoving())
+		return false;
+	origin = _originWorld;
+	topLeft = _topLeftWorld;
+	columnIncrement = _columnIncrementWorld;
+	rowIncrement = _rowIncrementWorld;
+	return true;
+}
+
+float RayTracingFramework::Camera::getPixelSpreadAngle() {
+	if (projection == ORTHOGRAPHIC)
+		return 0.0f;
+	return glm::length(_rowIncrementWorld) / glm::length(_topLeftWorld + 0.5f * (float)pixelWidth * _columnIncrementWorld + 0.5f * (float)pixelHeight * _rowIncrementWorld);
+}
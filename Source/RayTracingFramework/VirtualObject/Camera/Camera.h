@@ -4,24 +4,97 @@
 #include <RayTracingFramework\VirtualObject\IVirtualObject.h>
 
 namespace RayTracingFramework{
+	class RayPacket;
 
 	class Camera: public IVirtualObject
 	{
+	public:
+		enum Projection { PERSPECTIVE, ORTHOGRAPHIC };
 	protected:
 		//Define camera parameters in image space (size of the sensor, in pixels):
-		int pixelWidth, pixelHeight; 
+		int pixelWidth, pixelHeight;
 		//Define the camera parameters in 3D space (the "View volume" of our camera).
 		glm::vec4 topLeft, topRight, bottomLeft, bottomRight;	//These are equivalent to points A,B,C and D in the slides
-		float _near, _far; 
+		float _near, _far;
 		//Please note: the 3D location/orientation of the camera is implicitly contained in field "localToParent" (inherited from IVirtualObject)
-		virtual glm::vec4 _createLocalPrimaryRay(int x_pixel, int y_pixel);
+		Projection projection;
+		float apertureRadius, focalDistance;					//Thin lens model (apertureRadius = 0 -> pinhole camera).
+
+		//Values precomputed by prepareFrame (in world coordinates), so that each ray only needs a few additions:
+		glm::mat4 _preparedCameraToWorld, _preparedWorldToCamera;
+		glm::vec3 _originWorld;									//Camera position.
+		glm::vec3 _topLeftWorld;								//Perspective: direction to the top left corner of the near plane. Orthographic: position of that corner.
+		glm::vec3 _columnIncrementWorld, _rowIncrementWorld;	//Change of the above when moving one pixel right/down.
+		glm::vec3 _rightWorld, _upWorld, _forwardWorld;			//Camera basis (unit vectors).
+
+		void _prepareLocalIncrements(glm::vec3& topLeftLocal, glm::vec3& columnIncrement, glm::vec3& rowIncrement);
 	public:
 		Camera(IScene& scene, int width, int height, float top, float bottom, float left, float right, float n, float f);
-	
+
 		virtual ~Camera();
 
+		/**
+			Redefines the view volume from a vertical field of view (in degrees). Horizontal extent follows the aspect ratio of the image.
+		*/
+		void setPerspective(float verticalFOV, float n, float f);
+
+		/**
+			Switches to an orthographic projection (parallel rays), covering a view of the given size (in world units).
+		*/
+		void setOrthographic(float viewWidth, float viewHeight);
+
+		/**
+			Enables depth of field (thin lens model). Points at focalDistance (along the view direction) are in focus. apertureRadius = 0 disables it.
+		*/
+		void setThinLens(float apertureRadius, float focalDistance);
+
+		/**
+			Precomputes the camera basis and the per row/per column increments in world coordinates. Call it once per frame, after moving or reconfiguring the camera.
+			(The constructor and the set* methods call it automatically).
+		*/
+		void prepareFrame();
+
+		/**
+			Creates the ray through the top left corner of a pixel (pinhole, it ignores the lens).
+		*/
 		Ray createPrimaryRay(int x_pixel, int y_pixel);
+
+		/**
+			Creates the ray through a point of the image (in pixels, e.g. (x + 0.5, y + 0.5) is the centre of pixel (x, y)).
+			@param lensSample: Point of the lens (in [0,1)^2, (0.5, 0.5) is the centre of the lens) used by the thin lens model.
+			@param time: Time of the shutter interval ([0, 1]) the ray is traced at (motion blur). A camera with keyframes is placed at that time.
+			The ray carries its differentials (change of origin and direction per pixel, see RayDifferentials).
+		*/
+		Ray createPrimaryRay(float x_image, float y_image, glm::vec2 lensSample = glm::vec2(0.5f, 0.5f), float time = 0.0f);
+
+		/**
+			Creates a ray through pixel (x_pixel, y_pixel) for the current sample of sampler: it draws the position in the pixel (2 values),
+			the point of the lens (2 values) and the time (1 value), always in this order.
+		*/
+		Ray createPrimaryRay(int x_pixel, int y_pixel, Sampler& sampler);
+
+		/**
+			Creates the primary rays of a whole tile [x0, x1) x [y0, y1) in one call, writing them (and their differentials) into packet (structure of arrays).
+			@param pixelOffset: Position of the ray inside each pixel ((0,0) is the top left corner, as in createPrimaryRay(int, int)).
+			@param lensSample: Point of the lens used for all rays in the tile (see createPrimaryRay).
+		*/
+		void createPrimaryRays(int x0, int y0, int x1, int y1, RayPacket& packet, glm::vec2 pixelOffset = glm::vec2(0, 0), glm::vec2 lensSample = glm::vec2(0.5f, 0.5f));
+
+		/**
+			Angle (in radians) between the rays of two neighbouring pixels. Multiplied by a distance, it gives the size of the area a pixel sees (texture filtering).
+			Orthographic cameras return 0 (their footprint does not grow with distance).
+		*/
+		float getPixelSpreadAngle();
+
+		/**
+			Pinhole cameras (perspective, no lens, not moving): all the rays of pixel (x, y) start at origin and go through topLeft + u * columnIncrement + v * rowIncrement,
+			for (u, v) in [x, x + 1] x [y, y + 1] (world coordinates, directions not normalized). Returns false for other cameras.
+		*/
+		bool getPinholeRays(glm::vec3& origin, glm::vec3& topLeft, glm::vec3& columnIncrement, glm::vec3& rowIncrement);
+
+		inline int getPixelWidth() { return pixelWidth; }
+		inline int getPixelHeight() { return pixelHeight; }
 	};
 
 };
-#endif
\ No newline at end of file
+#endif
@@ -1,27 +1,69 @@
 #include "ISceneManager.h"
 #include "IVirtualObject.h"
 #include "RayTracingFramework\ShadingModels\IShadingModel.h"
+#include "RayTracingFramework\Textures\Texture.h"
 
 
-RayTracingFramework::ISceneManager::ISceneManager() :ID_seed(IVirtualObject::INVALID_OBJECT_ID)
+RayTracingFramework::ISceneManager::ISceneManager() :bvhValid(false), root(NULL)
 {
 	this->shadingModel = new RayTracingFramework::IShadingModel();
-
+	//The root is the first object registered (so it gets ROOT_OBJECT_ID).
+	root = new RayTracingFramework::IVirtualObject(NULL, NULL, *this);
 }
 
 RayTracingFramework::ISceneManager::~ISceneManager() 
 {
+	//Objects deregister themselves as they are deleted (children first is not needed: deleting a node does not delete its children).
+	std::vector<IVirtualObject*> objects;
+	registry.getObjects(objects);
+	for (size_t o = 0; o < objects.size(); o++)
+		if (objects[o] != root)
+			delete objects[o];
+	delete root;
+	for (size_t l = 0; l < lights.size(); l++)
+		delete lights[l];
+	for (size_t t = 0; t < textures.size(); t++)
+		delete textures[t];
+	delete shadingModel;
 }
 
 RayTracingFramework::ISceneManager& RayTracingFramework::ISceneManager::instance(){
 	static ISceneManager _instance;
-	_instance.getRootNode();//Make sure the root object has ben initialized
 	return _instance;
 }
 
+void RayTracingFramework::ISceneManager::setShadingModel(IShadingModel* s) {
+	if (s != shadingModel)
+		delete shadingModel;
+	shadingModel = s;
+}
+
 RayTracingFramework::IVirtualObject& RayTracingFramework::ISceneManager::getRootNode() {
-	static RayTracingFramework::IVirtualObject _root(NULL,NULL, *this);
-	return _root;
+	return *root;
 }
 
+void RayTracingFramework::IScene::getAttachedObjects(std::vector<IVirtualObject*>& objects) {
+	std::vector<IVirtualObject*> registered;
+	getObjects(registered);
+	for (size_t o = 0; o < registered.size(); o++) {
+		unsigned int ID = registered[o]->getID();
+		IVirtualObject* node;
+		while (ID != IVirtualObject::ROOT_OBJECT_ID && (node = findNodeByID(ID)) != NULL)
+			ID = node->getParentID();
+		if (ID == IVirtualObject::ROOT_OBJECT_ID)
+			objects.push_back(registered[o]);
+	}
+}
 
+void RayTracingFramework::ISceneManager::buildBVH(int timeSegments) {
+	//Objects attached to the scene graph (the ones testCollision would visit from the root).
+	std::vector<IVirtualObject*> objects;
+	getAttachedObjects(objects);
+	bvh.build(objects, timeSegments);
+	bvhValid = true;
+}
+
+void RayTracingFramework::ISceneManager::refitBVH() {
+	if (!bvhValid || !bvh.refit())
+		buildBVH();
+}
@@ -3,6 +3,8 @@
 #include <RayTracingFramework\VirtualObject\IVirtualObject.h>
 #include <RayTracingFramework\Light\ILight.h>
 #include <RayTracingFramework\ShadingModels\IShadingModel.h>
+#include <RayTracingFramework\VirtualObject\SceneBVH.h>
+#include <RayTracingFramework\VirtualObject\ObjectTable.h>
 #include <vector>
 namespace RayTracingFramework{
 
@@ -27,6 +29,21 @@ namespace RayTracingFramework{
 		*/
 		virtual IVirtualObject& getNodeByID(unsigned int ID) = 0;
 
+		/**
+			Returns the Virtual Object with the given ID, or NULL if there is none (e.g. the object was deleted). 
+		*/
+		virtual IVirtualObject* findNodeByID(unsigned int ID) = 0;
+
+		/**
+			Appends all the Virtual Objects of the scene (attached to the scene graph or not) to objects.
+		*/
+		virtual void getObjects(std::vector<IVirtualObject*>& objects) = 0;
+
+		/**
+			Appends the Virtual Objects attached to the scene graph (the ones a traversal from the root visits), e.g. to build acceleration structures.
+		*/
+		void getAttachedObjects(std::vector<IVirtualObject*>& objects);
+
 		/**
 			Returns the class that shades the objects in the scene. All objects will use the same "shader". 
 		*/
@@ -34,56 +51,112 @@ namespace RayTracingFramework{
 		/**
 			Returns a list with the lights currently defined in the scene.
 		*/
-		virtual std::vector<ILight*> getLights() = 0;
+		virtual const std::vector<ILight*>& getLights() = 0;
+
+		/**
+			Hands texture over to the scene, which deletes it when it is destroyed (e.g. textures shared by the materials of a scene file).
+		*/
+		virtual void addTexture(Texture* texture) = 0;
+
+		/**
+			Adds the intersections of ray with the objects of the scene (at the time of the ray). By default, it traverses the whole scene graph.
+		*/
+		virtual void intersect(Ray& ray) {
+			getRootNode().testCollision(ray, glm::mat4(1.0f));
+		}
 	};
 
 	/**
-		Implementation class for a IScene. This implementation makes use of the Singleton pattern, so only one Scene will be active at a time.
+		Implementation class for a IScene. instance() is the scene of the program (e.g. main.cpp), but other scenes can be created next to it (e.g. the
+		scenes a RenderServer keeps loaded, see SceneCache). A scene owns what is created in it: when it is destroyed, it deletes its objects (which must
+		have been created with new, and delete their geometry and material), its lights, its textures and its shading model.
 	*/
 	class ISceneManager: public IScene
 	{
-		unsigned int ID_seed;								//This keeps the next ID we will provide for a newly created object (we do not want ID duplicates)
-		std::map<unsigned int, IVirtualObject*> registry;	//Database with all the objects that exist in the scene. It allows us to quickly retrieve them by ID.
+		ObjectTable registry;								//Database with all the objects that exist in the scene. It gives them unique IDs and quickly retrieves them by ID (from any thread).
 		IShadingModel* shadingModel;						//Shading model to use. All objects are shaded in the same way
 		std::vector<ILight*> lights;						//Lights defined in the scene.
-		unsigned int assignNextValidID(){					//Assigns a valid ID to an object (It is called during object creation)
-			return ++ID_seed; //Increases value before returning--> It will never return INVALID_OBJECT_ID as an ID.
-		}
-		ISceneManager();									//Private constructor: Cannot be created directly --> This is part of the Singleton Pattern
+		std::vector<Texture*> textures;						//Textures handed over to the scene (see addTexture).
+		SceneBVH bvh;										//Acceleration structure (see buildBVH).
+		bool bvhValid;										//False until buildBVH is called, and after objects with geometry are added or removed.
+		IVirtualObject* root;								//Base node of the scene graph (the first object of the registry).
+		ISceneManager(const ISceneManager&);				//Not copyable.
+		ISceneManager& operator=(const ISceneManager&);
 	public:
+		ISceneManager();
 
 		//OWN METHODS: 
-		static ISceneManager& instance();					//Public method: Used to get the unique object	--> This is part of the Singleton pattern
+		static ISceneManager& instance();					//Public method: Used to get the scene of the program (created on first use).
 
-		inline void setShadingModel(IShadingModel* s) {
-			shadingModel = s;
-		}
+		/**
+			The scene takes ownership of s (the previous shading model is deleted).
+		*/
+		void setShadingModel(IShadingModel* s);
 
 		//METHODS INHERITED FROM THE INTERFACE: 
 		virtual IVirtualObject& getRootNode();				
 		virtual IVirtualObject& getNodeByID(unsigned int ID) {
-			return *(registry[ID]);
+			return *(registry.find(ID));
+		}
+
+		virtual IVirtualObject* findNodeByID(unsigned int ID) {
+			return registry.find(ID);
+		}
+
+		virtual void getObjects(std::vector<IVirtualObject*>& objects) {
+			registry.getObjects(objects);
 		}
 
 		virtual IShadingModel& getShadingModel() {
 			return *shadingModel;
 		}
 
-		virtual std::vector<ILight*> getLights() {
+		virtual const std::vector<ILight*>& getLights() {
 			return lights;
 		}
 
+		virtual void addTexture(Texture* texture) {
+			textures.push_back(texture);
+		}
+
+		/**
+			Builds the bounding volume hierarchy used by intersect, over all the objects in the scene graph. Call it once the scene is set up, and again
+			after moving objects (adding or removing objects with geometry disables it until it is built again; objects without geometry, e.g. cameras, do not).
+			@param timeSegments: See SceneBVH::build (0: chosen from the keyframes of moving objects).
+		*/
+		void buildBVH(int timeSegments = 0);
+
+		/**
+			Updates the hierarchy after objects moved, without building it again (see SceneBVH::refit), e.g. between the frames of an animation.
+			It is built instead if it is not valid (first call, or objects were added or removed).
+		*/
+		void refitBVH();
+
+		inline SceneBVH& getBVH() { return bvh; }
+
+		//Memory used by the registry of objects (see ObjectTable), e.g. for MemoryReport.
+		inline size_t getRegistryMemoryBytes() { return registry.getMemoryBytes(); }
+
+		virtual void intersect(Ray& ray) {
+			if (bvhValid)
+				bvh.intersect(ray);
+			else
+				IScene::intersect(ray);
+		}
+
 		~ISceneManager();
 	protected: 
 		virtual unsigned int registerVirtualObject(IVirtualObject* o) {
-			unsigned int ID = assignNextValidID();
-			registry[ID] = o;
+			unsigned int ID = registry.add(o);	//It will never return ROOT_OBJECT_ID after the root, nor reuse the ID of a deleted object.
+			if (o->hasGeometry())
+				bvhValid = false;
 			return ID;
 		}
 		virtual void deregisterVirtualObject(IVirtualObject* o) {
-			std::map<unsigned int, IVirtualObject*>::iterator it = registry.find(o->getID());
-			if (it != registry.end())
-				registry.erase(it);
+			registry.remove(o->getID());
+			//The hierarchy keeps pointers to the objects with geometry (and to the descendants of o, which are no longer in the scene graph).
+			if (o->hasGeometry() || o->getNumChildren() > 0)
+				bvhValid = false;
 		}
 		virtual void addLight(ILight* l) {
 			lights.push_back(l);
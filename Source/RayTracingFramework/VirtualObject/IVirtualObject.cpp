@@ -2,6 +2,7 @@
 #include "ISceneManager.h"
 #include <RayTracingFramework\Material.h>
 #include "RayTracingFramework\GeometricPrimitives\IGeometry.h"
+#include "RayTracingFramework\Profiling\Profiler.h"
 RayTracingFramework::IVirtualObject::IVirtualObject(IGeometry* _geometry, Material* _material, IScene& scene)
 	: scene(scene)
 	, ID(INVALID_OBJECT_ID)
@@ -10,6 +11,7 @@ RayTracingFramework::IVirtualObject::IVirtualObject(IGeometry* _geometry, Materi
 	, _fromParentToLocal(1.0f)
 	, _fromLocalToWorld(1.0f)								//Initialize to identity matrix
 	, _fromWorldToLocal(1.0f)
+	, _parentMoving(false)
 	, geometry(_geometry)
 	, material(_material)											//Default material.
 {
@@ -27,22 +29,54 @@ RayTracingFramework::IVirtualObject::IVirtualObject(IGeometry* _geometry, Materi
 void RayTracingFramework::IVirtualObject::addChild(RayTracingFramework::IVirtualObject* child) {
 	//0. notify the previous parent
 	if (child->getParentID()!=INVALID_OBJECT_ID){
-		IVirtualObject& old_parent = scene.getNodeByID(child->getParentID());
-		old_parent.removeChild(child);
+		IVirtualObject* old_parent = scene.findNodeByID(child->getParentID());
+		if (old_parent)//(it may have been deleted)
+			old_parent->removeChild(child);
 	}
 	//1. Add the children, and notify it that we are its new parent.
-	children[child->getID()] = child;
+	children.push_back(child);
 	child->_updateParentID(this->getID());
 	//2. Update world matrices (and propagate changes to sub-children):  
-	child->_updateParentWorldPosition(_fromLocalToWorld, _fromWorldToLocal);
+	child->_updateParentWorldPosition(toMatrix(_fromLocalToWorld), toMatrix(_fromWorldToLocal), isMoving());
 }
 
 void RayTracingFramework::IVirtualObject::testCollision(RayTracingFramework::Ray& ray, glm::mat4 fromWorldToParentCoordinates ) {
+	PROFILE_SCOPE("IVirtualObject::testCollision", getID());
 	//Test the collisions with the local primitive 
-	if(geometry) geometry->testLocalCollision(ray);
+	if (geometry) {
+		PROFILE_SCOPE("testLocalCollision", getID());
+		geometry->testLocalCollision(ray);
+	}
 	//Propagate message through all other children.
-	for (std::map<unsigned int, IVirtualObject*>::iterator it = children.begin(); it != children.end(); it++)
-		it->second->testCollision(ray, this->_fromParentToLocal*fromWorldToParentCoordinates);
+	for (size_t c = 0; c < children.size(); c++)
+		children[c]->testCollision(ray, toMatrix(this->_fromParentToLocal)*fromWorldToParentCoordinates);
+}
+
+void RayTracingFramework::IVirtualObject::setLocalToParentKeyframes(const std::vector<glm::mat4>& _keyframes) {
+	if (_keyframes.size() < 2) {
+		setLocalToParent(_keyframes.empty() ? toMatrix(fromLocalToParent) : _keyframes[0]);
+		return;
+	}
+	keyframes.assign(_keyframes.size(), StoredMatrix());
+	for (size_t k = 0; k < _keyframes.size(); k++)
+		keyframes[k] = toStoredMatrix(_keyframes[k]);
+	_setLocalToParent(_keyframes[0]);
+}
+
+glm::mat4 RayTracingFramework::IVirtualObject::getLocalToParent(float time) {
+	if (keyframes.empty())
+		return toMatrix(fromLocalToParent);
+	//Linear interpolation of the matrices of the two keyframes around time (points then move along straight lines between keyframes).
+	float position = glm::clamp(time, 0.0f, 1.0f) * (float)(keyframes.size() - 1);
+	int k = glm::min((int)position, (int)keyframes.size() - 2);
+	float blend = position - (float)k;
+	return toMatrix(keyframes[k]) * (1.0f - blend) + toMatrix(keyframes[k + 1]) * blend;
+}
+
+glm::mat4 RayTracingFramework::IVirtualObject::_getFromObjectToWorldCoordinates(float time) {
+	//Parents that do not move keep their precomputed matrix.
+	glm::mat4 parentToWorld = _parentMoving ? scene.getNodeByID(parent_ID).getFromObjectToWorldCoordinates(time) : toMatrix(_fromLocalToWorld) * toMatrix(_fromParentToLocal);
+	return parentToWorld * getLocalToParent(time);
 }
 
 RayTracingFramework::Material& RayTracingFramework::IVirtualObject::getMaterial() {
@@ -67,6 +101,9 @@ void RayTracingFramework::IVirtualObject::setGeometry(RayTracingFramework::IGeom
 
 RayTracingFramework::IVirtualObject::~IVirtualObject()
 {
+	IVirtualObject* parent = scene.findNodeByID(parent_ID);
+	if (parent)//Do not leave our parent pointing to a deleted child.
+		parent->removeChild(this);
 	scene.deregisterVirtualObject(this);
 	if (geometry) delete geometry;
 	if (material) delete material;
@@ -1,5 +1,7 @@
 #pragma once
 #include <RayTracingFramework\RayTracingPrerequisites.h>
+#include <RayTracingFramework\CompactStorage.h>
+#include <vector>
 
 namespace RayTracingFramework{
 	class Material;
@@ -12,11 +14,13 @@ namespace RayTracingFramework{
 		IScene& scene;
 		unsigned int ID;						//Unique identifier for the object. The SceneManager helps us get a unique identifier during the construction.
 		unsigned int parent_ID;					//Identifier of the parent. Defaults to Root node on creation, but it can change as we attach the object to different parts of the SceneGraph
-		glm::mat4 fromLocalToParent;			//Describes how to transform from local coordinates to parent's coordinates
-		glm::mat4 _fromParentToLocal;			//... this is the inverse of the above (it is generally a good idea to keep a pre-computed version, as this will be used a lot).
-		glm::mat4 _fromLocalToWorld;			//This describes how to transform from object coords to global world coordinates. It is the accumulated transformation of all the nodes above the current one (chained multiplication of all their local matrices). This object makes sure they are correctly maintained
-		glm::mat4 _fromWorldToLocal;			//... this is the inverse of the above (it is generally a good idea to keep a pre-computed version, as this will be used a lot).		
-		std::map<unsigned int, IVirtualObject*> children;	//Children of the local node.
+		StoredMatrix fromLocalToParent;			//Describes how to transform from local coordinates to parent's coordinates (see CompactStorage for the storage of the matrices).
+		StoredMatrix _fromParentToLocal;		//... this is the inverse of the above (it is generally a good idea to keep a pre-computed version, as this will be used a lot).
+		StoredMatrix _fromLocalToWorld;			//This describes how to transform from object coords to global world coordinates. It is the accumulated transformation of all the nodes above the current one (chained multiplication of all their local matrices). This object makes sure they are correctly maintained
+		StoredMatrix _fromWorldToLocal;			//... this is the inverse of the above (it is generally a good idea to keep a pre-computed version, as this will be used a lot).		
+		std::vector<IVirtualObject*> children;	//Children of the local node (contiguous, so traversals do not chase the nodes of a map).
+		std::vector<StoredMatrix> keyframes;	//Motion blur: fromLocalToParent at evenly spaced times of the shutter interval (empty if the node does not move).
+		bool _parentMoving;						//Whether any node above us has keyframes (so our world matrices depend on time too).
 
 		//COMPONENTS ATTACHED: Each component has a different functionality
 		Material* material;
@@ -43,7 +47,7 @@ namespace RayTracingFramework{
 			Transforms coordinates from local space to parent space ( glm::vec4 p_local_to_parent = Object.getLocalToParent() * p_local_to_O)
 		*/
 		inline glm::mat4 getLocalToParent(){
-			return fromLocalToParent;
+			return toMatrix(fromLocalToParent);
 		}
 
 		/**
@@ -53,25 +57,35 @@ namespace RayTracingFramework{
 			This method also updates transformations to/from world coordinates, and propagates changes to children.
 		*/
 		inline void setLocalToParent(glm::mat4 m){
-		
-			glm::mat4 prev_fromLocalToParent = fromLocalToParent, prev_fromParentToLocal = _fromParentToLocal;
-			//0. Compute the positions of our parent to/from world.
-			glm::mat4 parentToWorld = _fromLocalToWorld*prev_fromParentToLocal; 
-			glm::mat4 worldToParent = prev_fromLocalToParent*_fromWorldToLocal;
-			//1. Update local matrices. 
-			fromLocalToParent=m;
-			_fromParentToLocal = glm::inverse(m);
-			//2. Update world matrices (and propagate changes to children): 
-			_updateParentWorldPosition(parentToWorld, worldToParent); 
+			keyframes.clear();
+			_setLocalToParent(m);
 		}
 
-		
+		/**
+			Makes the object move during the shutter interval (motion blur): fromLocalToParent goes through the keyframes, evenly spaced over shutter times [0, 1]
+			(the first one at 0, the last one at 1), interpolated linearly in between. Time independent methods (e.g. getLocalToParent()) see the first keyframe.
+			Calling setLocalToParent (or passing less than 2 keyframes) makes it static again.
+		*/
+		void setLocalToParentKeyframes(const std::vector<glm::mat4>& keyframes);
+
+		inline int getNumKeyframes() { return (int)keyframes.size(); }
+
+		/**
+			True if this object (or any node above it) has keyframes, so that its position depends on time.
+		*/
+		inline bool isMoving() { return !keyframes.empty() || _parentMoving; }
+
+		/**
+			Position relative to the parent at a time of the shutter interval ([0, 1]).
+		*/
+		glm::mat4 getLocalToParent(float time);
+
 		/**
 			Return the current position/orientation of the parent, relative to this object.
 			Transforms coordinates from parent space to local space (e.g. glm::vec4 p_local_to_O = Object.getParentToLocal() * p_local_to_parent)
 		*/
 		inline glm::mat4 getParentToLocal(){
-			return _fromParentToLocal;
+			return toMatrix(_fromParentToLocal);
 		}
 
 		
@@ -80,7 +94,14 @@ namespace RayTracingFramework{
 			Transforms coordinates from world space to local space (e.g. glm::vec4 p_local_to_O = Object.getFromWorldToObjectCoordinates() * p_world)
 		*/
 		inline glm::mat4 getFromWorldToObjectCoordinates() {
-			return _fromWorldToLocal;
+			return toMatrix(_fromWorldToLocal);
+		}
+
+		/**
+			As above, at a time of the shutter interval ([0, 1], e.g. Ray::time). Static objects return the precomputed matrix.
+		*/
+		inline glm::mat4 getFromWorldToObjectCoordinates(float time) {
+			return isMoving() ? glm::inverse(getFromObjectToWorldCoordinates(time)) : toMatrix(_fromWorldToLocal);
 		}
 
 		
@@ -89,15 +110,26 @@ namespace RayTracingFramework{
 			Transforms coordinates from object space to world space (e.g. glm::vec4 p_world = Object.getFromObjectToWorldCoordinates() * p_local_to_O)
 		*/
 		inline glm::mat4 getFromObjectToWorldCoordinates() {
-			return _fromLocalToWorld;
+			return toMatrix(_fromLocalToWorld);
+		}
+
+		/**
+			As above, at a time of the shutter interval ([0, 1], e.g. Ray::time). Static objects return the precomputed matrix.
+		*/
+		inline glm::mat4 getFromObjectToWorldCoordinates(float time) {
+			return isMoving() ? _getFromObjectToWorldCoordinates(time) : toMatrix(_fromLocalToWorld);
 		}
 
 		Material& getMaterial();
 
+		inline bool hasMaterial() { return material != NULL; }
+
 		void setMaterial(Material* m);
 
 		IGeometry& getGeometry();
 
+		inline bool hasGeometry() { return geometry != NULL; }
+
 		void setGeometry(IGeometry* g);
 
 		/**
@@ -116,12 +148,14 @@ namespace RayTracingFramework{
 			Remove a child from the current object (if it exists). The child object is returned, so that the caller can re-use it (e.g. add it in another place of the scene)
 		*/
 		IVirtualObject* removeChild(unsigned int ID){
-			std::map<unsigned int, IVirtualObject*>::iterator it = children.find(ID); //Look for the children with that identifier
+			std::vector<IVirtualObject*>::iterator it = children.begin(); //Look for the children with that identifier
+			while (it != children.end() && (*it)->getID() != ID)
+				it++;
 			IVirtualObject* result = NULL; 
 			if (it != children.end()){//If found: 
-				result = it->second;	//we keep a pointer to it
-				children.erase(it);		//we remove it from our map (this does not delete the object).
-				result->_updateParentWorldPosition(glm::mat4(1.0f), glm::mat4(1.0f));//It is no-one's child now -> Update its world matrices (and propagate changes to sub-children):  
+				result = *it;			//we keep a pointer to it
+				children.erase(it);		//we remove it from our list (this does not delete the object).
+				result->_updateParentWorldPosition(glm::mat4(1.0f), glm::mat4(1.0f), false);//It is no-one's child now -> Update its world matrices (and propagate changes to sub-children):  
 				return result;			//we return the object.
 			}
 			return NULL;
@@ -132,20 +166,46 @@ namespace RayTracingFramework{
 		*/
 		inline IVirtualObject* removeChild(RayTracingFramework::IVirtualObject* o){ return removeChild(o->getID()); }
 
+		inline size_t getNumChildren() { return children.size(); }
+
+		/**
+			Memory used by the node itself (its matrices, keyframes and list of children), not by its components (see MemoryReport).
+		*/
+		inline size_t getMemoryBytes() {
+			return sizeof(IVirtualObject) + children.capacity() * sizeof(IVirtualObject*) + keyframes.capacity() * sizeof(StoredMatrix);
+		}
+
 
 	private: 
 		inline void _updateParentID(unsigned int newParent) {
 			parent_ID = newParent;
 		}
 
-		inline void _updateParentWorldPosition(glm::mat4 fromParentToWorld, glm::mat4 fromWorldToParent) {
+		inline void _setLocalToParent(glm::mat4 m) {
+			glm::mat4 prev_fromLocalToParent = toMatrix(fromLocalToParent), prev_fromParentToLocal = toMatrix(_fromParentToLocal);
+			//0. Compute the positions of our parent to/from world.
+			glm::mat4 parentToWorld = toMatrix(_fromLocalToWorld)*prev_fromParentToLocal; 
+			glm::mat4 worldToParent = prev_fromLocalToParent*toMatrix(_fromWorldToLocal);
+			//1. Update local matrices. 
+			fromLocalToParent = toStoredMatrix(m);
+			_fromParentToLocal = toStoredMatrix(glm::inverse(m));
+			//2. Update world matrices (and propagate changes to children): 
+			_updateParentWorldPosition(parentToWorld, worldToParent, _parentMoving); 
+		}
+
+		inline void _updateParentWorldPosition(glm::mat4 fromParentToWorld, glm::mat4 fromWorldToParent, bool parentMoving) {
 			//1. Update world matrices: 
-			_fromLocalToWorld = fromParentToWorld *fromLocalToParent;
-			_fromWorldToLocal = _fromParentToLocal * fromWorldToParent;
+			glm::mat4 localToWorld = fromParentToWorld * toMatrix(fromLocalToParent);
+			glm::mat4 worldToLocal = toMatrix(_fromParentToLocal) * fromWorldToParent;
+			_fromLocalToWorld = toStoredMatrix(localToWorld);
+			_fromWorldToLocal = toStoredMatrix(worldToLocal);
+			_parentMoving = parentMoving;
 			//3. Now, lets update our children (Our changes will also affect their matrices...)
-			for (std::map<unsigned int, IVirtualObject*>::iterator it = children.begin(); it != children.end(); it++)
-				it->second->_updateParentWorldPosition(_fromLocalToWorld, _fromWorldToLocal);
+			for (size_t c = 0; c < children.size(); c++)
+				children[c]->_updateParentWorldPosition(localToWorld, worldToLocal, isMoving());
 		}
+
+		glm::mat4 _getFromObjectToWorldCoordinates(float time);
 	};
 
 };
@@ -0,0 +1,75 @@
+#include "ObjectTable.h"
+#include "IVirtualObject.h"
+
+RayTracingFramework::ObjectTable::ObjectTable() : numSlots(0), numObjects(0) {
+	for (uint32_t c = 0; c < NUM_CHUNKS; c++)
+		chunks[c].store(NULL, std::memory_order_relaxed);
+}
+
+RayTracingFramework::ObjectTable::~ObjectTable() {
+	for (uint32_t c = 0; c < NUM_CHUNKS; c++)
+		delete[] chunks[c].load(std::memory_order_relaxed);
+}
+
+uint32_t RayTracingFramework::ObjectTable::add(IVirtualObject* object) {
+	std::lock_guard<std::mutex> lock(writeMutex);
+	uint32_t slot;
+	if (!freeSlots.empty()) {
+		slot = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else {
+		if (numSlots == MAX_OBJECTS)
+			return IVirtualObject::INVALID_OBJECT_ID;
+		slot = ++numSlots;	//Slot 0 is never used.
+		if (!chunks[slot >> CHUNK_BITS].load(std::memory_order_relaxed)) {
+			Slot* chunk = new Slot[CHUNK_SIZE];
+			for (uint32_t s = 0; s < CHUNK_SIZE; s++) {
+				chunk[s].ID.store(IVirtualObject::INVALID_OBJECT_ID, std::memory_order_relaxed);
+				chunk[s].object.store(NULL, std::memory_order_relaxed);
+				chunk[s].generation = 0;
+			}
+			chunks[slot >> CHUNK_BITS].store(chunk, std::memory_order_release);
+		}
+	}
+	Slot& entry = getSlotEntry(slot);
+	uint32_t ID = (entry.generation << SLOT_BITS) | slot;
+	entry.generation = (entry.generation + 1) & (0xFFFFFFFFu >> SLOT_BITS);
+	//The object is published before its ID, so readers that find the ID also see the object.
+	entry.object.store(object, std::memory_order_release);
+	entry.ID.store(ID, std::memory_order_release);
+	numObjects++;
+	return ID;
+}
+
+void RayTracingFramework::ObjectTable::remove(uint32_t ID) {
+	std::lock_guard<std::mutex> lock(writeMutex);
+	uint32_t slot = getSlot(ID);
+	if (slot == 0 || slot > numSlots)
+		return;
+	Slot& entry = getSlotEntry(slot);
+	if (entry.ID.load(std::memory_order_relaxed) != ID)
+		return;
+	entry.ID.store(IVirtualObject::INVALID_OBJECT_ID, std::memory_order_release);
+	entry.object.store(NULL, std::memory_order_release);
+	freeSlots.push_back(slot);
+	numObjects--;
+}
+
+size_t RayTracingFramework::ObjectTable::getMemoryBytes() {
+	std::lock_guard<std::mutex> lock(writeMutex);
+	size_t bytes = sizeof(ObjectTable) + freeSlots.capacity() * sizeof(uint32_t);
+	for (uint32_t c = 0; c < NUM_CHUNKS; c++)
+		if (chunks[c].load(std::memory_order_relaxed))
+			bytes += CHUNK_SIZE * sizeof(Slot);
+	return bytes;
+}
+
+void RayTracingFramework::ObjectTable::getObjects(std::vector<IVirtualObject*>& objects) {
+	std::lock_guard<std::mutex> lock(writeMutex);
+	for (uint32_t slot = 1; slot <= numSlots; slot++) {
+		IVirtualObject* object = getSlotEntry(slot).object.load(std::memory_order_relaxed);
+		if (object)
+			objects.push_back(object);
+	}
+}
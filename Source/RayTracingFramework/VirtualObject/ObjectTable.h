@@ -0,0 +1,91 @@
+/**
+	CLASS: ObjectTable
+	DESCRIPTION: Registry of the objects of a scene, indexed by their IDs (handles). An ID packs the slot of the object in a dense array (lower SLOT_BITS bits)
+	and the generation of the slot (upper bits). Slots of removed objects are reused by new ones with the next generation, so a stale ID (of a removed object)
+	does not find the object that took its slot (until the generations of the slot wrap around, after 256 reuses), and finding an object is just a few loads (no search, and unknown IDs are not inserted).
+	IDs fit in 32 bits (e.g. in hit records). Slot 0 is never used, so INVALID_OBJECT_ID (0) is never a valid ID, and the first object added gets ID 1 (root).
+	Slots are stored in chunks that are never moved or freed while the table exists, so find can be called from any number of threads without locks, even
+	while objects are added or removed (adding/removing takes a lock). Readers must not use an object after it has been destroyed, though.
+*/
+#ifndef _OBJECTTABLE_RAYTRACINGFRAMEWORK
+#define _OBJECTTABLE_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace RayTracingFramework{
+	class ObjectTable
+	{
+	public:
+		static const int SLOT_BITS = 24;
+		static const uint32_t SLOT_MASK = (1u << SLOT_BITS) - 1;
+		static const uint32_t MAX_OBJECTS = SLOT_MASK;		//Slots 1..SLOT_MASK.
+
+		ObjectTable();
+		~ObjectTable();
+
+		/**
+			Adds an object, returning its ID (INVALID_OBJECT_ID if the table is full).
+		*/
+		uint32_t add(IVirtualObject* object);
+
+		/**
+			Removes the object with ID (if it exists). Its ID becomes stale.
+		*/
+		void remove(uint32_t ID);
+
+		/**
+			Object with ID, or NULL if there is none (unknown, invalid or stale ID).
+		*/
+		inline IVirtualObject* find(uint32_t ID) {
+			uint32_t slot = ID & SLOT_MASK;
+			Slot* chunk = chunks[slot >> CHUNK_BITS].load(std::memory_order_acquire);
+			if (!chunk)
+				return NULL;
+			Slot& entry = chunk[slot & CHUNK_MASK];
+			if (entry.ID.load(std::memory_order_acquire) != ID)
+				return NULL;
+			IVirtualObject* object = entry.object.load(std::memory_order_acquire);
+			//The slot may have been emptied (and even reused) in the meantime: IDs are cleared before objects are replaced.
+			return (entry.ID.load(std::memory_order_relaxed) == ID) ? object : NULL;
+		}
+
+		inline uint32_t getNumObjects() { return numObjects; }
+
+		/**
+			Appends the objects in the table to objects, in slot order.
+		*/
+		void getObjects(std::vector<IVirtualObject*>& objects);
+
+		/**
+			Memory used by the table (its chunks of slots), not by the objects.
+		*/
+		size_t getMemoryBytes();
+
+		static inline uint32_t getSlot(uint32_t ID) { return ID & SLOT_MASK; }
+		static inline uint32_t getGeneration(uint32_t ID) { return ID >> SLOT_BITS; }
+
+	private:
+		static const int CHUNK_BITS = 12;
+		static const uint32_t CHUNK_SIZE = 1u << CHUNK_BITS;
+		static const uint32_t CHUNK_MASK = CHUNK_SIZE - 1;
+		static const uint32_t NUM_CHUNKS = (SLOT_MASK >> CHUNK_BITS) + 1;
+
+		struct Slot {
+			std::atomic<uint32_t> ID;				//ID of the object in the slot (INVALID_OBJECT_ID if empty).
+			std::atomic<IVirtualObject*> object;
+			uint32_t generation;					//Generation of the next object in the slot.
+		};
+
+		std::atomic<Slot*> chunks[NUM_CHUNKS];
+		std::mutex writeMutex;						//Serializes add/remove.
+		uint32_t numSlots;							//Slots in use or freed so far (slots 1..numSlots).
+		uint32_t numObjects;
+		std::vector<uint32_t> freeSlots;
+
+		inline Slot& getSlotEntry(uint32_t slot) { return chunks[slot >> CHUNK_BITS].load(std::memory_order_relaxed)[slot & CHUNK_MASK]; }
+	};
+};
+#endif
@@ -0,0 +1,224 @@
+#include "SceneBVH.h"
+#include "IVirtualObject.h"
+#include "RayTracingFramework\Ray.h"
+#include "RayTracingFramework\GeometricPrimitives\IGeometry.h"
+#include "RayTracingFramework\Profiling\Profiler.h"
+#include <algorithm>
+#include <cmath>
+
+RayTracingFramework::SceneBVH::SceneBVH()
+	: numBoundedObjects(0)
+{
+	;
+}
+
+void RayTracingFramework::SceneBVH::clear() {
+	segments.clear();
+	unboundedObjects.clear();
+	numBoundedObjects = 0;
+}
+
+void RayTracingFramework::SceneBVH::getWorldBounds(IVirtualObject& object, glm::vec3 localMinimum, glm::vec3 localMaximum, float startTime, float endTime, glm::vec3& minimum, glm::vec3& maximum) {
+	//Box around the transformed local box at several times of [startTime, endTime]. Between keyframes, matrices are interpolated linearly, so the
+	//corners move along straight lines: the boxes at the ends of the segment and at every keyframe inside it bound the whole motion. Objects moved by
+	//several levels of the scene graph do not move linearly: they are sampled more densely.
+	std::vector<float> times;
+	times.push_back(startTime);
+	times.push_back(endTime);
+	if (object.isMoving()) {
+		int keyframes = object.getNumKeyframes();
+		for (int k = 1; k < keyframes - 1; k++) {
+			float time = (float)k / (float)(keyframes - 1);
+			if (time > startTime && time < endTime)
+				times.push_back(time);
+		}
+		const int SAMPLES = 8;
+		for (int s = 1; s < SAMPLES; s++)
+			times.push_back(startTime + (endTime - startTime) * (float)s / (float)SAMPLES);
+	}
+	minimum = glm::vec3(FLT_MAX);
+	maximum = glm::vec3(-FLT_MAX);
+	for (size_t t = 0; t < times.size(); t++) {
+		glm::mat4 toWorld = object.getFromObjectToWorldCoordinates(times[t]);
+		for (int corner = 0; corner < 8; corner++) {
+			glm::vec4 p((corner & 1) ? localMaximum.x : localMinimum.x, (corner & 2) ? localMaximum.y : localMinimum.y, (corner & 4) ? localMaximum.z : localMinimum.z, 1);
+			glm::vec3 q(toWorld * p);
+			minimum = glm::min(minimum, q);
+			maximum = glm::max(maximum, q);
+		}
+		if (!object.isMoving())
+			break;//Same box at all times.
+	}
+	//Primitives find hits a little outside their bounds (rounding of their own tests, e.g. on faces hit at grazing angles): pad the box so they are not culled.
+	glm::vec3 padding = 1e-4f * (maximum - minimum) + glm::vec3(1e-4f);
+	minimum -= padding;
+	maximum += padding;
+}
+
+void RayTracingFramework::SceneBVH::build(const std::vector<IVirtualObject*>& objects, int timeSegments) {
+	clear();
+	//Objects with bounds go in the hierarchy; the rest are always tested.
+	std::vector<IVirtualObject*> bounded;
+	std::vector<glm::vec3> localMinimums, localMaximums;
+	int maxKeyframes = 1;
+	for (size_t o = 0; o < objects.size(); o++) {
+		IVirtualObject* object = objects[o];
+		if (!object->hasGeometry())
+			continue;
+		glm::vec3 minimum, maximum;
+		if (!object->getGeometry().getLocalBounds(minimum, maximum)) {
+			unboundedObjects.push_back(object);
+			continue;
+		}
+		bounded.push_back(object);
+		localMinimums.push_back(minimum);
+		localMaximums.push_back(maximum);
+		if (object->isMoving())
+			maxKeyframes = std::max(maxKeyframes, std::max(object->getNumKeyframes(), 2));
+	}
+	numBoundedObjects = (int)bounded.size();
+	//By default, one segment per interval between keyframes (motion within a segment is then linear, and its boxes tight).
+	if (timeSegments <= 0)
+		timeSegments = maxKeyframes - 1;
+	timeSegments = glm::clamp(timeSegments, 1, (int)MAX_TIME_SEGMENTS);
+	segments.resize(timeSegments);
+	if (bounded.empty())
+		return;
+	std::vector<glm::vec3> minimums(bounded.size()), maximums(bounded.size());
+	std::vector<int> order(bounded.size());
+	for (int s = 0; s < timeSegments; s++) {
+		Segment& segment = segments[s];
+		float startTime = (float)s / (float)timeSegments, endTime = (float)(s + 1) / (float)timeSegments;
+		for (size_t o = 0; o < bounded.size(); o++) {
+			getWorldBounds(*bounded[o], localMinimums[o], localMaximums[o], startTime, endTime, minimums[o], maximums[o]);
+			order[o] = (int)o;
+		}
+		Node root = { StoredBox(), 0, (int)bounded.size() };
+		segment.nodes.push_back(root);
+		subdivide(segment, 0, minimums, maximums, order);
+		segment.objects.resize(bounded.size());
+		for (size_t o = 0; o < bounded.size(); o++)
+			segment.objects[o] = bounded[order[o]];
+	}
+}
+
+bool RayTracingFramework::SceneBVH::refit() {
+	PROFILE_SCOPE("SceneBVH::refit");
+	if (segments.empty() || segments[0].objects.empty())
+		return true;
+	//Every segment holds the same objects (in different orders).
+	glm::vec3 localMinimum, localMaximum;
+	for (size_t o = 0; o < segments[0].objects.size(); o++)
+		if (!segments[0].objects[o]->getGeometry().getLocalBounds(localMinimum, localMaximum))
+			return false;
+	//Boxes are computed in full precision, and only stored once the box of the root (the quantisation grid) is known.
+	std::vector<glm::vec3> minimums, maximums;
+	for (size_t s = 0; s < segments.size(); s++) {
+		Segment& segment = segments[s];
+		float startTime = (float)s / (float)segments.size(), endTime = (float)(s + 1) / (float)segments.size();
+		minimums.assign(segment.nodes.size(), glm::vec3(FLT_MAX));
+		maximums.assign(segment.nodes.size(), glm::vec3(-FLT_MAX));
+		//Children always follow their parent, so going backwards updates them before it.
+		for (int n = (int)segment.nodes.size() - 1; n >= 0; n--) {
+			const Node& node = segment.nodes[n];
+			if (node.count > 0) {
+				for (int i = node.first; i < node.first + node.count; i++) {
+					glm::vec3 minimum, maximum;
+					segment.objects[i]->getGeometry().getLocalBounds(localMinimum, localMaximum);
+					getWorldBounds(*segment.objects[i], localMinimum, localMaximum, startTime, endTime, minimum, maximum);
+					minimums[n] = glm::min(minimums[n], minimum);
+					maximums[n] = glm::max(maximums[n], maximum);
+				}
+			}
+			else {
+				minimums[n] = glm::min(minimums[node.first], minimums[node.first + 1]);
+				maximums[n] = glm::max(maximums[node.first], maximums[node.first + 1]);
+			}
+		}
+		segment.grid.set(minimums[0], maximums[0]);
+		for (size_t n = 0; n < segment.nodes.size(); n++)
+			segment.nodes[n].box.set(minimums[n], maximums[n], segment.grid);
+	}
+	return true;
+}
+
+size_t RayTracingFramework::SceneBVH::getMemoryBytes() {
+	size_t bytes = sizeof(SceneBVH) + segments.capacity() * sizeof(Segment) + unboundedObjects.capacity() * sizeof(IVirtualObject*);
+	for (size_t s = 0; s < segments.size(); s++)
+		bytes += segments[s].nodes.capacity() * sizeof(Node) + segments[s].objects.capacity() * sizeof(IVirtualObject*);
+	return bytes;
+}
+
+void RayTracingFramework::SceneBVH::subdivide(Segment& segment, int node, std::vector<glm::vec3>& minimums, std::vector<glm::vec3>& maximums, std::vector<int>& order) {
+	int first = segment.nodes[node].first, count = segment.nodes[node].count;
+	glm::vec3 minimum(FLT_MAX), maximum(-FLT_MAX);
+	for (int i = first; i < first + count; i++) {
+		minimum = glm::min(minimum, minimums[order[i]]);
+		maximum = glm::max(maximum, maximums[order[i]]);
+	}
+	if (node == 0)
+		segment.grid.set(minimum, maximum);
+	segment.nodes[node].box.set(minimum, maximum, segment.grid);
+	if (count <= 2)
+		return;
+	//Split at the median box centre along the longest axis.
+	glm::vec3 extent = maximum - minimum;
+	int axis = (extent.x > extent.y && extent.x > extent.z) ? 0 : (extent.y > extent.z ? 1 : 2);
+	int half = count / 2;
+	std::nth_element(order.begin() + first, order.begin() + first + half, order.begin() + first + count,
+		[&minimums, &maximums, axis](int a, int b) { return minimums[a][axis] + maximums[a][axis] < minimums[b][axis] + maximums[b][axis]; });
+	int left = (int)segment.nodes.size();
+	Node children[2] = { { StoredBox(), first, half }, { StoredBox(), first + half, count - half } };
+	segment.nodes.push_back(children[0]);
+	segment.nodes.push_back(children[1]);
+	segment.nodes[node].first = left;
+	segment.nodes[node].count = 0;
+	subdivide(segment, left, minimums, maximums, order);
+	subdivide(segment, left + 1, minimums, maximums, order);
+}
+
+bool RayTracingFramework::SceneBVH::hitsBox(const Node& node, const BoxGrid& grid, glm::vec3 origin, glm::vec3 inverseDirection, float tMax) {
+	glm::vec3 t0 = (node.box.getMinimum(grid) - origin) * inverseDirection;
+	glm::vec3 t1 = (node.box.getMaximum(grid) - origin) * inverseDirection;
+	glm::vec3 tSmall = glm::min(t0, t1), tBig = glm::max(t0, t1);
+	//The whole line is tested, not just t >= 0: geometries report intersections behind the origin too (as graph traversal finds them).
+	float tNear = std::max(std::max(tSmall.x, tSmall.y), tSmall.z);
+	float tFar = std::min(std::min(tBig.x, tBig.y), std::min(tBig.z, tMax));
+	return tNear <= tFar;
+}
+
+void RayTracingFramework::SceneBVH::intersect(Ray& ray) {
+	PROFILE_SCOPE("SceneBVH::intersect");
+	for (size_t o = 0; o < unboundedObjects.size(); o++) {
+		PROFILE_SCOPE("testLocalCollision", unboundedObjects[o]->getID());
+		unboundedObjects[o]->getGeometry().testLocalCollision(ray);
+	}
+	if (segments.empty() || segments[0].nodes.empty())
+		return;
+	int s = glm::clamp((int)(ray.time * (float)segments.size()), 0, (int)segments.size() - 1);
+	Segment& segment = segments[s];
+	//Distances are measured along the unit direction (as the geometries do).
+	glm::vec3 origin(ray.origin_InWorldCoords), direction(glm::normalize(glm::vec3(ray.direction_InWorldCoords)));
+	glm::vec3 inverseDirection;
+	for (int axis = 0; axis < 3; axis++)
+		inverseDirection[axis] = 1.0f / ((std::abs(direction[axis]) > 1e-20f) ? direction[axis] : 1e-20f);
+	int stack[64];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0) {
+		const Node& node = segment.nodes[stack[--top]];
+		//All intersections are collected (transparency needs them), but once the ray keeps as many as it can, further boxes cannot add any.
+		float tMax = (ray.numIntersections == Ray::MAX_INTERSECTIONS) ? ray.intersections[Ray::MAX_INTERSECTIONS - 1].t_distance : FLT_MAX;
+		if (!hitsBox(node, segment.grid, origin, inverseDirection, tMax))
+			continue;
+		if (node.count > 0) {
+			for (int i = node.first; i < node.first + node.count; i++) {
+				PROFILE_SCOPE("testLocalCollision", segment.objects[i]->getID());
+				segment.objects[i]->getGeometry().testLocalCollision(ray);
+			}
+			continue;
+		}
+		stack[top++] = node.first + 1;
+		stack[top++] = node.first;
+	}
+}
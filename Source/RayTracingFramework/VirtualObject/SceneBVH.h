@@ -0,0 +1,76 @@
+/**
+	CLASS: SceneBVH
+	DESCRIPTION: Bounding volume hierarchy over the objects of a scene, so that a ray only tests the objects whose box it crosses (instead of every object in
+	the scene graph). Objects without bounds (e.g. planes) are tested by every ray.
+	Motion blur: the shutter interval is split into time segments, each with its own hierarchy, whose boxes only bound the motion of the objects during
+	that segment (not the whole swept volume). A ray traverses the hierarchy of the segment containing its time.
+	The hierarchy is a snapshot: it must be built again after objects are added or removed. After objects move (or their geometry changes), refit is enough
+	(boxes are recomputed but the tree is kept, so it is only as good as it was for the original positions: build it again after large changes).
+*/
+#ifndef _SCENEBVH_RAYTRACINGFRAMEWORK
+#define _SCENEBVH_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include <RayTracingFramework\CompactStorage.h>
+#include <vector>
+
+namespace RayTracingFramework{
+	class SceneBVH
+	{
+	public:
+		static const int MAX_TIME_SEGMENTS = 16;
+
+		SceneBVH();
+
+		/**
+			Builds the hierarchy over objects (those without geometry are ignored).
+			@param timeSegments: Number of time segments (1 for static scenes). 0 chooses it from the keyframes of the moving objects.
+		*/
+		void build(const std::vector<IVirtualObject*>& objects, int timeSegments = 0);
+
+		void clear();
+
+		/**
+			Recomputes the boxes of the hierarchy for the current positions (and keyframes) of its objects, keeping its structure and number of time segments.
+			Returns false (and leaves the hierarchy unchanged) if an object lost its bounds, in which case it must be built again.
+		*/
+		bool refit();
+
+		/**
+			Adds the intersections of ray (at its time) with the objects of the hierarchy, as IVirtualObject::testCollision does.
+		*/
+		void intersect(Ray& ray);
+
+		inline int getNumTimeSegments() { return (int)segments.size(); }
+		inline int getNumBoundedObjects() { return numBoundedObjects; }
+		inline int getNumUnboundedObjects() { return (int)unboundedObjects.size(); }
+
+		/**
+			Memory used by the hierarchy (nodes and object lists of all the time segments).
+		*/
+		size_t getMemoryBytes();
+
+		/**
+			World box around the local box of object during [startTime, endTime] (padded a little, as primitives find hits slightly outside their bounds).
+		*/
+		static void getWorldBounds(IVirtualObject& object, glm::vec3 localMinimum, glm::vec3 localMaximum, float startTime, float endTime, glm::vec3& minimum, glm::vec3& maximum);
+
+	private:
+		struct Node {
+			StoredBox box;	//Quantised in compact storage (see CompactStorage).
+			int first;		//Leaf: first object (in Segment::objects). Inner node: first child (the second one follows it).
+			int count;		//Objects of a leaf (0 for inner nodes).
+		};
+		struct Segment {
+			std::vector<Node> nodes;
+			std::vector<IVirtualObject*> objects;
+			BoxGrid grid;	//Quantisation of the boxes (the box of the root).
+		};
+		std::vector<Segment> segments;
+		std::vector<IVirtualObject*> unboundedObjects;
+		int numBoundedObjects;
+
+		void subdivide(Segment& segment, int node, std::vector<glm::vec3>& minimums, std::vector<glm::vec3>& maximums, std::vector<int>& order);
+		static bool hitsBox(const Node& node, const BoxGrid& grid, glm::vec3 origin, glm::vec3 inverseDirection, float tMax);
+	};
+};
+#endif
@@ -0,0 +1,96 @@
+#include "SceneCache.h"
+#include "RayTracingFramework\Profiling\MemoryReport.h"
+#include "RayTracingFramework\Profiling\Profiler.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+
+RayTracingFramework::SceneCache::SceneCache(size_t memoryBudget)
+	: memoryBudget(memoryBudget)
+	, residentBytes(0)
+	, numLoads(0)
+	, numHits(0)
+	, numEvictions(0)
+{
+	;
+}
+
+void RayTracingFramework::SceneCache::setMemoryBudget(size_t memoryBudget) {
+	std::lock_guard<std::mutex> lock(mutex);
+	this->memoryBudget = memoryBudget;
+	evict();
+}
+
+void RayTracingFramework::SceneCache::clear() {
+	std::lock_guard<std::mutex> lock(mutex);
+	entries.clear();
+	residentScenes.clear();
+	residentBytes = 0;
+}
+
+time_t RayTracingFramework::SceneCache::getModificationTime(const std::string& fileName) {
+	struct stat status;
+	if (stat(fileName.c_str(), &status) != 0)
+		return 0;
+	return status.st_mtime;
+}
+
+RayTracingFramework::SceneCache::ScenePointer RayTracingFramework::SceneCache::get(const std::string& fileName, std::string* error, bool* wasResident) {
+	time_t modificationTime = getModificationTime(fileName);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::unordered_map<std::string, std::list<ScenePointer>::iterator>::iterator found = residentScenes.find(fileName);
+		if (found != residentScenes.end() && (*found->second)->modificationTime == modificationTime) {
+			//Hit: move it to the front of the list.
+			entries.splice(entries.begin(), entries, found->second);
+			numHits++;
+			if (wasResident) *wasResident = true;
+			return *found->second;
+		}
+		if (found != residentScenes.end())
+			remove(found->second);//The file changed.
+	}
+	if (wasResident) *wasResident = false;
+
+	//Miss: load the scene and build its hierarchy (without holding the lock, other threads may use the cache meanwhile).
+	ScenePointer cached(new CachedScene());
+	{
+		PROFILE_SCOPE("SceneCache::load");
+		if (!SceneFile::load(fileName.c_str(), cached->scene, cached->settings, error))
+			return ScenePointer();
+		cached->scene.buildBVH();
+	}
+	cached->fileName = fileName;
+	cached->modificationTime = modificationTime;
+	MemoryReport memoryReport;
+	memoryReport.addScene(cached->scene);
+	cached->bytes = sizeof(CachedScene) + memoryReport.getTotalBytes();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	std::unordered_map<std::string, std::list<ScenePointer>::iterator>::iterator found = residentScenes.find(fileName);
+	if (found != residentScenes.end() && (*found->second)->modificationTime == modificationTime) {
+		entries.splice(entries.begin(), entries, found->second);
+		return *found->second;//Loaded twice (by two threads): keep the first one.
+	}
+	if (found != residentScenes.end())
+		remove(found->second);
+	entries.push_front(cached);
+	residentScenes[fileName] = entries.begin();
+	residentBytes += cached->bytes;
+	numLoads++;
+	evict();
+	return cached;
+}
+
+void RayTracingFramework::SceneCache::remove(std::list<ScenePointer>::iterator entry) {
+	residentBytes -= (*entry)->bytes;
+	residentScenes.erase((*entry)->fileName);
+	entries.erase(entry);
+}
+
+void RayTracingFramework::SceneCache::evict() {
+	//Drop the least recently used scenes until we are within budget (always keeping the most recent one).
+	while (residentBytes > memoryBudget && entries.size() > 1) {
+		remove(--entries.end());
+		numEvictions++;
+	}
+}
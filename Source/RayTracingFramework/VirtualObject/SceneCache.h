@@ -0,0 +1,75 @@
+/**
+	CLASS: SceneCache
+	DESCRIPTION: Keeps the most recently used scene files loaded (each in its own ISceneManager, with its bounding volume hierarchy built), within a fixed
+	memory budget, so that a long-running process (see RenderServer) only loads and builds a scene the first time it is asked for it, instead of once per
+	render. The memory of a scene is measured with MemoryReport. When the budget is exceeded, the least recently used scenes are evicted (and loaded again
+	if they are needed later). A scene file modified since it was loaded is loaded again. Scenes are handed out as shared pointers: a scene evicted while
+	another thread is still rendering it is deleted when that thread is done with it.
+*/
+#ifndef _SCENECACHE_RAYTRACINGFRAMEWORK
+#define _SCENECACHE_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include "ISceneManager.h"
+#include "SceneFile.h"
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <ctime>
+
+namespace RayTracingFramework{
+	class SceneCache
+	{
+	public:
+		//A loaded scene file. Cameras created in the scene (without geometry) do not invalidate its hierarchy, but they must be deleted after use.
+		struct CachedScene {
+			ISceneManager scene;
+			SceneFile::Settings settings;
+			std::string fileName;
+			time_t modificationTime;
+			size_t bytes;
+		};
+		typedef std::shared_ptr<CachedScene> ScenePointer;
+
+		/**
+			@param memoryBudget: Maximum memory (in bytes) used by resident scenes (the most recent scene is always kept, even if bigger).
+		*/
+		SceneCache(size_t memoryBudget = 1024 * 1024 * 1024);
+
+		/**
+			Changes the memory budget, evicting scenes if needed.
+		*/
+		void setMemoryBudget(size_t memoryBudget);
+
+		/**
+			Returns the scene of fileName (marking it as the most recently used), loading it if it is not resident (or if the file changed since).
+			Returns null if it cannot be loaded (see SceneFile::load).
+			@param wasResident: Set to whether the scene was found in the cache.
+		*/
+		ScenePointer get(const std::string& fileName, std::string* error = NULL, bool* wasResident = NULL);
+
+		/**
+			Drops all resident scenes.
+		*/
+		void clear();
+
+		inline size_t getResidentBytes() { return residentBytes; }
+		inline size_t getNumResidentScenes() { return entries.size(); }
+		inline unsigned long long getNumLoads() { return numLoads; }
+		inline unsigned long long getNumHits() { return numHits; }
+		inline unsigned long long getNumEvictions() { return numEvictions; }
+
+	private:
+		std::list<ScenePointer> entries;		//From most to least recently used.
+		std::unordered_map<std::string, std::list<ScenePointer>::iterator> residentScenes;
+		size_t memoryBudget, residentBytes;
+		unsigned long long numLoads, numHits, numEvictions;
+		std::mutex mutex;
+
+		void remove(std::list<ScenePointer>::iterator entry);
+		void evict();
+		static time_t getModificationTime(const std::string& fileName);
+	};
+};
+#endif
@@ -0,0 +1,180 @@
+#include "SceneFile.h"
+#include "ISceneManager.h"
+#include "IVirtualObject.h"
+#include "Animation.h"
+#include "RayTracingFramework\Material.h"
+#include "RayTracingFramework\GeometricPrimitives\IGeometry.h"
+#include "RayTracingFramework\GeometricPrimitives\Plane.h"
+#include "RayTracingFramework\GeometricPrimitives\ISphere.h"
+#include "RayTracingFramework\GeometricPrimitives\ITriangle.h"
+#include "RayTracingFramework\GeometricPrimitives\Box.h"
+#include "RayTracingFramework\Light\DirectionalLight.h"
+#include "RayTracingFramework\Textures\Texture.h"
+#include <fstream>
+#include <sstream>
+#include <map>
+
+namespace {
+	bool readVector(std::istringstream& line, glm::vec3& v) {
+		return (bool)(line >> v.x >> v.y >> v.z);
+	}
+
+	//Reads the optional transforms at the end of a statement. Returns false on unknown/incomplete ones.
+	bool readTransforms(std::istringstream& line, glm::mat4& transform, float* textureSize = NULL) {
+		std::string keyword;
+		while (line >> keyword) {
+			glm::vec3 v;
+			float value;
+			if (keyword == "translate" && readVector(line, v))
+				transform = glm::translate(transform, v);
+			else if (keyword == "rotate" && (line >> value) && readVector(line, v))
+				transform = glm::rotate(transform, glm::radians(value), v);
+			else if (keyword == "scale" && readVector(line, v))
+				transform = glm::scale(transform, v);
+			else if (keyword == "textureSize" && textureSize && (line >> value))
+				*textureSize = value;
+			else
+				return false;
+		}
+		return true;
+	}
+
+	bool readMaterial(std::istringstream& line, RayTracingFramework::Material& m, RayTracingFramework::IScene& scene) {
+		std::string keyword;
+		while (line >> keyword) {
+			glm::vec3 v;
+			std::string fileName;
+			bool ok = true;
+			if (keyword == "Ka") ok = (bool)(line >> m.K_a);
+			else if (keyword == "Kd") ok = (bool)(line >> m.K_d);
+			else if (keyword == "Ks") ok = (bool)(line >> m.K_s);
+			else if (keyword == "Kr") ok = (bool)(line >> m.K_r);
+			else if (keyword == "Kt") ok = (bool)(line >> m.K_t);
+			else if (keyword == "shininess") ok = (bool)(line >> m.shininess);
+			else if (keyword == "ior") ok = (bool)(line >> m.refractiveIndex);
+			else if (keyword == "diffuse" && (ok = readVector(line, v))) m.diffuseColour = v;
+			else if (keyword == "specular" && (ok = readVector(line, v))) m.specularColour = v;
+			else if (keyword == "emissive" && (ok = readVector(line, v))) m.emissiveColour = v;
+			else if ((keyword == "diffuseTexture" || keyword == "specularTexture") && (ok = (bool)(line >> fileName))) {
+				RayTracingFramework::Texture* texture = new RayTracingFramework::Texture(fileName.c_str());
+				if (!texture->isValid()) {
+					delete texture;
+					return false;
+				}
+				scene.addTexture(texture);	//Shared by the copies of the material: it lives as long as the scene.
+				(keyword == "diffuseTexture" ? m.diffuseTexture : m.specularTexture) = texture;
+			}
+			else
+				return false;
+			if (!ok)
+				return false;
+		}
+		return true;
+	}
+}
+
+bool RayTracingFramework::SceneFile::load(const char* fileName, IScene& scene, Settings& settings, std::string* error, Animation* animation) {
+	std::ifstream file(fileName);
+	if (!file) {
+		if (error) *error = std::string("Cannot open ") + fileName;
+		return false;
+	}
+	std::map<std::string, Material> materials;
+	std::string text;
+	int lineNumber = 0;
+	//Target of key statements: the last object, or the camera (keyCamera).
+	IVirtualObject* keyObject = NULL;
+	bool keyCamera = false;
+	while (std::getline(file, text)) {
+		lineNumber++;
+		size_t comment = text.find('#');
+		if (comment != std::string::npos)
+			text.erase(comment);
+		std::istringstream line(text);
+		std::string statement;
+		if (!(line >> statement))
+			continue;//Empty line.
+
+		bool ok = true;
+		IGeometry* geometry = NULL;
+		std::string materialName;
+		glm::mat4 transform(1.0f);
+		glm::vec3 a, b, c;
+		if (statement == "image")
+			ok = (bool)(line >> settings.width >> settings.height) && settings.width > 0 && settings.height > 0;
+		else if (statement == "camera") {
+			ok = (bool)(line >> settings.top >> settings.bottom >> settings.left >> settings.right >> settings.nearPlane >> settings.farPlane);
+			ok = ok && readTransforms(line, settings.cameraToWorld);
+			keyCamera = true;
+			keyObject = NULL;
+		}
+		else if (statement == "key") {
+			float frame;
+			ok = (line >> frame) && readTransforms(line, transform) && (keyCamera || keyObject);
+			if (ok && keyCamera) {
+				settings.cameraKeyFrames.push_back(frame);
+				settings.cameraKeys.push_back(transform);
+			}
+			else if (ok && animation)
+				animation->addKey(*keyObject, frame, transform);
+		}
+		else if (statement == "material") {
+			Material m;
+			ok = (line >> materialName) && readMaterial(line, m, scene);
+			if (ok)
+				materials[materialName] = m;
+		}
+		else if (statement == "directionalLight") {
+			std::string keyword;
+			Colour colour(1, 1, 1);
+			float angularRadius = 0;
+			ok = readVector(line, a);
+			while (ok && (line >> keyword)) {
+				if (keyword == "colour") ok = readVector(line, colour);
+				else if (keyword == "angularRadius") ok = (bool)(line >> angularRadius);
+				else ok = false;
+			}
+			if (ok)
+				new DirectionalLight(scene, glm::vec4(glm::normalize(a), 0.0f), colour, glm::radians(angularRadius));
+		}
+		else if (statement == "sphere") {
+			float radius;
+			ok = (line >> radius >> materialName) && readTransforms(line, transform);
+			if (ok) geometry = new ISphere(radius);
+		}
+		else if (statement == "plane") {
+			float textureSize = 1.0f;
+			ok = readVector(line, a) && readVector(line, b) && (line >> materialName) && readTransforms(line, transform, &textureSize);
+			if (ok) geometry = new Plane(glm::vec4(a, 1), glm::vec4(glm::normalize(b), 0), textureSize);
+		}
+		else if (statement == "triangle") {
+			//Vertices are directions from the origin of the object (w = 0), as in the scene of main.cpp.
+			ok = readVector(line, a) && readVector(line, b) && readVector(line, c) && (line >> materialName) && readTransforms(line, transform);
+			if (ok) geometry = new ITriangle(glm::vec4(a, 0), glm::vec4(b, 0), glm::vec4(c, 0));
+		}
+		else if (statement == "box") {
+			ok = readVector(line, a) && readVector(line, b) && (line >> materialName) && readTransforms(line, transform);
+			if (ok) geometry = new Box(glm::vec4(a, 1), glm::vec4(b, 1));
+		}
+		else
+			ok = false;
+
+		if (ok && geometry) {
+			std::map<std::string, Material>::iterator material = materials.find(materialName);
+			if (material == materials.end()) {
+				delete geometry;
+				if (error) *error = "Line " + std::to_string(lineNumber) + ": unknown material " + materialName;
+				return false;
+			}
+			IVirtualObject* object = new IVirtualObject(geometry, new Material(material->second), scene);
+			object->setLocalToParent(transform);
+			keyObject = object;
+			keyCamera = false;
+		}
+		if (!ok) {
+			if (error) *error = "Line " + std::to_string(lineNumber) + ": cannot parse '" + text + "'";
+			return false;
+		}
+	}
+	return true;
+}
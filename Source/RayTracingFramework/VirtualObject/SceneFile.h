@@ -0,0 +1,50 @@
+/**
+	CLASS: SceneFile
+	DESCRIPTION: Loads a scene described in a text file, so the same scene can be rendered by several processes (e.g. distributed rendering workers)
+	without recompiling. One statement per line ('#' starts a comment):
+		image <width> <height>
+		camera <top> <bottom> <left> <right> <near> <far> [transforms]
+		material <name> [Ka <v>] [Kd <v>] [Ks <v>] [Kr <v>] [Kt <v>] [shininess <v>] [ior <v>] [diffuse <r g b>] [specular <r g b>] [emissive <r g b>]
+			[diffuseTexture <tiled file>] [specularTexture <tiled file>]
+		sphere <radius> <material> [transforms]
+		plane <px py pz> <nx ny nz> <material> [textureSize <v>] [transforms]
+		triangle <ax ay az> <bx by bz> <cx cy cz> <material> [transforms]
+		box <min x y z> <max x y z> <material> [transforms]
+		directionalLight <dx dy dz> [colour <r g b>] [angularRadius <degrees>]
+		key <frame> [transforms]
+	Transforms (applied in the order they appear): translate <x y z>, rotate <degrees> <axis x y z>, scale <x y z>.
+	Each object gets its own copy of the named material. All objects are created as children of the root node of the scene.
+	Animation: key gives the transform at frame of the object (or camera) of the last object (or camera) statement above it, e.g. several key lines after a sphere
+	(see Animation; the transform of the object statement itself is used while no frame is applied).
+*/
+#ifndef _SCENEFILE_RAYTRACINGFRAMEWORK
+#define _SCENEFILE_RAYTRACINGFRAMEWORK
+#include <RayTracingFramework\RayTracingPrerequisites.h>
+#include <string>
+#include <vector>
+
+namespace RayTracingFramework{
+	class Animation;
+
+	class SceneFile
+	{
+	public:
+		//Image and camera described in the file (the camera needs to be created by the caller, as it depends on the scene).
+		struct Settings {
+			int width, height;
+			float top, bottom, left, right, nearPlane, farPlane;
+			glm::mat4 cameraToWorld;
+			std::vector<float> cameraKeyFrames;			//Keys of the camera (cameraToWorld at each of these frames).
+			std::vector<glm::mat4> cameraKeys;
+			Settings() : width(600), height(600), top(1), bottom(-1), left(-1), right(1), nearPlane(1), farPlane(1000), cameraToWorld(1.0f) { ; }
+		};
+
+		/**
+			Creates the objects, materials and lights of the file in scene. Returns false if the file cannot be read or has an error
+			(error then describes it, with its line number; objects created before the error stay in the scene).
+			@param animation: Receives the keys of the objects (NULL: they are ignored). Camera keys go to settings.
+		*/
+		static bool load(const char* fileName, IScene& scene, Settings& settings, std::string* error = NULL, Animation* animation = NULL);
+	};
+};
+#endif
@@ -3,6 +3,26 @@
 #include "RayTracingFramework\VirtualObject\Camera\Camera.h"
 #include "RayTracingFramework\VirtualObject\IVirtualObject.h"
 #include "RayTracingFramework\ShadingModels\IShadingModel.h"
+#include "RayTracingFramework\ShadingModels\IrradianceCache.h"
+#include "RayTracingFramework\ShadingModels\PathTracingShadingModel.h"
+#include "RayTracingFramework\Rendering\WavefrontRenderer.h"
+#include "RayTracingFramework\Rendering\FrameBuffer.h"
+#include "RayTracingFramework\Rendering\TiledEXRWriter.h"
+#include "RayTracingFramework\Rendering\RenderCoordinator.h"
+#include "RayTracingFramework\Rendering\RenderWorker.h"
+#include "RayTracingFramework\Rendering\RenderServer.h"
+#include "RayTracingFramework\Rendering\ProgressiveRenderer.h"
+#include "RayTracingFramework\Sampling\Sampler.h"
+#include "RayTracingFramework\Rendering\RenderCheckpoint.h"
+#include "RayTracingFramework\Rendering\Denoiser.h"
+#include "RayTracingFramework\Rendering\PrimaryVisibilityBuffer.h"
+#include "RayTracingFramework\Rendering\AnimationRenderer.h"
+#include "RayTracingFramework\Rendering\TemporalReuseRenderer.h"
+#include "RayTracingFramework\VirtualObject\Animation.h"
+#include "RayTracingFramework\Profiling\Profiler.h"
+#include "RayTracingFramework\Profiling\MemoryReport.h"
+#include "RayTracingFramework\VirtualObject\SceneFile.h"
+#include "RayTracingFramework\VirtualObject\SceneCache.h"
 #include "RayTracingFramework\GeometricPrimitives\IGeometry.h"
 #include "RayTracingFramework\GeometricPrimitives\Plane.h"
 #include "RayTracingFramework\GeometricPrimitives\ISphere.h"
@@ -16,47 +36,372 @@
 #include "RayTracingFramework\Light\DirectionalLight.h"
 //Add your new types of lights here.
 //
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <chrono>
 
 using namespace cimg_library;
 
 //Create scene declaration.
 RayTracingFramework::IScene& createScene();				
+//Renders pixels [x0, x1) x [y0, y1), one primary ray per pixel, into frameBuffer.
+void renderPixels(RayTracingFramework::Camera& cam, int x0, int y0, int x1, int y1, RayTracingFramework::FrameBuffer& frameBuffer);
+//First hits of the primary rays of renderPixels (NULL -> they traverse the scene).
+RayTracingFramework::PrimaryVisibilityBuffer* primaryVisibility = NULL;
+//Distributed rendering worker: loads the scene file and renders the tiles the coordinator sends through connection.
+int runRenderWorker(const char* sceneFileName, int connection);
+//Render server: renders the jobs clients submit through the socket at socketPath, keeping their scenes loaded between jobs.
+int runRenderServer(const char* socketPath);
+//Client of a render server: submits one job (camera of the scene file) and waits until it is written.
+int submitRenderJob(const char* socketPath, const char* sceneFileName, const char* outputFileName, int width, int height, int samplesPerPixel, int priority);
+
+//Renders the tiles of the jobs of distributed rendering with renderPixels.
+//With an animation, it first moves the scene to the frame of the job (one job at a time, as RenderWorker does). Without it, whoever calls it moves the scene (e.g. AnimationRenderer).
+class PixelTileRenderer : public RayTracingFramework::ITileRenderer {
+	RayTracingFramework::Camera& cam;
+	RayTracingFramework::Animation* animation;
+	int currentFrame;
+	bool frameApplied;
+public:
+	PixelTileRenderer(RayTracingFramework::Camera& cam, RayTracingFramework::Animation* animation = NULL) : cam(cam), animation(animation), currentFrame(0), frameApplied(false) { ; }
+	virtual void renderTile(const RayTracingFramework::RenderJob& job, RayTracingFramework::FrameBuffer& frameBuffer) {
+		if (animation && !animation->isEmpty() && (!frameApplied || job.frame != currentFrame)) {
+			animation->applyFrame(RayTracingFramework::ISceneManager::instance(), (float)job.frame);
+			cam.prepareFrame();
+			RayTracingFramework::ISceneManager::instance().refitBVH();
+			currentFrame = job.frame;
+			frameApplied = true;
+		}
+		renderPixels(cam, job.x0, job.y0, job.x1, job.y1, frameBuffer);
+	}
+};
+
+//Shows the tiles returned by the workers as they arrive, and copies the finished frame into the frame buffer of main.
+class PreviewFrameListener : public RayTracingFramework::RenderCoordinator::IFrameListener {
+	RayTracingFramework::FrameBuffer& output;
+	RayTracingFramework::FrameBuffer::ToneMapping toneMapping;
+	CImg<unsigned char>& img;
+	CImgDisplay& disp;
+public:
+	PreviewFrameListener(RayTracingFramework::FrameBuffer& output, RayTracingFramework::FrameBuffer::ToneMapping toneMapping, CImg<unsigned char>& img, CImgDisplay& disp)
+		: output(output), toneMapping(toneMapping), img(img), disp(disp) { ; }
+	virtual void tileFinished(const RayTracingFramework::RenderJob& job, RayTracingFramework::FrameBuffer& frameBuffer) {
+		frameBuffer.toneMap(img, toneMapping, job.y0, job.y1);
+		disp.display(img);
+	}
+	virtual void frameFinished(int frame, RayTracingFramework::FrameBuffer& frameBuffer) {
+		std::vector<unsigned char> data;
+		frameBuffer.serialize(data);
+		output.accumulate(&data[0], data.size());
+	}
+};
+
+//Writes each frame of an animation to numbered BMP and EXR files (on the writer thread of AnimationRenderer), and keeps the last one in the frame buffer of main.
+class AnimationFrameWriter : public RayTracingFramework::AnimationRenderer::IFrameListener {
+	RayTracingFramework::FrameBuffer& output;
+	RayTracingFramework::FrameBuffer::ToneMapping toneMapping;
+	int lastFrame;
+public:
+	AnimationFrameWriter(RayTracingFramework::FrameBuffer& output, RayTracingFramework::FrameBuffer::ToneMapping toneMapping, int lastFrame)
+		: output(output), toneMapping(toneMapping), lastFrame(lastFrame) { ; }
+	virtual void prepareFrame(int frame) {
+		//The visibility buffer is a snapshot of the previous frame.
+		if (primaryVisibility)
+			primaryVisibility->build();
+	}
+	virtual void frameFinished(int frame, RayTracingFramework::FrameBuffer& frameBuffer) {
+		CImg<unsigned char> image(frameBuffer.getWidth(), frameBuffer.getHeight(), 1, 3);
+		image.fill((const unsigned char)15);
+		frameBuffer.toneMap(image, toneMapping);
+		char fileName[64];
+		sprintf(fileName, "rayTracingResult_%04d.bmp", frame);
+		image.save(fileName);
+		sprintf(fileName, "rayTracingResult_%04d.exr", frame);
+		frameBuffer.writeEXR(fileName, RayTracingFramework::FrameBuffer::EXR_RLE_COMPRESSION);
+		printf("Frame %d written.\n", frame);
+		if (frame == lastFrame) {
+			std::vector<unsigned char> data;
+			frameBuffer.serialize(data);
+			output.accumulate(&data[0], data.size());
+		}
+	}
+};
 
 /*
  * MAIN
  * Run entire program:
+ * - Create scene (from a scene file, if one is given on the command line).
  * - Create image.
- * - Create scene.
  * - Define camera.
  * - Perform raytracing.
  * - Save image & display.
  */
 int main(int arg, char **argv)
 {
+	//Worker process of distributed rendering (started by the coordinator below).
+	if (arg == 4 && !strcmp(argv[1], "--render-worker"))
+		return runRenderWorker(argv[2], atoi(argv[3]));
+	//Render server (POSIX only): --render-server <socket>. Jobs are submitted with --render-submit <socket> <scene file> <output file> [width height [samples [priority]]],
+	//and --render-shutdown <socket> stops it.
+	if (arg == 3 && !strcmp(argv[1], "--render-server"))
+		return runRenderServer(argv[2]);
+	if (arg >= 5 && !strcmp(argv[1], "--render-submit"))
+		return submitRenderJob(argv[2], argv[3], argv[4], arg > 6 ? atoi(argv[5]) : 0, arg > 6 ? atoi(argv[6]) : 0, arg > 7 ? atoi(argv[7]) : 1, arg > 8 ? atoi(argv[8]) : 0);
+	if (arg == 3 && !strcmp(argv[1], "--render-shutdown")) {
+		int connection = RayTracingFramework::RenderServer::connect(argv[2]);
+		return (connection >= 0 && RayTracingFramework::RenderWorker::sendMessage(connection, RayTracingFramework::RenderWorker::MESSAGE_SHUTDOWN, NULL, 0)) ? 0 : 1;
+	}
+
+	//Create scene: from the scene file given on the command line (e.g. scenes/default.scene), or createScene() otherwise.
+	const char* sceneFileName = (arg > 1) ? argv[1] : NULL;
+	RayTracingFramework::SceneFile::Settings sceneSettings;	//Defaults: the image and camera used with createScene().
+	RayTracingFramework::Animation animation;				//Keys of the scene file (see useAnimation).
+	if (sceneFileName) {
+		std::string error;
+		if (!RayTracingFramework::SceneFile::load(sceneFileName, RayTracingFramework::ISceneManager::instance(), sceneSettings, &error, &animation)) {
+			printf("%s\n", error.c_str());
+			return 1;
+		}
+	}
+	else
+		createScene();
+	RayTracingFramework::IScene& scene = RayTracingFramework::ISceneManager::instance();
+
+	//Size of the image.
+	int imageWidth = sceneSettings.width, imageHeight = sceneSettings.height;
+
+	//Optional: indirect lighting (global illumination) from an irradiance cache, instead of a constant ambient light level.
+	bool useIrradianceCache = false;
+	RayTracingFramework::IrradianceCache irradianceCache;
+	if (useIrradianceCache)
+		scene.getShadingModel().setIrradianceCache(&irradianceCache);
+	//Optional: physically based path tracing instead of the default (Whitted style) shading model.
+	bool usePathTracing = false;
+	if (usePathTracing)
+		RayTracingFramework::ISceneManager::instance().setShadingModel(new RayTracingFramework::PathTracingShadingModel());
+	//Optional: breadth-first (wavefront) rendering, for the default shading model.
+	bool useWavefrontRenderer = false;
+	//Optional: stream finished tiles to a tiled EXR file instead of keeping the whole image in memory (for very large images).
+	//Only one tile is in memory at a time, and an interrupted render resumes from the tiles already in the file.
+	bool useStreamingOutput = false;
+	//Optional: render with worker processes on this machine, each loading its own copy of the scene file (so it needs one).
+	//Workers render with renderPixels and the default shading model. POSIX only: otherwise rendering stays in this process.
+	bool useDistributedRendering = false;
+	int numWorkers = 4;
+	//Optional: progressive rendering (many jittered samples per pixel, e.g. for path tracing), in several threads. Its state is saved
+	//to a checkpoint file regularly (in the background): if the program is killed, the next run resumes from it with identical results.
+	bool useProgressiveRendering = false;
+	int numPasses = 64;
+	double checkpointInterval = 60.0;	//Seconds.
+	RayTracingFramework::Sampler::Sequence sampleSequence = RayTracingFramework::Sampler::SEQUENCE_SOBOL;	//Or SEQUENCE_BLUE_NOISE (smoother at few passes), SEQUENCE_RANDOM.
+	//Optional: denoise the image once rendered, guided by its AOVs (e.g. a few progressive passes of path tracing instead of hundreds).
+	bool useDenoiser = false;
+	//Optional: profile the render (in this process). Writes where the time went as collapsed stacks (for flame graph tools), and the time of each tile as a heat map.
+	bool useProfiler = false;
+	RayTracingFramework::Profiler::setEnabled(useProfiler);
+	//Optional: primary rays take their first hit from a rasterised object ID/depth buffer, verified against the object of their pixel only
+	//(they traverse the scene when another object could be closer). Pinhole cameras only.
+	bool usePrimaryVisibilityBuffer = false;
+	//Optional: render the frames of the keys of the scene file (e.g. scenes/animation.scene) to numbered BMP/EXR files. The scene, its BVH (refit for each frame),
+	//caches and worker threads are reused from frame to frame, and each frame is written while the next one renders.
+	bool useAnimation = false;
+	int numAnimationThreads = 0;	//0 -> one per hardware thread.
+	//Optional (with useAnimation): while only the camera moves, pixels reuse the shadow and diffuse terms of the previous frame (reprojected with its depth and object IDs),
+	//and only trace them again where new surfaces appear. Default shading model only.
+	bool useTemporalReuse = false;
+	//Optional: print the memory used by the scene (nodes, geometry, materials, BVH, textures) and the framebuffer, once rendered.
+	//Build with RAYTRACINGFRAMEWORK_COMPACT_STORAGE defined to store matrices, normals and BVH boxes in compact formats (see CompactStorage.h).
+	bool useMemoryReport = false;
+
 	//Create image: params -> (width, height, bytes per colour channel, number of colour channels)
-	int imageWidth = 600, imageHeight = 600;
-	CImg<unsigned char> img = CImg<unsigned char>(imageWidth, imageHeight, 1, 3);
+	//(Not when streaming: the image is only in the tiled EXR file, and there is no window.)
+	CImg<unsigned char> img = CImg<unsigned char>(useStreamingOutput ? 0 : imageWidth, useStreamingOutput ? 0 : imageHeight, 1, 3);
 	//Fill with grey.
 	img.fill((const unsigned char)15);
 	//Display image in window.
 	CImgDisplay disp(img, "Ray tracing output", false);
-	
-	//Create scene.
-	RayTracingFramework::IScene& scene = createScene();
 
 	//Define Camera.
 	//Create camera using fields top, bottom, left, right, near and far
-	RayTracingFramework::Camera cam(scene, imageWidth, imageHeight, 1, -1, -1, 1, 1, 1000);								
+	RayTracingFramework::Camera cam(scene, imageWidth, imageHeight, sceneSettings.top, sceneSettings.bottom, sceneSettings.left, sceneSettings.right, sceneSettings.nearPlane, sceneSettings.farPlane);
+	cam.setLocalToParent(sceneSettings.cameraToWorld);
+	for (size_t k = 0; k < sceneSettings.cameraKeys.size(); k++)
+		animation.addKey(cam, sceneSettings.cameraKeyFrames[k], sceneSettings.cameraKeys[k]);
+	//Texture lookups filter the area seen by each pixel.
+	scene.getShadingModel().setPixelSpreadAngle(cam.getPixelSpreadAngle());
+	//Bounding volume hierarchy over the objects (it must be built again if objects are moved before rendering).
+	RayTracingFramework::ISceneManager::instance().buildBVH();
+	RayTracingFramework::PrimaryVisibilityBuffer visibilityBuffer(scene, cam);
+	if (usePrimaryVisibilityBuffer && visibilityBuffer.build())
+		primaryVisibility = &visibilityBuffer;
+
+	//HDR framebuffer (with depth, normal, object ID and albedo AOVs), and its conversion to 8 bits for display/BMP.
+	//(Not needed when streaming: each tile gets its own buffer.)
+	RayTracingFramework::FrameBuffer frameBuffer(useStreamingOutput ? 0 : imageWidth, useStreamingOutput ? 0 : imageHeight, true);
+	RayTracingFramework::FrameBuffer::ToneMapping toneMapping;	//Clamp, as the original output. E.g. ToneMapping(FrameBuffer::TONEMAP_ACES, 0.5f, 2.2f)
 	
 	//Perform raytracing.
-	for (int r = 0; r < imageHeight; r++) {
-		for (int c = 0; c < imageWidth; c++) {
+	RayTracingFramework::RenderCoordinator coordinator(imageWidth, imageHeight, 64, true);
+	if (useDistributedRendering && sceneFileName && !useStreamingOutput) {
+		std::vector<std::string> workerArguments;
+		workerArguments.push_back("--render-worker");
+		workerArguments.push_back(sceneFileName);
+		std::string error;
+		if (coordinator.startWorkers(numWorkers, argv[0], workerArguments, &error) < numWorkers)
+			printf("%s\n", error.empty() ? "Not all render workers could be started." : error.c_str());
+	}
+	if (coordinator.getNumWorkers() > 0) {
+		PreviewFrameListener listener(frameBuffer, toneMapping, img, disp);
+		if (!coordinator.renderFrames(0, 0, listener))
+			printf("All render workers died.\n");
+		coordinator.stopWorkers();
+		frameBuffer.toneMap(img, toneMapping);
+		disp.display(img);
+	}
+	else if (useAnimation && !animation.isEmpty() && !useStreamingOutput) {
+		PixelTileRenderer pixelRenderer(cam);
+		RayTracingFramework::TemporalReuseRenderer temporalRenderer(scene, cam, &animation);
+		temporalRenderer.setPrimaryVisibility(primaryVisibility);
+		RayTracingFramework::ITileRenderer& renderer = useTemporalReuse ? (RayTracingFramework::ITileRenderer&)temporalRenderer : (RayTracingFramework::ITileRenderer&)pixelRenderer;
+		RayTracingFramework::AnimationRenderer animationRenderer(RayTracingFramework::ISceneManager::instance(), cam, animation, renderer, numAnimationThreads, 32, true);
+		int firstFrame = (int)std::ceil(animation.getFirstFrame()), lastFrame = (int)std::floor(animation.getLastFrame());
+		AnimationFrameWriter writer(frameBuffer, toneMapping, lastFrame);
+		animationRenderer.renderFrames(firstFrame, lastFrame, writer);
+		if (useTemporalReuse)
+			printf("Temporal reuse: %llu pixels reused, %llu traced.\n", temporalRenderer.getNumReused(), temporalRenderer.getNumTraced());
+		//Display the last frame.
+		frameBuffer.toneMap(img, toneMapping);
+		disp.display(img);
+	}
+	else if (useProgressiveRendering && !useStreamingOutput) {
+		RayTracingFramework::ProgressiveRenderer progressive(scene, cam, frameBuffer, 0, 0, sampleSequence);
+		progressive.setPrimaryVisibility(primaryVisibility);
+		RayTracingFramework::RenderCheckpoint checkpoint("rayTracingResult.checkpoint");
+		if (checkpoint.load(progressive))
+			printf("Resuming from pass %d.\n", progressive.getNumPasses());
+		std::chrono::steady_clock::time_point lastCheckpoint = std::chrono::steady_clock::now();
+		while (progressive.getNumPasses() < numPasses) {
+			progressive.renderPass();
+			//Update display after each pass.
+			frameBuffer.toneMap(img, toneMapping);
+			disp.display(img);
+			if (std::chrono::duration<double>(std::chrono::steady_clock::now() - lastCheckpoint).count() > checkpointInterval && checkpoint.save(progressive))
+				lastCheckpoint = std::chrono::steady_clock::now();
+		}
+		//Finished: the checkpoint is not needed any more.
+		checkpoint.remove();
+	}
+	else if (useStreamingOutput) {
+		RayTracingFramework::TiledEXRWriter writer(imageWidth, imageHeight, 64, 64, true);
+		if (!writer.open("rayTracingResult_tiled.exr")) {
+			printf("Cannot open rayTracingResult_tiled.exr.\n");
+			return 1;
+		}
+		RayTracingFramework::WavefrontRenderer wavefront(scene, cam);
+		wavefront.setPrimaryVisibility(primaryVisibility);
+		for (int tileY = 0; tileY < writer.getNumTilesY(); tileY++) {
+			for (int tileX = 0; tileX < writer.getNumTilesX(); tileX++) {
+				//Skip tiles written by an earlier (interrupted) run.
+				if (writer.isTileWritten(tileX, tileY))
+					continue;
+				int x0, y0, x1, y1;
+				writer.getTileBounds(tileX, tileY, x0, y0, x1, y1);
+				RayTracingFramework::FrameBuffer tile(x1 - x0, y1 - y0, true, x0, y0);
+				if (useWavefrontRenderer)
+					wavefront.renderTile(x0, y0, x1, y1, tile);
+				else
+					renderPixels(cam, x0, y0, x1, y1, tile);
+				//Stop at the first tile that cannot be written (e.g. disk full): the next run resumes from the tiles already in the file.
+				if (!writer.writeTile(tileX, tileY, tile)) {
+					printf("Cannot write tile (%d, %d) to rayTracingResult_tiled.exr.\n", tileX, tileY);
+					return 1;
+				}
+			}
+			printf("Rows of tiles written: %d/%d\n", tileY + 1, writer.getNumTilesY());
+		}
+	}
+	else if (useWavefrontRenderer) {
+		//Breadth-first renderer: rays are traced in batches, one tile at a time.
+		RayTracingFramework::WavefrontRenderer wavefront(scene, cam);
+		wavefront.setPrimaryVisibility(primaryVisibility);
+		int tileSize = 32;
+		for (int y = 0; y < imageHeight; y += tileSize) {
+			for (int x = 0; x < imageWidth; x += tileSize)
+				wavefront.renderTile(x, y, glm::min(x + tileSize, imageWidth), glm::min(y + tileSize, imageHeight), frameBuffer);
+			//Update display each time a row of tiles is rendered.
+			frameBuffer.toneMap(img, toneMapping, y, glm::min(y + tileSize, imageHeight));
+			disp.display(img);
+		}
+	}
+	else {
+		for (int r = 0; r < imageHeight; r++) {
+			renderPixels(cam, 0, r, imageWidth, r + 1, frameBuffer);
+			//Update display each time row is rendered.
+			frameBuffer.toneMap(img, toneMapping, r, r + 1);
+			disp.display(img);
+		}
+	}
+
+	if (useProfiler) {
+		RayTracingFramework::Profiler::setEnabled(false);
+		RayTracingFramework::Profiler::writeCollapsedStacks("rayTracingProfile.txt", &scene);
+		RayTracingFramework::Profiler::writeTileTimes("rayTracingTileTimes.bmp", imageWidth, imageHeight);
+	}
+
+	if (useMemoryReport) {
+		RayTracingFramework::MemoryReport memoryReport;
+		memoryReport.addScene(RayTracingFramework::ISceneManager::instance());
+		memoryReport.addFrameBuffer(frameBuffer);
+		memoryReport.write();
+	}
+
+	if (useDenoiser && !useStreamingOutput) {
+		RayTracingFramework::Denoiser denoiser;
+		denoiser.denoise(frameBuffer);
+		frameBuffer.toneMap(img, toneMapping);
+		disp.display(img);
+	}
+	
+	//Save image to file and display in window for 30 seconds.
+	//HDR outputs (colour + AOVs). When streaming, they are already in rayTracingResult_tiled.exr.
+	if (!useStreamingOutput) {
+		img.save("rayTracingResult.bmp");
+		frameBuffer.writeEXR("rayTracingResult.exr", RayTracingFramework::FrameBuffer::EXR_RLE_COMPRESSION);
+		frameBuffer.writePFM("rayTracingResult.pfm");
+	}
+	while (!disp.is_closed())
+		disp.display(img).wait(30);
+
+	return 0;
+}
+
+/*
+ * RENDER PIXELS
+ * - Creates a single primary ray per pixel.
+ * - Tests collisions & computes the shaded colour of the closest one.
+ * - Accumulates the colour & AOVs of the pixel in the frame buffer.
+ */
+void renderPixels(RayTracingFramework::Camera& cam, int x0, int y0, int x1, int y1, RayTracingFramework::FrameBuffer& frameBuffer) {
+	PROFILE_SCOPE("renderPixels");
+	RayTracingFramework::Profiler::TileTimer tileTimer(x0, y0, x1, y1);
+	//Sample values (soft shadows, path tracing) depend on the pixel only, so tiles give the same pixels whichever worker renders them.
+	RayTracingFramework::Sampler sampler;
+	RayTracingFramework::Sampler* previousSampler = &RayTracingFramework::Sampler::getThreadSampler();
+	RayTracingFramework::Sampler::setThreadSampler(&sampler);
+	for (int r = y0; r < y1; r++) {
+		for (int c = x0; c < x1; c++) {
 			//Create a single ray per pixel.
 			RayTracingFramework::Ray ray = cam.createPrimaryRay(c, r);
+			sampler.startSample(c, r, 0);
 
 			//Test collisions.
-			RayTracingFramework::ISceneManager::instance().getRootNode().testCollision(ray, glm::mat4(1.0f));
-			
+			if (primaryVisibility)
+				primaryVisibility->intersect(ray, c, r);
+			else
+				RayTracingFramework::ISceneManager::instance().intersect(ray);
+		
 			//Check there are any valid collisions.
 			//Discard collisions behind camera.
 			while (ray.getClosestIntersection().t_distance < 0) ray.discardClosestIntersection();
@@ -70,21 +415,95 @@ int main(int arg, char **argv)
 			RayTracingFramework::IScene& scene = (RayTracingFramework::IScene&)RayTracingFramework::ISceneManager::instance();
 			RayTracingFramework::Colour shadedColour = scene.getShadingModel().computeShading(ray, scene, 0);
 
-			//Assign the computed colour to the pixel in the output image.
-			img(c, r, 0) = (unsigned char)((shadedColour.r <= 1 ? shadedColour.r : 1) * 255);// (r % 256);
-			img(c, r, 1) = (unsigned char)((shadedColour.g <= 1 ? shadedColour.g : 1) * 255);
-			img(c, r, 2) = (unsigned char)((shadedColour.b <= 1 ? shadedColour.b : 1) * 255);
+			//Accumulate the computed colour (unclamped) and the AOVs of the pixel.
+			frameBuffer.addSample(c, r, shadedColour);
+			frameBuffer.setAOVs(c, r, ray, scene);
 		}
-		//Update display each time row is rendered.
-		disp.display(img);
 	}
-	
-	//Save image to file and display in window for 30 seconds.
-	img.save("rayTracingResult.bmp");
-	while (!disp.is_closed())
-		disp.display(img).wait(30);
+	RayTracingFramework::Sampler::setThreadSampler(previousSampler);
+}
 
-	return 0;
+/*
+ * RUN RENDER WORKER
+ * - Loads the scene file once.
+ * - Renders tiles for the coordinator until it closes the connection.
+ */
+int runRenderWorker(const char* sceneFileName, int connection) {
+	RayTracingFramework::SceneFile::Settings settings;
+	RayTracingFramework::Animation animation;	//Jobs render the frames of the keys of the scene file.
+	if (!RayTracingFramework::SceneFile::load(sceneFileName, RayTracingFramework::ISceneManager::instance(), settings, NULL, &animation))
+		return 1;
+	RayTracingFramework::IScene& scene = RayTracingFramework::ISceneManager::instance();
+	RayTracingFramework::Camera cam(scene, settings.width, settings.height, settings.top, settings.bottom, settings.left, settings.right, settings.nearPlane, settings.farPlane);
+	cam.setLocalToParent(settings.cameraToWorld);
+	for (size_t k = 0; k < settings.cameraKeys.size(); k++)
+		animation.addKey(cam, settings.cameraKeyFrames[k], settings.cameraKeys[k]);
+	scene.getShadingModel().setPixelSpreadAngle(cam.getPixelSpreadAngle());
+	RayTracingFramework::ISceneManager::instance().buildBVH();
+	PixelTileRenderer renderer(cam, &animation);
+	return RayTracingFramework::RenderWorker::run(connection, renderer);
+}
+
+/*
+ * RUN RENDER SERVER
+ * - Keeps up to 1GB of scenes loaded (see SceneCache).
+ * - Renders the jobs of the clients, highest priority first, until a client asks it to shut down.
+ */
+int runRenderServer(const char* socketPath) {
+	RayTracingFramework::SceneCache scenes;
+	RayTracingFramework::RenderServer server(scenes);
+	printf("Render server listening on %s\n", socketPath);
+	int result = server.run(socketPath);
+	printf("Render server stopped: %llu jobs, %llu scene loads, %llu cache hits.\n", server.getNumFinishedJobs(), scenes.getNumLoads(), scenes.getNumHits());
+	return result;
+}
+
+/*
+ * SUBMIT RENDER JOB
+ * - Sends the job to the render server.
+ * - Prints its progress until the server says it is finished.
+ */
+int submitRenderJob(const char* socketPath, const char* sceneFileName, const char* outputFileName, int width, int height, int samplesPerPixel, int priority) {
+	int connection = RayTracingFramework::RenderServer::connect(socketPath);
+	if (connection < 0) {
+		printf("Cannot connect to the render server at %s\n", socketPath);
+		return 1;
+	}
+	RayTracingFramework::RenderServer::Job job;
+	memset(&job, 0, sizeof(job));
+	job.ID = 1;
+	job.priority = priority;
+	job.width = width;
+	job.height = height;
+	job.samplesPerPixel = samplesPerPixel;
+	job.useSceneCamera = 1;
+	strncpy(job.sceneFileName, sceneFileName, sizeof(job.sceneFileName) - 1);
+	strncpy(job.outputFileName, outputFileName, sizeof(job.outputFileName) - 1);
+	if (!RayTracingFramework::RenderWorker::sendMessage(connection, RayTracingFramework::RenderWorker::MESSAGE_SUBMIT, &job, sizeof(job)))
+		return 1;
+	RayTracingFramework::RenderWorker::MessageHeader header;
+	std::vector<unsigned char> payload;
+	while (RayTracingFramework::RenderWorker::receiveMessage(connection, header, payload)) {
+		if (header.type == RayTracingFramework::RenderWorker::MESSAGE_PROGRESS && header.size == sizeof(RayTracingFramework::RenderServer::Progress)) {
+			RayTracingFramework::RenderServer::Progress progress;
+			memcpy(&progress, &payload[0], sizeof(progress));
+			printf("\r%d/%d tiles", progress.tilesFinished, progress.numTiles);
+			fflush(stdout);
+		}
+		else if (header.type == RayTracingFramework::RenderWorker::MESSAGE_FINISHED && header.size == sizeof(RayTracingFramework::RenderServer::Result)) {
+			RayTracingFramework::RenderServer::Result result;
+			memcpy(&result, &payload[0], sizeof(result));
+			if (result.status != RayTracingFramework::RenderServer::STATUS_OK) {
+				printf("\nJob failed: %s\n", result.message);
+				return 1;
+			}
+			printf("\nWritten %s in %.2f s (scene %s).\n", outputFileName, result.seconds, result.sceneWasResident ? "already loaded" : "loaded");
+			return 0;
+		}
+		//(Tiles are not used here.)
+	}
+	printf("\nThe render server closed the connection.\n");
+	return 1;
 }
 
 /* 